@@ -0,0 +1,93 @@
+#ifndef HOST_BENCH_CYCLECOUNTER_H_
+#define HOST_BENCH_CYCLECOUNTER_H_
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+ * Compteur de cycles CPU (espace utilisateur) via perf_event_open.
+ *  Sans PMU (conteneur, VM), on se rabat sur le TSC en x86 : ce sont alors des cycles
+ *  de référence à fréquence fixe (isReferenceCycles() renvoie true), comparables entre eux
+ *  sur une même machine mais pas exactement égaux aux cycles coeur.
+ *  Sur la cible, le profiler de boucle compte déjà en cycles (DWT, voir util/LoopProfiler.h).
+ */
+class CycleCounter
+{
+public:
+    CycleCounter()
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        m_tscStart = 0;
+    }
+
+    ~CycleCounter()
+    {
+        if (m_fd >= 0)
+            close(m_fd);
+    }
+
+    bool isAvailable() const
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return true;
+#else
+        return m_fd >= 0;
+#endif
+    }
+
+    bool isReferenceCycles() const
+    {
+        return m_fd < 0;
+    }
+
+    void start()
+    {
+        if (m_fd >= 0)
+        {
+            ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+            return;
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        m_tscStart = __rdtsc();
+#endif
+    }
+
+    uint64_t stop()
+    {
+        if (m_fd >= 0)
+        {
+            ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t count = 0;
+            if (read(m_fd, &count, sizeof(count)) != sizeof(count))
+                return 0;
+            return count;
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc() - m_tscStart;
+#else
+        return 0;
+#endif
+    }
+
+private:
+    long m_fd;
+    uint64_t m_tscStart;
+};
+
+#endif /* HOST_BENCH_CYCLECOUNTER_H_ */
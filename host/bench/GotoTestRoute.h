@@ -0,0 +1,37 @@
+#ifndef HOST_BENCH_GOTOTESTROUTE_H_
+#define HOST_BENCH_GOTOTESTROUTE_H_
+
+#include "commandManager/CommandManager.h"
+#include "util/asservMath.h"
+
+/*
+ * Trajectoire de la commande shell "asserv gototest", partagée par les outils host.
+ *  Le robot part de (0, 0, 0) et y revient, orienté vers les X positifs.
+ */
+inline void addGotoTestRoute(CommandManager &commandManager)
+{
+    commandManager.addGoTo(200, 0);
+    commandManager.addGoTo(300, -50);
+    commandManager.addGoTo(400, 100);
+    commandManager.addGoTo(400, 300);
+    commandManager.addGoTo(0, 300);
+
+    commandManager.addGoTo(0, 0);
+    commandManager.addGoToAngle(100, 0);
+
+    commandManager.addGoToNoStop(200, 0);
+    commandManager.addGoToNoStop(300, -50);
+    commandManager.addGoToNoStop(400, 100);
+    commandManager.addGoToNoStop(400, 300);
+    commandManager.addGoToNoStop(0, 300);
+
+    commandManager.addGoTo(0, 0);
+    commandManager.addGoToAngle(100, 0);
+
+    commandManager.addStraightLine(300);
+    commandManager.addTurn(degToRad(90));
+    commandManager.addTurn(degToRad(-90));
+    commandManager.addStraightLine(-300);
+}
+
+#endif /* HOST_BENCH_GOTOTESTROUTE_H_ */
@@ -0,0 +1,66 @@
+#ifndef HOST_BENCH_INSTRUCTIONCOUNTER_H_
+#define HOST_BENCH_INSTRUCTIONCOUNTER_H_
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdint>
+
+/*
+ * Compteur d'instructions retirées (espace utilisateur) via perf_event_open.
+ *  Dans un conteneur ou une VM sans PMU, isAvailable() renvoie false et
+ *  les benchs n'affichent que le temps.
+ */
+class InstructionCounter
+{
+public:
+    InstructionCounter()
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    ~InstructionCounter()
+    {
+        if (m_fd >= 0)
+            close(m_fd);
+    }
+
+    bool isAvailable() const
+    {
+        return m_fd >= 0;
+    }
+
+    void start()
+    {
+        if (m_fd < 0)
+            return;
+        ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    uint64_t stop()
+    {
+        if (m_fd < 0)
+            return 0;
+        ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t count = 0;
+        if (read(m_fd, &count, sizeof(count)) != sizeof(count))
+            return 0;
+        return count;
+    }
+
+private:
+    long m_fd;
+};
+
+#endif /* HOST_BENCH_INSTRUCTIONCOUNTER_H_ */
@@ -0,0 +1,307 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <thread>
+
+#include "SimulatedRobot.h"
+#include "commandManager/CommandEventQueue.h"
+#include "USBStream.h"
+#include "util/asservMath.h"
+
+/*
+ * Évènements des commandes (CommandEventQueue) du robot ROBOT_NAME, sur robot simulé (voir host/sim/DiffDrivePlant.h).
+ *
+ *  - Enchaînement : le haut niveau n'envoie une commande qu'une fois la précédente terminée. Avec la ligne d'état
+ *    envoyée toutes les STATUS_PERIOD_S (asservPositionSerial avant les évènements), il l'apprend à la ligne suivante ;
+ *    avec les évènements, dès la mise à jour du CommandManager qui la termine. Durée du parcours et temps mort par commande.
+ *  - Arrêt d'urgence au milieu d'une file : la commande en cours est interrompue, les suivantes retirées, chacune avec son évènement,
+ *    par la boucle d'asserv et pas par le thread qui déclenche l'arrêt ; les commandes sont refusées jusqu'à la remise en marche.
+ *  - File pleine : push() n'attend pas, l'évènement est perdu et compté.
+ *  - Latence : un thread publie des évènements à la fréquence de la boucle de position, un autre les attend comme
+ *    asservPositionSerial (wait() puis pop()) : délai entre publication et réception.
+ *
+ *  Échoue si un évènement manque, est en double ou dans le désordre, si les évènements ne raccourcissent pas le parcours,
+ *  ou si la latence moyenne dépasse MAX_MEAN_LATENCY_US.
+ *
+ *  usage : commandEventBench [nombre d'évènements du test de latence]
+ */
+
+static constexpr double STATUS_PERIOD_S = 0.1;
+static constexpr double COMMAND_TIMEOUT_S = 30;
+static constexpr double MAX_MEAN_LATENCY_US = 10000;
+static constexpr uint32_t MAX_LATENCY_EVENTS = 4096;
+
+typedef enum
+{
+    move_straight, move_turn, move_goto
+} move_type_t;
+
+struct Move
+{
+    move_type_t type;
+    float a;    // distance (mm), angle (rad) ou X (mm)
+    float b;    // Y (mm) pour un goto
+};
+
+// Parcours envoyé commande par commande, depuis (0, 0, 0)
+static const Move s_route[] = {
+    { move_straight, 400, 0 },
+    { move_turn, float(M_PI / 2), 0 },
+    { move_goto, 400, 300 },
+    { move_goto, 0, 300 },
+    { move_goto, 0, 0 },
+    { move_turn, float(-M_PI / 2), 0 },
+    { move_straight, 200, 0 },
+    { move_straight, -200, 0 },
+};
+static constexpr uint8_t ROUTE_SIZE = sizeof(s_route) / sizeof(s_route[0]);
+
+static bool addMove(SimulatedRobot &robot, const Move &move)
+{
+    if (move.type == move_straight)
+        return robot.commandManager.addStraightLine(move.a);
+    if (move.type == move_turn)
+        return robot.commandManager.addTurn(move.a);
+    return robot.commandManager.addGoTo(move.a, move.b);
+}
+
+/*
+ * Vérifie l'évènement suivant de la file
+ */
+static bool expectEvent(CommandEventQueue &events, uint32_t commandId, CommandEvent::Type type)
+{
+    CommandEvent event;
+    if (!events.pop(&event))
+    {
+        printf("  missing event %d for command %u\n", type, (unsigned int) commandId);
+        return false;
+    }
+    if (event.commandId != commandId || event.type != type)
+    {
+        printf("  unexpected event %d for command %u, expected %d for command %u\n", event.type, (unsigned int) event.commandId,
+                type, (unsigned int) commandId);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Parcours commande par commande : le haut niveau attend la fin de chaque commande avant d'envoyer la suivante,
+ *  en lisant la ligne d'état toutes les STATUS_PERIOD_S, ou les évènements. Rend la durée du parcours, négative en cas d'erreur.
+ */
+static double runChainedRoute(bool useEvents, double *meanDeadTime_s, double *maxDeadTime_s)
+{
+    SimulatedRobot robot(simulatedPlantConfiguration());
+    CommandEventQueue &events = robot.commandManager.getEventQueue();
+
+    uint8_t sent = 0;
+    uint32_t lastId = 0;
+    bool completed = false;
+    bool ok = true;
+    double nextStatus_s = STATUS_PERIOD_S;
+    double completion_s = 0;
+    double sumDeadTime_s = 0;
+    *maxDeadTime_s = 0;
+
+    addMove(robot, s_route[sent++]);
+    lastId = robot.commandManager.getLastCommandId();
+    while (robot.plant.getTime_s() < COMMAND_TIMEOUT_S * ROUTE_SIZE)
+    {
+        robot.mainAsserv.loopIteration();
+        const double now = robot.plant.getTime_s();
+
+        // Les évènements sont vérifiés dans les deux cas, seul le mode évènements s'en sert pour enchaîner
+        bool done = false;
+        CommandEvent event;
+        while (events.pop(&event))
+        {
+            if (event.commandId != lastId || (event.type != CommandEvent::STARTED && event.type != CommandEvent::COMPLETED))
+                ok = false;
+            if (event.type == CommandEvent::COMPLETED)
+            {
+                completion_s = now;
+                done = true;
+            }
+        }
+
+        if (!useEvents)
+        {
+            // La ligne d'état ne montre que l'état de la file, à chaque période
+            if (now < nextStatus_s)
+                continue;
+            nextStatus_s += STATUS_PERIOD_S;
+            done = robot.isIdle();
+        }
+        if (!done)
+            continue;
+
+        sumDeadTime_s += now - completion_s;
+        if (now - completion_s > *maxDeadTime_s)
+            *maxDeadTime_s = now - completion_s;
+        if (sent == ROUTE_SIZE)
+        {
+            completed = true;
+            break;
+        }
+        addMove(robot, s_route[sent++]);
+        if (robot.commandManager.getLastCommandId() != lastId + 1)
+            ok = false;
+        lastId = robot.commandManager.getLastCommandId();
+    }
+
+    *meanDeadTime_s = sumDeadTime_s / ROUTE_SIZE;
+    return (completed && ok && events.getLostEvents() == 0) ? robot.plant.getTime_s() : -1;
+}
+
+/*
+ * Arrêt d'urgence pendant la deuxième commande d'une file de cinq, puis une commande après la reprise.
+ *  La file n'est vidée que par la boucle d'asserv, et les commandes sont refusées pendant l'arrêt d'urgence.
+ */
+static bool checkEmergencyStop()
+{
+    SimulatedRobot robot(simulatedPlantConfiguration());
+    CommandEventQueue &events = robot.commandManager.getEventQueue();
+
+    for (uint8_t i = 0; i < 5; i++)
+        robot.commandManager.addStraightLine(100);
+    while (robot.plant.getTime_s() < COMMAND_TIMEOUT_S && robot.commandManager.getPendingCommandCount() > 4)
+        robot.mainAsserv.loopIteration();
+    for (uint8_t i = 0; i < ASSERV_POSITION_DIVISOR * 10; i++)
+        robot.mainAsserv.loopIteration();
+
+    robot.mainAsserv.setEmergencyStop();
+    const bool deferred = robot.commandManager.getPendingCommandCount() == 4;
+    const bool rejected = !robot.commandManager.addStraightLine(50);
+    robot.mainAsserv.loopIteration();
+    robot.mainAsserv.resetEmergencyStop();
+    robot.commandManager.addStraightLine(-100);
+    const bool newId = robot.commandManager.getLastCommandId() == 6;
+    while (robot.plant.getTime_s() < 2 * COMMAND_TIMEOUT_S && !robot.isIdle())
+        robot.mainAsserv.loopIteration();
+
+    bool ok = expectEvent(events, 1, CommandEvent::STARTED) && expectEvent(events, 1, CommandEvent::COMPLETED)
+            && expectEvent(events, 2, CommandEvent::STARTED) && expectEvent(events, 2, CommandEvent::PREEMPTED)
+            && expectEvent(events, 3, CommandEvent::FLUSHED) && expectEvent(events, 4, CommandEvent::FLUSHED)
+            && expectEvent(events, 5, CommandEvent::FLUSHED)
+            && expectEvent(events, 6, CommandEvent::STARTED) && expectEvent(events, 6, CommandEvent::COMPLETED);
+    CommandEvent event;
+    ok = ok && deferred && rejected && newId && !events.pop(&event) && events.getLostEvents() == 0;
+
+    printf("  %-22s : started 1, completed 1, started 2, preempted 2, flushed 3..5 by the loop, then command 6 : %s\n",
+            "emergency stop", ok ? "ok" : "WRONG EVENTS");
+    return ok;
+}
+
+/*
+ * File pleine sans consommateur : push() rend false tout de suite, les évènements en trop sont comptés perdus
+ */
+static bool checkOverflow()
+{
+    CommandEventQueue events;
+    const uint32_t count = CommandEventQueue::DEPTH + 16;
+    uint32_t rejected = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t id = 1; id <= count; id++)
+    {
+        if (!events.push(id, CommandEvent::STARTED))
+            rejected++;
+        events.notify();
+    }
+    const double pushTime_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+
+    bool ok = rejected == count - CommandEventQueue::DEPTH && events.getLostEvents() == rejected;
+    for (uint32_t id = 1; id <= CommandEventQueue::DEPTH; id++)
+        ok = expectEvent(events, id, CommandEvent::STARTED) && ok;
+    CommandEvent event;
+    ok = ok && !events.pop(&event);
+
+    printf("  %-22s : %u events into %u slots, %u lost, %.1f ns per push + notify : %s\n", "full queue",
+            (unsigned int) count, CommandEventQueue::DEPTH, (unsigned int) events.getLostEvents(), pushTime_ns, ok ? "ok" : "WRONG");
+    return ok;
+}
+
+// Instant de publication de chaque évènement du test de latence, indexé par l'identifiant
+static std::chrono::steady_clock::time_point s_publishTimes[MAX_LATENCY_EVENTS + 1];
+
+static void publishEvents(CommandEventQueue *events, uint32_t count)
+{
+    const std::chrono::microseconds period(1000000 * ASSERV_POSITION_DIVISOR / ASSERV_THREAD_FREQUENCY);
+    for (uint32_t id = 1; id <= count; id++)
+    {
+        std::this_thread::sleep_for(period);
+        s_publishTimes[id] = std::chrono::steady_clock::now();
+        events->push(id, CommandEvent::COMPLETED);
+        events->notify();
+    }
+}
+
+/*
+ * Latence entre la publication par la boucle d'asserv et la réception par le thread d'envoi
+ */
+static bool checkLatency(uint32_t count)
+{
+    CommandEventQueue events;
+    std::thread producer(publishEvents, &events, count);
+
+    uint32_t expected = 1;
+    uint32_t errors = 0;
+    double sumLatency_us = 0;
+    double maxLatency_us = 0;
+    while (expected <= count)
+    {
+        events.wait(TIME_MS2I(100));
+        CommandEvent event;
+        while (events.pop(&event))
+        {
+            const double latency_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now()
+                    - s_publishTimes[event.commandId]).count();
+            if (event.commandId != expected)
+                errors++;
+            sumLatency_us += latency_us;
+            if (latency_us > maxLatency_us)
+                maxLatency_us = latency_us;
+            expected = event.commandId + 1;
+        }
+    }
+    producer.join();
+
+    const double meanLatency_us = sumLatency_us / count;
+    const bool ok = errors == 0 && events.getLostEvents() == 0 && meanLatency_us < MAX_MEAN_LATENCY_US;
+    printf("  %-22s : %u events, latency mean %.1f us, max %.1f us, %u errors, %u lost : %s\n", "latency", (unsigned int) count,
+            meanLatency_us, maxLatency_us, (unsigned int) errors, (unsigned int) events.getLostEvents(), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t latencyEvents = (argc > 1) ? atoi(argv[1]) : 500;
+    if (latencyEvents > MAX_LATENCY_EVENTS)
+        latencyEvents = MAX_LATENCY_EVENTS;
+
+    USBStream::init();
+
+    printf("%s : command events, position loop at %d Hz, status line every %.0f ms\n", ROBOT_NAME,
+            ASSERV_THREAD_FREQUENCY / ASSERV_POSITION_DIVISOR, STATUS_PERIOD_S * 1e3);
+
+    double pollingMeanDeadTime_s, pollingMaxDeadTime_s, eventMeanDeadTime_s, eventMaxDeadTime_s;
+    const double polling_s = runChainedRoute(false, &pollingMeanDeadTime_s, &pollingMaxDeadTime_s);
+    const double event_s = runChainedRoute(true, &eventMeanDeadTime_s, &eventMaxDeadTime_s);
+    printf("  %-22s : %u chained commands in %6.3f s, dead time by command mean %5.1f ms, max %5.1f ms\n", "status line polling",
+            ROUTE_SIZE, polling_s, pollingMeanDeadTime_s * 1e3, pollingMaxDeadTime_s * 1e3);
+    printf("  %-22s : %u chained commands in %6.3f s, dead time by command mean %5.1f ms, max %5.1f ms, %.3f s saved\n", "events",
+            ROUTE_SIZE, event_s, eventMeanDeadTime_s * 1e3, eventMaxDeadTime_s * 1e3, polling_s - event_s);
+    bool ok = polling_s > 0 && event_s > 0 && event_s < polling_s;
+
+    ok = checkEmergencyStop() && ok;
+    ok = checkOverflow() && ok;
+    ok = checkLatency(latencyEvents) && ok;
+
+    if (!ok)
+    {
+        printf("%s : FAILED (events missing, duplicated or out of order, or no faster than status polling)\n", ROBOT_NAME);
+        return 1;
+    }
+    return 0;
+}
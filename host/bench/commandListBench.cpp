@@ -0,0 +1,262 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#include "commandManager/CommandList.h"
+#include "commandManager/CommandManager.h"
+#include "commandManager/Commands/Command.h"
+
+/*
+ * Banc host de la CommandList, file sans verrou entre le thread qui ajoute les commandes et la boucle d'asserv.
+ *
+ *  - Stress : un thread producteur construit et publie des commandes numérotées aussi vite que la file le permet,
+ *    le thread principal (consommateur) les lit, regarde les suivantes comme le LookAheadPlanner (get(), getSecond())
+ *    et les retire. Chaque commande doit arriver entière avec son identifiant, une seule fois et dans l'ordre, et être détruite une seule fois.
+ *    Compilé avec make TSAN_ENABLE=true, ThreadSanitizer signale en plus toute course entre les deux threads.
+ *  - Débit : push + pop sur un seul thread, puis entre les deux threads.
+ *  - Empreinte mémoire de la file du CommandManager (emplacements statiques à la taille de la plus grande commande).
+ *
+ *  usage : commandListBench [nombre de commandes]
+ */
+
+static constexpr uint8_t LIST_SIZE = 32;
+static constexpr uint8_t PAYLOAD_SIZE = 8;
+
+// Commandes construites et détruites : chaque commande de la file doit être détruite une fois, par pop() ou flush()
+static std::atomic<uint32_t> constructed(0);
+static std::atomic<uint32_t> destroyed(0);
+
+/*
+ * Commande qui ne porte que son numéro, recopié dans une charge utile pour détecter une publication partielle
+ */
+class SequenceCommand final : public Command
+{
+public:
+    explicit SequenceCommand(uint32_t sequence) :
+            m_sequence(sequence)
+    {
+        for (uint8_t i = 0; i < PAYLOAD_SIZE; i++)
+            m_payload[i] = sequence * (i + 1);
+        constructed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    virtual ~SequenceCommand()
+    {
+        destroyed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    virtual void computeInitialConsign(float, float, float, float *, float *, const Regulator &, const Regulator &) override
+    {
+    }
+    virtual void updateConsign(float, float, float, float *, float *, const Regulator &, const Regulator &, float) override
+    {
+    }
+    virtual bool isGoalReached(float, float, float, const Regulator &, const Regulator &, const Command*) override
+    {
+        return true;
+    }
+    virtual bool noStop() const override
+    {
+        return false;
+    }
+
+    uint32_t getSequence() const
+    {
+        return m_sequence;
+    }
+
+    bool isIntact() const
+    {
+        for (uint8_t i = 0; i < PAYLOAD_SIZE; i++)
+        {
+            if (m_payload[i] != m_sequence * (i + 1))
+                return false;
+        }
+        return true;
+    }
+
+private:
+    uint32_t m_sequence;
+    uint32_t m_payload[PAYLOAD_SIZE];
+};
+
+typedef CommandList<LIST_SIZE, SequenceCommand> SequenceList;
+
+static void produce(SequenceList *list, uint32_t count)
+{
+    for (uint32_t sequence = 0; sequence < count; sequence++)
+    {
+        while (!list->push<SequenceCommand>(sequence + 1, sequence))
+            std::this_thread::yield();
+    }
+}
+
+static bool checkDestroyed(const char *name)
+{
+    const uint32_t alive = constructed.load() - destroyed.load();
+    if (alive != 0)
+        printf("%-10s : %u commands not destroyed\n", name, (unsigned int) alive);
+    return alive == 0;
+}
+
+static bool stress(uint32_t count)
+{
+    SequenceList list;
+    std::thread producer(produce, &list, count);
+
+    uint32_t expected = 0;
+    uint32_t errors = 0;
+    uint32_t peeks = 0;
+    uint32_t maxSize = 0;
+    while (expected < count)
+    {
+        SequenceCommand *first = static_cast<SequenceCommand*>(list.getFirst());
+        if (first == nullptr)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if (first->getSequence() != expected || first->getId() != expected + 1 || !first->isIntact())
+            errors++;
+
+        // Les commandes suivantes, comme les parcourt le LookAheadPlanner
+        uint8_t size = list.size();
+        if (size > maxSize)
+            maxSize = size;
+        if (size == 0 || size > LIST_SIZE)
+            errors++;
+        SequenceCommand const *second = static_cast<SequenceCommand const*>(list.getSecond());
+        if (second != nullptr && (second->getSequence() != expected + 1 || !second->isIntact()))
+            errors++;
+        for (uint8_t i = 2; i < size; i++)
+        {
+            SequenceCommand *cmd = static_cast<SequenceCommand*>(list.get(i));
+            if (cmd == nullptr || cmd->getSequence() != expected + i || !cmd->isIntact())
+                errors++;
+            peeks++;
+        }
+
+        list.pop();
+        expected++;
+    }
+    producer.join();
+
+    if (list.size() != 0 || list.getFirst() != nullptr || !checkDestroyed("stress"))
+        errors++;
+
+    printf("stress     : %u commands through a %u slots list, %u look-ahead reads, max size %u, %u errors\n",
+            (unsigned int) count, LIST_SIZE, (unsigned int) peeks, (unsigned int) maxSize, (unsigned int) errors);
+    return errors == 0;
+}
+
+static bool checkFullAndFlush()
+{
+    SequenceList list;
+    uint32_t errors = 0;
+
+    // Plusieurs tours de file : pleine à LIST_SIZE, vide après flush(), quelle que soit la position des index
+    for (uint32_t round = 0; round < 3 * LIST_SIZE; round++)
+    {
+        for (uint8_t i = 0; i < LIST_SIZE; i++)
+        {
+            if (!list.push<SequenceCommand>(i + 1, i))
+                errors++;
+        }
+        if (list.push<SequenceCommand>(LIST_SIZE + 1, LIST_SIZE) || list.size() != LIST_SIZE)
+            errors++;
+        SequenceCommand *last = static_cast<SequenceCommand*>(list.get(LIST_SIZE - 1));
+        if (last == nullptr || last->getSequence() != LIST_SIZE - 1u || list.get(LIST_SIZE) != nullptr)
+            errors++;
+
+        // Décale les index d'un cran à chaque tour
+        for (uint32_t i = 0; i <= round % LIST_SIZE; i++)
+            list.pop();
+        list.flush();
+        if (list.size() != 0 || list.getFirst() != nullptr || list.getSecond() != nullptr)
+            errors++;
+        for (uint32_t i = 0; i <= round % LIST_SIZE; i++)
+        {
+            list.push<SequenceCommand>(i + 1, i);
+            list.pop();
+        }
+        if (!checkDestroyed("full/flush"))
+            errors++;
+    }
+
+    // Commandes encore dans la file à sa destruction
+    {
+        SequenceList remaining;
+        remaining.push<SequenceCommand>(1, 0);
+        remaining.push<SequenceCommand>(2, 1);
+    }
+    if (!checkDestroyed("full/flush"))
+        errors++;
+
+    printf("full/flush : %u rounds, %u errors\n", 3 * LIST_SIZE, (unsigned int) errors);
+    return errors == 0;
+}
+
+static void throughput(uint32_t count)
+{
+    SequenceList list;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t sequence = 0; sequence < count; sequence++)
+    {
+        list.push<SequenceCommand>(sequence + 1, sequence);
+        list.getFirst();
+        list.pop();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    printf("throughput : one thread  %.1f ns per push + pop (%.1f M commands/s)\n",
+            elapsed.count() / count, count / elapsed.count() * 1e3);
+
+    start = std::chrono::steady_clock::now();
+    std::thread producer(produce, &list, count);
+    uint32_t received = 0;
+    while (received < count)
+    {
+        if (list.getFirst() == nullptr)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        list.pop();
+        received++;
+    }
+    producer.join();
+    elapsed = std::chrono::steady_clock::now() - start;
+    printf("throughput : two threads %.1f ns per command (%.1f M commands/s)\n",
+            elapsed.count() / count, count / elapsed.count() * 1e3);
+}
+
+static void footprint()
+{
+    printf("footprint  : %u bytes by SequenceCommand slot, %u bytes for the %u slots list\n",
+            (unsigned int) SequenceList::SLOT_SIZE, (unsigned int) sizeof(SequenceList), LIST_SIZE);
+    printf("footprint  : CommandManager queue, %u slots of %u bytes, %u bytes\n", CommandManager::COMMAND_LIST_DEPTH,
+            (unsigned int) CommandManager::CommandQueue::SLOT_SIZE, (unsigned int) sizeof(CommandManager::CommandQueue));
+    printf("footprint  : CommandManager queue operations, %u priority slots, %u bytes\n", CommandManager::PRIORITY_SLOTS,
+            (unsigned int) (CommandManager::PRIORITY_SLOTS * sizeof(CommandManager::CommandQueue::Slot)));
+    printf("footprint  : CommandManager total %u bytes, budget %u bytes\n",
+            (unsigned int) CommandManager::QUEUE_FOOTPRINT, (unsigned int) CommandManager::MAX_QUEUE_FOOTPRINT);
+}
+
+int main(int argc, char **argv)
+{
+    const uint32_t count = (argc > 1) ? atoi(argv[1]) : 1000000;
+
+    bool ok = checkFullAndFlush();
+    ok = stress(count) && ok;
+    throughput(count);
+    footprint();
+
+    if (!ok)
+    {
+        printf("commandListBench : FAILED (commands lost, reordered or partially published)\n");
+        return 1;
+    }
+    return 0;
+}
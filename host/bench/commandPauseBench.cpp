@@ -0,0 +1,396 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include "SimulatedRobot.h"
+#include "commandManager/CommandEventQueue.h"
+#include "commandManager/SCurveProfile.h"
+#include "USBStream.h"
+#include "util/asservMath.h"
+
+/*
+ * Pause et reprise du CommandManager du robot ROBOT_NAME, sur robot simulé (voir host/sim/DiffDrivePlant.h).
+ *
+ *  Parcours : ligne droite de ROUTE_LINE_MM, quart de tour, ligne droite de ROUTE_LAST_MM. Il est interrompu pendant
+ *   la première ligne droite puis pendant la rotation, le robot reste arrêté HOLD_S, puis repart :
+ *  - par pause et reprise : freinage aux limites de distanceBrakeConf et angleBrakeConf, file gardée, la commande en cours reprend depuis la pose d'arrêt ;
+ *  - comme jusqu'ici : arrêt d'urgence (file vidée), reset, puis le haut niveau renvoie le reste du parcours,
+ *    calculé depuis la position du robot.
+ *  Pour chacun : distance et vitesse de recul au freinage, durée de la reprise jusqu'à la pleine vitesse
+ *   (FULL_SPEED_RATIO de la vitesse max du profil de distance) et jusqu'à la fin du parcours, octets envoyés sur la liaison
+ *   série pour repartir, et écart de la pose finale au parcours sans interruption.
+ *  - File pendant la pause : commande ajoutée en pause qui attend la reprise, commande en cours remplacée pendant la pause
+ *    (démarrée à la reprise, depuis la pose d'arrêt), arrêt d'urgence qui annule la pause.
+ *
+ *  Échoue si le freinage de la pause sort de ses limites ou recule, si un évènement de la file est publié
+ *   pendant la pause, si le parcours repris ne finit pas sur le parcours prévu, ou si la reprise est plus lente que le renvoi.
+ *
+ *  usage : commandPauseBench
+ */
+
+static constexpr double COMMAND_TIMEOUT_S = 30;
+static constexpr double HOLD_S = 0.5;                   // arrêt tenu avant de repartir, le temps que l'adversaire s'écarte
+static constexpr float STOPPED_SPEED_MM_PER_SEC = 5;    // vitesse des roues sous laquelle le robot est arrêté
+static constexpr float FULL_SPEED_RATIO = 0.9f;
+static constexpr float ROUTE_LINE_MM = 4000;
+static constexpr float ROUTE_TURN_RAD = float(M_PI / 2);
+static constexpr float ROUTE_LAST_MM = 600;
+static constexpr float BRAKE_DISTANCE_TOLERANCE = 0.3f; // écart relatif toléré à la distance de freinage du profil
+static constexpr float MAX_REVERSE_SPEED_MM_PER_SEC = 20;   // recul des roues toléré à la fin du freinage
+static constexpr float MAX_ROUTE_ERROR_MM = 2 * COMMAND_MANAGER_ARRIVAL_DISTANCE_THRESHOLD_mm; // chaque parcours finit dans la fenêtre d'arrivée
+static constexpr float MAX_ROUTE_ERROR_RAD = 0.01f;
+static constexpr double RESUME_TOLERANCE_S = 0.05;      // reprise au plus aussi lente que le renvoi, à ce délai près
+
+// Tours de boucle jusqu'à l'arrêt des roues, au moins un
+static void runUntilStopped(SimulatedRobot &robot)
+{
+    const double start_s = robot.plant.getTime_s();
+    do
+        robot.mainAsserv.loopIteration();
+    while (robot.plant.getTime_s() < start_s + COMMAND_TIMEOUT_S && !robot.isStopped(STOPPED_SPEED_MM_PER_SEC));
+}
+
+/*
+ * Interruption du parcours : pendant la première ligne droite une fois le robot à trigger mm en X,
+ *  ou pendant la rotation une fois le cap à trigger rad
+ */
+typedef enum
+{
+    interrupt_line, interrupt_turn
+} interruption_type_t;
+
+struct Interruption
+{
+    const char *name;
+    interruption_type_t type;
+    float trigger;
+};
+
+static const Interruption s_interruptions[] = {
+    { "straight line", interrupt_line, 800 },
+    { "turn", interrupt_turn, float(M_PI / 4) },
+};
+static constexpr uint8_t INTERRUPTION_COUNT = sizeof(s_interruptions) / sizeof(s_interruptions[0]);
+
+struct Pose
+{
+    float X_mm;
+    float Y_mm;
+    float theta_rad;
+};
+
+struct InterruptionResult
+{
+    float triggerSpeed;         // vitesse au moment de l'interruption, en mm/s ou rad/s
+    float brakeDistance;        // parcouru depuis l'interruption jusqu'à la reprise, en mm ou rad
+    float profileBrakeDistance; // distance de freinage du profil depuis triggerSpeed
+    float minSpeed;             // vitesse de roue la plus négative dans le sens du mouvement, jusqu'à la reprise
+    uint32_t holdEvents;        // évènements publiés entre l'interruption et la reprise
+    bool holdStatusOk;          // état et commandes en attente gardés pendant l'arrêt
+    double fullSpeed_s;         // de la reprise à la pleine vitesse, négatif si elle n'est pas atteinte
+    double routeEnd_s;          // de la reprise à la fin du parcours, négatif en cas d'échec
+    uint32_t bytesSent;         // octets envoyés par le haut niveau pour repartir
+    uint32_t droppedCommands;   // commandes interrompues ou retirées de la file
+    float finalError_mm;
+    float finalError_rad;
+};
+
+static void addRoute(CommandManager &commandManager)
+{
+    commandManager.addStraightLine(ROUTE_LINE_MM);
+    commandManager.addTurn(ROUTE_TURN_RAD);
+    commandManager.addStraightLine(ROUTE_LAST_MM);
+}
+
+static Pose runReference()
+{
+    SimulatedRobot robot(simulatedPlantConfiguration());
+    addRoute(robot.commandManager);
+    robot.runUntilIdle(COMMAND_TIMEOUT_S);
+    Pose pose = { float(robot.plant.getX_mm()), float(robot.plant.getY_mm()), float(robot.plant.getTheta_rad()) };
+    return pose;
+}
+
+// Vitesse de roue dans le sens du mouvement interrompu : avance, ou rotation à gauche
+static float progressSpeed(SimulatedRobot &robot, const Interruption &interruption)
+{
+    if (interruption.type == interrupt_line)
+        return 0.5f * (robot.plant.getRightGroundSpeed() + robot.plant.getLeftGroundSpeed());
+    return 0.5f * (robot.plant.getRightGroundSpeed() - robot.plant.getLeftGroundSpeed());
+}
+
+static float progress(SimulatedRobot &robot, const Interruption &interruption)
+{
+    if (interruption.type == interrupt_line)
+        return robot.plant.getX_mm();
+    return robot.plant.getTheta_rad();
+}
+
+static uint32_t drainEvents(CommandEventQueue &events, uint32_t *droppedCommands)
+{
+    uint32_t count = 0;
+    CommandEvent event;
+    while (events.pop(&event))
+    {
+        if (event.type == CommandEvent::PREEMPTED || event.type == CommandEvent::FLUSHED)
+            (*droppedCommands)++;
+        count++;
+    }
+    return count;
+}
+
+/*
+ * Reste du parcours renvoyé par le haut niveau après un arrêt d'urgence, depuis la pose donnée par l'odométrie.
+ *  Rend le nombre d'octets des commandes série correspondantes (reset de l'arrêt d'urgence compris).
+ */
+static uint32_t resendRoute(SimulatedRobot &robot, const Interruption &interruption)
+{
+    CommandManager &commandManager = robot.commandManager;
+    char line[32];
+    uint32_t bytes = snprintf(line, sizeof(line), "r\n");
+
+    if (interruption.type == interrupt_line)
+    {
+        const float remaining_mm = ROUTE_LINE_MM - robot.odometry.getX();
+        commandManager.addStraightLine(remaining_mm);
+        bytes += snprintf(line, sizeof(line), "v%.0f\n", remaining_mm);
+    }
+    const float turn_rad = ROUTE_TURN_RAD - robot.odometry.getTheta();
+    commandManager.addTurn(turn_rad);
+    bytes += snprintf(line, sizeof(line), "t%.1f\n", turn_rad * 180 / M_PI);
+    commandManager.addStraightLine(ROUTE_LAST_MM);
+    bytes += snprintf(line, sizeof(line), "v%.0f\n", ROUTE_LAST_MM);
+    return bytes;
+}
+
+static InterruptionResult runInterrupted(const Interruption &interruption, bool pause, const Pose &reference)
+{
+    SimulatedRobot robot(simulatedPlantConfiguration());
+    CommandManager &commandManager = robot.commandManager;
+    CommandEventQueue &events = commandManager.getEventQueue();
+    InterruptionResult result = { 0, 0, 0, 0, 0, false, -1, -1, 0, 0, 0, 0 };
+
+    addRoute(commandManager);
+    while (robot.plant.getTime_s() < COMMAND_TIMEOUT_S && progress(robot, interruption) < interruption.trigger)
+        robot.mainAsserv.loopIteration();
+    drainEvents(events, &result.droppedCommands);
+
+    const float start = progress(robot, interruption);
+    const uint8_t pendingCommands = commandManager.getPendingCommandCount();
+    result.triggerSpeed = progressSpeed(robot, interruption);
+    if (interruption.type == interrupt_line)
+        result.profileBrakeDistance = SCurveProfile::stoppingDistance(result.triggerSpeed, distanceBrakeConf);
+    else
+        result.profileBrakeDistance = SCurveProfile::stoppingDistance(result.triggerSpeed / (0.5f * ENCODERS_WHEELS_DISTANCE_MM), angleBrakeConf);
+    if (interruption.type == interrupt_turn)
+        result.triggerSpeed /= 0.5f * ENCODERS_WHEELS_DISTANCE_MM;
+
+    if (pause)
+        commandManager.pause();
+    else
+        robot.mainAsserv.setEmergencyStop();
+
+    // Freinage jusqu'à l'arrêt, puis arrêt tenu HOLD_S
+    const double trigger_s = robot.plant.getTime_s();
+    double stopped_s = -1;
+    while (robot.plant.getTime_s() < trigger_s + COMMAND_TIMEOUT_S && (stopped_s < 0 || robot.plant.getTime_s() < stopped_s + HOLD_S))
+    {
+        robot.mainAsserv.loopIteration();
+        result.minSpeed = fminf(result.minSpeed, progressSpeed(robot, interruption));
+        if (stopped_s < 0 && robot.isStopped(STOPPED_SPEED_MM_PER_SEC))
+            stopped_s = robot.plant.getTime_s();
+    }
+    result.brakeDistance = fabsf(progress(robot, interruption) - start);
+    result.holdEvents = drainEvents(events, &result.droppedCommands);
+    if (pause)
+        result.holdStatusOk = commandManager.getCommandStatus() == CommandManager::STATUS_PAUSED
+                && commandManager.getPendingCommandCount() == pendingCommands;
+    else
+        result.holdStatusOk = commandManager.getCommandStatus() == CommandManager::STATUS_HALTED;
+
+    const double resume_s = robot.plant.getTime_s();
+    if (pause)
+    {
+        commandManager.resume();
+        result.bytesSent = 2;   // "c\n"
+    }
+    else
+    {
+        robot.mainAsserv.resetEmergencyStop();
+        result.bytesSent = resendRoute(robot, interruption);
+    }
+
+    while (robot.plant.getTime_s() < resume_s + COMMAND_TIMEOUT_S && !robot.isIdle())
+    {
+        robot.mainAsserv.loopIteration();
+        if (result.fullSpeed_s < 0 && robot.getSpeed() >= FULL_SPEED_RATIO * distanceProfileConf.maxSpeed)
+            result.fullSpeed_s = robot.plant.getTime_s() - resume_s;
+    }
+    drainEvents(events, &result.droppedCommands);
+    if (!robot.isIdle())
+        return result;
+
+    result.routeEnd_s = robot.plant.getTime_s() - resume_s;
+    result.finalError_mm = hypot(robot.plant.getX_mm() - reference.X_mm, robot.plant.getY_mm() - reference.Y_mm);
+    result.finalError_rad = fabs(robot.plant.getTheta_rad() - reference.theta_rad);
+    return result;
+}
+
+static void printResult(const Interruption &interruption, const char *mode, const InterruptionResult &result)
+{
+    const bool line = interruption.type == interrupt_line;
+    const float unitScale = line ? 1 : float(180 / M_PI);
+    const char *unit = line ? "mm" : "deg";
+
+    printf("  %-14s %-17s: speed %6.2f %s/s, brake %6.1f %s (profile %6.1f), reverse %6.1f mm/s, full speed ",
+            interruption.name, mode, result.triggerSpeed * unitScale, unit, result.brakeDistance * unitScale, unit,
+            result.profileBrakeDistance * unitScale, result.minSpeed);
+    if (result.fullSpeed_s >= 0)
+        printf("after %5.3f s", result.fullSpeed_s);
+    else
+        printf("not reached  ");
+    printf(", route end after %5.3f s, %2u bytes sent, %u commands dropped, final error %4.1f mm %5.3f rad\n",
+            result.routeEnd_s, (unsigned int) result.bytesSent, (unsigned int) result.droppedCommands,
+            result.finalError_mm, result.finalError_rad);
+}
+
+static bool checkInterruption(const Interruption &interruption, const Pose &reference)
+{
+    const InterruptionResult paused = runInterrupted(interruption, true, reference);
+    const InterruptionResult resent = runInterrupted(interruption, false, reference);
+    printResult(interruption, "pause + resume", paused);
+    printResult(interruption, "emergency + resend", resent);
+
+    bool ok = paused.routeEnd_s > 0 && resent.routeEnd_s > 0;
+    ok = ok && paused.holdEvents == 0 && paused.holdStatusOk && paused.droppedCommands == 0;
+    ok = ok && paused.minSpeed > -MAX_REVERSE_SPEED_MM_PER_SEC
+            && fabsf(paused.brakeDistance - paused.profileBrakeDistance) <= BRAKE_DISTANCE_TOLERANCE * paused.profileBrakeDistance;
+    ok = ok && paused.finalError_mm <= MAX_ROUTE_ERROR_MM && paused.finalError_rad <= MAX_ROUTE_ERROR_RAD;
+    ok = ok && paused.routeEnd_s <= resent.routeEnd_s + RESUME_TOLERANCE_S;
+    if (resent.fullSpeed_s >= 0)
+        ok = ok && paused.fullSpeed_s >= 0 && paused.fullSpeed_s <= resent.fullSpeed_s + RESUME_TOLERANCE_S;
+    return ok;
+}
+
+/*
+ * Vérifie l'évènement suivant de la file
+ */
+static bool expectEvent(CommandEventQueue &events, uint32_t commandId, CommandEvent::Type type)
+{
+    CommandEvent event;
+    if (!events.pop(&event))
+    {
+        printf("  missing event %d for command %u\n", type, (unsigned int) commandId);
+        return false;
+    }
+    if (event.commandId != commandId || event.type != type)
+    {
+        printf("  unexpected event %d for command %u, expected %d for command %u\n", event.type, (unsigned int) event.commandId,
+                type, (unsigned int) commandId);
+        return false;
+    }
+    return true;
+}
+
+static bool expectNoEvent(CommandEventQueue &events)
+{
+    CommandEvent event;
+    if (!events.pop(&event))
+        return true;
+    printf("  unexpected event %d for command %u\n", event.type, (unsigned int) event.commandId);
+    return false;
+}
+
+/*
+ * Commande ajoutée en pause, commande en cours remplacée pendant la pause, arrêt d'urgence pendant la pause
+ */
+static bool checkPauseQueue()
+{
+    SimulatedRobot robot(simulatedPlantConfiguration());
+    CommandManager &commandManager = robot.commandManager;
+    CommandEventQueue &events = commandManager.getEventQueue();
+    bool ok = true;
+
+    // Ajoutée en pause : attend la reprise, le statut suit la boucle d'asservissement
+    commandManager.pause();
+    ok = commandManager.getCommandStatus() == CommandManager::STATUS_IDLE && ok;
+    // Robot neuf : la première mise à jour de position tombe après ASSERV_POSITION_DIVISOR tours de boucle
+    robot.runPositionUpdates(2);
+    ok = commandManager.getCommandStatus() == CommandManager::STATUS_PAUSED && ok;
+    commandManager.addStraightLine(200);
+    robot.runFor(HOLD_S);
+    ok = expectNoEvent(events) && fabs(robot.plant.getX_mm()) < 1 && ok;
+    ok = commandManager.getCommandStatus() == CommandManager::STATUS_PAUSED && commandManager.getPendingCommandCount() == 1 && ok;
+    commandManager.resume();
+    robot.runUntilIdle(COMMAND_TIMEOUT_S);
+    ok = expectEvent(events, 1, CommandEvent::STARTED) && expectEvent(events, 1, CommandEvent::COMPLETED) && ok;
+    ok = fabs(robot.plant.getX_mm() - 200) < MAX_ROUTE_ERROR_MM && ok;
+    printf("  %-22s : no motion until resumed : %s\n", "added while paused", ok ? "ok" : "FAILED");
+
+    // Remplacée pendant la pause : démarre à la reprise, depuis la pose d'arrêt, la file est gardée
+    bool replaceOk = true;
+    const double startX_mm = robot.plant.getX_mm();
+    commandManager.addStraightLine(1000);
+    commandManager.addStraightLine(300);
+    while (robot.plant.getX_mm() < startX_mm + 300)
+        robot.mainAsserv.loopIteration();
+    commandManager.pause();
+    robot.runPositionUpdates(2);
+    replaceOk = commandManager.addStraightLine(200, CommandManager::QUEUE_REPLACE_CURRENT) && replaceOk;
+    runUntilStopped(robot);
+    const double stopX_mm = robot.plant.getX_mm();
+    robot.runFor(HOLD_S);
+    replaceOk = fabs(robot.plant.getX_mm() - stopX_mm) < 1 && replaceOk;
+    replaceOk = expectEvent(events, 2, CommandEvent::STARTED) && expectEvent(events, 2, CommandEvent::PREEMPTED)
+            && expectEvent(events, 4, CommandEvent::STARTED) && expectNoEvent(events) && replaceOk;
+    commandManager.resume();
+    robot.runUntilIdle(COMMAND_TIMEOUT_S);
+    replaceOk = expectEvent(events, 4, CommandEvent::COMPLETED) && expectEvent(events, 3, CommandEvent::STARTED)
+            && expectEvent(events, 3, CommandEvent::COMPLETED) && replaceOk;
+    replaceOk = fabs(robot.plant.getX_mm() - (stopX_mm + 200 + 300)) < MAX_ROUTE_ERROR_MM && replaceOk;
+    printf("  %-22s : replacement started on resume from the stop pose, queue kept : %s\n", "replaced while paused",
+            replaceOk ? "ok" : "FAILED");
+
+    // Arrêt d'urgence pendant la pause : la file est vidée et la pause annulée
+    bool emergencyOk = true;
+    commandManager.addStraightLine(500);
+    commandManager.addStraightLine(500);
+    robot.runPositionUpdates(10);
+    commandManager.pause();
+    robot.runPositionUpdates(2);
+    robot.mainAsserv.setEmergencyStop();
+    emergencyOk = commandManager.getCommandStatus() == CommandManager::STATUS_HALTED && emergencyOk;
+    robot.runPositionUpdates(1);
+    robot.mainAsserv.resetEmergencyStop();
+    emergencyOk = commandManager.getCommandStatus() == CommandManager::STATUS_IDLE && commandManager.getPendingCommandCount() == 0 && emergencyOk;
+    emergencyOk = expectEvent(events, 5, CommandEvent::STARTED) && expectEvent(events, 5, CommandEvent::PREEMPTED)
+            && expectEvent(events, 6, CommandEvent::FLUSHED) && emergencyOk;
+    runUntilStopped(robot);
+    commandManager.addStraightLine(100);
+    robot.runUntilIdle(COMMAND_TIMEOUT_S);
+    emergencyOk = expectEvent(events, 7, CommandEvent::STARTED) && expectEvent(events, 7, CommandEvent::COMPLETED) && emergencyOk;
+    printf("  %-22s : queue flushed, pause cancelled : %s\n", "emergency while paused", emergencyOk ? "ok" : "FAILED");
+
+    return ok && replaceOk && emergencyOk;
+}
+
+int main()
+{
+    USBStream::init();
+
+    printf("%s : pause and resume, position loop at %d Hz, distance profile %.0f mm/s %.0f mm/s²\n", ROBOT_NAME,
+            ASSERV_THREAD_FREQUENCY / ASSERV_POSITION_DIVISOR, distanceProfileConf.maxSpeed, distanceProfileConf.maxAcceleration);
+
+    const Pose reference = runReference();
+    bool ok = true;
+    for (uint8_t i = 0; i < INTERRUPTION_COUNT; i++)
+        ok = checkInterruption(s_interruptions[i], reference) && ok;
+    ok = checkPauseQueue() && ok;
+
+    if (!ok)
+    {
+        printf("%s : FAILED (pause brakes outside the profile, drops commands, resumes off the route or slower than a resend)\n", ROBOT_NAME);
+        return 1;
+    }
+    return 0;
+}
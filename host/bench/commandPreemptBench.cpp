@@ -0,0 +1,363 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
+#include <atomic>
+
+#include "SimulatedRobot.h"
+#include "commandManager/CommandEventQueue.h"
+#include "USBStream.h"
+#include "util/asservMath.h"
+
+/*
+ * Opérations sur la file du CommandManager (remplacement de la commande en cours, insertion en tête, vidage de la file)
+ *  du robot ROBOT_NAME, sur robot simulé (voir host/sim/DiffDrivePlant.h).
+ *
+ *  - Changement de but en cours de mouvement, comme à la détection d'un adversaire : arrêt d'urgence, reprise et nouvelle
+ *    commande (seul moyen avant les opérations sur la file), face au remplacement de la commande en cours.
+ *    Pour un Goto puis pour une ligne droite à profil : vitesse minimale pendant la transition, durée jusqu'aux abords
+ *    du nouveau but (la convergence finale du régulateur est la même dans les deux cas) et jusqu'à la fin de la commande,
+ *    et délai entre l'opération et le démarrage de la nouvelle commande, en mises à jour de la boucle de position.
+ *  - Ordre d'exécution et évènements : insertion en tête, seconde opération refusée tant que la première n'est pas appliquée,
+ *    vidage de la file qui garde la commande en cours et les commandes ajoutées après lui.
+ *  - Stress : un thread poste ajouts et opérations au hasard pendant qu'un autre fait tourner le CommandManager.
+ *    Chaque commande acceptée doit finir une seule fois (terminée, interrompue ou retirée), après son démarrage
+ *    sauf si elle est retirée. Compilé avec make TSAN_ENABLE=true, ThreadSanitizer signale en plus toute course.
+ *
+ *  Échoue si le remplacement arrête le robot, n'est pas appliqué à la mise à jour suivante, n'arrive pas aux abords du but
+ *   avant l'arrêt d'urgence, ou si un évènement manque, est en double ou dans le désordre.
+ *
+ *  usage : commandPreemptBench [nombre d'opérations du stress]
+ */
+
+static constexpr double COMMAND_TIMEOUT_S = 30;
+static constexpr float REDIRECT_MIN_SPEED_RATIO = 0.3f;    // vitesse minimale du remplacement, rapportée à la vitesse au moment de l'opération
+static constexpr double REDIRECT_WINDOW_S = 0.2;            // durée de la transition où la vitesse minimale est relevée
+static constexpr float REDIRECT_NEAR_MM = 20;               // distance au nouveau but qui compte comme arrivée, hors convergence finale
+
+/*
+ * Changement de but : la première commande part de (0, 0, 0), la seconde la remplace une fois le robot à triggerX_mm
+ */
+typedef enum
+{
+    redirect_goto, redirect_straight
+} redirect_type_t;
+
+struct Redirect
+{
+    const char *name;
+    redirect_type_t type;
+    float first;        // X du Goto (Y nul) ou distance de la ligne droite, en mm
+    float triggerX_mm;
+    float secondX;      // X du Goto ou distance de la ligne droite, en mm
+    float secondY;      // Y du Goto
+};
+
+static const Redirect s_redirects[] = {
+    { "goto", redirect_goto, 1400, 500, 1200, 250 },
+    { "straight line", redirect_straight, 1400, 500, 400, 0 },
+};
+static constexpr uint8_t REDIRECT_COUNT = sizeof(s_redirects) / sizeof(s_redirects[0]);
+
+struct RedirectResult
+{
+    double duration_s;          // de l'opération jusqu'au nouveau but atteint, négatif en cas d'échec
+    double near_s;              // de l'opération jusqu'à REDIRECT_NEAR_MM du nouveau but, ou jusqu'au but atteint s'il s'arrête plus loin
+    float triggerSpeed;         // vitesse au moment de l'opération
+    float minSpeed;             // vitesse minimale pendant REDIRECT_WINDOW_S après l'opération
+    uint32_t startUpdates;      // mises à jour de la boucle de position jusqu'au démarrage de la seconde commande
+    float finalError_mm;        // distance au but du Goto, écart à la distance voulue pour la ligne droite
+};
+
+// Tours de boucle jusqu'à la fin de la mise à jour suivante de la boucle de position
+static bool addSecond(SimulatedRobot &robot, const Redirect &redirect, CommandManager::QueueMode mode)
+{
+    if (redirect.type == redirect_goto)
+        return robot.commandManager.addGoTo(redirect.secondX, redirect.secondY, mode);
+    return robot.commandManager.addStraightLine(redirect.secondX, mode);
+}
+
+static RedirectResult runRedirect(const Redirect &redirect, bool replace)
+{
+    SimulatedRobot robot(simulatedPlantConfiguration());
+    CommandEventQueue &events = robot.commandManager.getEventQueue();
+    RedirectResult result = { -1, -1, 0, 0, 0, 0 };
+
+    if (redirect.type == redirect_goto)
+        robot.commandManager.addGoTo(redirect.first, 0);
+    else
+        robot.commandManager.addStraightLine(redirect.first);
+    while (robot.plant.getTime_s() < COMMAND_TIMEOUT_S && robot.plant.getX_mm() < redirect.triggerX_mm)
+        robot.mainAsserv.loopIteration();
+
+    const double trigger_s = robot.plant.getTime_s();
+    result.triggerSpeed = robot.getSpeed();
+    result.minSpeed = result.triggerSpeed;
+
+    bool accepted;
+    if (replace)
+    {
+        accepted = addSecond(robot, redirect, CommandManager::QUEUE_REPLACE_CURRENT);
+    }
+    else
+    {
+        // Jusqu'ici : arrêt d'urgence vu par une mise à jour de la boucle de position, reprise, puis la nouvelle commande
+        robot.mainAsserv.setEmergencyStop();
+        robot.runPositionUpdates(1);
+        robot.mainAsserv.resetEmergencyStop();
+        accepted = addSecond(robot, redirect, CommandManager::QUEUE_APPEND);
+    }
+    const uint32_t secondId = robot.commandManager.getLastCommandId();
+
+    // But de la ligne droite : relatif à la position où elle démarre
+    float goalX_mm = redirect.secondX;
+    bool started = false;
+    bool completed = false;
+    uint32_t iterations = 0;
+    while (accepted && !completed && robot.plant.getTime_s() < trigger_s + COMMAND_TIMEOUT_S)
+    {
+        robot.mainAsserv.loopIteration();
+        iterations++;
+        if (robot.plant.getTime_s() < trigger_s + REDIRECT_WINDOW_S && robot.getSpeed() < result.minSpeed)
+            result.minSpeed = robot.getSpeed();
+
+        CommandEvent event;
+        while (events.pop(&event))
+        {
+            if (event.commandId != secondId)
+                continue;
+            if (event.type == CommandEvent::STARTED && !started)
+            {
+                started = true;
+                result.startUpdates = (iterations + ASSERV_POSITION_DIVISOR - 1) / ASSERV_POSITION_DIVISOR;
+                if (redirect.type == redirect_straight)
+                    goalX_mm = robot.plant.getX_mm() + redirect.secondX;
+            }
+            if (event.type == CommandEvent::COMPLETED)
+                completed = true;
+        }
+
+        if (started && result.near_s < 0
+                && hypot(robot.plant.getX_mm() - goalX_mm, robot.plant.getY_mm() - redirect.secondY) < REDIRECT_NEAR_MM)
+            result.near_s = robot.plant.getTime_s() - trigger_s;
+    }
+    if (!completed)
+        return result;
+
+    result.duration_s = robot.plant.getTime_s() - trigger_s;
+    if (result.near_s < 0)
+        result.near_s = result.duration_s;
+    result.finalError_mm = hypot(robot.plant.getX_mm() - goalX_mm, robot.plant.getY_mm() - redirect.secondY);
+    return result;
+}
+
+static bool checkRedirect(const Redirect &redirect)
+{
+    const RedirectResult emergency = runRedirect(redirect, false);
+    const RedirectResult replace = runRedirect(redirect, true);
+
+    printf("  %-14s emergency stop : %6.3f s near the new goal, %6.3f s to completion, speed %6.1f -> min %6.1f mm/s, started after %u updates, error %5.1f mm\n",
+            redirect.name, emergency.near_s, emergency.duration_s, emergency.triggerSpeed, emergency.minSpeed,
+            (unsigned int) emergency.startUpdates, emergency.finalError_mm);
+    printf("  %-14s replace        : %6.3f s near the new goal, %6.3f s to completion, speed %6.1f -> min %6.1f mm/s, started after %u updates, error %5.1f mm, %.3f s saved\n",
+            redirect.name, replace.near_s, replace.duration_s, replace.triggerSpeed, replace.minSpeed,
+            (unsigned int) replace.startUpdates, replace.finalError_mm, emergency.near_s - replace.near_s);
+
+    return emergency.duration_s > 0 && replace.duration_s > 0 && replace.near_s > 0 && replace.near_s < emergency.near_s
+            && replace.startUpdates <= 1 && replace.minSpeed > REDIRECT_MIN_SPEED_RATIO * replace.triggerSpeed;
+}
+
+/*
+ * Vérifie l'évènement suivant de la file
+ */
+static bool expectEvent(CommandEventQueue &events, uint32_t commandId, CommandEvent::Type type)
+{
+    CommandEvent event;
+    if (!events.pop(&event))
+    {
+        printf("  missing event %d for command %u\n", type, (unsigned int) commandId);
+        return false;
+    }
+    if (event.commandId != commandId || event.type != type)
+    {
+        printf("  unexpected event %d for command %u, expected %d for command %u\n", event.type, (unsigned int) event.commandId,
+                type, (unsigned int) commandId);
+        return false;
+    }
+    return true;
+}
+
+static void runUntilIdle(SimulatedRobot &robot)
+{
+    const double start_s = robot.plant.getTime_s();
+    while (robot.plant.getTime_s() < start_s + COMMAND_TIMEOUT_S && !robot.isIdle())
+        robot.mainAsserv.loopIteration();
+}
+
+
+/*
+ * Insertion en tête pendant la première de trois lignes droites, puis vidage de la file pendant la première de quatre
+ */
+static bool checkQueueOrder()
+{
+    SimulatedRobot robot(simulatedPlantConfiguration());
+    CommandManager &commandManager = robot.commandManager;
+    CommandEventQueue &events = commandManager.getEventQueue();
+    bool ok = true;
+
+    for (uint8_t i = 0; i < 3; i++)
+        commandManager.addStraightLine(100);
+    robot.runPositionUpdates(10);
+    ok = commandManager.addTurn(float(M_PI / 4), CommandManager::QUEUE_INSERT_HEAD) && ok;
+    ok = !commandManager.addTurn(float(-M_PI / 4), CommandManager::QUEUE_INSERT_HEAD) && ok;   // la précédente n'est pas appliquée
+    ok = !commandManager.clearPendingCommands() && ok;
+    robot.runPositionUpdates(1);
+    ok = commandManager.getPendingCommandCount() == 4 && ok;
+    runUntilIdle(robot);
+
+    ok = expectEvent(events, 1, CommandEvent::STARTED) && expectEvent(events, 1, CommandEvent::COMPLETED)
+            && expectEvent(events, 4, CommandEvent::STARTED) && expectEvent(events, 4, CommandEvent::COMPLETED)
+            && expectEvent(events, 2, CommandEvent::STARTED) && expectEvent(events, 2, CommandEvent::COMPLETED)
+            && expectEvent(events, 3, CommandEvent::STARTED) && expectEvent(events, 3, CommandEvent::COMPLETED) && ok;
+    const bool insertOk = ok;
+
+    // Identifiants 5 à 8, puis 9 ajouté après le vidage mais avant la mise à jour qui l'applique
+    for (uint8_t i = 0; i < 4; i++)
+        commandManager.addStraightLine(100);
+    robot.runPositionUpdates(10);
+    ok = commandManager.clearPendingCommands() && ok;
+    ok = commandManager.addStraightLine(-100) && ok;
+    robot.runPositionUpdates(1);
+    ok = commandManager.getPendingCommandCount() == 2 && ok;
+    runUntilIdle(robot);
+
+    ok = expectEvent(events, 5, CommandEvent::STARTED)
+            && expectEvent(events, 6, CommandEvent::FLUSHED) && expectEvent(events, 7, CommandEvent::FLUSHED)
+            && expectEvent(events, 8, CommandEvent::FLUSHED)
+            && expectEvent(events, 5, CommandEvent::COMPLETED)
+            && expectEvent(events, 9, CommandEvent::STARTED) && expectEvent(events, 9, CommandEvent::COMPLETED) && ok;
+    CommandEvent event;
+    ok = ok && !events.pop(&event) && events.getLostEvents() == 0;
+
+    printf("  %-22s : inserted command after the current one, second operation refused until applied : %s\n",
+            "insert at head", insertOk ? "ok" : "WRONG ORDER");
+    printf("  %-22s : current command kept, pending commands flushed, later command kept : %s\n",
+            "clear pending", ok ? "ok" : "WRONG EVENTS");
+    return ok;
+}
+
+/*
+ * Stress : ajouts et opérations postés depuis un thread, le CommandManager mis à jour par un autre.
+ *  Sans profil ni déplacement, chaque ligne droite ou rotation finit à la mise à jour qui suit son démarrage.
+ */
+static constexpr uint32_t MAX_STRESS_COMMANDS = 1 << 16;
+static uint8_t s_started[MAX_STRESS_COMMANDS + 1];
+static uint8_t s_finished[MAX_STRESS_COMMANDS + 1];
+static std::atomic<bool> s_producerDone(false);
+
+static void postOperations(CommandManager *commandManager, uint32_t count)
+{
+    uint32_t seed = 1;
+    uint32_t accepted = 0;
+    while (accepted < count && commandManager->getLastCommandId() < MAX_STRESS_COMMANDS)
+    {
+        seed = seed * 1103515245 + 12345;
+        const uint8_t choice = (seed >> 16) % 8;
+        bool ok;
+        if (choice < 4)
+            ok = commandManager->addStraightLine(10);
+        else if (choice == 4)
+            ok = commandManager->addTurn(0.1f, CommandManager::QUEUE_REPLACE_CURRENT);
+        else if (choice == 5)
+            ok = commandManager->addStraightLine(-10, CommandManager::QUEUE_INSERT_HEAD);
+        else
+            ok = choice == 6 && commandManager->clearPendingCommands();
+        if (ok)
+            accepted++;
+        else
+            std::this_thread::yield();
+    }
+    s_producerDone.store(true, std::memory_order_release);
+}
+
+static bool stress(uint32_t count)
+{
+    SimulatedRobot robot(simulatedPlantConfiguration());
+    CommandManager &commandManager = robot.commandManager;
+    CommandEventQueue &events = commandManager.getEventQueue();
+    commandManager.enableMotionProfile(false);
+    commandManager.enableLookAhead(false);
+
+    std::thread producer(postOperations, &commandManager, count);
+    uint32_t errors = 0;
+    uint32_t updates = 0;
+    uint32_t idleUpdates = 0;
+    while (idleUpdates < 4)
+    {
+        commandManager.update(0, 0, 0, 1.0f / (ASSERV_THREAD_FREQUENCY / ASSERV_POSITION_DIVISOR));
+        updates++;
+        const bool producerDone = s_producerDone.load(std::memory_order_acquire);
+
+        CommandEvent event;
+        while (events.pop(&event))
+        {
+            if (event.commandId == 0 || event.commandId > MAX_STRESS_COMMANDS || s_finished[event.commandId])
+            {
+                errors++;
+                continue;
+            }
+            if (event.type == CommandEvent::STARTED)
+            {
+                errors += s_started[event.commandId];
+                s_started[event.commandId] = 1;
+            }
+            else
+            {
+                // Retirée sans démarrer, ou terminée / interrompue après son démarrage
+                if ((event.type == CommandEvent::FLUSHED) == (s_started[event.commandId] != 0))
+                    errors++;
+                s_finished[event.commandId] = 1;
+            }
+        }
+
+        if (producerDone && robot.isIdle())
+            idleUpdates++;
+        else
+            std::this_thread::yield();
+    }
+    producer.join();
+
+    const uint32_t lastId = commandManager.getLastCommandId();
+    uint32_t unfinished = 0;
+    for (uint32_t id = 1; id <= lastId; id++)
+        unfinished += 1 - s_finished[id];
+    const bool ok = errors == 0 && unfinished == 0 && events.getLostEvents() == 0;
+    printf("  %-22s : %u commands and operations over %u updates, %u errors, %u unfinished, %u lost events : %s\n", "stress",
+            (unsigned int) lastId, (unsigned int) updates, (unsigned int) errors, (unsigned int) unfinished,
+            (unsigned int) events.getLostEvents(), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t count = (argc > 1) ? atoi(argv[1]) : 20000;
+    if (count > MAX_STRESS_COMMANDS)
+        count = MAX_STRESS_COMMANDS;
+
+    USBStream::init();
+
+    printf("%s : command queue operations, position loop at %d Hz\n", ROBOT_NAME, ASSERV_THREAD_FREQUENCY / ASSERV_POSITION_DIVISOR);
+
+    bool ok = true;
+    for (uint8_t i = 0; i < REDIRECT_COUNT; i++)
+        ok = checkRedirect(s_redirects[i]) && ok;
+    ok = checkQueueOrder() && ok;
+    ok = stress(count) && ok;
+
+    if (!ok)
+    {
+        printf("%s : FAILED (replacement stops the robot, is late or slower than an emergency stop, or wrong events)\n", ROBOT_NAME);
+        return 1;
+    }
+    return 0;
+}
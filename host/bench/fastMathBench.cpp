@@ -0,0 +1,232 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include "robotConfig.h"
+#include "Odometry.h"
+#include "commandManager/Commands/Goto.h"
+#include "util/fastMath.h"
+
+/*
+ * Banc host des approximations de util/fastMath.h pour le robot ROBOT_NAME.
+ *
+ *  - précision : chaque fonction est comparée à la libm en double sur un balayage dense de son domaine d'usage, le
+ *    banc échoue si l'erreur max dépasse la borne documentée (FAST_*_MAX_ERROR) ;
+ *  - vitesse : ns par appel, libm float et approximation (indicatif, le rapport sur Cortex-M4 est plus grand : pas
+ *    de sinf/atan2f vectorisés ni de FPU double) ;
+ *  - match : un match de 100s est rejoué dans Odometry avec des deltas quantifiés au tick codeur, contre une
+ *    intégration exacte des mêmes deltas en long double. L'écart de position en fin de match doit rester sous un
+ *    tick codeur, avec ou sans ENABLE_FAST_MATH (make FAST_MATH_ENABLE=true bench).
+ *
+ *  usage : fastMathBench [durée du match en s]
+ */
+
+#ifdef ENABLE_FAST_MATH
+static const char *mathMode = "fast math";
+#else
+static const char *mathMode = "libm";
+#endif
+
+static constexpr uint32_t sweepPoints = 1000000;
+static constexpr uint32_t timedCalls = 2000000;
+
+static volatile float sink;
+
+struct Sweep
+{
+    double maxError = 0;
+    double worstInput = 0;
+
+    void add(double error, double input)
+    {
+        if (error > maxError)
+        {
+            maxError = error;
+            worstInput = input;
+        }
+    }
+};
+
+static bool report(const char *name, const Sweep &sweep, double bound, const char *unit)
+{
+    bool ok = sweep.maxError <= bound;
+    printf("  %-12s max error %.2e %s at %+.6g (bound %.2e)%s\n", name, sweep.maxError, unit, sweep.worstInput, bound,
+            ok ? "" : "  FAILED");
+    return ok;
+}
+
+static bool checkAccuracy()
+{
+    Sweep sinCosSweep, atanSweep, atan2Sweep, hypotSweep;
+
+    for (uint32_t i = 0; i <= sweepPoints; i++)
+    {
+        // Tout le domaine documenté, plus un balayage fin autour de [-π;π] où tombent le cap et les consignes
+        float x = -FAST_SINCOS_MAX_ARGUMENT + (2.0f * FAST_SINCOS_MAX_ARGUMENT * float(i)) / float(sweepPoints);
+        float y = -4.0f + 8.0f * float(i) / float(sweepPoints);
+        const float sinCosInputs[] = {x, y};
+        for (float input : sinCosInputs)
+        {
+            float sin_x, cos_x;
+            fastSinCosf(input, &sin_x, &cos_x);
+            sinCosSweep.add(fmax(fabs(sin_x - sin(double(input))), fabs(cos_x - cos(double(input)))), input);
+        }
+
+        // Pentes de GotoNoStop::computeConsignOnCircle, de 0 à l'infini : répartition logarithmique
+        float slope = ldexpf(1.0f + float(i % 1024) / 1024.0f, int(i / 1024) % 64 - 32);
+        const float slopes[] = {slope, -slope};
+        for (float input : slopes)
+            atanSweep.add(fabs(fastAtanf(input) - atan(double(input))), input);
+
+        // Directions de Goto::computeDeltaTheta sur tout le cercle, et distances de quelques µm à quelques m
+        double direction = 2.0 * M_PI * double(i) / double(sweepPoints) - M_PI;
+        float length = ldexpf(1.0f, int(i % 24) - 10);
+        float deltaX = float(length * cos(direction));
+        float deltaY = float(length * sin(direction));
+        double exactAtan2 = atan2(double(deltaY), double(deltaX));
+        double atan2Error = fabs(fastAtan2f(deltaY, deltaX) - exactAtan2);
+        atan2Sweep.add(fmin(atan2Error, 2.0 * M_PI - atan2Error), direction);
+
+        double exactHypot = hypot(double(deltaX), double(deltaY));
+        hypotSweep.add(fabs(fastHypotf(deltaX, deltaY) - exactHypot) / exactHypot, length);
+    }
+
+    printf("  accuracy against double precision libm :\n");
+    bool ok = report("sincos", sinCosSweep, FAST_SINCOS_MAX_ERROR, "");
+    ok &= report("atan", atanSweep, FAST_ATAN_MAX_ERROR, "rad");
+    ok &= report("atan2", atan2Sweep, FAST_ATAN2_MAX_ERROR, "rad");
+    ok &= report("hypot", hypotSweep, FAST_HYPOT_MAX_RELATIVE_ERROR, "(relative)");
+    return ok;
+}
+
+template<typename Function>
+static double nsByCall(Function function)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < timedCalls; i++)
+    {
+        // Arguments variés pour que le compilateur ne sorte rien de la boucle
+        float input = -3.0f + 6.0f * float(i & 0xFFFF) * (1.0f / 65536.0f);
+        sink = function(input);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / timedCalls;
+}
+
+static void measureSpeed()
+{
+    printf("  ns by call, libm / fast :\n");
+    printf("    sincos %5.1f / %5.1f\n",
+            nsByCall([](float x) { return sinf(x) + cosf(x); }),
+            nsByCall([](float x) { float s, c; fastSinCosf(x, &s, &c); return s + c; }));
+    printf("    atan   %5.1f / %5.1f\n", nsByCall([](float x) { return atanf(x); }), nsByCall([](float x) { return fastAtanf(x); }));
+    printf("    atan2  %5.1f / %5.1f\n",
+            nsByCall([](float x) { return atan2f(x, 1.5f - x); }),
+            nsByCall([](float x) { return fastAtan2f(x, 1.5f - x); }));
+    printf("    hypot  %5.1f / %5.1f (Goto::computeDeltaDist %5.1f)\n",
+            nsByCall([](float x) { return hypotf(x, 1.5f - x); }),
+            nsByCall([](float x) { return fastHypotf(x, 1.5f - x); }),
+            nsByCall([](float x) { return Goto::computeDeltaDist(x, 1.5f - x); }));
+}
+
+/*
+ * Vérité : arc de cercle intégré en long double, comme dans odometryDriftBench
+ */
+struct ReferenceOdometry
+{
+    long double x = 0, y = 0, theta = 0;
+
+    void refresh(long double deltaRight_mm, long double deltaLeft_mm, long double wheelsDistance_mm)
+    {
+        long double deltaDist = (deltaRight_mm + deltaLeft_mm) / 2;
+        long double deltaTheta = (deltaRight_mm - deltaLeft_mm) / wheelsDistance_mm;
+        long double half = deltaTheta / 2;
+        long double sinc = (half == 0) ? 1 : sinl(half) / half;
+        x += deltaDist * sinc * cosl(theta + half);
+        y += deltaDist * sinc * sinl(theta + half);
+        theta += deltaTheta;
+    }
+};
+
+// Vitesses des roues (mm/s) au temps t : rotations rapides sur place, arcs serrés et lignes droites, en boucle
+static void wheelSpeeds(double t, double *right, double *left)
+{
+    double phase = fmod(t, 12.0);
+    if (phase < 3.0) { // ligne droite rapide
+        *right = *left = 900.0;
+    } else if (phase < 4.5) { // rotation rapide sur place
+        *right = 700.0;
+        *left = -700.0;
+    } else if (phase < 8.0) { // arc serré
+        *right = 650.0;
+        *left = 150.0;
+    } else if (phase < 11.0) { // slalom
+        *right = 500.0 + 300.0 * sin(2.1 * t);
+        *left = 500.0 - 300.0 * sin(2.1 * t);
+    } else { // marche arrière lente
+        *right = -40.0;
+        *left = -35.0;
+    }
+}
+
+static bool checkMatch(double duration_s)
+{
+    const double loopPeriod = 1.0 / ASSERV_THREAD_FREQUENCY;
+    const double mmByTick = (2.0 * M_PI * ENCODERS_WHEELS_RADIUS_MM) / ENCODERS_TICKS_BY_TURN;
+    const float encodermmByTicks = float(M_2PI_F * float(ENCODERS_WHEELS_RADIUS_MM)) / ENCODERS_TICKS_BY_TURN;
+    const uint32_t nbIterations = (uint32_t) (duration_s * ASSERV_THREAD_FREQUENCY);
+
+    Odometry odometry(ENCODERS_WHEELS_DISTANCE_MM);
+    ReferenceOdometry reference;
+
+    double rightPosition_ticks = 0, leftPosition_ticks = 0;
+    int64_t rightCount = 0, leftCount = 0;
+    double maxPositionError_ticks = 0;
+    std::chrono::nanoseconds refreshTime(0);
+    for (uint32_t i = 1; i <= nbIterations; i++)
+    {
+        double right, left;
+        wheelSpeeds(i * loopPeriod, &right, &left);
+        rightPosition_ticks += right * loopPeriod / mmByTick;
+        leftPosition_ticks += left * loopPeriod / mmByTick;
+
+        int64_t newRightCount = (int64_t) floor(rightPosition_ticks);
+        int64_t newLeftCount = (int64_t) floor(leftPosition_ticks);
+        float deltaRight_mm = float(newRightCount - rightCount) * encodermmByTicks;
+        float deltaLeft_mm = float(newLeftCount - leftCount) * encodermmByTicks;
+        rightCount = newRightCount;
+        leftCount = newLeftCount;
+
+        auto start = std::chrono::steady_clock::now();
+        odometry.refresh(deltaRight_mm, deltaLeft_mm);
+        refreshTime += std::chrono::steady_clock::now() - start;
+
+        reference.refresh(deltaRight_mm, deltaLeft_mm, float(ENCODERS_WHEELS_DISTANCE_MM));
+
+        double positionError = hypot(odometry.getX() - reference.x, odometry.getY() - reference.y);
+        maxPositionError_ticks = fmax(maxPositionError_ticks, positionError / mmByTick);
+    }
+
+    double thetaError = fabs(remainder(odometry.getTheta() - reference.theta, 2.0 * M_PI));
+    double finalPositionError_ticks = hypot(odometry.getX() - reference.x, odometry.getY() - reference.y) / mmByTick;
+    printf("  %.0f s match, Odometry::refresh %.1f ns : position error %.3f tick at the end, %.3f tick max, heading %.1e rad (1 tick = %.4f mm)\n",
+            duration_s, double(refreshTime.count()) / nbIterations, finalPositionError_ticks, maxPositionError_ticks,
+            thetaError, mmByTick);
+
+    bool ok = maxPositionError_ticks < 1.0;
+    if (!ok)
+        printf("  FAILED, odometry drifts by more than one encoder tick over the match\n");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    const double duration_s = (argc > 1) ? strtod(argv[1], nullptr) : 100.0;
+
+    printf("%s (%s) :\n", ROBOT_NAME, mathMode);
+    bool ok = checkAccuracy();
+    measureSpeed();
+    ok &= checkMatch(duration_s);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,338 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include "SimulatedRobot.h"
+#include "USBStream.h"
+#include "WorkStealingPool.h"
+
+/*
+ * Balayage des réglages de l'asserv du robot ROBOT_NAME sur robot simulé (voir host/sim/DiffDrivePlant.h).
+ *
+ *  Chaque instance est une chaîne de contrôle complète (celle de main.cpp) contre son propre robot simulé,
+ *  avec un jeu de réglages tiré autour des valeurs du robotConfig.h : gains des asserv en vitesse (mis à l'échelle
+ *  sur les NB_PI_SUBSET plages), DIST_REGULATOR_KP, ANGLE_REGULATOR_KP, PLL_BANDWIDTH et les paramètres de
+ *  l'AdvancedAccelerationLimiter. L'instance 0 garde les réglages du robot.
+ *
+ *  Chaque instance déroule la même suite de commandes. Pour chaque commande on mesure, sur la position réelle :
+ *  le temps d'établissement (dernier instant hors tolérance), le dépassement et l'erreur d'arrivée.
+ *  Les instances sont réparties sur tous les coeurs (voir host/sim/WorkStealingPool.h) : une instance ne vit
+ *  que le temps de sa simulation, sur la pile de son worker, seuls les réglages et les scores sont partagés.
+ *
+ *  usage : gainSweep [nombre d'instances] [nombre de threads (0 = tous les coeurs)]
+ */
+
+static constexpr float MOVE_TIMEOUT_S = 10;
+static constexpr float HOLD_S = 0.5;                  // arrêt mesuré après chaque commande
+static constexpr float SETTLE_DISTANCE_MM = 3;
+static constexpr float SETTLE_ANGLE_RAD = 0.01;
+
+// Poids du score, en secondes : 1mm ~ 0.01rad ~ 20ms
+static constexpr float MM_WEIGHT_S = 0.02;
+static constexpr float RAD_WEIGHT_S = 2;
+static constexpr float TIMEOUT_PENALTY_S = 100;
+
+static constexpr unsigned RANKED_LINES = 15;
+
+struct GainSet
+{
+    float speedKpScale;
+    float speedKiScale;
+    float distKp;
+    float angleKp;
+    float pllBandwidth;
+    float distMaxAcc;
+    float distMinAcc;
+    float distHighSpeedThreshold;
+};
+
+struct SweepScore
+{
+    float settling_s;
+    float overshoot_mm;
+    float overshoot_rad;
+    float arrivalError_mm;
+    float arrivalError_rad;
+    float total;
+    uint8_t timeouts;
+};
+
+typedef enum
+{
+    move_straight, move_turn, move_goto
+} move_type_t;
+
+struct Move
+{
+    move_type_t type;
+    float a;    // distance (mm), angle (rad) ou X (mm)
+    float b;    // Y (mm) pour un goto
+};
+
+// Suite de commandes rejouée par chaque instance, depuis (0, 0, 0)
+static const Move s_route[] = {
+    { move_straight, 500, 0 },
+    { move_turn, float(M_PI / 2), 0 },
+    { move_goto, 500, 400 },
+    { move_turn, float(-M_PI), 0 },
+    { move_straight, -300, 0 },
+    { move_goto, 0, 0 },
+};
+
+/*
+ * Une instance : robot simulé dont la chaîne de contrôle prend les réglages du GainSet
+ */
+struct SimInstance
+{
+    explicit SimInstance(const GainSet &gains, const DiffDrivePlant::Configuration &plantConfig) :
+            robot(plantConfig, tuning(gains))
+    {
+    }
+
+    SimulatedTuning tuning(const GainSet &gains)
+    {
+        SimulatedTuning tuning;
+        tuning.angleKp = gains.angleKp;
+        tuning.distKp = gains.distKp;
+        tuning.pllBandwidth = gains.pllBandwidth;
+        tuning.speedKpRight = scaled(rightKp, speed_controller_right_Kp, gains.speedKpScale);
+        tuning.speedKiRight = scaled(rightKi, speed_controller_right_Ki, gains.speedKiScale);
+        tuning.speedKpLeft = scaled(leftKp, speed_controller_left_Kp, gains.speedKpScale);
+        tuning.speedKiLeft = scaled(leftKi, speed_controller_left_Ki, gains.speedKiScale);
+        tuning.distMaxAcc = gains.distMaxAcc;
+        tuning.distMinAcc = gains.distMinAcc;
+        tuning.distHighSpeedThreshold = gains.distHighSpeedThreshold;
+        return tuning;
+    }
+
+    static float* scaled(float *out, const float *gains, float scale)
+    {
+        for (int i = 0; i < NB_PI_SUBSET; i++)
+            out[i] = gains[i] * scale;
+        return out;
+    }
+
+    // Copies locales des gains mis à l'échelle, lues par les constructeurs des asserv en vitesse
+    float rightKp[NB_PI_SUBSET], rightKi[NB_PI_SUBSET], leftKp[NB_PI_SUBSET], leftKi[NB_PI_SUBSET];
+
+    SimulatedRobot robot;
+};
+
+static void scoreMove(SimulatedRobot &sim, const Move &move, SweepScore *score)
+{
+    DiffDrivePlant &plant = sim.plant;
+    CommandManager &commandManager = sim.commandManager;
+
+    const double startX = plant.getX_mm(), startY = plant.getY_mm(), startTheta = plant.getTheta_rad();
+    double goalX = startX, goalY = startY, goalTheta = startTheta;
+    switch (move.type)
+    {
+    case move_straight:
+        goalX += move.a * cos(startTheta);
+        goalY += move.a * sin(startTheta);
+        commandManager.addStraightLine(move.a);
+        break;
+    case move_turn:
+        goalTheta += move.a;
+        commandManager.addTurn(move.a);
+        break;
+    case move_goto:
+        goalX = move.a;
+        goalY = move.b;
+        commandManager.addGoTo(move.a, move.b);
+        break;
+    }
+
+    // Direction d'approche, pour mesurer le dépassement au delà du but
+    const double approachX = goalX - startX, approachY = goalY - startY;
+    const double approachLength = hypot(approachX, approachY);
+    const double turnSign = (goalTheta >= startTheta) ? 1 : -1;
+
+    const double startTime = plant.getTime_s();
+    double lastUnsettledTime = startTime;
+    double overshoot_mm = 0, overshoot_rad = 0;
+    double holdEnd = 0;
+    bool timeout = false;
+
+    while (true)
+    {
+        sim.mainAsserv.loopIteration();
+        const double now = plant.getTime_s();
+
+        const double errorX = plant.getX_mm() - goalX, errorY = plant.getY_mm() - goalY;
+        const double angleError = plant.getTheta_rad() - goalTheta;
+        bool settled;
+        if (move.type == move_turn)
+        {
+            settled = fabs(angleError) <= SETTLE_ANGLE_RAD;
+            overshoot_rad = std::max(overshoot_rad, turnSign * angleError);
+        }
+        else
+        {
+            settled = hypot(errorX, errorY) <= SETTLE_DISTANCE_MM;
+            if (approachLength > 0)
+                overshoot_mm = std::max(overshoot_mm, (errorX * approachX + errorY * approachY) / approachLength);
+        }
+        if (!settled)
+            lastUnsettledTime = now;
+
+        if (holdEnd == 0)
+        {
+            if (commandManager.getPendingCommandCount() == 0 && commandManager.getCommandStatus() == CommandManager::STATUS_IDLE)
+                holdEnd = now + HOLD_S;
+            else if (now - startTime > MOVE_TIMEOUT_S)
+            {
+                timeout = true;
+                break;
+            }
+        }
+        else if (now >= holdEnd)
+            break;
+    }
+
+    score->settling_s += lastUnsettledTime - startTime;
+    score->overshoot_mm += overshoot_mm;
+    score->overshoot_rad += overshoot_rad;
+    if (move.type == move_turn)
+        score->arrivalError_rad += fabs(remainder(plant.getTheta_rad() - goalTheta, M_2PI));
+    else
+        score->arrivalError_mm += hypot(plant.getX_mm() - goalX, plant.getY_mm() - goalY);
+    if (timeout)
+        score->timeouts++;
+}
+
+static SweepScore simulate(const GainSet &gains, const DiffDrivePlant::Configuration &plantConfig)
+{
+    SimInstance sim(gains, plantConfig);
+
+    SweepScore score = SweepScore();
+    for (const Move &move : s_route)
+    {
+        scoreMove(sim.robot, move, &score);
+        // Une commande qui n'aboutit pas rend les suivantes sans objet
+        if (score.timeouts)
+            break;
+    }
+
+    score.total = score.settling_s + MM_WEIGHT_S * (score.overshoot_mm + score.arrivalError_mm)
+            + RAD_WEIGHT_S * (score.overshoot_rad + score.arrivalError_rad) + TIMEOUT_PENALTY_S * score.timeouts;
+    return score;
+}
+
+/*
+ * Tirage reproductible des réglages, indépendant de l'ordre d'exécution : un générateur par instance
+ */
+static float randomScale(uint64_t *state, float minScale, float maxScale)
+{
+    // xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    uint64_t value = *state * 0x2545F4914F6CDD1DULL;
+    float unit = float(value >> 40) / float(1 << 24);
+    // Log-uniforme, autant de chances de diviser que de multiplier
+    return minScale * powf(maxScale / minScale, unit);
+}
+
+static GainSet drawGainSet(uint32_t index)
+{
+    GainSet gains;
+    gains.speedKpScale = 1;
+    gains.speedKiScale = 1;
+    gains.distKp = DIST_REGULATOR_KP;
+    gains.angleKp = ANGLE_REGULATOR_KP;
+    gains.pllBandwidth = PLL_BANDWIDTH;
+    gains.distMaxAcc = DIST_REGULATOR_MAX_ACC;
+    gains.distMinAcc = DIST_REGULATOR_MIN_ACC;
+    gains.distHighSpeedThreshold = DIST_REGULATOR_HIGH_SPEED_THRESHOLD;
+    if (index == 0)
+        return gains;
+
+    uint64_t state = 0x9E3779B97F4A7C15ULL * (index + 1);
+    gains.speedKpScale *= randomScale(&state, 0.5f, 2.0f);
+    gains.speedKiScale *= randomScale(&state, 0.5f, 2.0f);
+    gains.distKp *= randomScale(&state, 0.5f, 2.0f);
+    gains.angleKp *= randomScale(&state, 0.5f, 2.0f);
+    gains.pllBandwidth *= randomScale(&state, 0.5f, 2.0f);
+    gains.distMaxAcc *= randomScale(&state, 0.5f, 2.0f);
+    gains.distMinAcc = std::min(gains.distMinAcc * randomScale(&state, 0.5f, 2.0f), gains.distMaxAcc);
+    gains.distHighSpeedThreshold *= randomScale(&state, 0.5f, 2.0f);
+    return gains;
+}
+
+static double runSweep(const std::vector<GainSet> &gainSets, std::vector<SweepScore> &scores, uint32_t count, unsigned threadCount)
+{
+    const DiffDrivePlant::Configuration plantConfig = realisticPlantConfiguration();
+    WorkStealingPool pool(threadCount);
+
+    auto start = std::chrono::steady_clock::now();
+    pool.parallelFor(count, [&](uint32_t index, unsigned)
+    {
+        USBStream::init();
+        scores[index] = simulate(gainSets[index], plantConfig);
+    });
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    const uint32_t count = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 256;
+    const unsigned threadCount = WorkStealingPool(argc > 2 ? strtoul(argv[2], nullptr, 10) : 0).getThreadCount();
+    if (count == 0)
+        return 1;
+
+    std::vector<GainSet> gainSets(count);
+    std::vector<SweepScore> scores(count);
+    for (uint32_t i = 0; i < count; i++)
+        gainSets[i] = drawGainSet(i);
+
+    const double elapsed_s = runSweep(gainSets, scores, count, threadCount);
+
+    std::vector<uint32_t> ranking(count);
+    for (uint32_t i = 0; i < count; i++)
+        ranking[i] = i;
+    std::stable_sort(ranking.begin(), ranking.end(), [&](uint32_t a, uint32_t b)
+    {
+        return scores[a].total < scores[b].total;
+    });
+
+    printf("%s : %u instances on %u threads in %.2f s (%.0f instances/s, %zu bytes by instance)\n",
+            ROBOT_NAME, count, threadCount, elapsed_s, count / elapsed_s, sizeof(SimInstance));
+    printf("  rank    id  speedKp  speedKi   distKp  angleKp   pllBw   maxAcc   minAcc  hsThres | settle_s  over_mm over_rad  err_mm  err_rad | score\n");
+    for (uint32_t rank = 0; rank < count; rank++)
+    {
+        const uint32_t id = ranking[rank];
+        if (rank >= RANKED_LINES && id != 0)
+            continue;
+        const GainSet &g = gainSets[id];
+        const SweepScore &s = scores[id];
+        printf("  %4u %5u %8.3f %8.3f %8.3f %8.1f %7.1f %8.1f %8.1f %8.1f | %8.3f %8.2f %8.4f %7.2f %8.4f | %7.3f%s%s\n",
+                rank + 1, id, g.speedKpScale, g.speedKiScale, g.distKp, g.angleKp, g.pllBandwidth,
+                g.distMaxAcc, g.distMinAcc, g.distHighSpeedThreshold,
+                s.settling_s, s.overshoot_mm, s.overshoot_rad, s.arrivalError_mm, s.arrivalError_rad, s.total,
+                s.timeouts ? "  TIMEOUT" : "", id == 0 ? "  <= robotConfig.h" : "");
+    }
+
+    /* Passage à l'échelle : la part d'un thread refaite sur un seul thread doit prendre le même temps.
+     *  Même tirage, mêmes simulations : les scores doivent être identiques
+     */
+    if (threadCount > 1)
+    {
+        const uint32_t share = count / threadCount;
+        std::vector<SweepScore> singleScores(count);
+        const double single_s = runSweep(gainSets, singleScores, share, 1);
+        bool identical = true;
+        for (uint32_t i = 0; i < share; i++)
+            identical &= singleScores[i].total == scores[i].total;
+        printf("  scaling : %u instances on 1 thread in %.2f s, parallel efficiency %.0f%%%s\n",
+                share, single_s, 100.0 * (single_s / share) / (elapsed_s / count) / threadCount,
+                identical ? "" : "  (MISMATCHING SCORES)");
+        if (!identical)
+            return 1;
+    }
+
+    return scores[0].timeouts ? 1 : 0;
+}
@@ -0,0 +1,205 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+#include "SimulatedRobot.h"
+#include "USBStream.h"
+
+/*
+ * Temps de parcours de suites de points typiques d'un match Eurobot pour le robot ROBOT_NAME, sur robot simulé réaliste
+ *  (voir host/sim/DiffDrivePlant.h) : sans, puis avec la planification des vitesses de passage (voir src/commandManager/LookAheadPlanner.h,
+ *  réglages LOOKAHEAD_* du robotConfig.h). Chaque chemin est parcouru en Goto, puis en GotoNoStop.
+ *
+ *  On mesure le temps jusqu'à la fin de la dernière commande, l'écart max de la position réelle à la ligne brisée du chemin,
+ *  l'erreur finale (arrêt observé HOLD_S après la fin) et le patinage.
+ *
+ *  Échoue si un chemin n'est pas terminé en ROUTE_TIMEOUT_S, ou s'il s'arrête hors tolérance du dernier point.
+ *  Avec la planification, échoue aussi si le robot s'écarte du chemin de plus de LOOKAHEAD_JUNCTION_DEVIATION_MM,
+ *  ou s'il patine plus qu'en s'arrêtant sur chaque point (rotations sur place des Goto), à PLANNED_SLIP_TOLERANCE_MM près.
+ *
+ *  usage : lookAheadBench
+ */
+
+static constexpr double ROUTE_TIMEOUT_S = 30;
+static constexpr double HOLD_S = 0.5;
+// Erreur finale admise : la fenêtre d'arrivée d'un Goto précis, plus une tolérance d'établissement
+static constexpr double MAX_FINAL_ERROR_MM = COMMAND_MANAGER_GOTO_PRECISE_ARRIVAL_DISTANCE_mm + 3;
+// Patinage admis en plus de celui du même chemin parcouru en s'arrêtant sur chaque point
+static constexpr double PLANNED_SLIP_TOLERANCE_MM = 1;
+
+struct Point
+{
+    float x;
+    float y;
+};
+
+struct Route
+{
+    const char *name;
+    const Point *points;
+    unsigned count;
+};
+
+// Le robot part de (0, 0), orienté vers les X positifs
+static const Point s_gridPath[] = {    // sortie brute d'un A* sur grille de 100 mm : beaucoup de points alignés
+    { 100, 0 }, { 200, 0 }, { 300, 0 }, { 400, 100 }, { 500, 200 }, { 600, 300 },
+    { 700, 300 }, { 800, 300 }, { 900, 300 }, { 1000, 400 }, { 1100, 500 }, { 1200, 500 },
+};
+static const Point s_bypass[] = {      // contournement d'un obstacle au milieu de la table
+    { 400, 0 }, { 700, 300 }, { 1100, 300 }, { 1400, 0 }, { 1800, 0 },
+};
+static const Point s_slalom[] = {      // slalom entre des éléments de jeu
+    { 300, 150 }, { 600, -150 }, { 900, 150 }, { 1200, -150 }, { 1500, 0 },
+};
+static const Point s_square[] = {      // tour d'une zone, virages à angle droit
+    { 600, 0 }, { 600, 600 }, { 0, 600 }, { 0, 0 },
+};
+static const Point s_return[] = {      // aller-retour vers la zone de départ, avec un demi-tour
+    { 800, 200 }, { 1200, 200 }, { 800, 250 }, { 200, 0 },
+};
+
+#define ROUTE(name, points) { name, points, sizeof(points) / sizeof(points[0]) }
+static const Route s_routes[] = {
+    ROUTE("grid path", s_gridPath),
+    ROUTE("bypass", s_bypass),
+    ROUTE("slalom", s_slalom),
+    ROUTE("square", s_square),
+    ROUTE("return", s_return),
+};
+
+struct RouteResult
+{
+    bool completed;
+    double routeTime_s;
+    double maxDeviation_mm;   // écart max à la ligne brisée du chemin
+    double finalError_mm;
+    double slip_mm;
+};
+
+static double segmentDistance(double x, double y, const Point &a, const Point &b)
+{
+    double dx = b.x - a.x, dy = b.y - a.y;
+    double length2 = dx * dx + dy * dy;
+    double t = length2 > 0 ? std::min(1.0, std::max(0.0, ((x - a.x) * dx + (y - a.y) * dy) / length2)) : 0;
+    return hypot(x - (a.x + t * dx), y - (a.y + t * dy));
+}
+
+static double pathDistance(double x, double y, const Route &route)
+{
+    Point previous = { 0, 0 };
+    double distance = HUGE_VAL;
+    for (unsigned i = 0; i < route.count; i++)
+    {
+        distance = std::min(distance, segmentDistance(x, y, previous, route.points[i]));
+        previous = route.points[i];
+    }
+    return distance;
+}
+
+static RouteResult simulateRoute(const Route &route, bool noStop, bool lookAhead)
+{
+    SimulatedRobot robot(realisticPlantConfiguration());
+    DiffDrivePlant &plant = robot.plant;
+    CommandManager &commandManager = robot.commandManager;
+    SimAsservMain &mainAsserv = robot.mainAsserv;
+    commandManager.enableLookAhead(lookAhead);
+
+    // Comme le haut niveau : tout le chemin est envoyé d'un coup, le dernier point en Goto précis
+    for (unsigned i = 0; i < route.count; i++)
+    {
+        if (i + 1 == route.count)
+            commandManager.addGoTo(route.points[i].x, route.points[i].y);
+        else if (noStop)
+            commandManager.addGoToNoStop(route.points[i].x, route.points[i].y);
+        else
+            commandManager.addGoToWaypoint(route.points[i].x, route.points[i].y);
+    }
+
+    RouteResult result = RouteResult();
+    double holdEnd = 0;
+    while (true)
+    {
+        mainAsserv.loopIteration();
+        const double now = plant.getTime_s();
+
+        result.maxDeviation_mm = std::max(result.maxDeviation_mm, pathDistance(plant.getX_mm(), plant.getY_mm(), route));
+
+        if (holdEnd == 0)
+        {
+            if (commandManager.getPendingCommandCount() == 0 && commandManager.getCommandStatus() == CommandManager::STATUS_IDLE)
+            {
+                result.completed = true;
+                result.routeTime_s = now;
+                holdEnd = now + HOLD_S;
+            }
+            else if (now > ROUTE_TIMEOUT_S)
+                break;
+        }
+        else if (now >= holdEnd)
+            break;
+    }
+
+    const Point &last = route.points[route.count - 1];
+    result.finalError_mm = hypot(plant.getX_mm() - last.x, plant.getY_mm() - last.y);
+    result.slip_mm = plant.getSlipDistance_mm();
+    return result;
+}
+
+/*
+ * 'stopResult' : le même chemin parcouru en s'arrêtant sur chaque point, nullptr pour celui-ci
+ */
+static bool printResult(const char *mode, const RouteResult &result, const RouteResult *stopResult)
+{
+    const bool deviationExceeded = stopResult != nullptr && result.maxDeviation_mm > LOOKAHEAD_JUNCTION_DEVIATION_MM;
+    const bool slipExceeded = stopResult != nullptr && result.slip_mm > stopResult->slip_mm + PLANNED_SLIP_TOLERANCE_MM;
+    printf("    %-16s : %s in %6.3f s, max path deviation %6.1f mm%s, final error %5.2f mm, slip %6.1f mm%s\n",
+            mode, result.completed ? "done   " : "TIMEOUT", result.routeTime_s,
+            result.maxDeviation_mm, deviationExceeded ? " (ABOVE MAX)" : "", result.finalError_mm,
+            result.slip_mm, slipExceeded ? " (SLIPPING)" : "");
+
+    return result.completed && result.finalError_mm <= MAX_FINAL_ERROR_MM && !deviationExceeded && !slipExceeded;
+}
+
+int main()
+{
+    USBStream::init();
+
+    printf("%s : route time, stop on each point vs look-ahead junction speeds (%.0f mm/s2, %.1f rad/s2, lateral %.0f mm/s2, junction deviation %.0f mm, %d points ahead)\n",
+            ROBOT_NAME, lookAheadConf.maxAcceleration, lookAheadConf.maxAngularAcceleration, lookAheadConf.maxLateralAcceleration,
+            lookAheadConf.junctionDeviation_mm, LookAheadPlanner::MAX_WAYPOINTS);
+
+    bool ok = true;
+    double totalTime[2][2] = { { 0, 0 }, { 0, 0 } };   // [noStop][lookAhead]
+    for (const Route &route : s_routes)
+    {
+        printf("  %s, %u points\n", route.name, route.count);
+
+        for (int noStop = 0; noStop < 2; noStop++)
+        {
+            RouteResult stopResult = RouteResult();
+            for (int lookAhead = 0; lookAhead < 2; lookAhead++)
+            {
+                char mode[32];
+                snprintf(mode, sizeof(mode), "%s%s", noStop ? "gotonostop" : "goto", lookAhead ? " planned" : "");
+                RouteResult result = simulateRoute(route, noStop, lookAhead);
+                ok &= printResult(mode, result, lookAhead ? &stopResult : nullptr);
+                totalTime[noStop][lookAhead] += result.routeTime_s;
+                if (!lookAhead)
+                    stopResult = result;
+            }
+        }
+    }
+
+    printf("  total : goto %.3f s -> %.3f s (x%.2f), gotonostop %.3f s -> %.3f s (x%.2f)\n",
+            totalTime[0][0], totalTime[0][1], totalTime[0][0] / totalTime[0][1],
+            totalTime[1][0], totalTime[1][1], totalTime[1][0] / totalTime[1][1]);
+
+    if (!ok)
+    {
+        printf("%s : FAILED (route not completed in %.0f s, final error above %.1f mm, or planned route deviating above %.0f mm or slipping)\n",
+                ROBOT_NAME, ROUTE_TIMEOUT_S, MAX_FINAL_ERROR_MM, (double)LOOKAHEAD_JUNCTION_DEVIATION_MM);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+
+#include "SimulatedRobot.h"
+#include "AsservMain.h"
+#include "USBStream.h"
+#include "MockMotorController.h"
+#include "MockEncoders.h"
+#include "InstructionCounter.h"
+#include "CycleCounter.h"
+#include "GotoTestRoute.h"
+
+#ifdef ENABLE_LOOP_PROFILER
+#include "hal.h"
+extern BaseSequentialStream *outputStream;
+#endif
+
+/*
+ * Benchmark host de AsservMain::loopIteration() pour le robot ROBOT_NAME.
+ *
+ *  Le câblage est celui de src/Robots/<ROBOT_NAME>/main.cpp (mêmes réglages via robotConfig.h),
+ *  seuls les codeurs et le contrôleur moteur sont remplacés par des mocks.
+ *  Le robot parcourt en boucle la trajectoire de "asserv gototest".
+ *
+ *  Deux variantes sont mesurées sur la même trajectoire : AsservMain, qui appelle la chaîne
+ *  de contrôle via ses interfaces, et ComposedAsservMain avec les types concrets du robot.
+ *
+ *  usage : loopBench [nombre d'itérations]
+ */
+
+// Même composition que src/Robots/<robot>/RobotAsservMain.h, avec les mocks à la place des drivers
+typedef ComposedAsservMain<MockEncoders, MockMotorController, AdaptativeSpeedController,
+        SimpleAccelerationLimiter, AdvancedAccelerationLimiter> BenchAsservMain;
+
+struct BenchResult
+{
+    double nsByIteration;
+    double instructionsByIteration;
+    double cyclesByIteration;
+};
+
+template<typename AsservMainT>
+static BenchResult benchLoop(const char *variant, uint32_t nbIterations)
+{
+    const uint32_t nbRuns = 5;
+
+    MockMotorController motorController;
+    const float ticksByMm = ENCODERS_TICKS_BY_TURN / float(M_2PI * ENCODERS_WHEELS_RADIUS_MM);
+    MockEncoders encoders(motorController, MAX_SPEED_MM_PER_SEC / 100.0f / ASSERV_THREAD_FREQUENCY * ticksByMm);
+
+    SimulatedControlChain<AsservMainT> chain(motorController, encoders);
+    CommandManager &commandManager = chain.commandManager;
+    AsservMainT &mainAsserv = chain.mainAsserv;
+
+    // Appels via un pointeur de base, comme mainLoop()
+    AsservMain &asservLoop = mainAsserv;
+
+    InstructionCounter instructionCounter;
+    CycleCounter cycleCounter;
+    double bestNsByIteration = 1e300;
+    uint64_t bestInstructions = 0;
+    uint64_t bestCycles = 0;
+
+    for (uint32_t run = 0; run < nbRuns; run++)
+    {
+        uint32_t done = 0;
+        uint64_t instructions = 0;
+        uint64_t cycles = 0;
+        std::chrono::nanoseconds elapsed(0);
+
+        // Par paquets, pour ré-alimenter la liste de commandes hors de la mesure
+        while (done < nbIterations)
+        {
+            if (chain.isIdle())
+                addGotoTestRoute(commandManager);
+
+            uint32_t batch = nbIterations - done;
+            if (batch > 1000)
+                batch = 1000;
+
+            instructionCounter.start();
+            cycleCounter.start();
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < batch; i++)
+                asservLoop.loopIteration();
+            elapsed += std::chrono::steady_clock::now() - start;
+            cycles += cycleCounter.stop();
+            instructions += instructionCounter.stop();
+
+            done += batch;
+        }
+
+        double nsByIteration = double(elapsed.count()) / nbIterations;
+        if (nsByIteration < bestNsByIteration)
+        {
+            bestNsByIteration = nsByIteration;
+            bestInstructions = instructions;
+            bestCycles = cycles;
+        }
+    }
+
+    BenchResult result;
+    result.nsByIteration = bestNsByIteration;
+    result.instructionsByIteration = instructionCounter.isAvailable() ? double(bestInstructions) / nbIterations : 0;
+    result.cyclesByIteration = cycleCounter.isAvailable() ? double(bestCycles) / nbIterations : 0;
+
+    const double budget_ns = 1e9 / ASSERV_THREAD_FREQUENCY;
+    printf("%-10s %4d Hz %-8s : %8.1f ns/iteration", ROBOT_NAME, ASSERV_THREAD_FREQUENCY, variant, bestNsByIteration);
+    if (cycleCounter.isAvailable())
+        printf(", %8.1f %s/iteration", result.cyclesByIteration, cycleCounter.isReferenceCycles() ? "TSC cycles" : "cycles");
+    else
+        printf(",      n/a cycles/iteration");
+    if (instructionCounter.isAvailable())
+        printf(", %8.1f instructions/iteration", result.instructionsByIteration);
+    else
+        printf(",      n/a instructions/iteration");
+    printf("  (%.3f%% of the %.0f ns budget)\n", 100.0 * bestNsByIteration / budget_ns, budget_ns);
+
+#ifdef ENABLE_LOOP_PROFILER
+    // Stats cumulées sur tous les runs, le coût du profiler est inclus dans les ns/iteration ci-dessus
+    mainAsserv.getProfiler().print(outputStream);
+#endif
+
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    const uint32_t nbIterations = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 200000;
+
+    USBStream::init();
+
+    BenchResult virtualResult = benchLoop<AsservMain>("virtual", nbIterations);
+    BenchResult composedResult = benchLoop<BenchAsservMain>("composed", nbIterations);
+
+    printf("%-10s composed/virtual : %.2f (time)", ROBOT_NAME, composedResult.nsByIteration / virtualResult.nsByIteration);
+    if (virtualResult.cyclesByIteration > 0)
+        printf(", %.2f (cycles)", composedResult.cyclesByIteration / virtualResult.cyclesByIteration);
+    printf("\n");
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include "SimulatedRobot.h"
+#include "LoopTimer.h"
+#include "USBStream.h"
+#include "util/asservMath.h"
+
+/*
+ * Boucle d'asserv du robot ROBOT_NAME sur robot simulé (voir host/sim/DiffDrivePlant.h), cadencée par une LoopTimer
+ *  en temps virtuel avec gigue artificielle (voir LoopTimer::setVirtualJitter) : chaque échantillon codeur arrive
+ *  avec un retard aléatoire après son tick, et une partie des ticks tombe pendant l'itération précédente.
+ *  Le robot simulé avance à chaque période du temps réellement écoulé entre deux échantillons.
+ *
+ *  La boucle passe ce temps mesuré (deltaT) à toute sa chaîne. À côté, une Pll fantôme reçoit les mêmes deltas codeurs
+ *  avec la période nominale fixée à la construction, comme le faisait la boucle avant la mesure du deltaT.
+ *  Les deux estimations de vitesse sont comparées à la vitesse réelle des roues (erreur rms).
+ *
+ *  Scénarios : sans gigue, avec gigue, puis avec gigue et passage de la boucle à la moitié de sa fréquence en cours
+ *   de parcours (AsservMain::setLoopFrequency).
+ *  Échoue si un parcours n'aboutit pas, ou si la vitesse estimée avec le deltaT mesuré n'est pas plus juste
+ *   qu'avec la période nominale dès qu'il y a de la gigue.
+ *
+ *  usage : loopJitterBench [retard max d'échantillonnage, en us] [un tick manqué tous les N ticks]
+ */
+
+static constexpr float ROUTE_DISTANCE_MM = 1000;
+static constexpr uint32_t ROUTE_TIMEOUT_PERIODS = 60 * ASSERV_THREAD_FREQUENCY;
+// Passage à la moitié de la fréquence au milieu de la première ligne droite
+static constexpr uint32_t FREQUENCY_CHANGE_PERIOD = ASSERV_THREAD_FREQUENCY;
+
+/*
+ * Codeurs du robot simulé : font avancer le robot du temps mesuré par la LoopTimer,
+ *  et gardent les deltas de la période pour la Pll fantôme
+ */
+class JitteredEncoders final : public Encoders
+{
+public:
+    explicit JitteredEncoders(DiffDrivePlant &plant) :
+            m_plant(plant), m_loopTimer(nullptr), m_deltaRight(0), m_deltaLeft(0)
+    {
+    }
+
+    void setLoopTimer(const LoopTimer *loopTimer)
+    {
+        m_loopTimer = loopTimer;
+    }
+
+    virtual void getValues(float *deltaEncoderRight, float *deltaEncoderLeft) override
+    {
+        if (m_loopTimer != nullptr)
+            m_plant.setLoopPeriod(m_loopTimer->getSamplePeriod_s());
+        m_plant.getValues(deltaEncoderRight, deltaEncoderLeft);
+        m_deltaRight = *deltaEncoderRight;
+        m_deltaLeft = *deltaEncoderLeft;
+    }
+
+    float getDeltaRight() const { return m_deltaRight; }
+    float getDeltaLeft() const { return m_deltaLeft; }
+
+private:
+    DiffDrivePlant &m_plant;
+    const LoopTimer *m_loopTimer;
+    float m_deltaRight;
+    float m_deltaLeft;
+};
+
+typedef ComposedAsservMain<JitteredEncoders, DiffDrivePlant, AdaptativeSpeedController,
+        SimpleAccelerationLimiter, AdvancedAccelerationLimiter> JitterAsservMain;
+
+static bool runScenario(const char *name, uint32_t maxSampleDelay_us, uint16_t missedTickInterval, bool halveFrequency)
+{
+    DiffDrivePlant plant(simulatedPlantConfiguration());
+    JitteredEncoders encoders(plant);
+    SimulatedControlChain<JitterAsservMain> chain(plant, encoders);
+    Pll &rightPll = chain.rightPll;
+    Pll &leftPll = chain.leftPll;
+    Odometry &odometry = chain.odometry;
+    CommandManager &commandManager = chain.commandManager;
+    JitterAsservMain &mainAsserv = chain.mainAsserv;
+
+    // Pll fantôme : période nominale de construction, comme avant la mesure du deltaT
+    const float nominalPeriod = 1.0f / float(ASSERV_THREAD_FREQUENCY);
+    Pll nominalRightPll(PLL_BANDWIDTH);
+    Pll nominalLeftPll(PLL_BANDWIDTH);
+    const float mmByTicks = M_2PI_F * ENCODERS_WHEELS_RADIUS_MM / float(ENCODERS_TICKS_BY_TURN);
+
+    LoopTimer &timer = mainAsserv.getLoopTimer();
+    encoders.setLoopTimer(&timer);
+    timer.setVirtualJitter(maxSampleDelay_us, missedTickInterval);
+
+    commandManager.addStraightLine(ROUTE_DISTANCE_MM);
+    commandManager.addStraightLine(-ROUTE_DISTANCE_MM);
+    mainAsserv.resetDeadlineStats();
+    timer.start();
+
+    uint32_t periods = 0;
+    bool completed = false;
+    double measuredSquareSum = 0;
+    double nominalSquareSum = 0;
+    while (periods < ROUTE_TIMEOUT_PERIODS && !completed)
+    {
+        if (halveFrequency && periods == FREQUENCY_CHANGE_PERIOD)
+            mainAsserv.setLoopFrequency(ASSERV_THREAD_FREQUENCY / 2);
+        mainAsserv.runPeriod();
+        nominalRightPll.update(encoders.getDeltaRight(), nominalPeriod);
+        nominalLeftPll.update(encoders.getDeltaLeft(), nominalPeriod);
+        periods++;
+
+        const double rightSpeed = plant.getRightGroundSpeed();
+        const double leftSpeed = plant.getLeftGroundSpeed();
+        const double measuredRight = rightPll.getSpeed() * mmByTicks - rightSpeed;
+        const double measuredLeft = leftPll.getSpeed() * mmByTicks - leftSpeed;
+        const double nominalRight = nominalRightPll.getSpeed() * mmByTicks - rightSpeed;
+        const double nominalLeft = nominalLeftPll.getSpeed() * mmByTicks - leftSpeed;
+        measuredSquareSum += measuredRight * measuredRight + measuredLeft * measuredLeft;
+        nominalSquareSum += nominalRight * nominalRight + nominalLeft * nominalLeft;
+
+        completed = chain.isIdle();
+    }
+
+    const double measuredRms = sqrt(measuredSquareSum / (2.0 * periods));
+    const double nominalRms = sqrt(nominalSquareSum / (2.0 * periods));
+    const double positionError = hypot(odometry.getX() - plant.getX_mm(), odometry.getY() - plant.getY_mm());
+    printf("  %-26s : route %s in %5u periods (%.3f s simulated, %u Hz), %u missed ticks, period %.1f..%.1f us, odometry error %.2f mm\n",
+            name, completed ? "done" : "NOT DONE", (unsigned int) periods, plant.getTime_s(), (unsigned int) mainAsserv.getLoopFrequency(),
+            (unsigned int) timer.getMissedTicks(), timer.getMinPeriod_us(), timer.getMaxPeriod_us(), positionError);
+    printf("  %-26s   speed estimate error : measured deltaT %7.3f mm/s rms, nominal period %7.3f mm/s rms\n",
+            "", measuredRms, nominalRms);
+
+    const bool jittered = maxSampleDelay_us != 0 || missedTickInterval != 0 || halveFrequency;
+    return completed && (!jittered || measuredRms < nominalRms);
+}
+
+int main(int argc, char **argv)
+{
+    const uint32_t maxSampleDelay_us = (argc > 1) ? atoi(argv[1]) : 250000 / ASSERV_THREAD_FREQUENCY;
+    const uint16_t missedTickInterval = (argc > 2) ? atoi(argv[2]) : 50;
+
+    USBStream::init();
+
+    printf("%s : control loop at %d Hz, sample delay up to %u us, one missed tick every %u ticks\n", ROBOT_NAME,
+            ASSERV_THREAD_FREQUENCY, (unsigned int) maxSampleDelay_us, (unsigned int) missedTickInterval);
+    bool ok = runScenario("no jitter", 0, 0, false);
+    ok = runScenario("jitter", maxSampleDelay_us, missedTickInterval, false) && ok;
+    ok = runScenario("jitter, half frequency", maxSampleDelay_us, missedTickInterval, true) && ok;
+
+    if (!ok)
+    {
+        printf("%s : FAILED (route not done, or measured deltaT does not improve the speed estimate)\n", ROBOT_NAME);
+        return 1;
+    }
+    return 0;
+}
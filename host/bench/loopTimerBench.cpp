@@ -0,0 +1,154 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include "SimulatedRobot.h"
+#include "LoopTimer.h"
+#include "USBStream.h"
+
+/*
+ * Horloge de la boucle d'asserv (LoopTimer) du robot ROBOT_NAME, en temps virtuel.
+ *
+ *  - Période de l'ancienne attente sur le systick (TIME_MS2I sur la période tronquée en ms) et fréquence réellement
+ *    obtenue, face aux 1 / ASSERV_THREAD_FREQUENCY s utilisés par tous les intégrateurs de la boucle.
+ *  - LoopTimer seule pendant la durée demandée : nombre de ticks, temps écoulé, période moyenne, min et max,
+ *    et compteurs codeurs figés à chaque tick.
+ *  - Boucle complète sur robot simulé (voir host/sim/DiffDrivePlant.h) appelée par AsservMain::runPeriod() :
+ *    une ligne droite doit aboutir avec un tick par itération et sans échéance manquée.
+ *
+ *  Échoue si la LoopTimer dérive (temps écoulé différent de ticks / ASSERV_THREAD_FREQUENCY à la us près),
+ *  si sa gigue dépasse la us d'arrondi de la période, ou si la boucle complète ne suit pas ses ticks.
+ *
+ *  usage : loopTimerBench [durée simulée, en s]
+ */
+
+static constexpr float STRAIGHT_LINE_MM = 1000;
+static constexpr uint32_t ROUTE_TIMEOUT_PERIODS = 60 * ASSERV_THREAD_FREQUENCY;
+static constexpr float MAX_JITTER_US = 1.0f;
+
+/*
+ * Codeurs qui ne font que compter les captures du tick
+ */
+class LatchCounter : public Encoders
+{
+public:
+    LatchCounter() :
+            m_latches(0)
+    {
+    }
+
+    virtual void getValues(float *deltaEncoderRight, float *deltaEncoderLeft) override
+    {
+        *deltaEncoderRight = 0;
+        *deltaEncoderLeft = 0;
+    }
+
+    virtual void latchI() override
+    {
+        m_latches++;
+    }
+
+    uint32_t getLatches() const
+    {
+        return m_latches;
+    }
+
+private:
+    uint32_t m_latches;
+};
+
+static void printTimerStats(const char *name, const LoopTimer &timer)
+{
+    printf("  %-22s : %u ticks, mean period %.4f us (min %.3f, max %.3f), jitter %.3f us, wake latency %.3f us, missed %u\n",
+            name, (unsigned int) timer.getTicks(), timer.getMeanPeriod_us(), timer.getMinPeriod_us(), timer.getMaxPeriod_us(),
+            timer.getMaxJitter_us(), timer.getMaxWakeLatency_us(), (unsigned int) timer.getMissedTicks());
+}
+
+static void reportSystickSleep(double duration_s)
+{
+    // Ancienne mainLoop() : période convertie en ms entières puis en ticks du systick
+    const float loopPeriod = 1.0f / float(ASSERV_THREAD_FREQUENCY);
+    const time_conv_t loopPeriod_ms = (loopPeriod * 1000.0f);
+    const double period_us = TIME_I2US(TIME_MS2I(loopPeriod_ms));
+    const double frequency = 1e6 / period_us;
+    const double drift_ms = (duration_s * frequency / ASSERV_THREAD_FREQUENCY - duration_s) * 1e3;
+    printf("  %-22s : period %.1f us, actual frequency %.2f Hz, integrated time off by %.1f ms over %.0f s\n",
+            "systick sleep", period_us, frequency, drift_ms, duration_s);
+}
+
+static bool checkTimer(double duration_s)
+{
+    LatchCounter encoders;
+    LoopTimer timer(ASSERV_THREAD_FREQUENCY, encoders);
+    timer.start();
+
+    const uint32_t ticks = uint32_t(duration_s * ASSERV_THREAD_FREQUENCY);
+    uint64_t elapsed_ns = 0;
+    uint32_t previous = timer.now();
+    for (uint32_t i = 0; i < ticks; i++)
+    {
+        timer.waitTick();
+        elapsed_ns += timer.now() - previous;
+        previous = timer.now();
+    }
+    printTimerStats("loop timer", timer);
+
+    // Temps écoulé attendu : ticks / fréquence, exact à la us pour un nombre entier de secondes
+    const double expected_us = double(ticks) * 1e6 / ASSERV_THREAD_FREQUENCY;
+    const double drift_us = double(elapsed_ns) / 1e3 - expected_us;
+    const double meanError_us = double(timer.getMeanPeriod_us()) - 1e6 / ASSERV_THREAD_FREQUENCY;
+    printf("  %-22s : %.3f s elapsed, drift %.3f us, mean period error %.5f us, %u encoder latches\n",
+            "", double(elapsed_ns) / 1e9, drift_us, meanError_us, (unsigned int) encoders.getLatches());
+
+    return fabs(drift_us) < 1.0 && fabs(meanError_us) < 0.01 && timer.getMaxJitter_us() <= MAX_JITTER_US
+            && encoders.getLatches() == ticks && timer.getMissedTicks() == 0;
+}
+
+static bool checkControlLoop()
+{
+    SimulatedRobot robot(simulatedPlantConfiguration());
+    DiffDrivePlant &plant = robot.plant;
+    Odometry &odometry = robot.odometry;
+    CommandManager &commandManager = robot.commandManager;
+    SimAsservMain &mainAsserv = robot.mainAsserv;
+
+    commandManager.addStraightLine(STRAIGHT_LINE_MM);
+    mainAsserv.resetDeadlineStats();
+    mainAsserv.getLoopTimer().start();
+    uint32_t periods = 0;
+    bool completed = false;
+    while (periods < ROUTE_TIMEOUT_PERIODS && !completed)
+    {
+        mainAsserv.runPeriod();
+        periods++;
+        completed = robot.isIdle();
+    }
+
+    LoopTimer &timer = mainAsserv.getLoopTimer();
+    printTimerStats("control loop", timer);
+    printf("  %-22s : straight line %s in %u periods (%.3f s simulated), %.1f mm, %u deadline misses, min slack %u us\n", "",
+            completed ? "done" : "NOT DONE", (unsigned int) periods, plant.getTime_s(), odometry.getX(),
+            (unsigned int) mainAsserv.getDeadlineMisses(), (unsigned int) mainAsserv.getMinDeadlineSlack_us());
+
+    return completed && timer.getTicks() == periods && mainAsserv.getDeadlineMisses() == 0 && timer.getMaxJitter_us() <= MAX_JITTER_US;
+}
+
+int main(int argc, char **argv)
+{
+    const double duration_s = (argc > 1) ? atof(argv[1]) : 60;
+
+    USBStream::init();
+
+    printf("%s : control loop clock at %d Hz (period %.3f us), %.0f s in virtual time\n", ROBOT_NAME, ASSERV_THREAD_FREQUENCY,
+            1e6 / ASSERV_THREAD_FREQUENCY, duration_s);
+    reportSystickSleep(duration_s);
+    bool ok = checkTimer(duration_s);
+    ok = checkControlLoop() && ok;
+
+    if (!ok)
+    {
+        printf("%s : FAILED (loop timer drifts, jitters or does not drive the control loop)\n", ROBOT_NAME);
+        return 1;
+    }
+    return 0;
+}
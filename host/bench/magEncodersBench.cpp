@@ -0,0 +1,167 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+
+#include "ch.h"
+#include "hal.h"
+#include "Encoders/MagEncoders.h"
+#include "MockI2cBus.h"
+#include "MockAs5048b.h"
+
+extern BaseSequentialStream *outputStream;
+
+/*
+ * Banc host de MagEncoders : compare la lecture synchrone des AS5048B dans getValues()
+ *  et l'acquisition pipelinée lancée par startAcquisition() juste après l'écriture moteur.
+ *
+ *  Pour chaque mode, une boucle à la fréquence du PMX (200Hz) appelle getValues(), fait tourner les aimants
+ *  simulés (comme pendant la période écoulée), puis appelle startAcquisition() comme AsservMain.
+ *  On mesure le temps passé dans getValues() et on vérifie que la somme des deltas rendus
+ *  correspond exactement à la rotation simulée, y compris quand le bus bloque (échantillons perdus puis rattrapés).
+ *
+ *  usage : magEncodersBench [nombre de périodes]
+ */
+
+static constexpr uint32_t loopPeriod_us = 5000;
+
+// 400kHz : ~23us par octet (8 bits + ack), plus start/stop. Un transfert sur 150 bloqué 3ms (au delà du timeout de 1ms)
+static constexpr uint32_t transferOverhead_us = 25;
+static constexpr uint32_t byteDuration_us = 23;
+static constexpr uint32_t stallPeriod = 150;
+static constexpr uint32_t stallDuration_us = 3000;
+
+// Câblage du PMX : capteur 1 à gauche, capteur 2 à droite (is1EncoderRight = false)
+static constexpr i2caddr_t sensor1Address = AS5048B_ADDR(1, 1);
+static constexpr i2caddr_t sensor2Address = AS5048B_ADDR(0, 1);
+
+static bool runMode(MagEncoders &encoders, MockI2cBus &bus, MockAs5048b &sensor1, MockAs5048b &sensor2,
+        const char *name, uint32_t nbPeriods)
+{
+    uint32_t minCall_us = UINT32_MAX;
+    uint32_t maxCall_us = 0;
+    uint64_t sumCall_us = 0;
+    uint32_t missedPeriods = 0;
+    int64_t expectedRight = 0;
+    int64_t expectedLeft = 0;
+
+    uint32_t transfersBefore = bus.getTransferCount();
+    uint32_t timeoutsBefore = bus.getTimeoutCount();
+
+    encoders.start();
+
+    auto deadline = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nbPeriods; i++)
+    {
+        float deltaRight, deltaLeft;
+        rtcnt_t start = chSysGetRealtimeCounterX();
+        encoders.getValues(&deltaRight, &deltaLeft);
+        uint32_t call_us = RTC2US(STM32_HCLK, chSysGetRealtimeCounterX() - start);
+
+        sumCall_us += call_us;
+        if (call_us < minCall_us)
+            minCall_us = call_us;
+        if (call_us > maxCall_us)
+            maxCall_us = call_us;
+
+        // Les roues avancent à vitesse variable, assez vite pour que les capteurs fassent plusieurs tours
+        int32_t stepRight = 40 + (i % 30);
+        int32_t stepLeft = -(25 + (i % 17));
+        sensor2.rotate(stepRight);
+        sensor1.rotate(stepLeft);
+        expectedRight += stepRight;
+        expectedLeft += stepLeft;
+
+        encoders.startAcquisition();
+
+        deadline += std::chrono::microseconds(loopPeriod_us);
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            missedPeriods++;
+            deadline = std::chrono::steady_clock::now();
+        }
+        std::this_thread::sleep_until(deadline);
+    }
+
+    // Dernière itération, sans blocage du bus, pour consommer la rotation de la dernière période
+    bus.injectStalls(0, 0);
+    float deltaRight, deltaLeft;
+    encoders.getValues(&deltaRight, &deltaLeft);
+    if (deltaRight == 0.0f && deltaLeft == 0.0f)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(loopPeriod_us));
+        encoders.startAcquisition();
+        std::this_thread::sleep_for(std::chrono::microseconds(loopPeriod_us));
+        encoders.getValues(&deltaRight, &deltaLeft);
+    }
+
+    printf("%-9s : getValues() min %5u us, mean %5u us, max %5u us, %u/%u periods missed, %u transfers (%u timeouts)\n",
+            name, minCall_us, (uint32_t) (sumCall_us / nbPeriods), maxCall_us, missedPeriods, nbPeriods,
+            bus.getTransferCount() - transfersBefore, bus.getTimeoutCount() - timeoutsBefore);
+
+    int32_t sumRight, sumLeft;
+    encoders.getEncodersTotalCount(&sumRight, &sumLeft);
+    if (sumRight != expectedRight || sumLeft != expectedLeft)
+    {
+        printf("%-9s : FAILED, encoders total count (%d, %d) differ from the simulated rotation (%lld, %lld)\n", name,
+                sumRight, sumLeft, (long long) expectedRight, (long long) expectedLeft);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const uint32_t nbPeriods = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 400;
+
+    // Les drivers tracent chaque échec I2C sur outputStream, inutile de polluer la sortie du banc
+    static BaseSequentialStream nullStream = { fopen("/dev/null", "w") };
+    outputStream = &nullStream;
+
+    MockI2cBus bus(transferOverhead_us, byteDuration_us);
+    I2CD2.bus = &bus;
+    MockAs5048b sensor1(bus, sensor1Address);
+    MockAs5048b sensor2(bus, sensor2Address);
+    sensor1.setAngle(16000);
+    sensor2.setAngle(300);
+
+    bool ok = true;
+
+    MagEncoders syncEncoders(false, false, false, false);
+    syncEncoders.init();
+    bus.injectStalls(stallPeriod, stallDuration_us);
+    ok &= runMode(syncEncoders, bus, sensor1, sensor2, "sync", nbPeriods);
+
+    /*
+     * Comme sur la cible, le MagEncoders pipeliné n'est jamais détruit : son thread d'acquisition
+     *  attend indéfiniment sur le sémaphore du MagEncoders
+     */
+    bus.injectStalls(0, 0);
+    MagEncoders *pipelinedEncoders = new MagEncoders(false, false, false, true);
+    pipelinedEncoders->init();
+    pipelinedEncoders->resetAcquisitionStats();
+    bus.injectStalls(stallPeriod, stallDuration_us);
+    ok &= runMode(*pipelinedEncoders, bus, sensor1, sensor2, "pipelined", nbPeriods);
+
+    MagEncoders::AcquisitionStats stats = pipelinedEncoders->getAcquisitionStats();
+    printf("pipelined : %u requested, %u completed, %u errors, %u stale, latency min %u us, mean %u us, max %u us, max wait %u us\n",
+            stats.requested, stats.completed, stats.errors, stats.stale, stats.minLatency_us,
+            stats.completed ? (uint32_t) (stats.sumLatency_us / stats.completed) : 0, stats.maxLatency_us,
+            stats.maxWait_us);
+
+    // AGC, diagnostic et magnitude relus à basse fréquence doivent être ceux des capteurs simulés
+    MagEncoders::SensorStatus status1, status2;
+    pipelinedEncoders->getSensorsStatus(&status1, &status2);
+    if (status1.diag != MockAs5048b::DIAG_OCF || status2.diag != MockAs5048b::DIAG_OCF || status1.agc != 50
+            || status2.agc != 50)
+    {
+        printf("pipelined : FAILED, sensors status (agc %d/%d, diag %d/%d) differ from the simulated ones\n", status1.agc,
+                status2.agc, status1.diag, status2.diag);
+        ok = false;
+    }
+
+    // Pas de destructeurs statiques pendant que le thread d'acquisition tourne encore
+    fflush(stdout);
+    _exit(ok ? 0 : 1);
+}
@@ -0,0 +1,125 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+
+#include "ch.h"
+#include "hal.h"
+#include "motorController/Md22.h"
+#include "MockI2cBus.h"
+
+/*
+ * Banc host du Md22 : compare l'écriture synchrone et l'écriture asynchrone des consignes moteur
+ *  sur un bus I2C factice qui bloque de temps en temps (voir MockI2cBus).
+ *
+ *  Pour chaque mode, une boucle à la fréquence du PMX (200Hz) publie les consignes des deux moteurs,
+ *  et on mesure le temps passé dans setMotorsSpeed() ainsi que les périodes dépassées.
+ *  En fin de mode, les registres du MD22 factice doivent contenir les dernières consignes.
+ *
+ *  usage : md22Bench [nombre de périodes]
+ */
+
+static constexpr uint8_t md22Address = 0xB0 >> 1;
+static constexpr uint32_t loopPeriod_us = 5000;
+
+// 3 octets à 400kHz, et un transfert sur 40 bloqué 3ms (au delà du timeout de 1ms du Md22)
+static constexpr uint32_t transferDuration_us = 90;
+static constexpr uint32_t stallPeriod = 40;
+static constexpr uint32_t stallDuration_us = 3000;
+
+static Md22::I2cPinInit pinConf = { GPIOB, 6, GPIOB, 7 };
+
+static bool runMode(Md22 &md22, MockI2cBus &bus, const char *name, uint32_t nbPeriods)
+{
+    uint32_t minCall_us = UINT32_MAX;
+    uint32_t maxCall_us = 0;
+    uint64_t sumCall_us = 0;
+    uint32_t missedPeriods = 0;
+
+    uint32_t transfersBefore = bus.getTransferCount();
+    uint32_t timeoutsBefore = bus.getTimeoutCount();
+
+    auto deadline = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < nbPeriods; i++)
+    {
+        float right = 100.0f * ((i % 50) / 50.0f) - 50.0f;
+        float left = -right / 2;
+
+        rtcnt_t start = chSysGetRealtimeCounterX();
+        md22.setMotorsSpeed(right, left);
+        uint32_t call_us = RTC2US(STM32_HCLK, chSysGetRealtimeCounterX() - start);
+
+        sumCall_us += call_us;
+        if (call_us < minCall_us)
+            minCall_us = call_us;
+        if (call_us > maxCall_us)
+            maxCall_us = call_us;
+
+        deadline += std::chrono::microseconds(loopPeriod_us);
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            missedPeriods++;
+            deadline = std::chrono::steady_clock::now();
+        }
+        std::this_thread::sleep_until(deadline);
+    }
+
+    // Laisse le temps au thread d'écriture de vider le slot (et de réessayer après un éventuel blocage)
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    printf("%-6s : setMotorsSpeed() min %5u us, mean %5u us, max %5u us, %u/%u periods missed, %u transfers (%u timeouts)\n", name,
+            minCall_us, (uint32_t) (sumCall_us / nbPeriods), maxCall_us, missedPeriods, nbPeriods,
+            bus.getTransferCount() - transfersBefore, bus.getTimeoutCount() - timeoutsBefore);
+
+    // Le MD22 est câblé avec le moteur 1 à gauche (is1motorRight = false)
+    int8_t motor1 = (int8_t) bus.getRegister(md22Address, 1);
+    int8_t motor2 = (int8_t) bus.getRegister(md22Address, 2);
+    if (motor1 != md22.getLeftSpeed() || motor2 != md22.getRightSpeed())
+    {
+        printf("%-6s : FAILED, MD22 registers (%d, %d) differ from the last consigns (%d, %d)\n", name, motor1, motor2,
+                md22.getLeftSpeed(), md22.getRightSpeed());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const uint32_t nbPeriods = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 400;
+
+    MockI2cBus bus(transferDuration_us);
+    I2CD1.bus = &bus;
+
+    bool ok = true;
+
+    Md22 syncMd22(&pinConf, false, false, false, 400000, false);
+    syncMd22.init();
+    bus.injectStalls(stallPeriod, stallDuration_us);
+    ok &= runMode(syncMd22, bus, "sync", nbPeriods);
+
+    /*
+     * Comme sur la cible, le Md22 asynchrone n'est jamais détruit : son thread d'écriture
+     *  attend indéfiniment sur le sémaphore du Md22
+     */
+    bus.injectStalls(0, 0);
+    Md22 *asyncMd22 = new Md22(&pinConf, false, false, false, 400000, true);
+    asyncMd22->init();
+    bus.injectStalls(stallPeriod, stallDuration_us);
+    ok &= runMode(*asyncMd22, bus, "async", nbPeriods);
+
+    Md22::WriteStats stats = asyncMd22->getWriteStats();
+    printf("async  : %u published, %u written, %u dropped, %u write errors, %u failed I2C tries, latency min %u us, mean %u us, max %u us\n",
+            stats.published, stats.written, stats.dropped, stats.errors, stats.failedTries, stats.minLatency_us,
+            stats.written ? (uint32_t) (stats.sumLatency_us / stats.written) : 0, stats.maxLatency_us);
+
+    if (stats.written + stats.dropped != stats.published)
+    {
+        printf("async  : FAILED, written + dropped != published\n");
+        ok = false;
+    }
+
+    // Pas de destructeurs statiques pendant que le thread d'écriture tourne encore
+    fflush(stdout);
+    _exit(ok ? 0 : 1);
+}
@@ -0,0 +1,223 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include "SimulatedRobot.h"
+#include "OdometryCalibration.h"
+#include "USBStream.h"
+
+/*
+ * Calibration de l'odométrie (OdometryCalibration) du robot ROBOT_NAME.
+ *
+ *  Sans argument :
+ *   - le solveur retrouve les erreurs qui ont servi à générer des écarts sur son propre modèle,
+ *   - puis calibration complète sur robot simulé réaliste (voir host/sim/DiffDrivePlant.h) dont les roues codeuses ont
+ *     des erreurs de rayon et de voie connues : carrés horaires et anti-horaires en StraitLine/Turn, ligne droite pour
+ *     l'échelle moyenne, résolution, application en marche (AsservMain::setOdometryCalibration()), et carrés rejoués.
+ *   Échoue si les gains ou la voie trouvés s'écartent des vrais de plus de MAX_GAIN_ERROR / MAX_TRACK_ERROR_MM,
+ *   ou si les carrés ne reviennent pas au moins MIN_ERROR_REDUCTION fois plus près du départ après calibration.
+ *
+ *  Avec des mesures relevées sur le robot ("asserv umbmark" ou à la main), résout sans simulation, à partir des gains et
+ *  de la voie du robotConfig.h :
+ *   odometryCalibrationBench côté_mm horaireX_mm horaireY_mm antihoraireX_mm antihoraireY_mm [échelle des distances]
+ */
+
+static constexpr float SQUARE_SIDE_MM = 1000;
+static constexpr uint8_t SQUARES_BY_DIRECTION = 2;
+static constexpr float STRAIGHT_LINE_MM = 1500;
+static constexpr double COMMAND_TIMEOUT_S = 60;
+
+// Erreurs réelles des roues codeuses simulées face au robotConfig.h
+static constexpr float RIGHT_RADIUS_ERROR = 0.004f;
+static constexpr float LEFT_RADIUS_ERROR = -0.002f;
+static constexpr float WHEELS_DISTANCE_ERROR_MM = 1.5f;
+
+static constexpr float MAX_GAIN_ERROR = 3e-4f;
+static constexpr float MAX_TRACK_ERROR_MM = 0.3f;
+static constexpr double MIN_ERROR_REDUCTION = 5;
+
+static void printResult(const char *name, const OdometryCalibration::Result &result)
+{
+    printf("  %-23s : right gain %.6f, left gain %.6f, wheels distance %.3f mm, residual %.3f mm\n", name,
+            result.rightGain, result.leftGain, result.wheelsDistance_mm, result.residual_mm);
+}
+
+static int solveMeasures(int argc, char **argv)
+{
+    if (argc < 6)
+    {
+        printf("usage : %s side_mm cwX_mm cwY_mm ccwX_mm ccwY_mm [distanceScale]\n", argv[0]);
+        return 1;
+    }
+
+    OdometryCalibration calibration;
+    calibration.setSide(float(atof(argv[1])));
+    calibration.addRun(true, float(atof(argv[2])), float(atof(argv[3])));
+    calibration.addRun(false, float(atof(argv[4])), float(atof(argv[5])));
+    const float distanceScale = (argc > 6) ? float(atof(argv[6])) : 1.0f;
+
+    OdometryCalibration::Result result;
+    if (!calibration.solve(ENCODERS_RIGHT_GAIN, ENCODERS_LEFT_GAIN, ENCODERS_WHEELS_DISTANCE_MM, distanceScale, &result))
+    {
+        printf("%s : no solution\n", ROBOT_NAME);
+        return 1;
+    }
+    printf("%s : odometry calibration from measures (side %s mm, distance scale %.6f)\n", ROBOT_NAME, argv[1], distanceScale);
+    printResult("solution", result);
+    printf("#define ENCODERS_WHEELS_DISTANCE_MM (%.3f)\n#define ENCODERS_RIGHT_GAIN (%.6f)\n#define ENCODERS_LEFT_GAIN (%.6f)\n",
+            result.wheelsDistance_mm, result.rightGain, result.leftGain);
+    return 0;
+}
+
+// Le solveur sur son propre modèle : les écarts générés avec des erreurs connues doivent les redonner
+static bool checkSolverOnModel()
+{
+    const float rightScale = 1.0f + RIGHT_RADIUS_ERROR;
+    const float leftScale = 1.0f + LEFT_RADIUS_ERROR;
+    const float realWheelsDistance_mm = ENCODERS_WHEELS_DISTANCE_MM + WHEELS_DISTANCE_ERROR_MM;
+
+    OdometryCalibration calibration;
+    calibration.setSide(SQUARE_SIDE_MM);
+    float X, Y;
+    OdometryCalibration::squareEnd(SQUARE_SIDE_MM, true, ENCODERS_WHEELS_DISTANCE_MM, rightScale, leftScale, realWheelsDistance_mm, &X, &Y);
+    calibration.addRun(true, X, Y);
+    OdometryCalibration::squareEnd(SQUARE_SIDE_MM, false, ENCODERS_WHEELS_DISTANCE_MM, rightScale, leftScale, realWheelsDistance_mm, &X, &Y);
+    calibration.addRun(false, X, Y);
+
+    OdometryCalibration::Result result;
+    bool solved = calibration.solve(1, 1, ENCODERS_WHEELS_DISTANCE_MM, (rightScale + leftScale) * 0.5f, &result);
+    if (solved)
+        printResult("model", result);
+    else
+        printf("  model                   : no solution\n");
+    return solved && fabsf(result.rightGain - rightScale) <= MAX_GAIN_ERROR * 0.1f && fabsf(result.leftGain - leftScale) <= MAX_GAIN_ERROR * 0.1f
+            && fabsf(result.wheelsDistance_mm - realWheelsDistance_mm) <= MAX_TRACK_ERROR_MM * 0.1f;
+}
+
+enum Run
+{
+    RUN_CLOCKWISE_SQUARE, RUN_COUNTERCLOCKWISE_SQUARE, RUN_STRAIGHT_LINE
+};
+
+struct CalibrationRobot : SimulatedRobot
+{
+    explicit CalibrationRobot(const DiffDrivePlant::Configuration &plantConfiguration) :
+            SimulatedRobot(plantConfiguration)
+    {
+    }
+
+    // Exécute les commandes en file jusqu'à l'arrêt du robot
+    bool runCommands()
+    {
+        return runUntilIdle(COMMAND_TIMEOUT_S);
+    }
+
+    /*
+     * Odométrie remise à (0, 0, 0), puis un carré (calibration) ou une ligne droite : écart de la position réelle
+     *  à l'odométrie à l'arrivée, dans le repère réel de départ
+     */
+    bool runFromOrigin(Run run, OdometryCalibration &calibration, float *errorX_mm, float *errorY_mm, double *realDistance_mm)
+    {
+        const double startX = plant.getX_mm(), startY = plant.getY_mm(), startTheta = plant.getTheta_rad();
+        mainAsserv.setPosition(0, 0, 0);
+        bool added;
+        if (run == RUN_STRAIGHT_LINE)
+            added = commandManager.addStraightLine(STRAIGHT_LINE_MM);
+        else
+            added = calibration.addSquare(commandManager, SQUARE_SIDE_MM, run == RUN_CLOCKWISE_SQUARE);
+        if (!added || !runCommands())
+            return false;
+
+        const double dX = plant.getX_mm() - startX, dY = plant.getY_mm() - startY;
+        const double realX = dX * cos(startTheta) + dY * sin(startTheta);
+        const double realY = -dX * sin(startTheta) + dY * cos(startTheta);
+        *errorX_mm = float(realX - odometry.getX());
+        *errorY_mm = float(realY - odometry.getY());
+        *realDistance_mm = hypot(dX, dY);
+        return true;
+    }
+};
+
+/*
+ * Carrés dans les deux sens, ajoutés à calibration, et écart moyen au départ (sur tous les carrés)
+ */
+static bool runSquares(CalibrationRobot &robot, OdometryCalibration &calibration, double *meanError_mm)
+{
+    double sumError = 0;
+    for (uint8_t i = 0; i < 2 * SQUARES_BY_DIRECTION; i++)
+    {
+        const bool clockwise = (i % 2) == 0;
+        float errorX, errorY;
+        double realDistance_mm;
+        if (!robot.runFromOrigin(clockwise ? RUN_CLOCKWISE_SQUARE : RUN_COUNTERCLOCKWISE_SQUARE, calibration, &errorX, &errorY, &realDistance_mm))
+            return false;
+        calibration.addRun(clockwise, errorX, errorY);
+        printf("  %-23s : error X %7.2f mm Y %7.2f mm\n", clockwise ? "clockwise square" : "counterclockwise square", errorX, errorY);
+        sumError += hypot(errorX, errorY);
+    }
+    *meanError_mm = sumError / (2 * SQUARES_BY_DIRECTION);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    USBStream::init();
+
+    if (argc > 1)
+        return solveMeasures(argc, argv);
+
+    printf("%s : odometry calibration, %.0f mm squares, encoder radius error %+.2f%% %+.2f%%, wheels distance error %+.1f mm\n",
+            ROBOT_NAME, SQUARE_SIDE_MM, 100.0 * RIGHT_RADIUS_ERROR, 100.0 * LEFT_RADIUS_ERROR, WHEELS_DISTANCE_ERROR_MM);
+
+    bool ok = checkSolverOnModel();
+
+    DiffDrivePlant::Configuration plantConfiguration = simulatedPlantConfiguration();
+    plantConfiguration.maxGroundAcceleration_mmps2 = 3000;
+    plantConfiguration.rightEncoderRadiusError = RIGHT_RADIUS_ERROR;
+    plantConfiguration.leftEncoderRadiusError = LEFT_RADIUS_ERROR;
+    plantConfiguration.encoderWheelsDistance_mm = ENCODERS_WHEELS_DISTANCE_MM + WHEELS_DISTANCE_ERROR_MM;
+
+    CalibrationRobot robot(plantConfiguration);
+    robot.mainAsserv.setOdometryCalibration(ENCODERS_RIGHT_GAIN, ENCODERS_LEFT_GAIN, ENCODERS_WHEELS_DISTANCE_MM);
+
+    OdometryCalibration calibration;
+    double errorBefore_mm = 0;
+    ok = runSquares(robot, calibration, &errorBefore_mm) && ok;
+
+    // Échelle moyenne sur une ligne droite, comme on la mesurerait au mètre
+    float errorX, errorY;
+    double realDistance_mm = 0;
+    ok = robot.runFromOrigin(RUN_STRAIGHT_LINE, calibration, &errorX, &errorY, &realDistance_mm) && ok;
+    const float distanceScale = float(realDistance_mm / hypot(robot.odometry.getX(), robot.odometry.getY()));
+    printf("  %-23s : real %.2f mm for %.2f mm by odometry, distance scale %.6f\n", "straight line", realDistance_mm,
+            hypot(robot.odometry.getX(), robot.odometry.getY()), distanceScale);
+
+    OdometryCalibration::Result result;
+    if (!calibration.solve(ENCODERS_RIGHT_GAIN, ENCODERS_LEFT_GAIN, ENCODERS_WHEELS_DISTANCE_MM, distanceScale, &result))
+    {
+        printf("%s : FAILED (no solution)\n", ROBOT_NAME);
+        return 1;
+    }
+    printResult("solution", result);
+
+    const float rightGainError = fabsf(result.rightGain - (1.0f + RIGHT_RADIUS_ERROR));
+    const float leftGainError = fabsf(result.leftGain - (1.0f + LEFT_RADIUS_ERROR));
+    const float trackError = fabsf(result.wheelsDistance_mm - plantConfiguration.encoderWheelsDistance_mm);
+    printf("  %-23s : right gain %.6f, left gain %.6f, wheels distance %.3f mm\n", "errors", rightGainError, leftGainError, trackError);
+
+    robot.mainAsserv.setOdometryCalibration(result.rightGain, result.leftGain, result.wheelsDistance_mm);
+    OdometryCalibration check;
+    double errorAfter_mm = 0;
+    ok = runSquares(robot, check, &errorAfter_mm) && ok;
+    printf("  %-23s : mean square error %.2f mm before, %.2f mm after calibration\n", "result", errorBefore_mm, errorAfter_mm);
+
+    ok = ok && rightGainError <= MAX_GAIN_ERROR && leftGainError <= MAX_GAIN_ERROR && trackError <= MAX_TRACK_ERROR_MM
+            && errorAfter_mm * MIN_ERROR_REDUCTION <= errorBefore_mm;
+    if (!ok)
+    {
+        printf("%s : FAILED (gains off by more than %.4f, wheels distance by more than %.2f mm,"
+                " or square error not divided by %.0f)\n", ROBOT_NAME, MAX_GAIN_ERROR, MAX_TRACK_ERROR_MM, MIN_ERROR_REDUCTION);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include "robotConfig.h"
+#include "Odometry.h"
+#include "Regulator.h"
+
+/*
+ * Banc host de la dérive numérique de l'odométrie et des accumulateurs des régulateurs pour le robot ROBOT_NAME.
+ *
+ *  Un match de 100s est simulé à la fréquence de l'asserv : les roues suivent des profils de vitesse variés
+ *  (lignes droites, arcs, rotations sur place, approche lente), et les deltas passés à l'asserv sont quantifiés
+ *  au tick codeur comme dans AsservMain. Les mêmes deltas sont intégrés :
+ *   - par Odometry et Regulator (float, sommes compensées) ;
+ *   - par l'ancienne odométrie (position float, calcul du delta en double), recopiée ici comme référence ;
+ *   - en long double, qui sert de vérité.
+ *  Le banc échoue si l'odométrie ou les accumulateurs actuels dérivent de plus que les seuils ci-dessous.
+ *
+ *  usage : odometryDriftBench [durée du match en s]
+ */
+
+static constexpr double maxPositionError_mm = 0.1;
+static constexpr double maxThetaError_rad = 1e-5;
+static constexpr double maxAccumulatorError = 1e-2; // en mm ou en rad
+
+/*
+ * Odométrie d'avant le passage en simple précision
+ */
+class LegacyOdometry
+{
+public:
+    explicit LegacyOdometry(float encoderWheelsDistance_mm)
+    {
+        m_encoderWheelsDistance_mm = encoderWheelsDistance_mm;
+        m_X_mm = 0;
+        m_Y_mm = 0;
+        m_theta_rad = 0;
+    }
+
+    void refresh(float deltaRight_mm, float deltaLeft_mm)
+    {
+        float deltaDist = (deltaLeft_mm + deltaRight_mm) / 2;
+        float diffCount = deltaRight_mm - deltaLeft_mm;
+        double deltaTheta = double(diffCount) / double(m_encoderWheelsDistance_mm);
+
+        if (diffCount == 0) {
+            m_X_mm += deltaDist * cos(m_theta_rad);
+            m_Y_mm += deltaDist * sin(m_theta_rad);
+        } else {
+            float R = float(deltaDist) / deltaTheta;
+            m_X_mm += R * (-sin(m_theta_rad) + sin(m_theta_rad + deltaTheta));
+            m_Y_mm += R * (cos(m_theta_rad) - cos(m_theta_rad + deltaTheta));
+            m_theta_rad += deltaTheta;
+            if (m_theta_rad > M_PI)
+                m_theta_rad -= 2 * M_PI;
+            else if (m_theta_rad <= -M_PI)
+                m_theta_rad += 2 * M_PI;
+        }
+    }
+
+    float m_encoderWheelsDistance_mm;
+    float m_X_mm, m_Y_mm;
+    float m_theta_rad;
+};
+
+/*
+ * Vérité : même modèle d'arc de cercle, intégré en long double
+ */
+struct ReferenceOdometry
+{
+    long double x = 0, y = 0, theta = 0;
+    long double distance = 0, angle = 0;
+
+    void refresh(long double deltaRight_mm, long double deltaLeft_mm, long double wheelsDistance_mm)
+    {
+        long double deltaDist = (deltaRight_mm + deltaLeft_mm) / 2;
+        long double deltaTheta = (deltaRight_mm - deltaLeft_mm) / wheelsDistance_mm;
+        long double half = deltaTheta / 2;
+        long double sinc = (half == 0) ? 1 : sinl(half) / half;
+        x += deltaDist * sinc * cosl(theta + half);
+        y += deltaDist * sinc * sinl(theta + half);
+        theta += deltaTheta;
+        distance += deltaDist;
+        angle += deltaTheta;
+    }
+};
+
+// Vitesses des roues (mm/s) au temps t : une séquence de 20s répétée pendant tout le match
+static void wheelSpeeds(double t, double *right, double *left)
+{
+    double phase = fmod(t, 20.0);
+    if (phase < 4.0) { // ligne droite rapide
+        *right = *left = 800.0;
+    } else if (phase < 8.0) { // grand arc
+        *right = 600.0;
+        *left = 450.0;
+    } else if (phase < 10.0) { // rotation sur place
+        *right = 250.0;
+        *left = -250.0;
+    } else if (phase < 16.0) { // trajectoire sinueuse
+        *right = 400.0 + 250.0 * sin(1.3 * t);
+        *left = 400.0 + 250.0 * sin(1.3 * t + 1.1);
+    } else { // approche lente en marche arrière
+        *right = -15.0;
+        *left = -14.0;
+    }
+}
+
+static double wrapAngle(double angle)
+{
+    return remainder(angle, 2.0 * M_PI);
+}
+
+int main(int argc, char **argv)
+{
+    const double duration_s = (argc > 1) ? strtod(argv[1], nullptr) : 100.0;
+    const double loopPeriod = 1.0 / ASSERV_THREAD_FREQUENCY;
+    const double mmByTick = (2.0 * M_PI * ENCODERS_WHEELS_RADIUS_MM) / ENCODERS_TICKS_BY_TURN;
+    const float encodermmByTicks = float(M_2PI_F * float(ENCODERS_WHEELS_RADIUS_MM)) / ENCODERS_TICKS_BY_TURN;
+    const uint32_t nbIterations = (uint32_t) (duration_s * ASSERV_THREAD_FREQUENCY);
+
+    Odometry odometry(ENCODERS_WHEELS_DISTANCE_MM);
+    LegacyOdometry legacyOdometry(ENCODERS_WHEELS_DISTANCE_MM);
+    ReferenceOdometry reference;
+    Regulator distanceRegulator(1, 1);
+    Regulator angleRegulator(1, 1);
+    float naiveDistanceAccumulator = 0;
+
+    double rightPosition_ticks = 0, leftPosition_ticks = 0;
+    int64_t rightCount = 0, leftCount = 0;
+    for (uint32_t i = 1; i <= nbIterations; i++)
+    {
+        double right, left;
+        wheelSpeeds(i * loopPeriod, &right, &left);
+        rightPosition_ticks += right * loopPeriod / mmByTick;
+        leftPosition_ticks += left * loopPeriod / mmByTick;
+
+        // Deltas entiers en ticks, comme les codeurs
+        int64_t newRightCount = (int64_t) floor(rightPosition_ticks);
+        int64_t newLeftCount = (int64_t) floor(leftPosition_ticks);
+        float deltaRight = float(newRightCount - rightCount);
+        float deltaLeft = float(newLeftCount - leftCount);
+        rightCount = newRightCount;
+        leftCount = newLeftCount;
+
+        // Comme AsservMain::loopIteration()
+        float deltaRight_mm = deltaRight * encodermmByTicks;
+        float deltaLeft_mm = deltaLeft * encodermmByTicks;
+        odometry.refresh(deltaRight_mm, deltaLeft_mm);
+        legacyOdometry.refresh(deltaRight_mm, deltaLeft_mm);
+        float deltaDistance = (deltaRight_mm + deltaLeft_mm) * 0.5f;
+        distanceRegulator.updateFeedback(deltaDistance);
+        angleRegulator.updateFeedback((deltaRight_mm - deltaLeft_mm) / float(ENCODERS_WHEELS_DISTANCE_MM));
+        naiveDistanceAccumulator += deltaDistance;
+
+        reference.refresh(deltaRight_mm, deltaLeft_mm, float(ENCODERS_WHEELS_DISTANCE_MM));
+    }
+
+    double legacyPositionError = hypot(legacyOdometry.m_X_mm - reference.x, legacyOdometry.m_Y_mm - reference.y);
+    double legacyThetaError = fabs(wrapAngle(legacyOdometry.m_theta_rad - reference.theta));
+    double positionError = hypot(odometry.getX() - reference.x, odometry.getY() - reference.y);
+    double thetaError = fabs(wrapAngle(odometry.getTheta() - reference.theta));
+    double distanceError = fabs(distanceRegulator.getAccumulator() - reference.distance);
+    double angleError = fabs(angleRegulator.getAccumulator() - reference.angle);
+    double naiveDistanceError = fabs(naiveDistanceAccumulator - reference.distance);
+
+    printf("%s : %.0f s at %d Hz, %.1f m travelled, final position (%.1f, %.1f) mm\n", ROBOT_NAME, duration_s,
+            ASSERV_THREAD_FREQUENCY, (double) reference.distance / 1000.0, (double) reference.x, (double) reference.y);
+    printf("  odometry        : legacy %9.4f mm %.2e rad | single precision %9.4f mm %.2e rad\n", legacyPositionError,
+            legacyThetaError, positionError, thetaError);
+    printf("  accumulators    : distance %.2e mm (plain float sum %.2e mm), angle %.2e rad\n", distanceError,
+            naiveDistanceError, angleError);
+
+    bool ok = positionError < maxPositionError_mm && thetaError < maxThetaError_rad
+            && distanceError < maxAccumulatorError && angleError < maxAccumulatorError;
+    if (!ok)
+        printf("  FAILED, drift above the thresholds (%.2f mm, %.0e rad, %.0e)\n", maxPositionError_mm, maxThetaError_rad,
+                maxAccumulatorError);
+    return ok ? 0 : 1;
+}
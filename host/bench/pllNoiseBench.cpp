@@ -0,0 +1,137 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <random>
+
+#include "robotConfig.h"
+#include "Pll.h"
+
+/*
+ * Banc host du plancher de bruit de l'estimation de vitesse (Pll) pour le robot ROBOT_NAME.
+ *
+ *  Des traces codeur synthétiques (vitesse constante, position quantifiée au tick, bruit de +-1 LSB
+ *  optionnel comme un AS5048B, gain de calibration comme QuadratureEncoder) sont passées à la Pll actuelle,
+ *  qui suit la position en ticks fractionnaires, et à l'ancienne Pll (deltas tronqués en int16_t, erreur
+ *  calculée sur floor() de la position), recopiée ici comme référence.
+ *  Une fois la Pll accrochée, on mesure le biais et l'écart type de la vitesse estimée, en mm/s.
+ *
+ *  usage : pllNoiseBench [durée simulée par cas, en s]
+ */
+
+/*
+ * Pll d'avant le passage en ticks fractionnaires
+ */
+class LegacyPll
+{
+public:
+    explicit LegacyPll(float bandwidth)
+    {
+        m_kp = 2.0f * bandwidth;
+        m_ki = 0.25f * m_kp * m_kp;
+        m_position = 0;
+        m_speed = 0;
+        m_count = 0;
+    }
+
+    void update(int16_t deltaTicks, float deltaT)
+    {
+        m_position += deltaT * m_speed;
+        m_count += deltaTicks;
+        float deltaPos = (float) (m_count - (int64_t) floor(m_position));
+        m_position += deltaT * m_kp * deltaPos;
+        m_speed += deltaT * m_ki * deltaPos;
+        if (fabsf(m_speed) < 0.5f * deltaT * m_ki)
+            m_speed = 0.0f;
+    }
+
+    float getSpeed()
+    {
+        return m_speed;
+    }
+
+private:
+    float m_kp;
+    float m_ki;
+    float m_position;
+    float m_speed;
+    int64_t m_count;
+};
+
+struct EncoderTrace
+{
+    const char *name;
+    float gain; // gain de calibration appliqué aux deltas (1 = pas de correction)
+    bool jitter; // bruit de +-1 LSB sur la position lue
+};
+
+struct NoiseStats
+{
+    double bias_mmps;
+    double stddev_mmps;
+};
+
+static constexpr double mmByTick = (2.0 * M_PI * ENCODERS_WHEELS_RADIUS_MM) / ENCODERS_TICKS_BY_TURN;
+static constexpr float loopPeriod = 1.0f / ASSERV_THREAD_FREQUENCY;
+
+template<class PllType, class DeltaType>
+static NoiseStats runTrace(const EncoderTrace &trace, double speed_mmps, double duration_s)
+{
+    PllType pll(PLL_BANDWIDTH);
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> lsbNoise(-1, 1);
+
+    const uint32_t nbIterations = (uint32_t) (duration_s * ASSERV_THREAD_FREQUENCY);
+    const uint32_t settleIterations = ASSERV_THREAD_FREQUENCY; // 1s pour que la Pll s'accroche
+
+    // Vitesse vue par la Pll : les deltas sont multipliés par le gain de calibration
+    const double rawTicksByPeriod = speed_mmps / mmByTick / trace.gain * loopPeriod;
+
+    int64_t previousCount = 0;
+    double sumError = 0;
+    double sumSquaredError = 0;
+    for (uint32_t i = 1; i <= nbIterations; i++)
+    {
+        int64_t count = (int64_t) floor(rawTicksByPeriod * i) + (trace.jitter ? lsbNoise(random) : 0);
+        float delta = (float) (count - previousCount) * trace.gain;
+        previousCount = count;
+
+        pll.update((DeltaType) delta, loopPeriod);
+
+        if (i > settleIterations)
+        {
+            double error = pll.getSpeed() * mmByTick - speed_mmps;
+            sumError += error;
+            sumSquaredError += error * error;
+        }
+    }
+
+    uint32_t n = nbIterations - settleIterations;
+    double mean = sumError / n;
+    return {mean, sqrt(sumSquaredError / n - mean * mean)};
+}
+
+int main(int argc, char **argv)
+{
+    const double duration_s = (argc > 1) ? strtod(argv[1], nullptr) : 10.0;
+
+    const EncoderTrace traces[] = {
+            { "exact ticks", 1.0f, false },
+            { "gain 0.985", 0.985f, false },
+            { "gain 1.012 +-1 LSB", 1.012f, true },
+    };
+    const double speeds_mmps[] = { 2.0, 10.0, 50.0, 300.0 };
+
+    printf("%s : PLL bandwidth %d, %d Hz, %.4f mm/tick\n", ROBOT_NAME, PLL_BANDWIDTH, ASSERV_THREAD_FREQUENCY, mmByTick);
+    printf("  %-20s %8s | %22s | %22s\n", "trace", "mm/s", "legacy bias / stddev", "fractional bias / stddev");
+    for (const EncoderTrace &trace : traces)
+    {
+        for (double speed : speeds_mmps)
+        {
+            NoiseStats legacy = runTrace<LegacyPll, int16_t>(trace, speed, duration_s);
+            NoiseStats fractional = runTrace<Pll, float>(trace, speed, duration_s);
+            printf("  %-20s %8.1f | %10.3f / %9.3f | %10.3f / %9.3f\n", trace.name, speed, legacy.bias_mmps,
+                    legacy.stddev_mmps, fractional.bias_mmps, fractional.stddev_mmps);
+        }
+    }
+    return 0;
+}
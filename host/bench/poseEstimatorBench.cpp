@@ -0,0 +1,251 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+
+#include "SimulatedRobot.h"
+#include "PoseEstimator.h"
+#include "USBStream.h"
+#include "SimulatedGyro.h"
+#include "GotoTestRoute.h"
+#include "CycleCounter.h"
+
+/*
+ * Estimateur de position (PoseEstimator) du robot ROBOT_NAME, sur robot simulé réaliste (voir host/sim/DiffDrivePlant.h),
+ *  pour les robots qui ont des codeurs sur les roues motrices (MOTOR_ENCODERS_TICKS_BY_TURN dans leur robotConfig.h).
+ *
+ *  L'asserv suit la trajectoire "asserv gototest" sur son Odometry, comme sur le robot ; l'estimateur tourne à côté.
+ *  Les codeurs des roues motrices ont des erreurs de rayon et de voie, les roues motrices patinent. Trois cas :
+ *   - nominal : roues folles toujours au sol,
+ *   - lifts : une roue folle décolle régulièrement (0.2 s toutes les 3 s). L'asserv, sur l'Odometry, force alors
+ *     sur la roue motrice du même côté qui patine : ce côté n'est plus mesuré, et une roue qui décolle à l'arrêt ne se
+ *     voit pas. Donné pour information,
+ *   - lifts+gyro : idem, avec un gyromètre simulé (biais et bruit), qui tranche.
+ *  Pour chacun, erreur finale de l'Odometry et de l'estimateur face à la position réelle, part des itérations où l'erreur
+ *  de l'estimateur reste dans ses 3 écarts types, et calibration apprise des roues motrices face à la vraie.
+ *  Puis le coût d'un update(), en ns et en cycles.
+ *
+ *  Échoue si l'estimateur fait moins bien que l'Odometry sans décollage, ou n'en retire pas l'essentiel de l'erreur
+ *  avec décollages et gyromètre, si ses covariances ne couvrent pas l'erreur réelle, ou si la calibration apprise est fausse.
+ *
+ *  usage : poseEstimatorBench
+ */
+
+#ifndef MOTOR_ENCODERS_TICKS_BY_TURN
+
+int main()
+{
+    printf("%s : no motor encoders, pose estimator not used\n", ROBOT_NAME);
+    return 0;
+}
+
+#else
+
+static constexpr double ROUTE_TIMEOUT_S = 120;
+// Erreurs réelles des roues motrices face aux valeurs nominales du robotConfig.h
+static constexpr float RIGHT_MOTOR_RADIUS_ERROR = 0.015f;
+static constexpr float LEFT_MOTOR_RADIUS_ERROR = -0.010f;
+static constexpr float MOTOR_WHEELS_DISTANCE_ERROR = 0.02f;
+// Décollage périodique d'une roue folle, en alternant les côtés
+static constexpr double LIFT_PERIOD_S = 3;
+static constexpr double LIFT_DURATION_S = 0.2;
+// Gyromètre simulé
+static constexpr float GYRO_BIAS_RADPS = 0.002f;
+static constexpr float GYRO_NOISE_RADPS = 0.01f;
+
+// Sans décollage, l'estimateur ne doit pas dégrader l'Odometry (marge pour la quantification)
+static constexpr double NOMINAL_MAX_EXTRA_ERROR_MM = 1;
+// Avec décollages et gyromètre, il doit en retirer l'essentiel de l'erreur
+static constexpr double LIFT_MIN_ERROR_REDUCTION = 5;
+static constexpr double MIN_CONSISTENCY = 0.9;
+static constexpr double MAX_MOTOR_SCALE_ERROR = 0.003;
+static constexpr double MAX_MOTOR_TRACK_ERROR_MM = 2;
+
+static constexpr int TIMING_ITERATIONS = 200000;
+
+struct ScenarioResult
+{
+    bool completed;
+    double odometryError_mm;
+    double odometryAngleError_rad;
+    double estimatorError_mm;
+    double estimatorAngleError_rad;
+    double consistency;           // part des itérations où l'erreur de l'estimateur est dans ses 3 écarts types
+    double rightScaleError;       // facteur d'échelle appris / réel
+    double leftScaleError;
+    double trackError_mm;
+    double headingRateBiasError;  // rad/s
+    uint32_t freeWheelRejects;
+    uint32_t motorRejects;
+};
+
+static bool withinThreeSigma(double error, float variance)
+{
+    return error * error <= 9.0 * double(variance);
+}
+
+static ScenarioResult simulateScenario(const DiffDrivePlant::Configuration &plantConfiguration, bool lifts, bool gyro)
+{
+    SimulatedRobot robot(plantConfiguration);
+    DiffDrivePlant &plant = robot.plant;
+    Odometry &odometry = robot.odometry;
+    CommandManager &commandManager = robot.commandManager;
+    SimAsservMain &mainAsserv = robot.mainAsserv;
+
+    SimulatedGyro simulatedGyro(plant, GYRO_BIAS_RADPS, GYRO_NOISE_RADPS);
+    PoseEstimator poseEstimator(poseEstimatorConf, plant.getMotorEncoders(), gyro ? &simulatedGyro : nullptr);
+    mainAsserv.setPoseEstimator(&poseEstimator);
+
+    addGotoTestRoute(commandManager);
+
+    ScenarioResult result;
+    result.completed = false;
+    uint32_t iterations = 0;
+    uint32_t consistentIterations = 0;
+
+    while (plant.getTime_s() < ROUTE_TIMEOUT_S)
+    {
+        if (lifts)
+        {
+            const double time = plant.getTime_s();
+            const bool lifted = fmod(time, LIFT_PERIOD_S) >= LIFT_PERIOD_S - LIFT_DURATION_S;
+            const bool rightSide = int(time / LIFT_PERIOD_S) % 2 == 0;
+            plant.setEncodersContact((lifted && rightSide) ? 0 : 1, (lifted && !rightSide) ? 0 : 1);
+        }
+
+        mainAsserv.loopIteration();
+
+        float covariance[3][3];
+        poseEstimator.getPoseCovariance(covariance);
+        const double errorX = poseEstimator.getX() - plant.getX_mm();
+        const double errorY = poseEstimator.getY() - plant.getY_mm();
+        const double errorTheta = remainder(poseEstimator.getTheta() - plant.getTheta_rad(), M_2PI);
+        iterations++;
+        if (withinThreeSigma(errorX, covariance[0][0]) && withinThreeSigma(errorY, covariance[1][1])
+                && withinThreeSigma(errorTheta, covariance[2][2]))
+            consistentIterations++;
+
+        if (commandManager.getPendingCommandCount() == 0 && commandManager.getCommandStatus() == CommandManager::STATUS_IDLE)
+        {
+            result.completed = true;
+            break;
+        }
+    }
+
+    result.odometryError_mm = hypot(odometry.getX() - plant.getX_mm(), odometry.getY() - plant.getY_mm());
+    result.odometryAngleError_rad = fabs(remainder(odometry.getTheta() - plant.getTheta_rad(), M_2PI));
+    result.estimatorError_mm = hypot(poseEstimator.getX() - plant.getX_mm(), poseEstimator.getY() - plant.getY_mm());
+    result.estimatorAngleError_rad = fabs(remainder(poseEstimator.getTheta() - plant.getTheta_rad(), M_2PI));
+    result.consistency = double(consistentIterations) / iterations;
+
+    // Le codeur compte distance / (rayon réel), l'estimateur le voit comme distance * échelle / (rayon nominal)
+    result.rightScaleError = fabs(poseEstimator.getRightMotorScale() * (1.0 + plantConfiguration.rightMotorEncoderRadiusError) - 1.0);
+    result.leftScaleError = fabs(poseEstimator.getLeftMotorScale() * (1.0 + plantConfiguration.leftMotorEncoderRadiusError) - 1.0);
+    result.trackError_mm = fabs(poseEstimator.getMotorWheelsDistance() - plantConfiguration.motorWheelsDistance_mm);
+    result.headingRateBiasError = gyro ? fabs(poseEstimator.getHeadingRateBias() - GYRO_BIAS_RADPS) : 0;
+    result.freeWheelRejects = poseEstimator.getRejectCount(PoseEstimator::SOURCE_RIGHT_ENCODER)
+            + poseEstimator.getRejectCount(PoseEstimator::SOURCE_LEFT_ENCODER);
+    result.motorRejects = poseEstimator.getRejectCount(PoseEstimator::SOURCE_RIGHT_MOTOR_ENCODER)
+            + poseEstimator.getRejectCount(PoseEstimator::SOURCE_LEFT_MOTOR_ENCODER);
+    return result;
+}
+
+static void printResult(const char *name, const ScenarioResult &result)
+{
+    printf("  %-10s : %s, odometry error %7.2f mm %7.4f rad, estimator error %6.2f mm %7.4f rad, within 3 sigma %5.1f%%,"
+            " motor scale error %.4f %.4f, motor track error %5.2f mm, gyro bias error %.4f rad/s, rejects %u free wheels %u motors\n",
+            name, result.completed ? "done   " : "TIMEOUT", result.odometryError_mm, result.odometryAngleError_rad,
+            result.estimatorError_mm, result.estimatorAngleError_rad, 100.0 * result.consistency,
+            result.rightScaleError, result.leftScaleError, result.trackError_mm, result.headingRateBiasError,
+            unsigned(result.freeWheelRejects), unsigned(result.motorRejects));
+}
+
+static bool checkCalibration(const ScenarioResult &result)
+{
+    return result.consistency >= MIN_CONSISTENCY
+            && result.rightScaleError <= MAX_MOTOR_SCALE_ERROR && result.leftScaleError <= MAX_MOTOR_SCALE_ERROR
+            && result.trackError_mm <= MAX_MOTOR_TRACK_ERROR_MM;
+}
+
+/*
+ * Coût d'une itération de l'estimateur seul, sur des deltas de ligne droite en légère courbe
+ */
+class ConstantEncoders final : public Encoders
+{
+public:
+    explicit ConstantEncoders(float right, float left) : m_right(right), m_left(left)
+    {
+    }
+    virtual ~ConstantEncoders()
+    {
+    }
+    virtual void getValues(float *deltaEncoderRight, float *deltaEncoderLeft) override
+    {
+        *deltaEncoderRight = m_right;
+        *deltaEncoderLeft = m_left;
+    }
+
+private:
+    float m_right;
+    float m_left;
+};
+
+static void measureUpdateCost()
+{
+    const float motormmByTick = poseEstimatorConf.motorEncodermmByTick;
+    ConstantEncoders motorEncoders(float(int(2.5f / motormmByTick)), float(int(2.4f / motormmByTick)));
+    PoseEstimator poseEstimator(poseEstimatorConf, motorEncoders);
+
+    CycleCounter cycleCounter;
+    auto start = std::chrono::steady_clock::now();
+    cycleCounter.start();
+    for (int i = 0; i < TIMING_ITERATIONS; i++)
+        poseEstimator.update(2.5f, 2.4f, ASSERV_THREAD_PERIOD_S);
+    uint64_t cycles = cycleCounter.stop();
+    double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    printf("  update     : %6.1f ns, %6.1f %s by iteration (X %.1f, keeps the result alive)\n",
+            elapsed_ns / TIMING_ITERATIONS, double(cycles) / TIMING_ITERATIONS,
+            cycleCounter.isReferenceCycles() ? "reference cycles" : "cycles", poseEstimator.getX());
+}
+
+int main()
+{
+    USBStream::init();
+
+    printf("%s : pose estimator, gototest route, motor encoders radius error %+.1f%% %+.1f%%, track error %+.1f%%\n", ROBOT_NAME,
+            100.0 * RIGHT_MOTOR_RADIUS_ERROR, 100.0 * LEFT_MOTOR_RADIUS_ERROR, 100.0 * MOTOR_WHEELS_DISTANCE_ERROR);
+
+    // Robot réaliste (comme routeSim), roues folles calibrées : l'estimateur ne corrige pas leur géométrie
+    DiffDrivePlant::Configuration plantConfiguration = simulatedPlantConfiguration();
+    plantConfiguration.maxGroundAcceleration_mmps2 = 3000;
+    plantConfiguration.motorWheelsDistance_mm = MOTOR_ENCODERS_WHEELS_DISTANCE_MM * (1.0f + MOTOR_WHEELS_DISTANCE_ERROR);
+    plantConfiguration.motorEncoderWheelRadius_mm = MOTOR_ENCODERS_WHEELS_RADIUS_MM;
+    plantConfiguration.rightMotorEncoderRadiusError = RIGHT_MOTOR_RADIUS_ERROR;
+    plantConfiguration.leftMotorEncoderRadiusError = LEFT_MOTOR_RADIUS_ERROR;
+    plantConfiguration.motorEncoderTicksByTurn = MOTOR_ENCODERS_TICKS_BY_TURN;
+
+    ScenarioResult nominal = simulateScenario(plantConfiguration, false, false);
+    printResult("nominal", nominal);
+    ScenarioResult lifts = simulateScenario(plantConfiguration, true, false);
+    printResult("lifts", lifts);
+    ScenarioResult liftsGyro = simulateScenario(plantConfiguration, true, true);
+    printResult("lifts+gyro", liftsGyro);
+
+    measureUpdateCost();
+
+    bool ok = nominal.estimatorError_mm <= nominal.odometryError_mm + NOMINAL_MAX_EXTRA_ERROR_MM
+            && liftsGyro.estimatorError_mm * LIFT_MIN_ERROR_REDUCTION <= liftsGyro.odometryError_mm
+            && checkCalibration(nominal) && checkCalibration(liftsGyro);
+    if (!ok)
+    {
+        printf("%s : FAILED (estimator error above odometry + %.0f mm without lifts, not %.0f times below it with lifts and gyro,"
+                " less than %.0f%% of iterations within 3 sigma, or motor scale error above %.3f / track error above %.0f mm)\n",
+                ROBOT_NAME, NOMINAL_MAX_EXTRA_ERROR_MM, LIFT_MIN_ERROR_REDUCTION, 100.0 * MIN_CONSISTENCY,
+                MAX_MOTOR_SCALE_ERROR, MAX_MOTOR_TRACK_ERROR_MM);
+        return 1;
+    }
+    return 0;
+}
+
+#endif
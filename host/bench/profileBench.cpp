@@ -0,0 +1,192 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+#include "SimulatedRobot.h"
+#include "USBStream.h"
+
+/*
+ * Temps d'arrivée des lignes droites et des rotations du robot ROBOT_NAME, sur robot simulé réaliste
+ *  (voir host/sim/DiffDrivePlant.h) : chaîne de limiteurs d'accélération seule, puis profil de vitesse en S
+ *  (voir src/commandManager/SCurveProfile.h, réglages DIST_PROFILE_* et ANGLE_PROFILE_* du robotConfig.h).
+ *
+ *  Chaque déplacement part de l'arrêt, sur un robot neuf. On mesure, sur la position réelle :
+ *   - l'arrivée : instant où le CommandManager considère la commande terminée,
+ *   - l'établissement : dernier instant hors tolérance (arrêt observé HOLD_S après l'arrivée),
+ *   - le dépassement au delà du but, l'erreur finale, l'accélération max au sol d'une roue motrice et le patinage.
+ *  L'accélération est prise sur une période de l'asserv en position (ASSERV_POSITION_DIVISOR itérations) : d'une itération
+ *  à l'autre, elle est dominée par le pas de la consigne quantifiée par la MD22 (±200 mm/s² sur le PMI).
+ *
+ *  Échoue si un déplacement n'est pas terminé en MOVE_TIMEOUT_S, s'il s'arrête hors tolérance, ou si un profil
+ *  dépasse l'accélération max des régulateurs (DIST_REGULATOR_MAX_ACC, ANGLE_REGULATOR_MAX_ACC sur chaque roue).
+ *
+ *  usage : profileBench
+ */
+
+static constexpr double MOVE_TIMEOUT_S = 10;
+static constexpr double HOLD_S = 0.5;
+static constexpr double SETTLE_DISTANCE_MM = 3;
+static constexpr double SETTLE_ANGLE_RAD = 0.01;
+// Erreur finale admise : la fenêtre d'arrivée du CommandManager, plus la tolérance d'établissement
+static constexpr double MAX_FINAL_DISTANCE_ERROR_MM = COMMAND_MANAGER_ARRIVAL_DISTANCE_THRESHOLD_mm + SETTLE_DISTANCE_MM;
+static constexpr double MAX_FINAL_ANGLE_ERROR_RAD = COMMAND_MANAGER_ARRIVAL_ANGLE_THRESHOLD_RAD + SETTLE_ANGLE_RAD;
+
+struct Move
+{
+    bool turn;
+    float value;    // mm ou rad
+};
+
+static const Move s_moves[] = {
+    { false, 50 },
+    { false, 200 },
+    { false, 500 },
+    { false, 1000 },
+    { false, -300 },
+    { true, float(M_PI / 8) },
+    { true, float(M_PI / 2) },
+    { true, float(M_PI) },
+    { true, float(-M_PI / 2) },
+};
+
+struct MoveResult
+{
+    bool completed;
+    double arrival_s;
+    double settling_s;
+    double overshoot;     // mm ou rad
+    double finalError;    // mm ou rad
+    double peakAcceleration_mmps2;  // roue motrice la plus sollicitée
+    double slip_mm;
+};
+
+static MoveResult simulateMove(const Move &move, bool motionProfile)
+{
+    SimulatedRobot robot(realisticPlantConfiguration());
+    DiffDrivePlant &plant = robot.plant;
+    CommandManager &commandManager = robot.commandManager;
+    SimAsservMain &mainAsserv = robot.mainAsserv;
+    commandManager.enableMotionProfile(motionProfile);
+
+    if (move.turn)
+        commandManager.addTurn(move.value);
+    else
+        commandManager.addStraightLine(move.value);
+
+    const double sign = (move.value >= 0) ? 1 : -1;
+    const double period = 1.0 / ASSERV_THREAD_FREQUENCY;
+
+    MoveResult result = MoveResult();
+    double lastUnsettledTime = 0;
+    double holdEnd = 0;
+    // Vitesses au sol des ASSERV_POSITION_DIVISOR dernières itérations, la plus ancienne en rightSpeeds[oldest]
+    double rightSpeeds[ASSERV_POSITION_DIVISOR] = {};
+    double leftSpeeds[ASSERV_POSITION_DIVISOR] = {};
+    int oldest = 0;
+
+    while (true)
+    {
+        mainAsserv.loopIteration();
+        const double now = plant.getTime_s();
+
+        // Accélération au sol de chaque roue motrice, en ligne droite comme en rotation
+        result.peakAcceleration_mmps2 = std::max(result.peakAcceleration_mmps2,
+                std::max(fabs(plant.getRightGroundSpeed() - rightSpeeds[oldest]), fabs(plant.getLeftGroundSpeed() - leftSpeeds[oldest]))
+                / (ASSERV_POSITION_DIVISOR * period));
+        rightSpeeds[oldest] = plant.getRightGroundSpeed();
+        leftSpeeds[oldest] = plant.getLeftGroundSpeed();
+        oldest = (oldest + 1) % ASSERV_POSITION_DIVISOR;
+
+        // Erreur signée dans le sens du déplacement : positive au delà du but
+        double error;
+        bool settled;
+        if (move.turn)
+        {
+            error = sign * (plant.getTheta_rad() - move.value);
+            settled = fabs(error) <= SETTLE_ANGLE_RAD;
+        }
+        else
+        {
+            error = sign * (plant.getX_mm() - move.value);
+            settled = hypot(plant.getX_mm() - move.value, plant.getY_mm()) <= SETTLE_DISTANCE_MM;
+        }
+        result.overshoot = std::max(result.overshoot, error);
+        if (!settled)
+            lastUnsettledTime = now;
+
+        if (holdEnd == 0)
+        {
+            if (commandManager.getPendingCommandCount() == 0 && commandManager.getCommandStatus() == CommandManager::STATUS_IDLE)
+            {
+                result.completed = true;
+                result.arrival_s = now;
+                holdEnd = now + HOLD_S;
+            }
+            else if (now > MOVE_TIMEOUT_S)
+                break;
+        }
+        else if (now >= holdEnd)
+            break;
+    }
+
+    result.settling_s = lastUnsettledTime;
+    if (move.turn)
+        result.finalError = fabs(plant.getTheta_rad() - move.value);
+    else
+        result.finalError = hypot(plant.getX_mm() - move.value, plant.getY_mm());
+    result.slip_mm = plant.getSlipDistance_mm();
+    return result;
+}
+
+static bool printResult(const char *mode, const MoveResult &result, bool turn, bool motionProfile)
+{
+    const char *unit = turn ? "rad" : "mm ";
+    const double maxAcceleration = turn ? ANGLE_REGULATOR_MAX_ACC : DIST_REGULATOR_MAX_ACC;
+    const bool accelerationExceeded = motionProfile && result.peakAcceleration_mmps2 > maxAcceleration;
+    printf("    %-8s : %s arrival %6.3f s, settling %6.3f s, overshoot %7.3f %s, final error %6.3f %s, peak acc %6.0f mm/s2%s, slip %6.1f mm\n",
+            mode, result.completed ? "done   " : "TIMEOUT", result.arrival_s, result.settling_s,
+            result.overshoot, unit, result.finalError, unit, result.peakAcceleration_mmps2, accelerationExceeded ? " (ABOVE MAX)" : "", result.slip_mm);
+
+    return result.completed && result.finalError <= (turn ? MAX_FINAL_ANGLE_ERROR_RAD : MAX_FINAL_DISTANCE_ERROR_MM)
+            && !accelerationExceeded;
+}
+
+int main()
+{
+    USBStream::init();
+
+    printf("%s : time to arrival, acceleration limiters vs S-curve profile (%.0f mm/s, %.0f mm/s2, %.0f mm/s3 | %.1f rad/s, %.1f rad/s2, %.0f rad/s3)\n",
+            ROBOT_NAME, distanceProfileConf.maxSpeed, distanceProfileConf.maxAcceleration, distanceProfileConf.maxJerk,
+            angleProfileConf.maxSpeed, angleProfileConf.maxAcceleration, angleProfileConf.maxJerk);
+
+    bool ok = true;
+    double limiterArrival = 0, profileArrival = 0;
+    double limiterSettling = 0, profileSettling = 0;
+    for (const Move &move : s_moves)
+    {
+        printf("  %s %g %s\n", move.turn ? "turn" : "straight", move.value, move.turn ? "rad" : "mm");
+
+        MoveResult limiter = simulateMove(move, false);
+        ok &= printResult("limiters", limiter, move.turn, false);
+        MoveResult profile = simulateMove(move, true);
+        ok &= printResult("s-curve", profile, move.turn, true);
+
+        limiterArrival += limiter.arrival_s;
+        profileArrival += profile.arrival_s;
+        limiterSettling += limiter.settling_s;
+        profileSettling += profile.settling_s;
+    }
+
+    printf("  total : arrival %.3f s -> %.3f s (x%.2f), settling %.3f s -> %.3f s (x%.2f)\n",
+            limiterArrival, profileArrival, limiterArrival / profileArrival,
+            limiterSettling, profileSettling, limiterSettling / profileSettling);
+
+    if (!ok)
+    {
+        printf("%s : FAILED (move not completed in %.0f s, final error above %.1f mm / %.3f rad, or profile above %.0f / %.0f mm/s2)\n",
+                ROBOT_NAME, MOVE_TIMEOUT_S, MAX_FINAL_DISTANCE_ERROR_MM, MAX_FINAL_ANGLE_ERROR_RAD, (double)DIST_REGULATOR_MAX_ACC, (double)ANGLE_REGULATOR_MAX_ACC);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+
+#include "SimulatedRobot.h"
+#include "USBStream.h"
+#include "GotoTestRoute.h"
+
+/*
+ * Simulation en boucle fermée de la trajectoire "asserv gototest" pour le robot ROBOT_NAME.
+ *
+ *  La chaîne de contrôle est celle de src/Robots/<ROBOT_NAME>/main.cpp (mêmes réglages via robotConfig.h),
+ *  les codeurs et les moteurs sont remplacés par le robot simulé (voir host/sim/DiffDrivePlant.h), en temps virtuel.
+ *  Deux robots simulés : idéal, puis avec des imperfections réalistes (moteurs, zone morte, MD22, patinage, géométrie).
+ *
+ *  Échoue si la trajectoire n'est pas terminée en MAX_ROUTE_TIME_S de temps virtuel,
+ *  ou si le robot idéal ne revient pas à son point de départ, ou si son odométrie diverge de sa position réelle.
+ *
+ *  usage : routeSim
+ */
+
+static constexpr double MAX_ROUTE_TIME_S = 120;
+// Les commandes relatives (StraitLine, Turn) cumulent leurs fenêtres d'arrivée : le retour n'est pas exact même sur le robot idéal.
+//  Le GotoAngle vise (100, 0) depuis le point d'arrêt du Goto (0, 0) dans sa fenêtre : l'écart de cap qui en résulte se retrouve sur la ligne droite
+static constexpr double IDEAL_MAX_POSITION_ERROR_MM = 12;
+static constexpr double IDEAL_MAX_ANGLE_ERROR_RAD = 0.05;
+// Sur le robot idéal, l'odométrie ne doit s'écarter de la position réelle que par la quantification des codeurs
+static constexpr double IDEAL_MAX_ODOMETRY_ERROR_MM = 0.5;
+
+struct RouteResult
+{
+    bool completed;
+    double routeTime_s;
+    double wallTime_ms;
+    double positionError_mm;     // position réelle finale / point de départ
+    double angleError_rad;
+    double odometryError_mm;     // odométrie / position réelle
+    double slipDistance_mm;
+};
+
+static RouteResult simulateRoute(const DiffDrivePlant::Configuration &plantConfiguration)
+{
+    SimulatedRobot robot(plantConfiguration);
+    DiffDrivePlant &plant = robot.plant;
+    Odometry &odometry = robot.odometry;
+    CommandManager &commandManager = robot.commandManager;
+    SimAsservMain &mainAsserv = robot.mainAsserv;
+
+    addGotoTestRoute(commandManager);
+
+    RouteResult result;
+    result.completed = false;
+
+    auto start = std::chrono::steady_clock::now();
+    while (plant.getTime_s() < MAX_ROUTE_TIME_S)
+    {
+        mainAsserv.loopIteration();
+        if (commandManager.getPendingCommandCount() == 0 && commandManager.getCommandStatus() == CommandManager::STATUS_IDLE)
+        {
+            result.completed = true;
+            break;
+        }
+    }
+    result.wallTime_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    result.routeTime_s = plant.getTime_s();
+    result.positionError_mm = hypot(plant.getX_mm(), plant.getY_mm());
+    result.angleError_rad = fabs(remainder(plant.getTheta_rad(), M_2PI));
+    result.odometryError_mm = hypot(odometry.getX() - plant.getX_mm(), odometry.getY() - plant.getY_mm());
+    result.slipDistance_mm = plant.getSlipDistance_mm();
+    return result;
+}
+
+static void printResult(const char *plantName, const RouteResult &result)
+{
+    printf("  %-10s : %s in %6.2f s (%6.1f ms wall, x%.0f), return error %6.2f mm %7.4f rad, odometry error %6.2f mm, slip %7.1f mm\n",
+            plantName, result.completed ? "done   " : "TIMEOUT", result.routeTime_s, result.wallTime_ms,
+            result.routeTime_s * 1000.0 / result.wallTime_ms,
+            result.positionError_mm, result.angleError_rad, result.odometryError_mm, result.slipDistance_mm);
+}
+
+int main()
+{
+    USBStream::init();
+
+    printf("%s : gototest route, %d Hz\n", ROBOT_NAME, ASSERV_THREAD_FREQUENCY);
+
+    DiffDrivePlant::Configuration ideal = DiffDrivePlant::idealConfiguration(ASSERV_THREAD_FREQUENCY, 1.2f * MAX_SPEED_MM_PER_SEC,
+            ENCODERS_WHEELS_RADIUS_MM, ENCODERS_WHEELS_DISTANCE_MM, ENCODERS_TICKS_BY_TURN);
+
+    DiffDrivePlant::Configuration realistic = realisticPlantConfiguration();
+    realistic.rightEncoderRadiusError = 0.002f;
+    realistic.leftEncoderRadiusError = -0.001f;
+    realistic.encoderWheelsDistance_mm = ENCODERS_WHEELS_DISTANCE_MM + 0.5f;
+
+    RouteResult idealResult = simulateRoute(ideal);
+    printResult("ideal", idealResult);
+    RouteResult realisticResult = simulateRoute(realistic);
+    printResult("realistic", realisticResult);
+
+    bool ok = idealResult.completed && realisticResult.completed
+            && idealResult.positionError_mm <= IDEAL_MAX_POSITION_ERROR_MM
+            && idealResult.angleError_rad <= IDEAL_MAX_ANGLE_ERROR_RAD
+            && idealResult.odometryError_mm <= IDEAL_MAX_ODOMETRY_ERROR_MM;
+    if (!ok)
+    {
+        printf("%s : FAILED (route not completed in %.0f s, or ideal return error above %.1f mm / %.2f rad, or ideal odometry error above %.1f mm)\n",
+                ROBOT_NAME, MAX_ROUTE_TIME_S, IDEAL_MAX_POSITION_ERROR_MM, IDEAL_MAX_ANGLE_ERROR_RAD, IDEAL_MAX_ODOMETRY_ERROR_MM);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include "SimulatedRobot.h"
+#include "PoseEstimator.h"
+#include "SlipDetector.h"
+#include "USBStream.h"
+#include "GotoTestRoute.h"
+
+/*
+ * Détection du patinage (SlipDetector) du robot ROBOT_NAME, sur robot simulé réaliste (voir host/sim/DiffDrivePlant.h).
+ *
+ *  Trajectoire "asserv gototest" sur un sol adhérent puis glissant (adhérence à 1.5 fois DIST_REGULATOR_MAX_ACC,
+ *  franchie une fois les accélérations des roues cumulées), sans puis avec détection, aux accélérations des limiteurs et des
+ *  profils du robotConfig.h puis relevées de RAISED_ACCELERATION_FACTOR. Sur les robots qui ont des codeurs moteurs (MOTOR_ENCODERS_TICKS_BY_TURN), la détection est aussi
+ *  rejouée avec le PoseEstimator comme seconde source.
+ *  Puis un aller-retour en ligne droite à profil (PROFILED_LINE_MM) sur sol glissant aux accélérations relevées : les limiteurs
+ *  ne bornent que la correction pendant un profil, le facteur d'accélération doit passer par les profils du CommandManager.
+ *  Pour chaque cas : durée, patinage cumulé des roues motrices, erreur de retour au point de départ, nombre de
+ *  patinages détectés et plus petit facteur d'accélération appliqué.
+ *
+ *  Échoue si une trajectoire avec détection n'aboutit pas, si la détection se déclenche sur sol adhérent aux accélérations nominales,
+ *  ou si elle ne divise pas au moins par MIN_SLIP_REDUCTION le patinage sur sol glissant aux accélérations relevées
+ *  (trajectoire "asserv gototest" et ligne droite à profil).
+ *
+ *  usage : slipBench
+ */
+
+static constexpr double ROUTE_TIMEOUT_S = 120;
+static constexpr float HIGH_GRIP_MMPS2 = 3000;
+static constexpr float LOW_GRIP_MMPS2 = 1.5f * DIST_REGULATOR_MAX_ACC;
+// Les profils, à PROFILE_ACCELERATION_SHARE des accélérations max des régulateurs, passent au double de celles-ci
+static constexpr float RAISED_ACCELERATION_FACTOR = 2.5f;
+static constexpr double MIN_SLIP_REDUCTION = 2;
+static constexpr float PROFILED_LINE_MM = 1000;
+
+enum Route
+{
+    ROUTE_GOTOTEST, ROUTE_PROFILED_LINE
+};
+
+enum Detection
+{
+    DETECTION_OFF, DETECTION_TRACKING, DETECTION_MOTOR_ENCODERS
+};
+
+struct RouteResult
+{
+    bool completed;
+    double routeTime_s;
+    double slipDistance_mm;
+    double returnError_mm;
+    uint32_t slipEvents;
+    float minAccelerationScale;
+};
+
+static RouteResult simulateRoute(const DiffDrivePlant::Configuration &plantConfiguration, float accelerationFactor, Detection detection,
+        Route route = ROUTE_GOTOTEST)
+{
+    SimulatedTuning tuning;
+    tuning.angleMaxAcc *= accelerationFactor;
+    tuning.distMaxAcc *= accelerationFactor;
+    tuning.distMinAcc *= accelerationFactor;
+    tuning.distProfile.maxAcceleration *= accelerationFactor;
+    tuning.angleProfile.maxAcceleration *= accelerationFactor;
+    SimulatedRobot robot(plantConfiguration, tuning);
+    DiffDrivePlant &plant = robot.plant;
+    CommandManager &commandManager = robot.commandManager;
+    SimAsservMain &mainAsserv = robot.mainAsserv;
+
+    SlipDetector slipDetector(slipDetectorConf);
+    if (detection != DETECTION_OFF)
+        mainAsserv.setSlipDetector(&slipDetector);
+#ifdef MOTOR_ENCODERS_TICKS_BY_TURN
+    PoseEstimator poseEstimator(poseEstimatorConf, plant.getMotorEncoders());
+    if (detection == DETECTION_MOTOR_ENCODERS)
+        mainAsserv.setPoseEstimator(&poseEstimator);
+#endif
+
+    if (route == ROUTE_PROFILED_LINE)
+    {
+        commandManager.addStraightLine(PROFILED_LINE_MM);
+        commandManager.addStraightLine(-PROFILED_LINE_MM);
+    }
+    else
+    {
+        addGotoTestRoute(commandManager);
+    }
+
+    RouteResult result;
+    result.completed = false;
+    result.minAccelerationScale = 1;
+    while (plant.getTime_s() < ROUTE_TIMEOUT_S)
+    {
+        mainAsserv.loopIteration();
+        if (slipDetector.getAccelerationScale() < result.minAccelerationScale)
+            result.minAccelerationScale = slipDetector.getAccelerationScale();
+
+        if (robot.isIdle())
+        {
+            result.completed = true;
+            break;
+        }
+    }
+
+    result.routeTime_s = plant.getTime_s();
+    result.slipDistance_mm = plant.getSlipDistance_mm();
+    result.returnError_mm = hypot(plant.getX_mm(), plant.getY_mm());
+    result.slipEvents = slipDetector.getSlipEvents();
+    return result;
+}
+
+static void printResult(const char *name, const RouteResult &result)
+{
+    printf("  %-36s : %s in %6.2f s, slip %7.1f mm, return error %6.2f mm, %3u slip events, min acceleration scale %.2f\n",
+            name, result.completed ? "done   " : "TIMEOUT", result.routeTime_s, result.slipDistance_mm, result.returnError_mm,
+            unsigned(result.slipEvents), result.minAccelerationScale);
+}
+
+int main()
+{
+    USBStream::init();
+
+    printf("%s : slip detection, gototest route and profiled line, grip %.0f / %.0f mm/s2, accelerations x1 / x%.1f\n", ROBOT_NAME,
+            HIGH_GRIP_MMPS2, LOW_GRIP_MMPS2, RAISED_ACCELERATION_FACTOR);
+
+    DiffDrivePlant::Configuration highGrip = simulatedPlantConfiguration();
+    highGrip.maxGroundAcceleration_mmps2 = HIGH_GRIP_MMPS2;
+#ifdef MOTOR_ENCODERS_TICKS_BY_TURN
+    highGrip.motorWheelsDistance_mm = MOTOR_ENCODERS_WHEELS_DISTANCE_MM;
+    highGrip.motorEncoderWheelRadius_mm = MOTOR_ENCODERS_WHEELS_RADIUS_MM;
+    highGrip.motorEncoderTicksByTurn = MOTOR_ENCODERS_TICKS_BY_TURN;
+#endif
+    DiffDrivePlant::Configuration lowGrip = highGrip;
+    lowGrip.maxGroundAcceleration_mmps2 = LOW_GRIP_MMPS2;
+
+    RouteResult highNominal = simulateRoute(highGrip, 1, DETECTION_TRACKING);
+    printResult("high grip, x1, detection", highNominal);
+    RouteResult highRaisedOff = simulateRoute(highGrip, RAISED_ACCELERATION_FACTOR, DETECTION_OFF);
+    printResult("high grip, raised, no detection", highRaisedOff);
+    RouteResult highRaised = simulateRoute(highGrip, RAISED_ACCELERATION_FACTOR, DETECTION_TRACKING);
+    printResult("high grip, raised, detection", highRaised);
+
+    RouteResult lowNominalOff = simulateRoute(lowGrip, 1, DETECTION_OFF);
+    printResult("low grip, x1, no detection", lowNominalOff);
+    RouteResult lowNominal = simulateRoute(lowGrip, 1, DETECTION_TRACKING);
+    printResult("low grip, x1, detection", lowNominal);
+    RouteResult lowRaisedOff = simulateRoute(lowGrip, RAISED_ACCELERATION_FACTOR, DETECTION_OFF);
+    printResult("low grip, raised, no detection", lowRaisedOff);
+    RouteResult lowRaised = simulateRoute(lowGrip, RAISED_ACCELERATION_FACTOR, DETECTION_TRACKING);
+    printResult("low grip, raised, detection", lowRaised);
+
+    // Sans détection, le sol glissant peut faire osciller le robot au-delà du timeout : seules les trajectoires avec détection doivent aboutir
+    bool ok = highNominal.completed && highRaised.completed && lowNominal.completed && lowRaised.completed
+            && highNominal.slipEvents == 0
+            && lowRaised.slipDistance_mm * MIN_SLIP_REDUCTION <= lowRaisedOff.slipDistance_mm;
+
+#ifdef MOTOR_ENCODERS_TICKS_BY_TURN
+    RouteResult lowNominalMotor = simulateRoute(lowGrip, 1, DETECTION_MOTOR_ENCODERS);
+    printResult("low grip, x1, detection + motors", lowNominalMotor);
+    RouteResult lowRaisedMotor = simulateRoute(lowGrip, RAISED_ACCELERATION_FACTOR, DETECTION_MOTOR_ENCODERS);
+    printResult("low grip, raised, detection + motors", lowRaisedMotor);
+    ok = ok && lowNominalMotor.completed && lowRaisedMotor.completed
+            && lowRaisedMotor.slipDistance_mm * MIN_SLIP_REDUCTION <= lowRaisedOff.slipDistance_mm;
+#endif
+
+    RouteResult lineRaisedOff = simulateRoute(lowGrip, RAISED_ACCELERATION_FACTOR, DETECTION_OFF, ROUTE_PROFILED_LINE);
+    printResult("line, low grip, raised, no detection", lineRaisedOff);
+    RouteResult lineRaised = simulateRoute(lowGrip, RAISED_ACCELERATION_FACTOR, DETECTION_TRACKING, ROUTE_PROFILED_LINE);
+    printResult("line, low grip, raised, detection", lineRaised);
+    ok = ok && lineRaised.completed && lineRaised.slipDistance_mm * MIN_SLIP_REDUCTION <= lineRaisedOff.slipDistance_mm;
+
+    if (!ok)
+    {
+        printf("%s : FAILED (route with detection not completed in %.0f s, slip detected on high grip at nominal accelerations,"
+                " or detection doesn't divide the low grip slip by %.0f at raised accelerations)\n", ROBOT_NAME, ROUTE_TIMEOUT_S, MIN_SLIP_REDUCTION);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+#include "SimulatedRobot.h"
+#include "USBStream.h"
+
+/*
+ * Parcours de chemins courbes par le robot ROBOT_NAME, sur robot simulé réaliste (voir host/sim/DiffDrivePlant.h) :
+ *  suite de GotoNoStop sur les points de contrôle (sans, puis avec la planification des vitesses de passage),
+ *  puis une seule commande SplinePath (voir src/commandManager/Commands/SplinePath.h, réglages SPLINE_* du robotConfig.h).
+ *
+ *  On mesure le temps jusqu'à la fin du chemin, le plus grand écart entre un point de contrôle et le passage du robot,
+ *  la régularité du cap (accélération angulaire efficace et max), l'erreur finale (arrêt observé HOLD_S après la fin),
+ *  le patinage et le temps moyen d'une itération de la boucle d'asserv.
+ *
+ *  Échoue si un chemin n'est pas terminé en ROUTE_TIMEOUT_S, s'il s'arrête hors tolérance du dernier point,
+ *  ou si la spline, qui passe par les points de contrôle, en est suivie à plus de MAX_SPLINE_POINT_MISS_MM.
+ *
+ *  usage : splineBench
+ */
+
+static constexpr double ROUTE_TIMEOUT_S = 30;
+static constexpr double HOLD_S = 0.5;
+// Erreur finale admise : la fenêtre d'arrivée, plus une tolérance d'établissement
+static constexpr double MAX_FINAL_ERROR_MM = COMMAND_MANAGER_ARRIVAL_DISTANCE_THRESHOLD_mm + 3;
+static constexpr double MAX_SPLINE_POINT_MISS_MM = 40;
+
+struct Route
+{
+    const char *name;
+    const float *X;
+    const float *Y;
+    uint8_t count;
+};
+
+// Le robot part de (0, 0), orienté vers les X positifs
+static const float s_bypassX[] = { 400, 700, 1100, 1400, 1800 };     // contournement d'un obstacle au milieu de la table
+static const float s_bypassY[] = { 0, 300, 300, 0, 0 };
+static const float s_slalomX[] = { 300, 600, 900, 1200, 1500 };      // slalom entre des éléments de jeu
+static const float s_slalomY[] = { 150, -150, 150, -150, 0 };
+static const float s_uTurnX[] = { 600, 900, 600, 0 };                // demi-tour en roulant, retour parallèle au départ
+static const float s_uTurnY[] = { 0, 300, 600, 600 };
+static const float s_sideX[] = { 0, 300, 700 };                      // premier point sur le côté : le robot s'aligne d'abord
+static const float s_sideY[] = { 400, 700, 700 };
+
+#define ROUTE(name, X, Y) { name, X, Y, sizeof(X) / sizeof(X[0]) }
+static const Route s_routes[] = {
+    ROUTE("bypass", s_bypassX, s_bypassY),
+    ROUTE("slalom", s_slalomX, s_slalomY),
+    ROUTE("u-turn", s_uTurnX, s_uTurnY),
+    ROUTE("side start", s_sideX, s_sideY),
+};
+
+enum Mode
+{
+    MODE_GOTONOSTOP,
+    MODE_GOTONOSTOP_PLANNED,
+    MODE_SPLINE,
+};
+static const char *s_modeNames[] = { "gotonostop", "gotonostop planned", "spline" };
+
+struct RouteResult
+{
+    bool completed;
+    double routeTime_s;
+    double pointMiss_mm;          // plus grand écart entre un point de contrôle et le passage du robot
+    double rmsAngularAcc_radps2;
+    double peakAngularAcc_radps2;
+    double finalError_mm;
+    double slip_mm;
+    double iteration_ns;
+};
+
+static RouteResult simulateRoute(const Route &route, Mode mode)
+{
+    SimulatedRobot robot(realisticPlantConfiguration());
+    DiffDrivePlant &plant = robot.plant;
+    CommandManager &commandManager = robot.commandManager;
+    SimAsservMain &mainAsserv = robot.mainAsserv;
+    commandManager.enableLookAhead(mode == MODE_GOTONOSTOP_PLANNED);
+
+    if (mode == MODE_SPLINE)
+    {
+        commandManager.addSpline(route.X, route.Y, route.count);
+    }
+    else
+    {
+        // Comme le haut niveau : tout le chemin est envoyé d'un coup, le dernier point en Goto précis
+        for (uint8_t i = 0; i + 1 < route.count; i++)
+            commandManager.addGoToNoStop(route.X[i], route.Y[i]);
+        commandManager.addGoTo(route.X[route.count - 1], route.Y[route.count - 1]);
+    }
+
+    const double period = 1.0 / ASSERV_THREAD_FREQUENCY;
+    double pointDistance[SplinePath::MAX_POINTS];
+    std::fill(pointDistance, pointDistance + route.count, HUGE_VAL);
+
+    RouteResult result = RouteResult();
+    double holdEnd = 0;
+    double previousAngularSpeed = 0;
+    double squaredAngularAccSum = 0;
+    unsigned angularAccSamples = 0, iterations = 0;
+    double elapsed_ns = 0;
+    while (true)
+    {
+        auto start = std::chrono::steady_clock::now();
+        mainAsserv.loopIteration();
+        elapsed_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        iterations++;
+        const double now = plant.getTime_s();
+
+        for (uint8_t i = 0; i < route.count; i++)
+            pointDistance[i] = std::min(pointDistance[i], (double) hypot(plant.getX_mm() - route.X[i], plant.getY_mm() - route.Y[i]));
+
+        // Régularité du cap, sur la période de consigne (le bruit de la boucle de vitesse est filtré), tant que le chemin n'est pas terminé
+        double angularAcc = 0;
+        if (iterations % ASSERV_POSITION_DIVISOR == 0)
+        {
+            const double angularSpeed = (plant.getRightGroundSpeed() - plant.getLeftGroundSpeed()) / realisticPlantConfiguration().motorWheelsDistance_mm;
+            angularAcc = (angularSpeed - previousAngularSpeed) / (ASSERV_POSITION_DIVISOR * period);
+            previousAngularSpeed = angularSpeed;
+        }
+
+        if (holdEnd == 0)
+        {
+            if (iterations % ASSERV_POSITION_DIVISOR == 0)
+            {
+                squaredAngularAccSum += angularAcc * angularAcc;
+                angularAccSamples++;
+            }
+            result.peakAngularAcc_radps2 = std::max(result.peakAngularAcc_radps2, fabs(angularAcc));
+
+            if (commandManager.getPendingCommandCount() == 0 && commandManager.getCommandStatus() == CommandManager::STATUS_IDLE)
+            {
+                result.completed = true;
+                result.routeTime_s = now;
+                holdEnd = now + HOLD_S;
+            }
+            else if (now > ROUTE_TIMEOUT_S)
+                break;
+        }
+        else if (now >= holdEnd)
+            break;
+    }
+
+    result.pointMiss_mm = *std::max_element(pointDistance, pointDistance + route.count);
+    result.rmsAngularAcc_radps2 = sqrt(squaredAngularAccSum / angularAccSamples);
+    result.finalError_mm = hypot(plant.getX_mm() - route.X[route.count - 1], plant.getY_mm() - route.Y[route.count - 1]);
+    result.slip_mm = plant.getSlipDistance_mm();
+    result.iteration_ns = elapsed_ns / iterations;
+    return result;
+}
+
+static bool printResult(Mode mode, const RouteResult &result)
+{
+    printf("    %-18s : %s in %6.3f s, point miss %5.1f mm, angular acc rms %5.1f max %6.1f rad/s2, final error %5.2f mm, slip %6.1f mm, %5.0f ns/iteration\n",
+            s_modeNames[mode], result.completed ? "done   " : "TIMEOUT", result.routeTime_s, result.pointMiss_mm,
+            result.rmsAngularAcc_radps2, result.peakAngularAcc_radps2, result.finalError_mm, result.slip_mm, result.iteration_ns);
+
+    bool ok = result.completed && result.finalError_mm <= MAX_FINAL_ERROR_MM;
+    if (mode == MODE_SPLINE)
+        ok &= result.pointMiss_mm <= MAX_SPLINE_POINT_MISS_MM;
+    return ok;
+}
+
+int main()
+{
+    USBStream::init();
+
+    printf("%s : curved paths, GotoNoStop chain vs SplinePath (%.0f mm/s, lateral %.0f mm/s2, Ramsete b %g /mm2 zeta %.2f, %d points table)\n",
+            ROBOT_NAME, splinePathConf.maxSpeed, splinePathConf.maxLateralAcceleration, splinePathConf.ramseteB, splinePathConf.ramseteZeta,
+            SplinePath::TABLE_SIZE);
+
+    bool ok = true;
+    double totalTime[3] = { 0, 0, 0 };
+    double totalRmsAngularAcc[3] = { 0, 0, 0 };
+    for (const Route &route : s_routes)
+    {
+        printf("  %s, %u points\n", route.name, route.count);
+
+        for (int mode = MODE_GOTONOSTOP; mode <= MODE_SPLINE; mode++)
+        {
+            RouteResult result = simulateRoute(route, Mode(mode));
+            ok &= printResult(Mode(mode), result);
+            totalTime[mode] += result.routeTime_s;
+            totalRmsAngularAcc[mode] += result.rmsAngularAcc_radps2;
+        }
+    }
+
+    printf("  total : time %.3f s / %.3f s -> %.3f s, angular acc rms (sum) %.1f / %.1f -> %.1f rad/s2\n",
+            totalTime[MODE_GOTONOSTOP], totalTime[MODE_GOTONOSTOP_PLANNED], totalTime[MODE_SPLINE],
+            totalRmsAngularAcc[MODE_GOTONOSTOP], totalRmsAngularAcc[MODE_GOTONOSTOP_PLANNED], totalRmsAngularAcc[MODE_SPLINE]);
+
+    if (!ok)
+    {
+        printf("%s : FAILED (path not completed in %.0f s, final error above %.1f mm, or spline point missed by more than %.0f mm)\n",
+                ROBOT_NAME, ROUTE_TIMEOUT_S, MAX_FINAL_ERROR_MM, MAX_SPLINE_POINT_MISS_MM);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,292 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "robotConfig.h"
+#include "Pll.h"
+#include "VelocityEstimator/AdaptivePll.h"
+#include "VelocityEstimator/KalmanVelocityEstimator.h"
+
+/*
+ * Banc host des estimateurs de vitesse (voir src/VelocityEstimator) du robot ROBOT_NAME : Pll à PLL_BANDWIDTH,
+ *  AdaptivePll (adaptivePllConf) et KalmanVelocityEstimator (kalmanVelocityConf) du robotConfig.h.
+ *
+ *  Des traces codeur (position quantifiée au tick, bruit de +-1 LSB optionnel) sont rejouées dans chaque estimateur :
+ *  arrêt, vitesse lente, vitesse max, trapèze aux accélérations du robotConfig.h et vitesse sinusoïdale.
+ *  Une fois les estimateurs accrochés, on mesure l'erreur RMS sur la vitesse et l'accélération, et sur la sinusoïde le
+ *  retard (déphasage de la vitesse estimée converti en ms).
+ *  Le trapèze est aussi rejoué à la moitié de la fréquence de la boucle, dans le filtre de Kalman avec les gains de la
+ *  période nominale puis avec ceux recalculés pour la nouvelle période (KalmanVelocityEstimator::setPeriod).
+ *  Échoue si un estimateur diverge, si l'AdaptivePll est plus bruitée que la Pll à basse vitesse ou plus en retard
+ *  qu'elle sur la sinusoïde, si l'accélération du filtre de Kalman est moins juste que celle de la Pll en mouvement
+ *  (trapèze, sinusoïde), ou si les gains recalculés suivent moins bien le trapèze lent que ceux de la période nominale.
+ *
+ *  Avec un fichier (un delta codeur en ticks par ligne, une ligne par période, par exemple les RawEncoderDelta du
+ *  stream USB), la trace enregistrée est rejouée ; la référence est alors sa moyenne glissante centrée.
+ *
+ *  usage : velocityEstimatorBench [fichier de deltas]
+ */
+
+static constexpr double mmByTick = (2.0 * M_PI * ENCODERS_WHEELS_RADIUS_MM) / ENCODERS_TICKS_BY_TURN;
+static constexpr float loopPeriod = 1.0f / ASSERV_THREAD_FREQUENCY;
+static constexpr double SETTLE_S = 0.5;
+static constexpr double SINE_FREQUENCY_HZ = 2;
+// Retard en plus toléré pour l'AdaptivePll sur la sinusoïde (bande passante réduite aux creux de vitesse)
+static constexpr double MAX_ADAPTIVE_EXTRA_LAG_MS = 0.1;
+// Demi-fenêtre de la moyenne glissante de référence d'une trace enregistrée
+static constexpr uint32_t REFERENCE_HALF_WINDOW = ASSERV_THREAD_FREQUENCY / 50;
+
+// Ce que vérifie une trace
+enum TraceCheck
+{
+    CHECK_NONE, CHECK_LOW_SPEED_NOISE, CHECK_TRACKING
+};
+
+/*
+ * Trace codeur : deltas lus par période, et vitesse et accélération réelles (nan si inconnues), en ticks
+ */
+struct EncoderTrace
+{
+    const char *name;
+    TraceCheck check;
+    std::vector<float> deltas;
+    std::vector<double> speeds;
+    std::vector<double> accelerations;
+    bool sine;
+    uint32_t decimation;    // période de la trace en périodes de la boucle
+};
+
+struct EstimatorStats
+{
+    double speedRms_mmps;
+    double accelerationRms_mmps2;
+    double lag_ms;
+    bool finite;
+};
+
+enum SpeedShape
+{
+    SHAPE_CONSTANT, SHAPE_TRAPEZOID, SHAPE_SINE
+};
+
+/*
+ * Position réelle échantillonnée à chaque période, quantifiée au tick comme le ferait un codeur
+ */
+static EncoderTrace makeTrace(const char *name, TraceCheck check, SpeedShape shape, double speed_mmps, bool jitter,
+        uint32_t decimation = 1)
+{
+    EncoderTrace trace;
+    trace.name = name;
+    trace.check = check;
+    trace.sine = (shape == SHAPE_SINE);
+    trace.decimation = decimation;
+    const float period = decimation * loopPeriod;
+
+    const double acceleration = DIST_REGULATOR_MAX_ACC;
+    const double rampTime = speed_mmps / acceleration;
+    const double cruiseTime = 0.5;
+    const double duration = (shape == SHAPE_TRAPEZOID) ? SETTLE_S + 2 * rampTime + cruiseTime + 0.5 : 5.0;
+    const double omega = 2 * M_PI * SINE_FREQUENCY_HZ;
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> lsbNoise(-1, 1);
+
+    // Position de départ hors tick entier, pour que la quantification ne soit pas symétrique
+    double position = 0.37;
+    int64_t previousCount = (int64_t) floor(position);
+    const uint32_t nbIterations = (uint32_t) (duration * ASSERV_THREAD_FREQUENCY / decimation);
+    for (uint32_t i = 1; i <= nbIterations; i++)
+    {
+        const double t = i * double(period);
+        double speed = speed_mmps, accel = 0;
+        if (shape == SHAPE_TRAPEZOID)
+        {
+            const double tr = t - SETTLE_S;
+            if (tr < 0)
+                speed = 0;
+            else if (tr < rampTime)
+                speed = acceleration * tr, accel = acceleration;
+            else if (tr < rampTime + cruiseTime)
+                speed = speed_mmps;
+            else if (tr < 2 * rampTime + cruiseTime)
+                speed = speed_mmps - acceleration * (tr - rampTime - cruiseTime), accel = -acceleration;
+            else
+                speed = 0;
+        }
+        else if (shape == SHAPE_SINE)
+        {
+            speed = speed_mmps * (1 + 0.5 * sin(omega * t));
+            accel = speed_mmps * 0.5 * omega * cos(omega * t);
+        }
+
+        // Intégration exacte sur la période pour les profils linéaires, au trapèze pour la sinusoïde
+        position += (speed - 0.5 * accel * double(period)) / mmByTick * double(period);
+        int64_t count = (int64_t) floor(position) + (jitter ? lsbNoise(random) : 0);
+        trace.deltas.push_back(float(count - previousCount));
+        previousCount = count;
+        trace.speeds.push_back(speed / mmByTick);
+        trace.accelerations.push_back(accel / mmByTick);
+    }
+    return trace;
+}
+
+static bool loadTrace(const char *fileName, EncoderTrace *trace)
+{
+    FILE *file = fopen(fileName, "r");
+    if (file == nullptr)
+        return false;
+    trace->name = fileName;
+    trace->check = CHECK_NONE;
+    trace->sine = false;
+    trace->decimation = 1;
+    float delta;
+    while (fscanf(file, "%f", &delta) == 1)
+        trace->deltas.push_back(delta);
+    fclose(file);
+
+    // Référence : moyenne glissante centrée des deltas, accélération inconnue
+    const uint32_t n = trace->deltas.size();
+    for (uint32_t i = 0; i < n; i++)
+    {
+        const uint32_t first = (i >= REFERENCE_HALF_WINDOW) ? i - REFERENCE_HALF_WINDOW : 0;
+        const uint32_t last = (i + REFERENCE_HALF_WINDOW < n) ? i + REFERENCE_HALF_WINDOW : n - 1;
+        double sum = 0;
+        for (uint32_t j = first; j <= last; j++)
+            sum += trace->deltas[j];
+        trace->speeds.push_back(sum / (last - first + 1) / double(loopPeriod));
+        trace->accelerations.push_back(NAN);
+    }
+    return n > 0;
+}
+
+static EstimatorStats replay(VelocityEstimator &estimator, const EncoderTrace &trace)
+{
+    estimator.reset();
+    const uint32_t settleIterations = (uint32_t) (SETTLE_S * ASSERV_THREAD_FREQUENCY / trace.decimation);
+    const float period = trace.decimation * loopPeriod;
+    const double omega = 2 * M_PI * SINE_FREQUENCY_HZ;
+
+    EstimatorStats stats = {0, 0, 0, true};
+    uint32_t count = 0, accelerationCount = 0;
+    // Projection de la vitesse estimée sur sin et cos, pour son déphasage sur la sinusoïde
+    double sumSin = 0, sumCos = 0;
+    for (uint32_t i = 0; i < trace.deltas.size(); i++)
+    {
+        estimator.update(trace.deltas[i], period);
+        if (!std::isfinite(estimator.getSpeed()) || !std::isfinite(estimator.getAcceleration()))
+            stats.finite = false;
+        if (i < settleIterations)
+            continue;
+
+        const double speedError = (estimator.getSpeed() - trace.speeds[i]) * mmByTick;
+        stats.speedRms_mmps += speedError * speedError;
+        count++;
+        if (!std::isnan(trace.accelerations[i]))
+        {
+            const double accelerationError = (estimator.getAcceleration() - trace.accelerations[i]) * mmByTick;
+            stats.accelerationRms_mmps2 += accelerationError * accelerationError;
+            accelerationCount++;
+        }
+        if (trace.sine)
+        {
+            const double t = (i + 1) * double(period);
+            sumSin += estimator.getSpeed() * sin(omega * t);
+            sumCos += estimator.getSpeed() * cos(omega * t);
+        }
+    }
+    stats.speedRms_mmps = sqrt(stats.speedRms_mmps / count);
+    stats.accelerationRms_mmps2 = (accelerationCount > 0) ? sqrt(stats.accelerationRms_mmps2 / accelerationCount) : NAN;
+    stats.lag_ms = trace.sine ? 1000.0 * atan2(-sumCos, sumSin) / omega : NAN;
+    return stats;
+}
+
+static void printStats(const char *name, const EstimatorStats &stats)
+{
+    printf("    %-8s : speed %8.3f mm/s rms, acceleration %9.1f mm/s2 rms", name, stats.speedRms_mmps, stats.accelerationRms_mmps2);
+    if (!std::isnan(stats.lag_ms))
+        printf(", lag %5.2f ms", stats.lag_ms);
+    printf("%s\n", stats.finite ? "" : " DIVERGED");
+}
+
+int main(int argc, char **argv)
+{
+    Pll pll(PLL_BANDWIDTH);
+    AdaptivePll adaptivePll(adaptivePllConf);
+    KalmanVelocityEstimator kalman(kalmanVelocityConf);
+
+    printf("%s : PLL bandwidth %d, adaptive PLL %.0f to %.0f from %.0f mm/s, Kalman gains %.4f %.2f %.1f, %d Hz, %.4f mm/tick\n",
+            ROBOT_NAME, PLL_BANDWIDTH, adaptivePllConf.minBandwidth, adaptivePllConf.maxBandwidth,
+            adaptivePllConf.maxBandwidthSpeed * mmByTick, kalman.getPositionGain(), kalman.getSpeedGain(), kalman.getAccelerationGain(),
+            ASSERV_THREAD_FREQUENCY, mmByTick);
+
+    std::vector<EncoderTrace> traces;
+    if (argc > 1)
+    {
+        EncoderTrace recorded;
+        if (!loadTrace(argv[1], &recorded))
+        {
+            printf("%s : can't read deltas from %s\n", ROBOT_NAME, argv[1]);
+            return 1;
+        }
+        traces.push_back(recorded);
+    }
+    else
+    {
+        traces.push_back(makeTrace("standstill +-1 LSB", CHECK_LOW_SPEED_NOISE, SHAPE_CONSTANT, 0, true));
+        traces.push_back(makeTrace("20 mm/s", CHECK_LOW_SPEED_NOISE, SHAPE_CONSTANT, 20, false));
+        traces.push_back(makeTrace("max speed", CHECK_NONE, SHAPE_CONSTANT, MAX_SPEED_MM_PER_SEC, false));
+        traces.push_back(makeTrace("trapezoid", CHECK_TRACKING, SHAPE_TRAPEZOID, MAX_SPEED_MM_PER_SEC, false));
+        traces.push_back(makeTrace("sine", CHECK_TRACKING, SHAPE_SINE, 0.5 * MAX_SPEED_MM_PER_SEC, false));
+    }
+
+    bool ok = true;
+    for (const EncoderTrace &trace : traces)
+    {
+        printf("  %s\n", trace.name);
+        EstimatorStats pllStats = replay(pll, trace);
+        printStats("pll", pllStats);
+        EstimatorStats adaptiveStats = replay(adaptivePll, trace);
+        printStats("adaptive", adaptiveStats);
+        EstimatorStats kalmanStats = replay(kalman, trace);
+        printStats("kalman", kalmanStats);
+
+        ok = ok && pllStats.finite && adaptiveStats.finite && kalmanStats.finite;
+        if (trace.check == CHECK_LOW_SPEED_NOISE)
+        {
+            ok = ok && adaptiveStats.speedRms_mmps <= pllStats.speedRms_mmps;
+        }
+        else if (trace.check == CHECK_TRACKING)
+        {
+            ok = ok && kalmanStats.accelerationRms_mmps2 <= pllStats.accelerationRms_mmps2;
+            if (trace.sine)
+                ok = ok && adaptiveStats.lag_ms <= pllStats.lag_ms + MAX_ADAPTIVE_EXTRA_LAG_MS;
+        }
+    }
+
+    /* Boucle passée à la moitié de sa fréquence (asserv loopfreq) : le filtre de Kalman aux gains recalculés
+     *  pour la nouvelle période doit suivre le trapèze au moins aussi bien qu'avec ceux de la période nominale
+     */
+    if (argc <= 1)
+    {
+        EncoderTrace slowTrace = makeTrace("trapezoid, half loop frequency", CHECK_TRACKING, SHAPE_TRAPEZOID,
+                MAX_SPEED_MM_PER_SEC, false, 2);
+        printf("  %s\n", slowTrace.name);
+        EstimatorStats nominalGainsStats = replay(kalman, slowTrace);
+        printStats("nominal", nominalGainsStats);
+        kalman.setPeriod(slowTrace.decimation * loopPeriod);
+        EstimatorStats retunedStats = replay(kalman, slowTrace);
+        printStats("retuned", retunedStats);
+        ok = ok && retunedStats.finite && retunedStats.accelerationRms_mmps2 <= nominalGainsStats.accelerationRms_mmps2
+                && retunedStats.speedRms_mmps <= nominalGainsStats.speedRms_mmps;
+    }
+
+    if (!ok)
+    {
+        printf("%s : FAILED (estimator diverged, adaptive PLL noisier at low speed or later than the PLL,"
+                " Kalman acceleration worse than the PLL's or not improved by retuning to the loop period)\n", ROBOT_NAME);
+        return 1;
+    }
+    return 0;
+}
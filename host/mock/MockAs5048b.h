@@ -0,0 +1,60 @@
+#ifndef HOST_MOCK_MOCKAS5048B_H_
+#define HOST_MOCK_MOCKAS5048B_H_
+
+#include "MockI2cBus.h"
+
+/*
+ * AS5048B simulé : tient à jour la table de registres du capteur sur un MockI2cBus
+ *  (AGC, diagnostic, magnitude et angle sur 14 bits, découpés en MSB 8 bits / LSB 6 bits comme le vrai capteur)
+ */
+class MockAs5048b
+{
+public:
+    static constexpr uint8_t GAIN_REG = 0xFA;
+    static constexpr uint8_t DIAG_REG = 0xFB;
+    static constexpr uint8_t MAGNMSB_REG = 0xFC;
+    static constexpr uint8_t ANGLMSB_REG = 0xFE;
+
+    // Diagnostic : bit OCF (offset compensation finished) seul, valeur attendue par MagEncoders::init()
+    static constexpr uint8_t DIAG_OCF = 0x01;
+
+    MockAs5048b(MockI2cBus &bus, i2caddr_t address) :
+            m_bus(bus), m_address(address)
+    {
+        m_angle = 0;
+        m_bus.setRegister(m_address, GAIN_REG, 50);
+        m_bus.setRegister(m_address, DIAG_REG, DIAG_OCF);
+        setRegister14(MAGNMSB_REG, 4000);
+        setAngle(0);
+    }
+
+    void setAngle(uint16_t raw)
+    {
+        m_angle = raw & 0x3FFF;
+        setRegister14(ANGLMSB_REG, m_angle);
+    }
+
+    // Fait tourner l'aimant de delta pas, modulo un tour
+    void rotate(int32_t delta)
+    {
+        setAngle((uint16_t) ((m_angle + delta) & 0x3FFF));
+    }
+
+    uint16_t getAngle() const
+    {
+        return m_angle;
+    }
+
+private:
+    void setRegister14(uint8_t msbReg, uint16_t value)
+    {
+        m_bus.setRegister(m_address, msbReg, (uint8_t) (value >> 6));
+        m_bus.setRegister(m_address, msbReg + 1, (uint8_t) (value & 0x3F));
+    }
+
+    MockI2cBus &m_bus;
+    i2caddr_t m_address;
+    uint16_t m_angle;
+};
+
+#endif /* HOST_MOCK_MOCKAS5048B_H_ */
@@ -0,0 +1,47 @@
+#ifndef HOST_MOCK_MOCKENCODERS_H_
+#define HOST_MOCK_MOCKENCODERS_H_
+
+#include "Encoders/Encoder.h"
+#include "MockMotorController.h"
+#include <cmath>
+
+/*
+ * Codeurs factices : le déplacement de chaque roue est proportionnel à la
+ *  dernière consigne moteur, quantifié au tick près comme un codeur en quadrature.
+ *  Suffisant pour que le CommandManager et les régulateurs suivent leurs chemins nominaux.
+ */
+class MockEncoders final : public Encoders
+{
+public:
+    MockEncoders(MockMotorController &motorController, float ticksByPercent) :
+            m_motorController(motorController), m_ticksByPercent(ticksByPercent)
+    {
+        m_rightRemainder = 0;
+        m_leftRemainder = 0;
+    }
+    virtual ~MockEncoders()
+    {
+    }
+
+    virtual void getValues(float *deltaEncoderRight, float *deltaEncoderLeft)
+    {
+        *deltaEncoderRight = quantize(m_motorController.getRightSpeed() * m_ticksByPercent, &m_rightRemainder);
+        *deltaEncoderLeft = quantize(m_motorController.getLeftSpeed() * m_ticksByPercent, &m_leftRemainder);
+    }
+
+private:
+    static float quantize(float delta, float *remainder)
+    {
+        float total = delta + *remainder;
+        float ticks = floorf(total);
+        *remainder = total - ticks;
+        return ticks;
+    }
+
+    MockMotorController &m_motorController;
+    float m_ticksByPercent;
+    float m_rightRemainder;
+    float m_leftRemainder;
+};
+
+#endif /* HOST_MOCK_MOCKENCODERS_H_ */
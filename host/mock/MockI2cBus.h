@@ -0,0 +1,110 @@
+#ifndef HOST_MOCK_MOCKI2CBUS_H_
+#define HOST_MOCK_MOCKI2CBUS_H_
+
+#include "hal.h"
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+/*
+ * Bus I2C factice : chaque adresse 7 bits a une table de 256 registres,
+ *  avec le même comportement que le MD22 et l'AS5048B :
+ *   - le premier octet écrit est l'adresse du registre
+ *   - les octets suivants (écriture) ou lus sont aux registres suivants (auto-incrément)
+ *
+ *  Chaque transfert dure m_transferDuration_us plus m_byteDuration_us par octet échangé (adresse comprise).
+ *  Un transfert sur m_stallPeriod dure en plus m_stallDuration_us
+ *   (clock stretching, esclave occupé...) ; s'il dépasse le timeout demandé, le transfert échoue en MSG_TIMEOUT.
+ */
+class MockI2cBus: public HostI2cBus
+{
+public:
+    explicit MockI2cBus(uint32_t transferDuration_us, uint32_t byteDuration_us = 0)
+    {
+        m_transferDuration_us = transferDuration_us;
+        m_byteDuration_us = byteDuration_us;
+        m_stallPeriod = 0;
+        m_stallDuration_us = 0;
+        m_transferCount = 0;
+        m_timeoutCount = 0;
+        std::memset(m_registers, 0, sizeof(m_registers));
+        std::memset(m_registerPointer, 0, sizeof(m_registerPointer));
+    }
+    virtual ~MockI2cBus()
+    {
+    }
+
+    void injectStalls(uint32_t everyNTransfers, uint32_t stallDuration_us)
+    {
+        m_stallPeriod = everyNTransfers;
+        m_stallDuration_us = stallDuration_us;
+    }
+
+    uint8_t getRegister(i2caddr_t addr, uint8_t reg)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_registers[addr & 0x7F][reg];
+    }
+
+    void setRegister(i2caddr_t addr, uint8_t reg, uint8_t value)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_registers[addr & 0x7F][reg] = value;
+    }
+
+    uint32_t getTransferCount() const
+    {
+        return m_transferCount;
+    }
+    uint32_t getTimeoutCount() const
+    {
+        return m_timeoutCount;
+    }
+
+    virtual msg_t transfer(i2caddr_t addr, const uint8_t *txbuf, size_t txbytes, uint8_t *rxbuf, size_t rxbytes,
+            sysinterval_t timeout)
+    {
+        uint32_t nbBytes = 1 + txbytes + (rxbytes > 0 ? 1 + rxbytes : 0);
+        uint32_t duration_us = m_transferDuration_us + nbBytes * m_byteDuration_us;
+        m_transferCount++;
+        if (m_stallPeriod != 0 && (m_transferCount % m_stallPeriod) == 0)
+            duration_us += m_stallDuration_us;
+
+        if (timeout != TIME_INFINITE && duration_us > TIME_I2US(timeout))
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(TIME_I2US(timeout)));
+            m_timeoutCount++;
+            return MSG_TIMEOUT;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(duration_us));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint8_t *registers = m_registers[addr & 0x7F];
+        uint8_t &pointer = m_registerPointer[addr & 0x7F];
+        if (txbytes > 0)
+        {
+            pointer = txbuf[0];
+            for (size_t i = 1; i < txbytes; i++)
+                registers[pointer++] = txbuf[i];
+        }
+        for (size_t i = 0; i < rxbytes; i++)
+            rxbuf[i] = registers[pointer++];
+
+        return MSG_OK;
+    }
+
+private:
+    std::mutex m_mutex;
+    uint8_t m_registers[128][256];
+    uint8_t m_registerPointer[128];
+
+    uint32_t m_transferDuration_us;
+    uint32_t m_byteDuration_us;
+    uint32_t m_stallPeriod;
+    uint32_t m_stallDuration_us;
+    uint32_t m_transferCount;
+    uint32_t m_timeoutCount;
+};
+
+#endif /* HOST_MOCK_MOCKI2CBUS_H_ */
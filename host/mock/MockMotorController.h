@@ -0,0 +1,44 @@
+#ifndef HOST_MOCK_MOCKMOTORCONTROLLER_H_
+#define HOST_MOCK_MOCKMOTORCONTROLLER_H_
+
+#include "motorController/MotorController.h"
+
+/*
+ * Contrôleur moteur factice : retient juste la dernière consigne (en %) de chaque moteur
+ */
+class MockMotorController final : public MotorController
+{
+public:
+    MockMotorController()
+    {
+        m_rightSpeed = 0;
+        m_leftSpeed = 0;
+    }
+    virtual ~MockMotorController()
+    {
+    }
+
+    virtual void setMotorRightSpeed(float percentage)
+    {
+        m_rightSpeed = percentage;
+    }
+    virtual void setMotorLeftSpeed(float percentage)
+    {
+        m_leftSpeed = percentage;
+    }
+
+    float getRightSpeed() const
+    {
+        return m_rightSpeed;
+    }
+    float getLeftSpeed() const
+    {
+        return m_leftSpeed;
+    }
+
+private:
+    float m_rightSpeed;
+    float m_leftSpeed;
+};
+
+#endif /* HOST_MOCK_MOCKMOTORCONTROLLER_H_ */
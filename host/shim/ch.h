@@ -0,0 +1,150 @@
+#ifndef HOST_SHIM_CH_H_
+#define HOST_SHIM_CH_H_
+
+/*
+ * Shim ChibiOS/RT pour compiler le coeur de l'asserv sur le host (Linux).
+ *  Seule la partie de l'API utilisée par src/ est émulée, avec la même sémantique
+ *  (systick à CH_CFG_ST_FREQUENCY, comme cfg_chibios/chconf.h)
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <condition_variable>
+
+#define FALSE 0
+#define TRUE 1
+
+#define CH_CFG_ST_FREQUENCY     10000
+#define CH_DBG_ENABLE_ASSERTS   TRUE
+
+typedef uint32_t systime_t;
+typedef uint32_t sysinterval_t;
+typedef uint64_t time_conv_t;
+typedef int32_t  msg_t;
+typedef uint32_t tprio_t;
+typedef uint32_t rtcnt_t;
+
+#define MSG_OK          (msg_t)0
+#define MSG_TIMEOUT     (msg_t)-1
+#define MSG_RESET       (msg_t)-2
+
+#define TIME_IMMEDIATE  ((sysinterval_t)0)
+#define TIME_INFINITE   ((sysinterval_t)-1)
+
+#define TIME_S2I(secs)                                                      \
+  ((sysinterval_t)((time_conv_t)(secs) * (time_conv_t)CH_CFG_ST_FREQUENCY))
+
+#define TIME_MS2I(msecs)                                                    \
+  ((sysinterval_t)((((time_conv_t)(msecs) *                                 \
+                     (time_conv_t)CH_CFG_ST_FREQUENCY) +                    \
+                    (time_conv_t)999) / (time_conv_t)1000))
+
+#define TIME_US2I(usecs)                                                    \
+  ((sysinterval_t)((((time_conv_t)(usecs) *                                 \
+                     (time_conv_t)CH_CFG_ST_FREQUENCY) +                    \
+                    (time_conv_t)999999) / (time_conv_t)1000000))
+
+#define TIME_I2MS(interval)                                                 \
+  (time_msecs_t)((((time_conv_t)(interval) * (time_conv_t)1000) +           \
+                  (time_conv_t)CH_CFG_ST_FREQUENCY - (time_conv_t)1) /      \
+                 (time_conv_t)CH_CFG_ST_FREQUENCY)
+
+#define TIME_I2US(interval)                                                 \
+  (time_usecs_t)((((time_conv_t)(interval) * (time_conv_t)1000000) +        \
+                  (time_conv_t)CH_CFG_ST_FREQUENCY - (time_conv_t)1) /      \
+                 (time_conv_t)CH_CFG_ST_FREQUENCY)
+
+typedef uint32_t time_msecs_t;
+typedef uint32_t time_usecs_t;
+
+#define chTimeMS2I(msecs) TIME_MS2I(msecs)
+#define chTimeUS2I(usecs) TIME_US2I(usecs)
+
+static inline systime_t chTimeAddX(systime_t systime, sysinterval_t interval)
+{
+    return systime + interval;
+}
+
+static inline sysinterval_t chTimeDiffX(systime_t start, systime_t end)
+{
+    return (sysinterval_t) (end - start);
+}
+
+static inline bool chTimeIsInRangeX(systime_t time, systime_t start, systime_t end)
+{
+    return (systime_t) (time - start) < (systime_t) (end - start);
+}
+
+/*
+ * Sections critiques : le host ne préempte pas le thread d'asserv,
+ *  elles sont donc vides.
+ */
+void chSysLock(void);
+void chSysUnlock(void);
+
+systime_t chVTGetSystemTime(void);
+#define chVTGetSystemTimeX() chVTGetSystemTime()
+
+void chThdSleep(sysinterval_t time);
+void chThdSleepUntil(systime_t time);
+systime_t chThdSleepUntilWindowed(systime_t prev, systime_t next);
+void chThdYield(void);
+#define chThdSleepMilliseconds(msecs) chThdSleep(TIME_MS2I(msecs))
+#define chThdSleepMicroseconds(usecs) chThdSleep(TIME_US2I(usecs))
+
+void chSysHalt(const char *reason);
+
+/*
+ * Compteur temps réel : le DWT->CYCCNT sur la cible (à STM32_HCLK, voir hal.h),
+ *  des ns sur le host
+ */
+rtcnt_t chSysGetRealtimeCounterX(void);
+#define RTC2US(freq, n) ((((n) - 1UL) / ((freq) / 1000000UL)) + 1UL)
+
+/*
+ * Threads : un std::thread par thread ChibiOS. La priorité est ignorée,
+ *  le code partagé ne doit donc pas compter dessus pour son exclusion mutuelle.
+ */
+#define LOWPRIO     ((tprio_t)2)
+#define NORMALPRIO  ((tprio_t)128)
+#define HIGHPRIO    ((tprio_t)255)
+
+struct thread_t;
+typedef void (*tfunc_t)(void *p);
+
+#define THD_WORKING_AREA(s, n) uint8_t s[n]
+#define THD_FUNCTION(tname, arg) void tname(void *arg)
+
+thread_t *chThdCreateStatic(void *wsp, size_t size, tprio_t prio, tfunc_t pf, void *arg);
+void chRegSetThreadName(const char *name);
+
+struct binary_semaphore_t
+{
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool taken;
+};
+
+void chBSemObjectInit(binary_semaphore_t *bsp, bool taken);
+msg_t chBSemWait(binary_semaphore_t *bsp);
+msg_t chBSemWaitTimeout(binary_semaphore_t *bsp, sysinterval_t timeout);
+void chBSemSignal(binary_semaphore_t *bsp);
+
+/*
+ * Même contrat que util/exceptionVectors.h sur la cible
+ */
+void dbg_assert(const char* assertion, const char* file, unsigned line, const char* func, const char* reason);
+
+#define chDbgCheck(c) chDbgAssert(c, "invalid parameter")
+
+#define chDbgAssert(c, r)                                        \
+    do {                                                         \
+        if (CH_DBG_ENABLE_ASSERTS != FALSE) {                    \
+            if (!(c)) {                                          \
+                dbg_assert(#c, __FILE__, __LINE__, __func__, r); \
+            }                                                    \
+        }                                                        \
+    } while (false)
+
+#endif /* HOST_SHIM_CH_H_ */
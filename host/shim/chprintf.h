@@ -0,0 +1,8 @@
+#ifndef HOST_SHIM_CHPRINTF_H_
+#define HOST_SHIM_CHPRINTF_H_
+
+#include "hal_streams.h"
+
+int chprintf(BaseSequentialStream *chp, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#endif /* HOST_SHIM_CHPRINTF_H_ */
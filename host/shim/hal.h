@@ -0,0 +1,16 @@
+#ifndef HOST_SHIM_HAL_H_
+#define HOST_SHIM_HAL_H_
+
+/*
+ * Shim ChibiOS/HAL pour le host, voir ch.h
+ */
+
+#include "ch.h"
+#include "hal_streams.h"
+#include "hal_pal.h"
+#include "hal_i2c.h"
+
+// Fréquence du compteur temps réel du host (ns), voir chSysGetRealtimeCounterX()
+#define STM32_HCLK 1000000000UL
+
+#endif /* HOST_SHIM_HAL_H_ */
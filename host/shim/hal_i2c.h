@@ -0,0 +1,70 @@
+#ifndef HOST_SHIM_HAL_I2C_H_
+#define HOST_SHIM_HAL_I2C_H_
+
+/*
+ * Shim du driver I2C de ChibiOS : les transferts sont délégués à un HostI2cBus
+ *  (voir host/mock/MockI2cBus.h) branché sur I2CD1 ou I2CD2 par l'outil host.
+ */
+
+#include "ch.h"
+#include <mutex>
+
+typedef uint16_t i2caddr_t;
+
+typedef enum
+{
+    I2C_UNINIT = 0, I2C_STOP = 1, I2C_READY = 2, I2C_ACTIVE_TX = 3, I2C_ACTIVE_RX = 4, I2C_LOCKED = 5
+} i2cstate_t;
+
+typedef enum
+{
+    OPMODE_I2C = 1, OPMODE_SMBUS_DEVICE = 2, OPMODE_SMBUS_HOST = 3
+} i2copmode_t;
+
+typedef enum
+{
+    STD_DUTY_CYCLE = 1, FAST_DUTY_CYCLE_2 = 2, FAST_DUTY_CYCLE_16_9 = 3
+} i2cdutycycle_t;
+
+struct I2CConfig
+{
+    i2copmode_t op_mode;
+    uint32_t clock_speed;
+    i2cdutycycle_t duty_cycle;
+};
+
+class HostI2cBus
+{
+public:
+    virtual ~HostI2cBus()
+    {
+    }
+
+    /*
+     * Même contrat que i2cMasterTransmitTimeout : MSG_OK, MSG_TIMEOUT (le driver passe alors à I2C_LOCKED)
+     *  ou MSG_RESET (NACK, erreur de bus)
+     */
+    virtual msg_t transfer(i2caddr_t addr, const uint8_t *txbuf, size_t txbytes, uint8_t *rxbuf, size_t rxbytes,
+            sysinterval_t timeout) = 0;
+};
+
+struct I2CDriver
+{
+    i2cstate_t state;
+    const I2CConfig *config;
+    HostI2cBus *bus;
+    std::mutex mutex;
+};
+
+extern I2CDriver I2CD1;
+extern I2CDriver I2CD2;
+
+void i2cStart(I2CDriver *i2cp, const I2CConfig *config);
+void i2cStop(I2CDriver *i2cp);
+void i2cAcquireBus(I2CDriver *i2cp);
+void i2cReleaseBus(I2CDriver *i2cp);
+msg_t i2cMasterTransmitTimeout(I2CDriver *i2cp, i2caddr_t addr, const uint8_t *txbuf, size_t txbytes, uint8_t *rxbuf,
+        size_t rxbytes, sysinterval_t timeout);
+msg_t i2cMasterReceiveTimeout(I2CDriver *i2cp, i2caddr_t addr, uint8_t *rxbuf, size_t rxbytes, sysinterval_t timeout);
+
+#endif /* HOST_SHIM_HAL_I2C_H_ */
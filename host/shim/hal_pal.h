@@ -0,0 +1,25 @@
+#ifndef HOST_SHIM_HAL_PAL_H_
+#define HOST_SHIM_HAL_PAL_H_
+
+/*
+ * Shim PAL : les GPIO n'existent pas sur le host, la configuration des pins est ignorée
+ */
+
+#include <cstdint>
+
+struct stm32_gpio_t
+{
+    uint32_t ODR;
+};
+
+extern stm32_gpio_t hostGpioA, hostGpioB, hostGpioC;
+#define GPIOA (&hostGpioA)
+#define GPIOB (&hostGpioB)
+#define GPIOC (&hostGpioC)
+
+#define PAL_MODE_ALTERNATE(n)       (0)
+#define PAL_STM32_OTYPE_OPENDRAIN   (0)
+
+#define palSetPadMode(port, pad, mode) ((void) (port), (void) (pad), (void) (mode))
+
+#endif /* HOST_SHIM_HAL_PAL_H_ */
@@ -0,0 +1,14 @@
+#ifndef HOST_SHIM_HAL_STREAMS_H_
+#define HOST_SHIM_HAL_STREAMS_H_
+
+#include <cstdio>
+
+/*
+ * Sur le host, un flux séquentiel n'est qu'un FILE* (stdout, stderr, fichier de log...)
+ */
+struct BaseSequentialStream
+{
+    FILE *file;
+};
+
+#endif /* HOST_SHIM_HAL_STREAMS_H_ */
@@ -0,0 +1,135 @@
+#include "ch.h"
+#include "hal.h"
+#include "chprintf.h"
+#include <chrono>
+#include <thread>
+#include <cstdarg>
+#include <cstdlib>
+
+/*
+ * Implémentation host du shim ChibiOS : le temps système est l'horloge monotone
+ *  du host, ramenée à la fréquence du systick de la cible.
+ */
+
+static BaseSequentialStream stdoutStream = { stdout };
+BaseSequentialStream *outputStream = &stdoutStream;
+
+static const std::chrono::steady_clock::time_point s_startTime = std::chrono::steady_clock::now();
+
+void chSysLock(void)
+{
+}
+
+void chSysUnlock(void)
+{
+}
+
+systime_t chVTGetSystemTime(void)
+{
+    auto elapsed = std::chrono::steady_clock::now() - s_startTime;
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    return (systime_t) ((time_conv_t) elapsed_us * CH_CFG_ST_FREQUENCY / 1000000);
+}
+
+void chThdSleep(sysinterval_t time)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds((time_conv_t) time * 1000000 / CH_CFG_ST_FREQUENCY));
+}
+
+void chThdSleepUntil(systime_t time)
+{
+    // Même arithmétique modulaire que ChibiOS : une échéance passée ne dort pas
+    sysinterval_t remaining = time - chVTGetSystemTime();
+    if ((int32_t) remaining > 0)
+        chThdSleep(remaining);
+}
+
+systime_t chThdSleepUntilWindowed(systime_t prev, systime_t next)
+{
+    systime_t time = chVTGetSystemTime();
+    if (chTimeIsInRangeX(time, prev, next))
+        chThdSleep(chTimeDiffX(time, next));
+    return chTimeAddX(next, chTimeDiffX(prev, next));
+}
+
+void chThdYield(void)
+{
+    std::this_thread::yield();
+}
+
+rtcnt_t chSysGetRealtimeCounterX(void)
+{
+    auto elapsed = std::chrono::steady_clock::now() - s_startTime;
+    return (rtcnt_t) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+thread_t *chThdCreateStatic(void *wsp, size_t size, tprio_t prio, tfunc_t pf, void *arg)
+{
+    (void) wsp;
+    (void) size;
+    (void) prio;
+    std::thread(pf, arg).detach();
+    return (thread_t*) wsp;
+}
+
+void chRegSetThreadName(const char *name)
+{
+    (void) name;
+}
+
+void chBSemObjectInit(binary_semaphore_t *bsp, bool taken)
+{
+    bsp->taken = taken;
+}
+
+msg_t chBSemWait(binary_semaphore_t *bsp)
+{
+    return chBSemWaitTimeout(bsp, TIME_INFINITE);
+}
+
+msg_t chBSemWaitTimeout(binary_semaphore_t *bsp, sysinterval_t timeout)
+{
+    std::unique_lock<std::mutex> lock(bsp->mutex);
+    if (timeout == TIME_INFINITE)
+    {
+        bsp->condition.wait(lock, [bsp] { return !bsp->taken; });
+    }
+    else
+    {
+        auto duration = std::chrono::microseconds((time_conv_t) timeout * 1000000 / CH_CFG_ST_FREQUENCY);
+        if (!bsp->condition.wait_for(lock, duration, [bsp] { return !bsp->taken; }))
+            return MSG_TIMEOUT;
+    }
+    bsp->taken = true;
+    return MSG_OK;
+}
+
+void chBSemSignal(binary_semaphore_t *bsp)
+{
+    {
+        std::lock_guard<std::mutex> lock(bsp->mutex);
+        bsp->taken = false;
+    }
+    bsp->condition.notify_one();
+}
+
+void chSysHalt(const char *reason)
+{
+    fprintf(stderr, "chSysHalt: %s\n", reason);
+    abort();
+}
+
+void dbg_assert(const char* assertion, const char* file, unsigned line, const char* func, const char* reason)
+{
+    fprintf(stderr, "%s:%u (%s): assertion (%s) failed ; reason = %s\n", file, line, func, assertion, reason);
+    chSysHalt(func);
+}
+
+int chprintf(BaseSequentialStream *chp, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vfprintf(chp->file, fmt, ap);
+    va_end(ap);
+    return n;
+}
@@ -0,0 +1,49 @@
+#include "hal.h"
+
+/*
+ * Implémentation host des drivers HAL utilisés par src/ (PAL, I2C)
+ */
+
+stm32_gpio_t hostGpioA, hostGpioB, hostGpioC;
+
+I2CDriver I2CD1 = { I2C_STOP, nullptr, nullptr, { } };
+I2CDriver I2CD2 = { I2C_STOP, nullptr, nullptr, { } };
+
+void i2cStart(I2CDriver *i2cp, const I2CConfig *config)
+{
+    chDbgAssert(i2cp->state == I2C_STOP || i2cp->state == I2C_READY || i2cp->state == I2C_LOCKED, "invalid state");
+    i2cp->config = config;
+    i2cp->state = I2C_READY;
+}
+
+void i2cStop(I2CDriver *i2cp)
+{
+    i2cp->state = I2C_STOP;
+}
+
+void i2cAcquireBus(I2CDriver *i2cp)
+{
+    i2cp->mutex.lock();
+}
+
+void i2cReleaseBus(I2CDriver *i2cp)
+{
+    i2cp->mutex.unlock();
+}
+
+msg_t i2cMasterTransmitTimeout(I2CDriver *i2cp, i2caddr_t addr, const uint8_t *txbuf, size_t txbytes, uint8_t *rxbuf,
+        size_t rxbytes, sysinterval_t timeout)
+{
+    chDbgAssert(i2cp->state == I2C_READY, "not ready");
+    chDbgAssert(i2cp->bus != nullptr, "no host I2C bus attached to this driver");
+
+    i2cp->state = I2C_ACTIVE_TX;
+    msg_t msg = i2cp->bus->transfer(addr, txbuf, txbytes, rxbuf, rxbytes, timeout);
+    i2cp->state = (msg == MSG_TIMEOUT) ? I2C_LOCKED : I2C_READY;
+    return msg;
+}
+
+msg_t i2cMasterReceiveTimeout(I2CDriver *i2cp, i2caddr_t addr, uint8_t *rxbuf, size_t rxbytes, sysinterval_t timeout)
+{
+    return i2cMasterTransmitTimeout(i2cp, addr, nullptr, 0, rxbuf, rxbytes, timeout);
+}
@@ -0,0 +1,65 @@
+#include "USBStream.h"
+#include <cstring>
+
+/*
+ * Implémentation host de USBStream : pas d'USB, chaque échantillon est recopié
+ *  dans un buffer local pour garder un coût proche de celui de la cible.
+ *  Instance et buffer sont propres à chaque thread : chaque thread qui fait tourner une boucle d'asserv appelle init().
+ */
+
+static thread_local UsbStreamSample s_hostBuffer;
+
+const uint32_t synchroWord_stream = 0xCAFED00D;
+
+thread_local USBStream *USBStream::s_instance = NULL;
+USBStream::USBStream()
+{
+    m_currentPtr = NULL;
+    m_timestamp = 0;
+    m_bufferSize = 0;
+    std::memset(&m_currentStruct, 0xFF, sizeof(m_currentStruct));
+}
+
+void USBStream::init()
+{
+    if (s_instance == NULL)
+        s_instance = new USBStream();
+    s_instance->getEmptyBuffer();
+}
+
+void* USBStream::sendCurrentStream()
+{
+    m_currentStruct.synchro = synchroWord_stream;
+    m_currentStruct.timestamp = m_timestamp++;
+
+    sendFullBuffer();
+
+    getEmptyBuffer();
+
+    return m_currentPtr;
+}
+
+void USBStream::sendConfig(uint8_t *, uint8_t)
+{
+}
+
+void USBStream::sendFullBuffer()
+{
+    if (m_currentPtr != NULL) {
+        *m_currentPtr = m_currentStruct;
+    }
+}
+
+void USBStream::getEmptyBuffer()
+{
+    m_currentPtr = &s_hostBuffer;
+}
+
+void USBStream::getFullBuffer(void **, uint32_t *size)
+{
+    *size = 0;
+}
+
+void USBStream::releaseBuffer()
+{
+}
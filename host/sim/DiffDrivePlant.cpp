@@ -0,0 +1,167 @@
+#include "DiffDrivePlant.h"
+#include "util/asservMath.h"
+#include <cmath>
+
+DiffDrivePlant::Configuration DiffDrivePlant::idealConfiguration(float loopFrequency, float maxSpeed_mmps,
+        float encoderWheelRadius_mm, float encoderWheelsDistance_mm, uint32_t encoderTicksByTurn)
+{
+    Configuration config;
+    config.loopPeriod_s = 1.0f / loopFrequency;
+    config.maxWheelSpeed_mmps = maxSpeed_mmps;
+    config.rightMotorTimeConstant_s = 0;
+    config.leftMotorTimeConstant_s = 0;
+    config.motorDeadband_percent = 0;
+    config.md22Quantization = false;
+    config.maxGroundAcceleration_mmps2 = 0;
+    config.motorWheelsDistance_mm = encoderWheelsDistance_mm;
+    config.encoderWheelRadius_mm = encoderWheelRadius_mm;
+    config.rightEncoderRadiusError = 0;
+    config.leftEncoderRadiusError = 0;
+    config.encoderWheelsDistance_mm = encoderWheelsDistance_mm;
+    config.encoderTicksByTurn = encoderTicksByTurn;
+    config.motorEncoderWheelRadius_mm = encoderWheelRadius_mm;
+    config.rightMotorEncoderRadiusError = 0;
+    config.leftMotorEncoderRadiusError = 0;
+    config.motorEncoderTicksByTurn = encoderTicksByTurn;
+    return config;
+}
+
+static float motorAlpha(float timeConstant_s, float period_s)
+{
+    // Premier ordre discrétisé exactement, une constante de temps nulle donne un moteur instantané
+    if (timeConstant_s <= 0)
+        return 1;
+    return 1.0f - expf(-period_s / timeConstant_s);
+}
+
+DiffDrivePlant::DiffDrivePlant(const Configuration &configuration) :
+        m_config(configuration), m_motorEncoders(*this)
+{
+    setLoopPeriod(m_config.loopPeriod_s);
+    m_rightTicksBymm = m_config.encoderTicksByTurn / (M_2PI_F * m_config.encoderWheelRadius_mm * (1.0f + m_config.rightEncoderRadiusError));
+    m_leftTicksBymm = m_config.encoderTicksByTurn / (M_2PI_F * m_config.encoderWheelRadius_mm * (1.0f + m_config.leftEncoderRadiusError));
+    m_rightMotorTicksBymm = m_config.motorEncoderTicksByTurn / (M_2PI_F * m_config.motorEncoderWheelRadius_mm * (1.0f + m_config.rightMotorEncoderRadiusError));
+    m_leftMotorTicksBymm = m_config.motorEncoderTicksByTurn / (M_2PI_F * m_config.motorEncoderWheelRadius_mm * (1.0f + m_config.leftMotorEncoderRadiusError));
+
+    m_rightConsign = 0;
+    m_leftConsign = 0;
+    m_rightWheelSpeed = 0;
+    m_leftWheelSpeed = 0;
+    m_rightGroundSpeed = 0;
+    m_leftGroundSpeed = 0;
+    m_rightTicksRemainder = 0;
+    m_leftTicksRemainder = 0;
+    m_rightContact = 1;
+    m_leftContact = 1;
+    m_rotationSpeed = 0;
+    m_rightMotorTicksRemainder = 0;
+    m_leftMotorTicksRemainder = 0;
+    m_rightMotorEncoderDelta = 0;
+    m_leftMotorEncoderDelta = 0;
+
+    m_X_mm = 0;
+    m_Y_mm = 0;
+    m_theta_rad = 0;
+    m_time_s = 0;
+    m_slipDistance_mm = 0;
+}
+
+void DiffDrivePlant::setMotorRightSpeed(float percentage)
+{
+    m_rightConsign = percentage;
+}
+
+void DiffDrivePlant::setMotorLeftSpeed(float percentage)
+{
+    m_leftConsign = percentage;
+}
+
+void DiffDrivePlant::setPosition(double X_mm, double Y_mm, double theta_rad)
+{
+    m_X_mm = X_mm;
+    m_Y_mm = Y_mm;
+    m_theta_rad = theta_rad;
+}
+
+void DiffDrivePlant::setLoopPeriod(float loopPeriod_s)
+{
+    m_config.loopPeriod_s = loopPeriod_s;
+    m_rightMotorAlpha = motorAlpha(m_config.rightMotorTimeConstant_s, loopPeriod_s);
+    m_leftMotorAlpha = motorAlpha(m_config.leftMotorTimeConstant_s, loopPeriod_s);
+}
+
+void DiffDrivePlant::setEncodersContact(float rightContact, float leftContact)
+{
+    m_rightContact = rightContact;
+    m_leftContact = leftContact;
+}
+
+float DiffDrivePlant::motorTargetSpeed(float percentage) const
+{
+    percentage = limit(percentage, -100.0f, 100.0f);
+
+    if (m_config.md22Quantization)
+    {
+        // Comme Md22::computeConsign(), puis retour en % côté carte
+        int8_t consign = (int8_t) fmap(percentage, -100.0f, 100.0f, -128.0f, 127.0f);
+        percentage = fmap(consign, -128.0f, 127.0f, -100.0f, 100.0f);
+    }
+
+    float magnitude = fabsf(percentage);
+    if (magnitude <= m_config.motorDeadband_percent)
+        return 0;
+
+    float speed = (magnitude - m_config.motorDeadband_percent) / (100.0f - m_config.motorDeadband_percent) * m_config.maxWheelSpeed_mmps;
+    return (percentage > 0) ? speed : -speed;
+}
+
+float DiffDrivePlant::groundSpeedStep(float groundSpeed, float wheelSpeed, float maxDelta)
+{
+    // Sans limite d'adhérence, la roue ne patine jamais
+    if (maxDelta <= 0)
+        return wheelSpeed;
+    return groundSpeed + limit(wheelSpeed - groundSpeed, -maxDelta, maxDelta);
+}
+
+float DiffDrivePlant::quantize(float ticks, float *remainder)
+{
+    float total = ticks + *remainder;
+    float quantized = floorf(total);
+    *remainder = total - quantized;
+    return quantized;
+}
+
+void DiffDrivePlant::getValues(float *deltaEncoderRight, float *deltaEncoderLeft)
+{
+    const float dt = m_config.loopPeriod_s;
+
+    m_rightWheelSpeed += m_rightMotorAlpha * (motorTargetSpeed(m_rightConsign) - m_rightWheelSpeed);
+    m_leftWheelSpeed += m_leftMotorAlpha * (motorTargetSpeed(m_leftConsign) - m_leftWheelSpeed);
+
+    const float maxGroundDelta = m_config.maxGroundAcceleration_mmps2 * dt;
+    m_rightGroundSpeed = groundSpeedStep(m_rightGroundSpeed, m_rightWheelSpeed, maxGroundDelta);
+    m_leftGroundSpeed = groundSpeedStep(m_leftGroundSpeed, m_leftWheelSpeed, maxGroundDelta);
+    m_slipDistance_mm += (fabsf(m_rightWheelSpeed - m_rightGroundSpeed) + fabsf(m_leftWheelSpeed - m_leftGroundSpeed)) * dt;
+
+    // Mouvement du châssis, imposé par les roues motrices
+    const float speed = (m_rightGroundSpeed + m_leftGroundSpeed) * 0.5f;
+    const float rotationSpeed = (m_rightGroundSpeed - m_leftGroundSpeed) / m_config.motorWheelsDistance_mm;
+    m_rotationSpeed = rotationSpeed;
+
+    const double deltaTheta = double(rotationSpeed) * dt;
+    const double midTheta = m_theta_rad + deltaTheta * 0.5;
+    m_X_mm += double(speed) * dt * cos(midTheta);
+    m_Y_mm += double(speed) * dt * sin(midTheta);
+    m_theta_rad += deltaTheta;
+    m_time_s += dt;
+
+    // ... vu par les roues codeuses, à leur propre voie
+    const float rightDistance = (speed + rotationSpeed * m_config.encoderWheelsDistance_mm * 0.5f) * dt;
+    const float leftDistance = (speed - rotationSpeed * m_config.encoderWheelsDistance_mm * 0.5f) * dt;
+    *deltaEncoderRight = quantize(rightDistance * m_rightContact * m_rightTicksBymm, &m_rightTicksRemainder) * m_rightGain;
+    *deltaEncoderLeft = quantize(leftDistance * m_leftContact * m_leftTicksBymm, &m_leftTicksRemainder) * m_leftGain;
+
+    // ... et par les codeurs des roues motrices, qui tournent à la vitesse de roue même quand elles patinent
+    m_rightMotorEncoderDelta = quantize(m_rightWheelSpeed * dt * m_rightMotorTicksBymm, &m_rightMotorTicksRemainder);
+    m_leftMotorEncoderDelta = quantize(m_leftWheelSpeed * dt * m_leftMotorTicksBymm, &m_leftMotorTicksRemainder);
+}
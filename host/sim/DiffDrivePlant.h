@@ -0,0 +1,167 @@
+#ifndef HOST_SIM_DIFFDRIVEPLANT_H_
+#define HOST_SIM_DIFFDRIVEPLANT_H_
+
+#include "Encoders/Encoder.h"
+#include "motorController/MotorController.h"
+#include <cstdint>
+
+/*
+ * Robot à propulsion différentielle simulé, en temps virtuel.
+ *
+ *  Reçoit les consignes moteur (en %) via MotorController et rend des deltas codeur quantifiés via Encoders :
+ *  la boucle d'asserv (AsservMain, CommandManager, Odometry) tourne en boucle fermée contre lui,
+ *  sans carte ni attente. Chaque getValues() fait avancer la simulation d'une période de boucle.
+ *
+ *  Modèle, pour chaque côté :
+ *   - consigne quantifiée comme l'envoie la MD22 (int8, de -128 à 127),
+ *   - zone morte du moteur, puis vitesse de roue du premier ordre (constante de temps du moteur),
+ *   - adhérence limitée : la vitesse au sol suit la vitesse de roue avec une accélération bornée, l'écart est du patinage,
+ *   - roues codeuses folles, avec leur propre rayon (erreur par côté) et leur propre voie,
+ *     quantifiées au tick près avec ENCODERS_TICKS_BY_TURN ticks par tour, qui peuvent perdre le contact avec le sol
+ *     (les gains Encoders::setGains() s'appliquent aux ticks rendus, comme sur le robot),
+ *   - codeurs sur les roues motrices (getMotorEncoders()), qui voient la vitesse de roue, patinage compris.
+ *  La position réelle du robot (getX_mm()...) sert de vérité terrain face à l'odométrie.
+ */
+class DiffDrivePlant final : public Encoders, public MotorController
+{
+public:
+    struct Configuration
+    {
+        float loopPeriod_s;
+
+        // Moteurs : vitesse au sol de la roue motrice à 100%, constante de temps, zone morte (en %)
+        float maxWheelSpeed_mmps;
+        float rightMotorTimeConstant_s;
+        float leftMotorTimeConstant_s;
+        float motorDeadband_percent;
+        bool  md22Quantization;
+
+        // Adhérence : accélération max au sol de chaque roue motrice, au delà elle patine
+        float maxGroundAcceleration_mmps2;
+        float motorWheelsDistance_mm;
+
+        // Roues codeuses : valeurs nominales (celles du robotConfig.h) et erreurs réelles
+        float encoderWheelRadius_mm;
+        float rightEncoderRadiusError;   // rayon réel = nominal * (1 + erreur)
+        float leftEncoderRadiusError;
+        float encoderWheelsDistance_mm;  // voie réelle des roues codeuses
+        uint32_t encoderTicksByTurn;
+
+        // Codeurs des roues motrices : rayon nominal, erreurs réelles, résolution
+        float motorEncoderWheelRadius_mm;
+        float rightMotorEncoderRadiusError;
+        float leftMotorEncoderRadiusError;
+        uint32_t motorEncoderTicksByTurn;
+    };
+
+    /*
+     * Codeurs des roues motrices, lus après getValues() : ticks de la même période
+     */
+    class MotorEncoders final : public Encoders
+    {
+    public:
+        explicit MotorEncoders(const DiffDrivePlant &plant) : m_plant(plant)
+        {
+        }
+        virtual ~MotorEncoders()
+        {
+        }
+
+        virtual void getValues(float *deltaEncoderRight, float *deltaEncoderLeft) override
+        {
+            *deltaEncoderRight = m_plant.m_rightMotorEncoderDelta;
+            *deltaEncoderLeft = m_plant.m_leftMotorEncoderDelta;
+        }
+
+    private:
+        const DiffDrivePlant &m_plant;
+    };
+
+    /*
+     * Configuration idéale (pas de zone morte, ni patinage, ni erreur de géométrie)
+     *  à partir des réglages nominaux du robot. Les imperfections se règlent ensuite champ par champ.
+     */
+    static Configuration idealConfiguration(float loopFrequency, float maxSpeed_mmps,
+            float encoderWheelRadius_mm, float encoderWheelsDistance_mm, uint32_t encoderTicksByTurn);
+
+    explicit DiffDrivePlant(const Configuration &configuration);
+    virtual ~DiffDrivePlant()
+    {
+    }
+
+    /*
+     * Encoders : avance la simulation d'une période et rend les ticks codeur de cette période
+     */
+    virtual void getValues(float *deltaEncoderRight, float *deltaEncoderLeft) override;
+
+    /*
+     * MotorController : consignes appliquées à partir de la prochaine période
+     */
+    virtual void setMotorRightSpeed(float percentage) override;
+    virtual void setMotorLeftSpeed(float percentage) override;
+
+    void setPosition(double X_mm, double Y_mm, double theta_rad);
+
+    /*
+     * Durée des périodes suivantes : pour suivre une boucle dont la période varie (gigue, ticks manqués)
+     */
+    void setLoopPeriod(float loopPeriod_s);
+
+    /*
+     * Contact des roues codeuses folles avec le sol : 1 en temps normal, 0 pour une roue levée (bordure, obstacle)
+     *  qui ne compte plus rien, entre les deux pour une roue qui glisse
+     */
+    void setEncodersContact(float rightContact, float leftContact);
+
+    MotorEncoders &getMotorEncoders() { return m_motorEncoders; }
+
+    // Vérité terrain
+    double getX_mm() const { return m_X_mm; }
+    double getY_mm() const { return m_Y_mm; }
+    double getTheta_rad() const { return m_theta_rad; }
+    double getTime_s() const { return m_time_s; }
+    float getRightGroundSpeed() const { return m_rightGroundSpeed; }
+    float getLeftGroundSpeed() const { return m_leftGroundSpeed; }
+    float getRotationSpeed() const { return m_rotationSpeed; }
+    // Distance cumulée parcourue par les roues motrices en patinant (en mm, les deux côtés)
+    double getSlipDistance_mm() const { return m_slipDistance_mm; }
+
+private:
+    float motorTargetSpeed(float percentage) const;
+    static float groundSpeedStep(float groundSpeed, float wheelSpeed, float maxDelta);
+    static float quantize(float ticks, float *remainder);
+
+    Configuration m_config;
+    float m_rightMotorAlpha;
+    float m_leftMotorAlpha;
+    float m_rightTicksBymm;
+    float m_leftTicksBymm;
+
+    float m_rightConsign;
+    float m_leftConsign;
+    float m_rightWheelSpeed;
+    float m_leftWheelSpeed;
+    float m_rightGroundSpeed;
+    float m_leftGroundSpeed;
+    float m_rightTicksRemainder;
+    float m_leftTicksRemainder;
+    float m_rightContact;
+    float m_leftContact;
+    float m_rotationSpeed;
+
+    float m_rightMotorTicksBymm;
+    float m_leftMotorTicksBymm;
+    float m_rightMotorTicksRemainder;
+    float m_leftMotorTicksRemainder;
+    float m_rightMotorEncoderDelta;
+    float m_leftMotorEncoderDelta;
+    MotorEncoders m_motorEncoders;
+
+    double m_X_mm;
+    double m_Y_mm;
+    double m_theta_rad;
+    double m_time_s;
+    double m_slipDistance_mm;
+};
+
+#endif /* HOST_SIM_DIFFDRIVEPLANT_H_ */
@@ -0,0 +1,36 @@
+#ifndef HOST_SIM_SIMULATEDGYRO_H_
+#define HOST_SIM_SIMULATEDGYRO_H_
+
+#include "HeadingRateSensor.h"
+#include "DiffDrivePlant.h"
+#include <random>
+
+/*
+ * Gyromètre simulé : vitesse angulaire réelle du robot simulé, plus un biais constant et un bruit blanc gaussien
+ *  (graine fixe, les résultats sont reproductibles). Un échantillon par itération.
+ */
+class SimulatedGyro final : public HeadingRateSensor
+{
+public:
+    SimulatedGyro(const DiffDrivePlant &plant, float bias_radps, float noise_radps) :
+            m_plant(plant), m_bias(bias_radps), m_noise(0.0f, noise_radps), m_generator(42)
+    {
+    }
+    virtual ~SimulatedGyro()
+    {
+    }
+
+    virtual bool getHeadingRate(float *rate_radps) override
+    {
+        *rate_radps = m_plant.getRotationSpeed() + m_bias + m_noise(m_generator);
+        return true;
+    }
+
+private:
+    const DiffDrivePlant &m_plant;
+    float m_bias;
+    std::normal_distribution<float> m_noise;
+    std::mt19937 m_generator;
+};
+
+#endif /* HOST_SIM_SIMULATEDGYRO_H_ */
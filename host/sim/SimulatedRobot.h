@@ -0,0 +1,191 @@
+#ifndef HOST_SIM_SIMULATEDROBOT_H_
+#define HOST_SIM_SIMULATEDROBOT_H_
+
+#include <cmath>
+
+#include "robotConfig.h"
+#include "ComposedAsservMain.h"
+#include "commandManager/CommandManager.h"
+#include "SpeedController/AdaptativeSpeedController.h"
+#include "AccelerationLimiter/SimpleAccelerationLimiter.h"
+#include "AccelerationLimiter/AdvancedAccelerationLimiter.h"
+#include "Odometry.h"
+#include "Regulator.h"
+#include "Pll.h"
+#include "DiffDrivePlant.h"
+
+/*
+ * Robot ROBOT_NAME simulé pour les outils host : chaîne de contrôle construite comme dans src/Robots/<robot>/main.cpp,
+ *  avec les réglages du robotConfig.h, autour d'un DiffDrivePlant ou des codeurs et moteurs propres à un banc.
+ *  Header seulement : robotConfig.h est celui du robot de l'exécutable (un outil par robot, voir host/Makefile).
+ */
+
+typedef ComposedAsservMain<DiffDrivePlant, DiffDrivePlant, AdaptativeSpeedController,
+        SimpleAccelerationLimiter, AdvancedAccelerationLimiter> SimAsservMain;
+
+/*
+ * Moteurs du robot simulé : constantes de temps différentes à droite et à gauche, zone morte,
+ *  consigne quantifiée comme par le MD22. Adhérence parfaite, roues motrices sur la voie des roues codeuses.
+ */
+static inline DiffDrivePlant::Configuration simulatedPlantConfiguration()
+{
+    DiffDrivePlant::Configuration config = DiffDrivePlant::idealConfiguration(ASSERV_THREAD_FREQUENCY, 1.2f * MAX_SPEED_MM_PER_SEC,
+            ENCODERS_WHEELS_RADIUS_MM, ENCODERS_WHEELS_DISTANCE_MM, ENCODERS_TICKS_BY_TURN);
+    config.rightMotorTimeConstant_s = 0.060f;
+    config.leftMotorTimeConstant_s = 0.050f;
+    config.motorDeadband_percent = 4;
+    config.md22Quantization = true;
+    return config;
+}
+
+/*
+ * Même robot, avec l'adhérence limitée au sol et les roues motrices sur une voie plus courte que les roues codeuses
+ */
+static inline DiffDrivePlant::Configuration realisticPlantConfiguration()
+{
+    DiffDrivePlant::Configuration config = simulatedPlantConfiguration();
+    config.maxGroundAcceleration_mmps2 = 3000;
+    config.motorWheelsDistance_mm = ENCODERS_WHEELS_DISTANCE_MM * 0.8f;
+    return config;
+}
+
+/*
+ * Réglages de la chaîne de contrôle, ceux du robotConfig.h par défaut.
+ *  Les gains des asserv en vitesse pointent sur des tableaux de NB_PI_SUBSET valeurs, copiés à la construction.
+ */
+struct SimulatedTuning
+{
+    SimulatedTuning() :
+            angleKp(ANGLE_REGULATOR_KP), distKp(DIST_REGULATOR_KP), pllBandwidth(PLL_BANDWIDTH),
+            speedKpRight(speed_controller_right_Kp), speedKiRight(speed_controller_right_Ki),
+            speedKpLeft(speed_controller_left_Kp), speedKiLeft(speed_controller_left_Ki),
+            angleMaxAcc(ANGLE_REGULATOR_MAX_ACC), distMaxAcc(DIST_REGULATOR_MAX_ACC), distMinAcc(DIST_REGULATOR_MIN_ACC),
+            distHighSpeedThreshold(DIST_REGULATOR_HIGH_SPEED_THRESHOLD),
+            distProfile(distanceProfileConf), angleProfile(angleProfileConf)
+    {
+    }
+
+    float angleKp;
+    float distKp;
+    float pllBandwidth;
+    const float *speedKpRight;
+    const float *speedKiRight;
+    const float *speedKpLeft;
+    const float *speedKiLeft;
+    float angleMaxAcc;
+    float distMaxAcc;
+    float distMinAcc;
+    float distHighSpeedThreshold;
+    SCurveProfile::Configuration distProfile;
+    SCurveProfile::Configuration angleProfile;
+};
+
+/*
+ * Régulateurs, Pll, odométrie, asserv en vitesse, limiteurs, CommandManager et boucle d'asserv AsservMainT
+ *  (ComposedAsservMain ou AsservMain), branchés sur les moteurs et codeurs donnés
+ */
+template<typename AsservMainT>
+struct SimulatedControlChain
+{
+    template<typename MotorControllerT, typename EncodersT>
+    SimulatedControlChain(MotorControllerT &motorController, EncodersT &encoders, const SimulatedTuning &tuning = SimulatedTuning()) :
+            angleRegulator(tuning.angleKp, MAX_SPEED_MM_PER_SEC),
+            distanceRegulator(tuning.distKp, MAX_SPEED_MM_PER_SEC),
+            rightPll(tuning.pllBandwidth), leftPll(tuning.pllBandwidth),
+            odometry(ENCODERS_WHEELS_DISTANCE_MM, 0, 0),
+            speedControllerRight(tuning.speedKpRight, tuning.speedKiRight, speed_controller_right_SpeedRange, 100, MAX_SPEED_MM_PER_SEC),
+            speedControllerLeft(tuning.speedKpLeft, tuning.speedKiLeft, speed_controller_left_SpeedRange, 100, MAX_SPEED_MM_PER_SEC),
+            angleAccelerationlimiter(tuning.angleMaxAcc),
+            distanceAccelerationLimiter(tuning.distMaxAcc, tuning.distMinAcc, tuning.distHighSpeedThreshold),
+            commandManager(COMMAND_MANAGER_ARRIVAL_DISTANCE_THRESHOLD_mm, COMMAND_MANAGER_ARRIVAL_ANGLE_THRESHOLD_RAD,
+                    preciseGotoConf, waypointGotoConf, gotoNoStopConf, tuning.distProfile, tuning.angleProfile, distanceBrakeConf, angleBrakeConf,
+                    lookAheadConf, splinePathConf,
+                    angleRegulator, distanceRegulator),
+            mainAsserv(ASSERV_THREAD_FREQUENCY, ASSERV_POSITION_DIVISOR,
+                    ENCODERS_WHEELS_RADIUS_MM, ENCODERS_WHEELS_DISTANCE_MM, ENCODERS_TICKS_BY_TURN,
+                    commandManager, motorController, encoders, odometry,
+                    angleRegulator, distanceRegulator,
+                    angleAccelerationlimiter, distanceAccelerationLimiter,
+                    speedControllerRight, speedControllerLeft,
+                    rightPll, leftPll)
+    {
+    }
+
+    // File vide et plus de commande en cours
+    bool isIdle()
+    {
+        return commandManager.getPendingCommandCount() == 0 && commandManager.getCommandStatus() == CommandManager::STATUS_IDLE;
+    }
+
+    Regulator angleRegulator;
+    Regulator distanceRegulator;
+    Pll rightPll;
+    Pll leftPll;
+    Odometry odometry;
+    AdaptativeSpeedController speedControllerRight;
+    AdaptativeSpeedController speedControllerLeft;
+    SimpleAccelerationLimiter angleAccelerationlimiter;
+    AdvancedAccelerationLimiter distanceAccelerationLimiter;
+    CommandManager commandManager;
+    AsservMainT mainAsserv;
+};
+
+/*
+ * Le DiffDrivePlant est dans une base à part pour être construit avant la chaîne de contrôle qui le référence
+ */
+struct SimulatedPlant
+{
+    explicit SimulatedPlant(const DiffDrivePlant::Configuration &plantConfiguration) :
+            plant(plantConfiguration)
+    {
+    }
+
+    DiffDrivePlant plant;
+};
+
+/*
+ * Robot simulé complet : DiffDrivePlant (moteurs et codeurs) piloté par la boucle d'asserv du robot, en temps virtuel
+ */
+struct SimulatedRobot : SimulatedPlant, SimulatedControlChain<SimAsservMain>
+{
+    explicit SimulatedRobot(const DiffDrivePlant::Configuration &plantConfiguration, const SimulatedTuning &tuning = SimulatedTuning()) :
+            SimulatedPlant(plantConfiguration), SimulatedControlChain<SimAsservMain>(plant, plant, tuning)
+    {
+    }
+
+    // Vitesse d'avance réelle, moyenne des deux roues
+    float getSpeed() const
+    {
+        return 0.5f * (plant.getRightGroundSpeed() + plant.getLeftGroundSpeed());
+    }
+
+    bool isStopped(float stoppedSpeed_mm_per_sec) const
+    {
+        return fabsf(plant.getRightGroundSpeed()) < stoppedSpeed_mm_per_sec && fabsf(plant.getLeftGroundSpeed()) < stoppedSpeed_mm_per_sec;
+    }
+
+    // Tours de boucle jusqu'à la fin des commandes en file, au plus timeout_s : vrai si elles sont finies
+    bool runUntilIdle(double timeout_s)
+    {
+        const double start_s = plant.getTime_s();
+        while (plant.getTime_s() < start_s + timeout_s && !isIdle())
+            mainAsserv.loopIteration();
+        return isIdle();
+    }
+
+    void runFor(double duration_s)
+    {
+        const double start_s = plant.getTime_s();
+        while (plant.getTime_s() < start_s + duration_s)
+            mainAsserv.loopIteration();
+    }
+
+    // Tours de boucle jusqu'à la fin de la mise à jour suivante de la boucle de position, updates fois
+    void runPositionUpdates(uint32_t updates)
+    {
+        for (uint32_t i = 0; i < updates * ASSERV_POSITION_DIVISOR; i++)
+            mainAsserv.loopIteration();
+    }
+};
+
+#endif /* HOST_SIM_SIMULATEDROBOT_H_ */
@@ -0,0 +1,134 @@
+#ifndef HOST_SIM_WORKSTEALINGPOOL_H_
+#define HOST_SIM_WORKSTEALINGPOOL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/*
+ * Exécution parallèle de tâches indépendantes indexées de 0 à count-1, par vol de travail.
+ *
+ *  Chaque worker reçoit une tranche contiguë d'index, qu'il consomme par le début.
+ *  Quand sa tranche est vide, il vole la moitié haute de la tranche d'un autre worker :
+ *  les tâches de durées inégales (simulation qui se termine en timeout...) se répartissent sans file partagée.
+ *  Une tranche tient dans un seul mot atomique (début | fin), sur sa propre ligne de cache.
+ *
+ *  task(index, worker) est appelée une fois par index, worker étant dans [0, getThreadCount()[.
+ */
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(unsigned threadCount = 0)
+    {
+        m_threadCount = threadCount ? threadCount : std::thread::hardware_concurrency();
+        if (m_threadCount == 0)
+            m_threadCount = 1;
+    }
+
+    unsigned getThreadCount() const
+    {
+        return m_threadCount;
+    }
+
+    template<typename Task>
+    void parallelFor(uint32_t count, Task task)
+    {
+        std::vector<Slice> slices(m_threadCount);
+        for (unsigned worker = 0; worker < m_threadCount; worker++)
+        {
+            uint32_t begin = uint64_t(count) * worker / m_threadCount;
+            uint32_t end = uint64_t(count) * (worker + 1) / m_threadCount;
+            slices[worker].range.store(pack(begin, end), std::memory_order_relaxed);
+        }
+
+        std::vector<std::thread> threads;
+        for (unsigned worker = 1; worker < m_threadCount; worker++)
+            threads.emplace_back(&WorkStealingPool::run<Task>, this, slices.data(), worker, std::ref(task));
+        run(slices.data(), 0, task);
+
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+private:
+    struct alignas(64) Slice
+    {
+        std::atomic<uint64_t> range;
+    };
+
+    static uint64_t pack(uint32_t begin, uint32_t end)
+    {
+        return (uint64_t(end) << 32) | begin;
+    }
+    static uint32_t beginOf(uint64_t range)
+    {
+        return uint32_t(range);
+    }
+    static uint32_t endOf(uint64_t range)
+    {
+        return uint32_t(range >> 32);
+    }
+
+    // Prend le premier index de sa propre tranche
+    static bool popFront(Slice &slice, uint32_t *index)
+    {
+        uint64_t range = slice.range.load(std::memory_order_acquire);
+        while (beginOf(range) < endOf(range))
+        {
+            if (slice.range.compare_exchange_weak(range, pack(beginOf(range) + 1, endOf(range)), std::memory_order_acq_rel))
+            {
+                *index = beginOf(range);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Vole la moitié haute (au moins un index) de la tranche d'un autre worker
+    static bool stealHalf(Slice &victim, uint32_t *begin, uint32_t *end)
+    {
+        uint64_t range = victim.range.load(std::memory_order_acquire);
+        while (beginOf(range) < endOf(range))
+        {
+            uint32_t middle = beginOf(range) + (endOf(range) - beginOf(range)) / 2;
+            if (victim.range.compare_exchange_weak(range, pack(beginOf(range), middle), std::memory_order_acq_rel))
+            {
+                *begin = middle;
+                *end = endOf(range);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template<typename Task>
+    void run(Slice *slices, unsigned worker, Task &task)
+    {
+        Slice &own = slices[worker];
+        while (true)
+        {
+            uint32_t index;
+            while (popFront(own, &index))
+                task(index, worker);
+
+            // Tranche vide : on parcourt les autres workers, et on s'arrête quand il n'y a plus rien à voler
+            bool stolen = false;
+            for (unsigned i = 1; i < m_threadCount && !stolen; i++)
+            {
+                uint32_t begin, end;
+                if (stealHalf(slices[(worker + i) % m_threadCount], &begin, &end))
+                {
+                    own.range.store(pack(begin, end), std::memory_order_release);
+                    stolen = true;
+                }
+            }
+            if (!stolen)
+                return;
+        }
+    }
+
+    unsigned m_threadCount;
+};
+
+#endif /* HOST_SIM_WORKSTEALINGPOOL_H_ */
@@ -3,26 +3,126 @@
 
 #include "AccelerationLimiter.h"
 
+/*
+ * Partie commune des limiteurs : détection de l'accélération, le limiteur concret (LimiterT)
+ *  ne fait que borner la variation de consigne via sa méthode limitOutput().
+ *
+ *  LimiterT est la classe dérivée (CRTP) : l'appel à limitOutput() est résolu à la compilation
+ *  et peut être inliné dans limitAcceleration(), elle-même inlinable dans une boucle qui connaît
+ *  le limiteur concret (voir ComposedAsservMain.h). La classe dérivée doit déclarer
+ *  AbstractAccelerationLimiter<LimiterT> friend si son limitOutput() est privé.
+ */
+template<typename LimiterT>
 class AbstractAccelerationLimiter : public AccelerationLimiter
 {
 
 public:
-    AbstractAccelerationLimiter();
+    AbstractAccelerationLimiter()
+    {
+        m_enabled = true;
+        m_lastOutput = 0;
+        m_accelerationScale = 1;
+    }
     virtual ~AbstractAccelerationLimiter(){};
 
-    virtual float limitAcceleration(float dt, float targetSpeed, float currentSpeed);
+    virtual float limitAcceleration(float dt, float targetSpeed, float currentSpeed) override
+    {
+        // First of all, if this limiter is disabled, just return the targeted speed
+        if( !m_enabled)
+        {
+            m_lastOutput = targetSpeed;
+            return targetSpeed;
+        }
 
-    virtual void enable();
-    virtual void disable();
+        /* Then determine if we are
+         * accelerating or decelerating ...
+         */
+        bool isAccelerating;
+        if( m_lastOutput >= 0 && targetSpeed >= 0)
+        {
+            if (m_lastOutput <= targetSpeed)
+                isAccelerating = true;
+            else
+                isAccelerating = false;
+        }
+        else if( m_lastOutput < 0 && targetSpeed < 0)
+        {
+            if (m_lastOutput <= targetSpeed)
+                isAccelerating = false;
+            else
+                isAccelerating = true;
+        }
+        else
+        {
+            // In this case we will change way (ie: going front to going back), consider this as acceleration
+            isAccelerating = true;
+        }
 
-    virtual void reset();
 
-    static float constrain(float value, float low, float high);
+        /*
+         *  ... as the acceleration only is limited !
+         */
+        if( isAccelerating )
+            m_lastOutput += static_cast<LimiterT*>(this)->limitOutput(dt, targetSpeed, m_lastOutput, currentSpeed);
+        else
+            m_lastOutput = targetSpeed;
 
-private:
+        return m_lastOutput;
+    }
+
+    virtual float limitProfileSpeed(float dt, float targetSpeed) override
+    {
+        if( !m_enabled)
+        {
+            m_lastOutput = targetSpeed;
+            return targetSpeed;
+        }
+
+        const float maxDelta = dt * PROFILE_ACCELERATION_RATIO * static_cast<LimiterT*>(this)->getMaxAcceleration() * m_accelerationScale;
+        m_lastOutput += constrain(targetSpeed - m_lastOutput, -maxDelta, maxDelta);
+        return m_lastOutput;
+    }
+
+    virtual float bypass(float targetSpeed) override
+    {
+        m_lastOutput = targetSpeed;
+        return targetSpeed;
+    }
+
+    virtual void setAccelerationScale(float scale) override
+    {
+        m_accelerationScale = scale;
+    }
 
-    virtual float limitOutput(float dt, float targetSpeed, float previousOutput, float currentSpeed) = 0;
+    virtual void enable() override
+    {
+        m_enabled = true;
+    }
 
+    virtual void disable() override
+    {
+        m_enabled = false;
+    }
+
+    virtual void reset() override
+    {
+        m_lastOutput = 0;
+    }
+
+    static float constrain(float value, float low, float high)
+    {
+        if (value < low)
+            return low;
+        if (value > high)
+            return high;
+        return value;
+    }
+
+protected:
+    // A appliquer par le limitOutput() de la classe dérivée
+    float m_accelerationScale;
+
+private:
     bool  m_enabled;
     float m_lastOutput;
 };
@@ -10,6 +10,32 @@ public:
 
     virtual float limitAcceleration(float dt, float targetSpeed, float currentSpeed) = 0;
 
+    /*
+     * Consigne qui suit un profil de vitesse (voir SCurveProfile) : le profil borne déjà son accélération,
+     *  sous l'accélération max du limiteur, reste à borner la correction de l'asserv en position.
+     *  Contrairement à limitAcceleration(), la décélération est bornée aussi, à PROFILE_ACCELERATION_RATIO
+     *  de l'accélération max quelle que soit la vitesse. Le limiteur reste synchronisé : la prochaine consigne limitée partira de celle-ci
+     */
+    virtual float limitProfileSpeed(float dt, float targetSpeed) = 0;
+
+    /*
+     * Rend la consigne sans la limiter, pendant le freinage de la pause (voir CommandManager::pause) : son profil est
+     *  déjà aux accélérations max, sans marge pour une correction. Le limiteur reste synchronisé
+     */
+    virtual float bypass(float targetSpeed) = 0;
+
+    /*
+     * Quand la borne est atteinte (la consigne rattrape d'un coup l'avance de l'anticipation au départ d'un profil),
+     *  l'asserv en vitesse dépasse un peu l'accélération de sa consigne : la marge sous l'accélération max couvre ce dépassement.
+     *  Les profils doivent en rester en dessous (PROFILE_ACCELERATION_SHARE du robotConfig.h)
+     */
+    static constexpr float PROFILE_ACCELERATION_RATIO = 0.9f;
+
+    /*
+     * Facteur appliqué aux accélérations max (1 par défaut), baissé quand les roues patinent (voir SlipDetector)
+     */
+    virtual void setAccelerationScale(float scale) = 0;
+
     virtual void enable() = 0;
     virtual void disable() = 0;
     virtual void reset() = 0;
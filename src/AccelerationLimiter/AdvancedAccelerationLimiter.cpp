@@ -29,10 +29,13 @@ float AdvancedAccelerationLimiter::limitOutput(float dt, float targetSpeed, floa
     float change = targetSpeed - previousOutput;
     float maxDelta;
 
-    if( fabs(currentSpeed) >= m_HighSpeedThreshold)
+    if( fabsf(currentSpeed) >= m_HighSpeedThreshold)
        maxDelta = dt * m_maxAcceleration;
    else
-       maxDelta = dt * (m_minAcceleration + fabs(currentSpeed)*(m_maxAcceleration-m_minAcceleration)/m_HighSpeedThreshold);
+       maxDelta = dt * (m_minAcceleration + fabsf(currentSpeed)*(m_maxAcceleration-m_minAcceleration)/m_HighSpeedThreshold);
+
+    // Lowered while the drive wheels slip (see SlipDetector)
+    maxDelta *= m_accelerationScale;
 
     return constrain(change, -maxDelta, maxDelta);
 }
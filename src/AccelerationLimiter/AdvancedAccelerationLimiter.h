@@ -3,7 +3,7 @@
 
 #include "AbstractAccelerationLimiter.h"
 
-class AdvancedAccelerationLimiter : public AbstractAccelerationLimiter
+class AdvancedAccelerationLimiter final : public AbstractAccelerationLimiter<AdvancedAccelerationLimiter>
 {
 
 public:
@@ -19,7 +19,8 @@ public:
     inline float getHighSpeedThreshold() const{ return m_HighSpeedThreshold; };
 
 private:
-    virtual float limitOutput(float dt, float targetSpeed, float previousOutput, float currentSpeed);
+    friend class AbstractAccelerationLimiter<AdvancedAccelerationLimiter>;
+    float limitOutput(float dt, float targetSpeed, float previousOutput, float currentSpeed);
 
     float m_maxAcceleration;
     float m_minAcceleration;
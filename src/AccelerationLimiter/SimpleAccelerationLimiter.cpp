@@ -18,7 +18,7 @@ SimpleAccelerationLimiter::SimpleAccelerationLimiter(float maxAcceleration) : Ab
 float SimpleAccelerationLimiter::limitOutput(float dt, float targetSpeed, float previousOutput, float)
 {
     float change = targetSpeed - previousOutput;
-    float maxDelta = dt * m_maxAcceleration;
+    float maxDelta = dt * m_maxAcceleration * m_accelerationScale;
 
     return constrain(change, -maxDelta, maxDelta);
 }
@@ -3,7 +3,7 @@
 
 #include "AbstractAccelerationLimiter.h"
 
-class SimpleAccelerationLimiter : public AbstractAccelerationLimiter
+class SimpleAccelerationLimiter final : public AbstractAccelerationLimiter<SimpleAccelerationLimiter>
 {
 
 public:
@@ -14,7 +14,8 @@ public:
     inline float getMaxAcceleration() const { return m_maxAcceleration; };
 
 private:
-    virtual float limitOutput(float dt, float targetSpeed, float previousOutput, float currentSpeed);
+    friend class AbstractAccelerationLimiter<SimpleAccelerationLimiter>;
+    float limitOutput(float dt, float targetSpeed, float previousOutput, float currentSpeed);
 
     float m_maxAcceleration;
 };
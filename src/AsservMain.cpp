@@ -1,17 +1,21 @@
 #include "AsservMain.h"
+#include "ComposedAsservMain.h"
 #include "ch.h"
 #include "hal.h"
 #include "commandManager/CommandManager.h"
 #include "USBStream.h"
 #include "Odometry.h"
+#include "PoseEstimator.h"
+#include "SlipDetector.h"
 #include "SpeedController/SpeedController.h"
 #include "AccelerationLimiter/AccelerationLimiter.h"
-#include "Pll.h"
+#include "VelocityEstimator/VelocityEstimator.h"
 #include "Regulator.h"
 #include <chprintf.h>
 #include <cfloat>
 #include "Encoders/Encoder.h"
 #include "util/asservMath.h"
+#include "util/LoopProfiler.h"
 
 AsservMain::AsservMain(uint16_t loopFrequency, uint16_t speedPositionLoopDivisor, float wheelRadius_mm,
         float encoderWheelsDistance_mm, uint32_t encodersTicksByTurn, CommandManager &commandManager,
@@ -19,19 +23,21 @@ AsservMain::AsservMain(uint16_t loopFrequency, uint16_t speedPositionLoopDivisor
         Regulator &angleRegulator, Regulator &distanceRegulator,
         AccelerationLimiter &angleRegulatorAccelerationLimiter, AccelerationLimiter &distanceRegulatorAccelerationLimiter,
         SpeedController &speedControllerRight, SpeedController &speedControllerLeft,
-        Pll &rightPll, Pll &leftPll) :
+        VelocityEstimator &rightVelocityEstimator, VelocityEstimator &leftVelocityEstimator) :
 
-        m_motorController(motorController), m_encoders(encoders), m_odometry(odometrie),
+        m_motorController(motorController), m_encoders(encoders), m_odometry(odometrie), m_poseEstimator(nullptr), m_slipDetector(nullptr),
             m_speedControllerRight(speedControllerRight), m_speedControllerLeft(speedControllerLeft),
             m_angleRegulator(angleRegulator), m_distanceRegulator(distanceRegulator),
             m_angleRegulatorAccelerationLimiter(angleRegulatorAccelerationLimiter), m_distanceRegulatorAccelerationLimiter(distanceRegulatorAccelerationLimiter),
             m_commandManager(commandManager),
-            m_pllRight(rightPll), m_pllLeft(leftPll),
-            m_distanceByEncoderTurn_mm(M_2PI * wheelRadius_mm), m_encodersTicksByTurn(encodersTicksByTurn), m_encodermmByTicks(m_distanceByEncoderTurn_mm / m_encodersTicksByTurn),
+            m_velocityEstimatorRight(rightVelocityEstimator), m_velocityEstimatorLeft(leftVelocityEstimator),
+            m_distanceByEncoderTurn_mm(M_2PI_F * wheelRadius_mm), m_encodersTicksByTurn(encodersTicksByTurn), m_encodermmByTicks(m_distanceByEncoderTurn_mm / m_encodersTicksByTurn),
             m_encoderWheelsDistance_mm(encoderWheelsDistance_mm), m_encoderWheelsDistance_ticks(encoderWheelsDistance_mm / m_encodermmByTicks),
-            m_loopFrequency(loopFrequency), m_loopPeriod(1.0 / float(loopFrequency)), m_speedPositionLoopDivisor( speedPositionLoopDivisor)
+            m_loopFrequency(loopFrequency), m_loopPeriod(1.0f / float(loopFrequency)), m_speedPositionLoopDivisor( speedPositionLoopDivisor),
+            m_loopTimer(loopFrequency, encoders)
 {
     m_asservCounter = 0;
+    m_positionLoopElapsed = 0;
     m_distRegulatorOutputSpeedConsign = 0;
     m_angleRegulatorOutputSpeedConsign = 0;
     m_distSpeedLimited = 0;
@@ -41,6 +47,12 @@ AsservMain::AsservMain(uint16_t loopFrequency, uint16_t speedPositionLoopDivisor
     m_asservMode = normal_mode;
     m_directSpeedMode_rightWheelSpeed = 0;
     m_directSpeedMode_leftWheelSpeed = 0;
+    m_deadlineMisses = 0;
+    m_worstDeadlineLateness_us = 0;
+    m_minDeadlineSlack_us = 0;
+    m_onTimeIterations = 0;
+    m_telemetryMode = telemetry_full;
+    m_telemetryCounter = 0;
 }
 
 float AsservMain::convertSpeedTommSec(float speed_ticksPerSec)
@@ -51,16 +63,30 @@ float AsservMain::convertSpeedTommSec(float speed_ticksPerSec)
     return speed_nbTurnPerSec * m_distanceByEncoderTurn_mm;
 }
 
-float AsservMain::estimateDeltaAngle(int16_t deltaCountRight, int16_t deltaCountLeft)
+float AsservMain::measureLoopPeriod()
 {
-    // en rad
-    return float(deltaCountRight - deltaCountLeft) / m_encoderWheelsDistance_ticks;
+    // Sans LoopTimer (outils host qui appellent loopIteration() directement), la période nominale
+    if (!m_loopTimer.isRunning())
+        return m_loopPeriod;
+
+    float deltaT = m_loopTimer.getSamplePeriod_s();
+    if (deltaT < MIN_LOOP_PERIOD_FACTOR * m_loopPeriod)
+        deltaT = MIN_LOOP_PERIOD_FACTOR * m_loopPeriod;
+    else if (deltaT > MAX_LOOP_PERIOD_FACTOR * m_loopPeriod)
+        deltaT = MAX_LOOP_PERIOD_FACTOR * m_loopPeriod;
+    return deltaT;
 }
 
-float AsservMain::estimateDeltaDistance(int16_t deltaCountRight, int16_t deltaCountLeft)
+float AsservMain::estimateDeltaAngle(float deltaCountRight, float deltaCountLeft)
+{
+    // en rad. Deltas en float : les gains des codeurs en font des ticks fractionnaires
+    return (deltaCountRight - deltaCountLeft) / m_encoderWheelsDistance_ticks;
+}
+
+float AsservMain::estimateDeltaDistance(float deltaCountRight, float deltaCountLeft)
 {
     // en mm
-    return float(deltaCountRight + deltaCountLeft) * (1.0 / 2.0) * m_encodermmByTicks;
+    return (deltaCountRight + deltaCountLeft) * 0.5f * m_encodermmByTicks;
 }
 
 void AsservMain::mainLoop()
@@ -74,117 +100,101 @@ void AsservMain::mainLoop()
 //    m_motorController.setMotorLeftSpeed(40.0);
 //    chThdSleepMilliseconds(1 );
 //    }
-    const time_conv_t loopPeriod_ms = (m_loopPeriod * 1000.0);
-    systime_t time = chVTGetSystemTime();
-    time += TIME_MS2I(loopPeriod_ms);
-    while (true) {
-        float encoderDeltaRight;
-        float encoderDeltaLeft;
-        m_encoders.getValues(&encoderDeltaRight, &encoderDeltaLeft);
-
-
-
-        // Mise à jour de la position en polaire
-        m_odometry.refresh(encoderDeltaRight * m_encodermmByTicks, encoderDeltaLeft * m_encodermmByTicks);
-
-        // Estimation & mise à jour des feedbacks
-        float deltaAngle_radian = estimateDeltaAngle(encoderDeltaRight, encoderDeltaLeft);
-        float deltaDistance_mm = estimateDeltaDistance(encoderDeltaRight, encoderDeltaLeft);
-
-        m_angleRegulator.updateFeedback(deltaAngle_radian);
-        m_distanceRegulator.updateFeedback(deltaDistance_mm);
+    resetDeadlineStats();
+    m_loopTimer.start();
+    while (true)
+        runPeriod();
+}
 
-        /* Calculer une nouvelle consigne de vitesse a chaque  ASSERV_POSITION_DIVISOR tour de boucle
-         * L'asserv en vitesse étant commandé par l'asserv en position, on laisse qq'e tours de boucle
-         * à l'asserv en vitesse pour atteindre sa consigne.
-         */
-        if (m_asservCounter == m_speedPositionLoopDivisor && m_enablePolar) {
-            m_commandManager.update(m_odometry.getX(), m_odometry.getY(), m_odometry.getTheta());
+void AsservMain::runPeriod()
+{
+    waitNextTick();
+    loopIteration();
+}
 
-            if (m_asservMode == normal_mode)
-            {
-                m_angleRegulatorOutputSpeedConsign = m_angleRegulator.updateOutput( m_commandManager.getAngleGoal() );
-                m_distRegulatorOutputSpeedConsign  = m_distanceRegulator.updateOutput( m_commandManager.getDistanceGoal() );
-            }
+void AsservMain::waitNextTick()
+{
+    // Avant le premier tick, il n'y a pas encore eu d'itération à mesurer
+    if (m_loopTimer.getTicks() == 0)
+    {
+        m_loopTimer.waitTick();
+        return;
+    }
 
-            m_asservCounter = 0;
+    int32_t slack_us = m_loopTimer.getTimeToNextTick_us();
+    if (slack_us >= 0)
+    {
+        if (uint32_t(slack_us) < m_minDeadlineSlack_us)
+            m_minDeadlineSlack_us = slack_us;
+
+        // Après une seconde sans dépassement, on réactive progressivement la télémétrie
+        m_onTimeIterations++;
+        if (m_onTimeIterations >= m_loopFrequency && m_telemetryMode != telemetry_full)
+        {
+            m_telemetryMode = (m_telemetryMode == telemetry_off) ? telemetry_throttled : telemetry_full;
+            m_onTimeIterations = 0;
         }
-
-        /*
-         * Regulation en vitesse
+    }
+    else
+    {
+        /* Échéance ratée : on compte et on déleste la télémétrie. Le tick manqué est traité tout de suite
+         *  (voir LoopTimer::waitTick) plutôt que d'enchaîner des itérations de rattrapage
          */
-        m_pllRight.update(encoderDeltaRight, m_loopPeriod);
-        float estimatedSpeedRight = convertSpeedTommSec(m_pllRight.getSpeed());
-
-        m_pllLeft.update(encoderDeltaLeft, m_loopPeriod);
-        float estimatedSpeedLeft = convertSpeedTommSec(m_pllLeft.getSpeed());
-
-        if (m_asservMode == normal_mode || m_asservMode == regulator_output_control) {
-            // On limite l'acceleration sur la sortie du regulateur de distance et d'angle
-            m_distSpeedLimited = m_distanceRegulatorAccelerationLimiter.limitAcceleration(m_loopPeriod, m_distRegulatorOutputSpeedConsign, (estimatedSpeedRight+estimatedSpeedLeft)*0.5 );
-            m_angleSpeedLimited = m_angleRegulatorAccelerationLimiter.limitAcceleration(m_loopPeriod, m_angleRegulatorOutputSpeedConsign, (estimatedSpeedRight-estimatedSpeedLeft)/m_encoderWheelsDistance_mm );
-
-            // Mise à jour des consignes en vitesse avec acceleration limitée
-            m_speedControllerRight.setSpeedGoal(m_distSpeedLimited + m_angleSpeedLimited);
-            m_speedControllerLeft.setSpeedGoal(m_distSpeedLimited - m_angleSpeedLimited);
-        } else {
-            /* Ici, on ajoute un mode de fonctionnement pour pouvoir controler indépendamment les roues avec l'IHM ou le shell.
-             * C'est batard, et cela ne doit pas être utilisé autrement que pour faire du réglage
-             *      on réutilise les filtres de pente pour ne pas avoir à en instancier d'autres
-             */
-            float rightWheelSpeed = m_distanceRegulatorAccelerationLimiter.limitAcceleration(m_loopPeriod, m_directSpeedMode_rightWheelSpeed, FLT_MAX);
-            float leftWheelSpeed = m_angleRegulatorAccelerationLimiter.limitAcceleration(m_loopPeriod, m_directSpeedMode_leftWheelSpeed, FLT_MAX);
-            m_speedControllerRight.setSpeedGoal(rightWheelSpeed);
-            m_speedControllerLeft.setSpeedGoal(leftWheelSpeed);
-        }
-
-        float outputSpeedRight = m_speedControllerRight.update(estimatedSpeedRight);
-        float outputSpeedLeft = m_speedControllerLeft.update(estimatedSpeedLeft);
-
-        if (m_enableMotors) {
-            m_motorController.setMotorRightSpeed(outputSpeedRight);
-            m_motorController.setMotorLeftSpeed(outputSpeedLeft);
-        }
-
-        USBStream::instance()->setSpeedEstimatedRight(estimatedSpeedRight);
-        USBStream::instance()->setSpeedEstimatedLeft(estimatedSpeedLeft);
-        USBStream::instance()->setSpeedGoalRight(m_speedControllerRight.getSpeedGoal());
-        USBStream::instance()->setSpeedGoalLeft(m_speedControllerLeft.getSpeedGoal());
-        USBStream::instance()->setSpeedOutputRight(outputSpeedRight);
-        USBStream::instance()->setSpeedOutputLeft(outputSpeedLeft);
-        USBStream::instance()->setSpeedIntegratedOutputRight(m_speedControllerRight.getIntegratedOutput());
-        USBStream::instance()->setSpeedIntegratedOutputLeft(m_speedControllerLeft.getIntegratedOutput());
-        USBStream::instance()->setSpeedKpRight(m_speedControllerRight.getCurrentKp());
-        USBStream::instance()->setSpeedKpLeft(m_speedControllerLeft.getCurrentKp());
-        USBStream::instance()->setSpeedKiRight(m_speedControllerRight.getCurrentKi());
-        USBStream::instance()->setSpeedKiLeft(m_speedControllerLeft.getCurrentKi());
-
-
-        USBStream::instance()->setAngleGoal(m_commandManager.getAngleGoal());
-        USBStream::instance()->setAngleAccumulator(m_angleRegulator.getAccumulator());
-        USBStream::instance()->setAngleOutput(m_angleRegulatorOutputSpeedConsign);
-        USBStream::instance()->setAngleOutputLimited(m_angleSpeedLimited);
-
-        USBStream::instance()->setDistGoal(m_commandManager.getDistanceGoal());
-        USBStream::instance()->setDistAccumulator(m_distanceRegulator.getAccumulator());
-        USBStream::instance()->setDistOutput(m_distRegulatorOutputSpeedConsign);
-        USBStream::instance()->setDistOutputLimited(m_distSpeedLimited);
+        uint32_t lateness_us = -slack_us;
+        m_deadlineMisses++;
+        if (lateness_us > m_worstDeadlineLateness_us)
+            m_worstDeadlineLateness_us = lateness_us;
+        m_minDeadlineSlack_us = 0;
+
+        m_onTimeIterations = 0;
+        if (m_telemetryMode != telemetry_off)
+            m_telemetryMode = (m_telemetryMode == telemetry_full) ? telemetry_throttled : telemetry_off;
+    }
 
-        USBStream::instance()->setOdoX(m_odometry.getX());
-        USBStream::instance()->setOdoY(m_odometry.getY());
-        USBStream::instance()->setOdoTheta(m_odometry.getTheta());
+    m_loopTimer.waitTick();
+}
 
-        USBStream::instance()->setRawEncoderDeltaLeft((float) encoderDeltaLeft);
-        USBStream::instance()->setRawEncoderDeltaRight((float) encoderDeltaRight);
+bool AsservMain::isTelemetryDue()
+{
+    switch (m_telemetryMode)
+    {
+    case telemetry_full:
+        return true;
+    case telemetry_throttled:
+        return (m_telemetryCounter++ % TELEMETRY_THROTTLE_DIVISOR) == 0;
+    default:
+        return false;
+    }
+}
 
-        USBStream::instance()->sendCurrentStream();
+void AsservMain::resetDeadlineStats()
+{
+    chSysLock();
+    m_deadlineMisses = 0;
+    m_worstDeadlineLateness_us = 0;
+    m_minDeadlineSlack_us = (1000000 + m_loopFrequency - 1) / m_loopFrequency;
+    chSysUnlock();
+    m_loopTimer.resetStats();
+}
 
-        m_asservCounter++;
+void AsservMain::setLoopFrequency(uint16_t loopFrequency)
+{
+    chSysLock();
+    m_loopFrequency = loopFrequency;
+    m_loopPeriod = 1.0f / float(loopFrequency);
+    chSysUnlock();
+    m_velocityEstimatorRight.setPeriod(1.0f / float(loopFrequency));
+    m_velocityEstimatorLeft.setPeriod(1.0f / float(loopFrequency));
+    m_loopTimer.setFrequency(loopFrequency);
+    resetDeadlineStats();
+}
 
-        chDbgAssert(chVTGetSystemTime() < time, "asserv thread missed deadline !");
-        chThdSleepUntil(time);
-        time += TIME_MS2I(loopPeriod_ms);
-    }
+void AsservMain::loopIteration()
+{
+    loopIterationWith(m_encoders, m_motorController,
+            m_speedControllerRight, m_speedControllerLeft,
+            m_angleRegulatorAccelerationLimiter, m_distanceRegulatorAccelerationLimiter,
+            m_velocityEstimatorRight, m_velocityEstimatorLeft);
 }
 
 void AsservMain::setRegulatorsSpeed(float distSpeed, float angleSpeed)
@@ -192,7 +202,7 @@ void AsservMain::setRegulatorsSpeed(float distSpeed, float angleSpeed)
     chSysLock();
     m_asservMode = regulator_output_control;
     m_distRegulatorOutputSpeedConsign = distSpeed;
-    m_angleRegulatorOutputSpeedConsign = (angleSpeed * m_encoderWheelsDistance_mm) * 0.5;
+    m_angleRegulatorOutputSpeedConsign = (angleSpeed * m_encoderWheelsDistance_mm) * 0.5f;
     chSysUnlock();
 }
 
@@ -291,6 +301,8 @@ void AsservMain::setPosition(float X_mm, float Y_mm, float theta_rad)
 {
     chSysLock();
     m_odometry.setPosition(X_mm, Y_mm, theta_rad);
+    if (m_poseEstimator != nullptr)
+        m_poseEstimator->setPosition(X_mm, Y_mm, theta_rad);
     /* CommandManager shall be reseted,
      *    because when the current position is overrided in the odometry,
      *    enqued consign in the commandManager are false
@@ -299,6 +311,43 @@ void AsservMain::setPosition(float X_mm, float Y_mm, float theta_rad)
     chSysUnlock();
 }
 
+void AsservMain::setPoseEstimator(PoseEstimator *poseEstimator)
+{
+    chSysLock();
+    m_poseEstimator = poseEstimator;
+    if (poseEstimator != nullptr)
+    {
+        poseEstimator->setPosition(m_odometry.getX(), m_odometry.getY(), m_odometry.getTheta());
+        poseEstimator->setEncoderWheelsDistance(m_encoderWheelsDistance_mm);
+    }
+    chSysUnlock();
+}
+
+void AsservMain::setSlipDetector(SlipDetector *slipDetector)
+{
+    chSysLock();
+    m_slipDetector = slipDetector;
+    if (slipDetector != nullptr)
+        slipDetector->reset();
+    // Sans détection, les limiteurs et les profils reprennent leurs accélérations nominales
+    m_angleRegulatorAccelerationLimiter.setAccelerationScale(1);
+    m_distanceRegulatorAccelerationLimiter.setAccelerationScale(1);
+    m_commandManager.setAccelerationScale(1);
+    chSysUnlock();
+}
+
+void AsservMain::setOdometryCalibration(float rightGain, float leftGain, float encoderWheelsDistance_mm)
+{
+    chSysLock();
+    m_encoders.setGains(rightGain, leftGain);
+    m_encoderWheelsDistance_mm = encoderWheelsDistance_mm;
+    m_encoderWheelsDistance_ticks = encoderWheelsDistance_mm / m_encodermmByTicks;
+    m_odometry.setWheelsDistance(encoderWheelsDistance_mm);
+    if (m_poseEstimator != nullptr)
+        m_poseEstimator->setEncoderWheelsDistance(encoderWheelsDistance_mm);
+    chSysUnlock();
+}
+
 void AsservMain::limitMotorControllerConsignToPercentage(float percentage)
 {
     /*
@@ -325,6 +374,10 @@ void AsservMain::reset()
      */
     chSysLock();
     m_odometry.reset();
+    if (m_poseEstimator != nullptr)
+        m_poseEstimator->setPosition(0, 0, 0);
+    if (m_slipDetector != nullptr)
+        m_slipDetector->reset();
     m_speedControllerRight.resetIntegral();
     m_speedControllerLeft.resetIntegral();
     m_angleRegulator.reset();
@@ -332,8 +385,8 @@ void AsservMain::reset()
     m_angleRegulatorAccelerationLimiter.reset();
     m_distanceRegulatorAccelerationLimiter.reset();
     m_commandManager.reset();
-    m_pllRight.reset();
-    m_pllLeft.reset();
+    m_velocityEstimatorRight.reset();
+    m_velocityEstimatorLeft.reset();
     chSysUnlock();
 }
 
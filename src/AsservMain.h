@@ -1,13 +1,18 @@
 #ifndef ASSERVMAIN_H_
 #define ASSERVMAIN_H_
 
+#include "ch.h"
 #include "motorController/MotorController.h"
+#include "util/LoopProfiler.h"
+#include "LoopTimer.h"
 #include <cstdint>
 
 class CommandManager;
 class Encoders;
 class Odometry;
-class Pll;
+class PoseEstimator;
+class SlipDetector;
+class VelocityEstimator;
 class AccelerationLimiter;
 class SpeedController;
 class Regulator;
@@ -21,7 +26,7 @@ public:
             Regulator &angleRegulator, Regulator &distanceRegulator,
             AccelerationLimiter &angleRegulatorAccelerationLimiter, AccelerationLimiter &distanceRegulatorAccelerationLimiter,
             SpeedController &speedControllerRight, SpeedController &speedControllerLeft,
-            Pll &rightPll, Pll &leftPll);
+            VelocityEstimator &rightVelocityEstimator, VelocityEstimator &leftVelocityEstimator);
 
     virtual ~AsservMain()
     {
@@ -30,6 +35,20 @@ public:
 
     void mainLoop();
 
+    /*
+     * Attente du tick suivant de la LoopTimer puis une itération : ce que fait mainLoop() à chaque période,
+     *  utilisable par les outils host en temps virtuel (la LoopTimer doit avoir été démarrée)
+     */
+    void runPeriod();
+
+    /*
+     * Une seule itération de la boucle d'asserv, sans attente.
+     *  mainLoop() l'appelle à chaque période, les outils host (voir host/) l'appellent directement.
+     *  Ici, toute la chaîne est appelée via ses interfaces ; ComposedAsservMain la redéfinit
+     *  avec les types concrets du robot (voir ComposedAsservMain.h)
+     */
+    virtual void loopIteration();
+
     /*
      *	On peut donner une vitesse par roue en utilisant la fonction: setWheelsSpeed
      *	Le mode de fonctionnement change et doit être remis à la normal en utilisant: resetToNormalMode
@@ -60,20 +79,123 @@ public:
 
     void setPosition(float X_mm, float Y_mm, float theta_rad);
     void limitMotorControllerConsignToPercentage(float percentage);
+
+    /*
+     * Estimateur de position mis à jour à chaque itération avec les deltas codeurs de l'odométrie (nullptr pour l'arrêter).
+     *  Il suit setPosition() et reset(), l'asserv reste sur l'Odometry.
+     */
+    void setPoseEstimator(PoseEstimator *poseEstimator);
+
+    /*
+     * Détection du patinage (nullptr pour l'arrêter) : ses facteurs d'accélération sont appliqués aux deux limiteurs.
+     *  Avec un PoseEstimator, les codeurs des roues motrices lui servent de seconde source
+     */
+    void setSlipDetector(SlipDetector *slipDetector);
+
+    /*
+     * Calibration de l'odométrie (voir OdometryCalibration) appliquée en marche : gains par roue des codeurs,
+     *  voie des roues codeuses de l'Odometry, du PoseEstimator s'il y en a un, et de la conversion ticks/angle de la boucle
+     */
+    void setOdometryCalibration(float rightGain, float leftGain, float encoderWheelsDistance_mm);
+    float getEncoderWheelsDistance() const
+    {
+        return m_encoderWheelsDistance_mm;
+    }
+
+    /*
+     * Suivi des échéances de la boucle d'asserv, qui sont les ticks de la LoopTimer : nombre de dépassements,
+     *  pire retard et plus petite marge restante avant l'échéance (en us)
+     */
+    inline uint32_t getDeadlineMisses() const
+    {
+        return m_deadlineMisses;
+    }
+    inline uint32_t getWorstDeadlineLateness_us() const
+    {
+        return m_worstDeadlineLateness_us;
+    }
+    inline uint32_t getMinDeadlineSlack_us() const
+    {
+        return m_minDeadlineSlack_us;
+    }
+    inline uint8_t getTelemetryMode() const
+    {
+        return m_telemetryMode;
+    }
+    void resetDeadlineStats();
+
+    // Horloge de la boucle, avec ses mesures de période et de gigue
+    inline LoopTimer& getLoopTimer()
+    {
+        return m_loopTimer;
+    }
+
+    /*
+     * Change la fréquence de la boucle en marche : la LoopTimer suit au tick suivant,
+     *  le deltaT mesuré de chaque itération reste borné autour de la nouvelle période
+     *  et les estimateurs de vitesse recalculent les gains qui dépendent de la période (VelocityEstimator::setPeriod)
+     */
+    void setLoopFrequency(uint16_t loopFrequency);
+    inline uint16_t getLoopFrequency() const
+    {
+        return m_loopFrequency;
+    }
+
+#ifdef ENABLE_LOOP_PROFILER
+    inline LoopProfiler& getProfiler()
+    {
+        return m_profiler;
+    }
+#endif
+
+protected:
+    /*
+     * Corps de loopIteration(), instancié une fois par composition de types (voir ComposedAsservMain.h).
+     *  Les codeurs, le contrôleur moteur, les asserv en vitesse, les limiteurs et les estimateurs de vitesse sont ceux
+     *  passés en paramètres (les mêmes objets que les membres de la classe, vus avec leur type concret)
+     */
+    template<typename EncodersT, typename MotorControllerT, typename SpeedControllerT,
+             typename AngleLimiterT, typename DistanceLimiterT, typename VelocityEstimatorT>
+    void loopIterationWith(EncodersT &encoders, MotorControllerT &motorController,
+            SpeedControllerT &speedControllerRight, SpeedControllerT &speedControllerLeft,
+            AngleLimiterT &angleRegulatorAccelerationLimiter, DistanceLimiterT &distanceRegulatorAccelerationLimiter,
+            VelocityEstimatorT &velocityEstimatorRight, VelocityEstimatorT &velocityEstimatorLeft);
+
 private:
 
     float convertSpeedTommSec(float speed_ticksPerSec);
-    float estimateDeltaAngle(int16_t deltaCountRight, int16_t deltaCountLeft);
-    float estimateDeltaDistance(int16_t deltaCountRight, int16_t deltaCountLeft);
+    float measureLoopPeriod();
+    float estimateDeltaAngle(float deltaCountRight, float deltaCountLeft);
+    float estimateDeltaDistance(float deltaCountRight, float deltaCountLeft);
+
+    void waitNextTick();
+    bool isTelemetryDue();
 
     typedef enum
     {
         normal_mode, direct_speed_mode, regulator_output_control
     } asserv_mode_t;
 
+    // Délestage de la télémétrie quand la boucle dépasse ses échéances
+    typedef enum
+    {
+        telemetry_full, telemetry_throttled, telemetry_off
+    } telemetry_mode_t;
+
+    // En mode telemetry_throttled, un échantillon USB toutes les TELEMETRY_THROTTLE_DIVISOR itérations
+    static constexpr uint8_t TELEMETRY_THROTTLE_DIVISOR = 4;
+
+    /* Bornes du deltaT mesuré, en périodes nominales : en dessous, timestamp aberrant,
+     *  au dessus, plus de trois ticks manqués à la suite
+     */
+    static constexpr float MIN_LOOP_PERIOD_FACTOR = 0.5f;
+    static constexpr float MAX_LOOP_PERIOD_FACTOR = 4.0f;
+
     MotorController &m_motorController;
     Encoders &m_encoders;
     Odometry &m_odometry;
+    PoseEstimator *m_poseEstimator;
+    SlipDetector *m_slipDetector;
     SpeedController &m_speedControllerRight;
     SpeedController &m_speedControllerLeft;
     Regulator &m_angleRegulator;
@@ -81,18 +203,20 @@ private:
     AccelerationLimiter &m_angleRegulatorAccelerationLimiter;
     AccelerationLimiter &m_distanceRegulatorAccelerationLimiter;
     CommandManager &m_commandManager;
-    Pll &m_pllRight;
-    Pll &m_pllLeft;
+    VelocityEstimator &m_velocityEstimatorRight;
+    VelocityEstimator &m_velocityEstimatorLeft;
     const float m_distanceByEncoderTurn_mm;
     const float m_encodersTicksByTurn;
     const float m_encodermmByTicks;
-    const float m_encoderWheelsDistance_mm;
-    const float m_encoderWheelsDistance_ticks;
+    float m_encoderWheelsDistance_mm;
+    float m_encoderWheelsDistance_ticks;
 
-    const uint16_t m_loopFrequency;
-    const float m_loopPeriod;
+    uint16_t m_loopFrequency;
+    float m_loopPeriod;
     const uint16_t m_speedPositionLoopDivisor;
     uint8_t m_asservCounter;
+    // Temps écoulé depuis la dernière mise à jour du CommandManager
+    float m_positionLoopElapsed;
 
     float m_distRegulatorOutputSpeedConsign;
     float m_distSpeedLimited;
@@ -105,6 +229,18 @@ private:
     asserv_mode_t m_asservMode;
     float m_directSpeedMode_rightWheelSpeed;
     float m_directSpeedMode_leftWheelSpeed;
+
+    LoopTimer m_loopTimer;
+    uint32_t m_deadlineMisses;
+    uint32_t m_worstDeadlineLateness_us;
+    uint32_t m_minDeadlineSlack_us;
+    uint16_t m_onTimeIterations;
+    telemetry_mode_t m_telemetryMode;
+    uint8_t m_telemetryCounter;
+
+#ifdef ENABLE_LOOP_PROFILER
+    LoopProfiler m_profiler;
+#endif
 };
 
 #endif /* ASSERVMAIN_H_ */
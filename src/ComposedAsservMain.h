@@ -0,0 +1,283 @@
+#ifndef COMPOSEDASSERVMAIN_H_
+#define COMPOSEDASSERVMAIN_H_
+
+#include "AsservMain.h"
+#include "commandManager/CommandManager.h"
+#include "USBStream.h"
+#include "Odometry.h"
+#include "PoseEstimator.h"
+#include "SlipDetector.h"
+#include "Pll.h"
+#include "VelocityEstimator/VelocityEstimator.h"
+#include "Regulator.h"
+#include "util/LoopProfiler.h"
+#include <cfloat>
+
+/*
+ * AsservMain dont la boucle connaît à la compilation le type concret de chaque maillon de la chaîne de contrôle :
+ *  codeurs, contrôleur moteur, asserv en vitesse, limiteurs d'accélération (angle et distance) et estimateurs de vitesse
+ *  (Pll par défaut).
+ *
+ *  Les appels de loopIteration() vers ces objets ne passent plus par leur vtable et peuvent être inlinés (LTO).
+ *  Pour cela les types passés doivent être des classes final (ou sans méthode virtuelle redéfinie plus bas),
+ *  sinon le compilateur garde l'appel virtuel.
+ *
+ *  Le reste de l'API (shell, raspIO...) est celui d'AsservMain, qui garde ses références vers les interfaces.
+ *  Chaque robot instancie sa composition dans src/Robots/<robot>/RobotAsservMain.cpp.
+ */
+template<typename EncodersT, typename MotorControllerT, typename SpeedControllerT,
+         typename AngleLimiterT, typename DistanceLimiterT, typename VelocityEstimatorT = Pll>
+class ComposedAsservMain final : public AsservMain
+{
+public:
+    explicit ComposedAsservMain(uint16_t loopFrequency, uint16_t speedPositionLoopDivisor, float wheelRadius_mm,
+            float encoderWheelsDistance_mm, uint32_t encodersTicksByTurn, CommandManager &commandManager,
+            MotorControllerT &motorController, EncodersT &encoders, Odometry &odometrie,
+            Regulator &angleRegulator, Regulator &distanceRegulator,
+            AngleLimiterT &angleRegulatorAccelerationLimiter, DistanceLimiterT &distanceRegulatorAccelerationLimiter,
+            SpeedControllerT &speedControllerRight, SpeedControllerT &speedControllerLeft,
+            VelocityEstimatorT &rightVelocityEstimator, VelocityEstimatorT &leftVelocityEstimator) :
+            AsservMain(loopFrequency, speedPositionLoopDivisor, wheelRadius_mm,
+                    encoderWheelsDistance_mm, encodersTicksByTurn, commandManager,
+                    motorController, encoders, odometrie,
+                    angleRegulator, distanceRegulator,
+                    angleRegulatorAccelerationLimiter, distanceRegulatorAccelerationLimiter,
+                    speedControllerRight, speedControllerLeft,
+                    rightVelocityEstimator, leftVelocityEstimator),
+            m_motorController(motorController), m_encoders(encoders),
+            m_speedControllerRight(speedControllerRight), m_speedControllerLeft(speedControllerLeft),
+            m_angleRegulatorAccelerationLimiter(angleRegulatorAccelerationLimiter),
+            m_distanceRegulatorAccelerationLimiter(distanceRegulatorAccelerationLimiter),
+            m_velocityEstimatorRight(rightVelocityEstimator), m_velocityEstimatorLeft(leftVelocityEstimator)
+    {
+    }
+
+    virtual ~ComposedAsservMain()
+    {
+    }
+
+    virtual void loopIteration() override;
+
+private:
+    MotorControllerT &m_motorController;
+    EncodersT &m_encoders;
+    SpeedControllerT &m_speedControllerRight;
+    SpeedControllerT &m_speedControllerLeft;
+    AngleLimiterT &m_angleRegulatorAccelerationLimiter;
+    DistanceLimiterT &m_distanceRegulatorAccelerationLimiter;
+    VelocityEstimatorT &m_velocityEstimatorRight;
+    VelocityEstimatorT &m_velocityEstimatorLeft;
+};
+
+template<typename EncodersT, typename MotorControllerT, typename SpeedControllerT,
+         typename AngleLimiterT, typename DistanceLimiterT, typename VelocityEstimatorT>
+void ComposedAsservMain<EncodersT, MotorControllerT, SpeedControllerT, AngleLimiterT, DistanceLimiterT, VelocityEstimatorT>::loopIteration()
+{
+    loopIterationWith(m_encoders, m_motorController,
+            m_speedControllerRight, m_speedControllerLeft,
+            m_angleRegulatorAccelerationLimiter, m_distanceRegulatorAccelerationLimiter,
+            m_velocityEstimatorRight, m_velocityEstimatorLeft);
+}
+
+/*
+ * Corps de la boucle d'asserv, commun à AsservMain (instancié avec les interfaces dans AsservMain.cpp)
+ *  et à chaque ComposedAsservMain
+ */
+template<typename EncodersT, typename MotorControllerT, typename SpeedControllerT,
+         typename AngleLimiterT, typename DistanceLimiterT, typename VelocityEstimatorT>
+void AsservMain::loopIterationWith(EncodersT &encoders, MotorControllerT &motorController,
+        SpeedControllerT &speedControllerRight, SpeedControllerT &speedControllerLeft,
+        AngleLimiterT &angleRegulatorAccelerationLimiter, DistanceLimiterT &distanceRegulatorAccelerationLimiter,
+        VelocityEstimatorT &velocityEstimatorRight, VelocityEstimatorT &velocityEstimatorLeft)
+{
+    LOOP_PROFILER_START(m_profiler);
+
+    float encoderDeltaRight;
+    float encoderDeltaLeft;
+    encoders.getValues(&encoderDeltaRight, &encoderDeltaLeft);
+    // Temps réellement couvert par ces deltas codeurs, qui sert à toute la chaîne plutôt que la période nominale
+    const float deltaT = measureLoopPeriod();
+    LOOP_PROFILER_LAP(m_profiler, STAGE_ENCODERS);
+
+    // Mise à jour de la position en polaire
+    m_odometry.refresh(encoderDeltaRight * m_encodermmByTicks, encoderDeltaLeft * m_encodermmByTicks);
+    if (m_poseEstimator != nullptr)
+        m_poseEstimator->update(encoderDeltaRight * m_encodermmByTicks, encoderDeltaLeft * m_encodermmByTicks, deltaT);
+
+    // Estimation & mise à jour des feedbacks
+    float deltaAngle_radian = estimateDeltaAngle(encoderDeltaRight, encoderDeltaLeft);
+    float deltaDistance_mm = estimateDeltaDistance(encoderDeltaRight, encoderDeltaLeft);
+
+    m_angleRegulator.updateFeedback(deltaAngle_radian);
+    m_distanceRegulator.updateFeedback(deltaDistance_mm);
+    LOOP_PROFILER_LAP(m_profiler, STAGE_ODOMETRY);
+
+    /* Calculer une nouvelle consigne de vitesse a chaque  ASSERV_POSITION_DIVISOR tour de boucle
+     * L'asserv en vitesse étant commandé par l'asserv en position, on laisse qq'e tours de boucle
+     * à l'asserv en vitesse pour atteindre sa consigne.
+     */
+    m_positionLoopElapsed = m_enablePolar ? m_positionLoopElapsed + deltaT : 0;
+    if (m_asservCounter == m_speedPositionLoopDivisor && m_enablePolar) {
+        m_commandManager.update(m_odometry.getX(), m_odometry.getY(), m_odometry.getTheta(), m_positionLoopElapsed);
+        m_positionLoopElapsed = 0;
+
+        if (m_asservMode == normal_mode)
+        {
+            // Vitesse de consigne en anticipation (nulle hors profil), la sortie angle est une vitesse de roue
+            m_angleRegulatorOutputSpeedConsign = m_angleRegulator.updateOutput( m_commandManager.getAngleGoal(),
+                    m_commandManager.getAngleSpeedGoal() * m_encoderWheelsDistance_mm * 0.5f );
+            m_distRegulatorOutputSpeedConsign  = m_distanceRegulator.updateOutput( m_commandManager.getDistanceGoal(),
+                    m_commandManager.getDistanceSpeedGoal() );
+        }
+
+        m_asservCounter = 0;
+    }
+    LOOP_PROFILER_LAP(m_profiler, STAGE_COMMAND_MANAGER);
+
+    /*
+     * Regulation en vitesse
+     */
+    velocityEstimatorRight.update(encoderDeltaRight, deltaT);
+    float estimatedSpeedRight = convertSpeedTommSec(velocityEstimatorRight.getSpeed());
+
+    velocityEstimatorLeft.update(encoderDeltaLeft, deltaT);
+    float estimatedSpeedLeft = convertSpeedTommSec(velocityEstimatorLeft.getSpeed());
+
+    /* Patinage : consignes de la période écoulée face aux vitesses mesurées (et aux codeurs des roues motrices
+     *  s'il y en a), le facteur d'accélération qui en sort s'applique aux limiteurs ci-dessous et aux profils des commandes
+     */
+    if (m_slipDetector != nullptr)
+    {
+        if (m_enableMotors)
+        {
+            float slipSpeedRight = 0;
+            float slipSpeedLeft = 0;
+            if (m_poseEstimator != nullptr)
+            {
+                slipSpeedRight = m_poseEstimator->getRightMotorSlipSpeed();
+                slipSpeedLeft = m_poseEstimator->getLeftMotorSlipSpeed();
+            }
+            m_slipDetector->update(deltaT, speedControllerRight.getSpeedGoal(), speedControllerLeft.getSpeedGoal(),
+                    estimatedSpeedRight, estimatedSpeedLeft, slipSpeedRight, slipSpeedLeft);
+        }
+        distanceRegulatorAccelerationLimiter.setAccelerationScale(m_slipDetector->getAccelerationScale());
+        angleRegulatorAccelerationLimiter.setAccelerationScale(m_slipDetector->getAccelerationScale());
+        m_commandManager.setAccelerationScale(m_slipDetector->getAccelerationScale());
+    }
+    LOOP_PROFILER_LAP(m_profiler, STAGE_PLL);
+
+    if (m_asservMode == normal_mode && m_commandManager.isFollowingProfile()) {
+        /* Le profil de la commande borne déjà accélération, décélération et jerk, avec une marge sous l'accélération
+         *  max des limiteurs : ils ne bornent plus que la correction de l'asserv en position, dans cette marge.
+         *  Le freinage de la pause, sans marge, les contourne.
+         *  La vitesse du profil est interpolée par son accélération entre deux mises à jour de l'asserv en position
+         */
+        const float distSpeed = m_distRegulatorOutputSpeedConsign + m_commandManager.getDistanceAccelerationGoal() * m_positionLoopElapsed;
+        const float angleSpeed = m_angleRegulatorOutputSpeedConsign
+                + m_commandManager.getAngleAccelerationGoal() * m_encoderWheelsDistance_mm * 0.5f * m_positionLoopElapsed;
+        if (m_commandManager.isBraking())
+        {
+            m_distSpeedLimited = distanceRegulatorAccelerationLimiter.bypass(distSpeed);
+            m_angleSpeedLimited = angleRegulatorAccelerationLimiter.bypass(angleSpeed);
+        }
+        else
+        {
+            m_distSpeedLimited = distanceRegulatorAccelerationLimiter.limitProfileSpeed(deltaT, distSpeed);
+            m_angleSpeedLimited = angleRegulatorAccelerationLimiter.limitProfileSpeed(deltaT, angleSpeed);
+        }
+
+        speedControllerRight.setSpeedGoal(m_distSpeedLimited + m_angleSpeedLimited);
+        speedControllerLeft.setSpeedGoal(m_distSpeedLimited - m_angleSpeedLimited);
+    } else if (m_asservMode == normal_mode || m_asservMode == regulator_output_control) {
+        // On limite l'acceleration sur la sortie du regulateur de distance et d'angle
+        m_distSpeedLimited = distanceRegulatorAccelerationLimiter.limitAcceleration(deltaT, m_distRegulatorOutputSpeedConsign, (estimatedSpeedRight+estimatedSpeedLeft)*0.5f );
+        m_angleSpeedLimited = angleRegulatorAccelerationLimiter.limitAcceleration(deltaT, m_angleRegulatorOutputSpeedConsign, (estimatedSpeedRight-estimatedSpeedLeft)/m_encoderWheelsDistance_mm );
+
+        // Mise à jour des consignes en vitesse avec acceleration limitée
+        speedControllerRight.setSpeedGoal(m_distSpeedLimited + m_angleSpeedLimited);
+        speedControllerLeft.setSpeedGoal(m_distSpeedLimited - m_angleSpeedLimited);
+    } else {
+        /* Ici, on ajoute un mode de fonctionnement pour pouvoir controler indépendamment les roues avec l'IHM ou le shell.
+         * C'est batard, et cela ne doit pas être utilisé autrement que pour faire du réglage
+         *      on réutilise les filtres de pente pour ne pas avoir à en instancier d'autres
+         */
+        float rightWheelSpeed = distanceRegulatorAccelerationLimiter.limitAcceleration(deltaT, m_directSpeedMode_rightWheelSpeed, FLT_MAX);
+        float leftWheelSpeed = angleRegulatorAccelerationLimiter.limitAcceleration(deltaT, m_directSpeedMode_leftWheelSpeed, FLT_MAX);
+        speedControllerRight.setSpeedGoal(rightWheelSpeed);
+        speedControllerLeft.setSpeedGoal(leftWheelSpeed);
+    }
+    LOOP_PROFILER_LAP(m_profiler, STAGE_LIMITERS);
+
+    float outputSpeedRight = speedControllerRight.update(estimatedSpeedRight, deltaT);
+    float outputSpeedLeft = speedControllerLeft.update(estimatedSpeedLeft, deltaT);
+    LOOP_PROFILER_LAP(m_profiler, STAGE_SPEED_CONTROLLERS);
+
+    if (m_enableMotors) {
+        motorController.setMotorsSpeed(outputSpeedRight, outputSpeedLeft);
+    }
+    // Les angles de la prochaine itération sont acquis pendant que la boucle attend sa période
+    encoders.startAcquisition();
+    LOOP_PROFILER_LAP(m_profiler, STAGE_MOTOR_OUTPUT);
+
+    /* La télémétrie est optionnelle : elle est ralentie puis coupée
+     *  quand la boucle dépasse ses échéances (voir waitNextTick)
+     */
+    if (isTelemetryDue())
+    {
+        USBStream::instance()->setSpeedEstimatedRight(estimatedSpeedRight);
+        USBStream::instance()->setSpeedEstimatedLeft(estimatedSpeedLeft);
+        USBStream::instance()->setSpeedGoalRight(speedControllerRight.getSpeedGoal());
+        USBStream::instance()->setSpeedGoalLeft(speedControllerLeft.getSpeedGoal());
+        USBStream::instance()->setSpeedOutputRight(outputSpeedRight);
+        USBStream::instance()->setSpeedOutputLeft(outputSpeedLeft);
+        USBStream::instance()->setSpeedIntegratedOutputRight(speedControllerRight.getIntegratedOutput());
+        USBStream::instance()->setSpeedIntegratedOutputLeft(speedControllerLeft.getIntegratedOutput());
+        USBStream::instance()->setSpeedKpRight(speedControllerRight.getCurrentKp());
+        USBStream::instance()->setSpeedKpLeft(speedControllerLeft.getCurrentKp());
+        USBStream::instance()->setSpeedKiRight(speedControllerRight.getCurrentKi());
+        USBStream::instance()->setSpeedKiLeft(speedControllerLeft.getCurrentKi());
+
+
+        USBStream::instance()->setAngleGoal(m_commandManager.getAngleGoal());
+        USBStream::instance()->setAngleAccumulator(m_angleRegulator.getAccumulator());
+        USBStream::instance()->setAngleOutput(m_angleRegulatorOutputSpeedConsign);
+        USBStream::instance()->setAngleOutputLimited(m_angleSpeedLimited);
+
+        USBStream::instance()->setDistGoal(m_commandManager.getDistanceGoal());
+        USBStream::instance()->setDistAccumulator(m_distanceRegulator.getAccumulator());
+        USBStream::instance()->setDistOutput(m_distRegulatorOutputSpeedConsign);
+        USBStream::instance()->setDistOutputLimited(m_distSpeedLimited);
+
+        USBStream::instance()->setOdoX(m_odometry.getX());
+        USBStream::instance()->setOdoY(m_odometry.getY());
+        USBStream::instance()->setOdoTheta(m_odometry.getTheta());
+
+        USBStream::instance()->setRawEncoderDeltaLeft((float) encoderDeltaLeft);
+        USBStream::instance()->setRawEncoderDeltaRight((float) encoderDeltaRight);
+
+#ifdef ENABLE_LOOP_PROFILER
+        // Durées de l'itération précédente, l'itération courante n'étant pas terminée
+        USBStream::instance()->setLoopDuration(LoopProfiler::ticksToMicroseconds(m_profiler.getStats(LoopProfiler::STAGE_TOTAL).last));
+        USBStream::instance()->setLoopIODuration(LoopProfiler::ticksToMicroseconds(
+                m_profiler.getStats(LoopProfiler::STAGE_ENCODERS).last + m_profiler.getStats(LoopProfiler::STAGE_MOTOR_OUTPUT).last));
+#endif
+
+        if (m_slipDetector != nullptr)
+        {
+            USBStream::instance()->setSlipEvents(m_slipDetector->getSlipEvents());
+            USBStream::instance()->setAccelerationScale(m_slipDetector->getAccelerationScale());
+        }
+
+        USBStream::instance()->setDeadlineMisses(m_deadlineMisses);
+        USBStream::instance()->setWorstDeadlineLateness(m_worstDeadlineLateness_us);
+        LOOP_PROFILER_LAP(m_profiler, STAGE_USB_STREAM_SETTERS);
+
+        USBStream::instance()->sendCurrentStream();
+    }
+    LOOP_PROFILER_LAP(m_profiler, STAGE_USB_STREAM_SEND);
+
+    m_asservCounter++;
+    LOOP_PROFILER_END(m_profiler);
+}
+
+#endif /* COMPOSEDASSERVMAIN_H_ */
@@ -6,11 +6,55 @@
 class Encoders
 {
 public:
+    Encoders() :
+            m_rightGain(1), m_leftGain(1)
+    {
+    }
     virtual ~Encoders()
     {
     }
 
     virtual void getValues(float *deltaEncoderRight, float *deltaEncoderLeft) = 0;
+
+    /*
+     * Appelé par la boucle d'asserv juste après l'écriture des consignes moteur.
+     *  Les codeurs lus sur un bus lent peuvent y lancer en tâche de fond
+     *  l'acquisition qui sera consommée par le getValues() de l'itération suivante.
+     */
+    virtual void startAcquisition()
+    {
+    }
+
+    /*
+     * Appelé sous verrou par l'interruption du tick de la boucle (voir LoopTimer) : les codeurs lus par des compteurs
+     *  matériels y figent leurs valeurs, que getValues() consommera. Les deltas correspondent ainsi exactement à une
+     *  période du timer, quel que soit le retard de réveil du thread. Les codeurs lus sur un bus n'y font rien.
+     */
+    virtual void latchI()
+    {
+    }
+
+    /*
+     * Gains par roue appliqués par getValues() aux deltas en ticks (1 par défaut) : écarts de rayon entre les deux
+     *  roues codeuses, mesurés par la calibration de l'odométrie (voir OdometryCalibration)
+     */
+    void setGains(float rightGain, float leftGain)
+    {
+        m_rightGain = rightGain;
+        m_leftGain = leftGain;
+    }
+    float getRightGain() const
+    {
+        return m_rightGain;
+    }
+    float getLeftGain() const
+    {
+        return m_leftGain;
+    }
+
+protected:
+    float m_rightGain;
+    float m_leftGain;
 };
 
 #endif /* SRC_ENCODER_H_ */
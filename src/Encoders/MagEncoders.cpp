@@ -6,9 +6,34 @@
 #include <chprintf.h>
 #include "hal_streams.h"
 
+// Le thread d'acquisition passe après le thread d'asserv et l'écriture asynchrone des moteurs
+constexpr tprio_t acquisitionPriority = HIGHPRIO - 2;
+// Attente maximale dans getValues() d'une acquisition en retard avant de rendre un delta nul
+constexpr sysinterval_t acquisitionWaitTimeout = TIME_US2I(500);
+
+static THD_WORKING_AREA(waMagEncodersAcquisition, 512);
+static bool acquisitionThreadStarted = false;
+
+// Nombre de pas par tour d'un AS5048B (14 bits)
+constexpr int32_t AS5048B_STEPS = 16384;
+
 extern BaseSequentialStream *outputStream;
 
-MagEncoders::MagEncoders(bool is1EncoderRight, bool invertEncoderRight, bool invertEncoderLeft) :
+/*
+ * Différence de deux angles 14 bits, ramenée dans [-8192;8191] : le passage par zéro d'un tour est géré
+ *  tant que la roue fait moins d'un demi-tour entre deux lectures
+ */
+static inline int32_t angleDelta(uint16_t raw, uint16_t previous)
+{
+    int32_t delta = (int32_t) raw - (int32_t) previous;
+    if (delta >= AS5048B_STEPS / 2)
+        delta -= AS5048B_STEPS;
+    else if (delta < -AS5048B_STEPS / 2)
+        delta += AS5048B_STEPS;
+    return delta;
+}
+
+MagEncoders::MagEncoders(bool is1EncoderRight, bool invertEncoderRight, bool invertEncoderLeft, bool pipelinedAcquisition) :
         Encoders(), m_mysensor1(AS5048B_ADDR(1, 1)), m_mysensor2(AS5048B_ADDR(0, 1))
 {
 
@@ -24,6 +49,13 @@ MagEncoders::MagEncoders(bool is1EncoderRight, bool invertEncoderRight, bool inv
     m_encoder1Previous = 0;
     m_encoder2Previous = 0;
     m_is1EncoderRight = is1EncoderRight;
+    m_pipelinedAcquisition = pipelinedAcquisition;
+
+    m_sampleSlot = 0;
+    m_requestTime = 0;
+    m_sensor1Status = {0, 0, 0};
+    m_sensor2Status = {0, 0, 0};
+    resetAcquisitionStats();
 }
 
 MagEncoders::~MagEncoders()
@@ -63,6 +95,7 @@ void MagEncoders::init()
     chDbgAssert((diag == 1), "init() m_mysensor1 MagEncoders - getAllData (diag != 1) NOK\r\n");
     chDbgAssert((agc >= 30 && agc <= 79),
             "init() m_mysensor1 MagEncoders - getAllData (agc >= 30 && agc <= 79) NOK\r\n");
+    m_sensor1Status = {agc, diag, mag};
 
 
     int connect2 = m_mysensor2.begin();
@@ -73,21 +106,40 @@ void MagEncoders::init()
     chDbgAssert((diag == 1), "init() m_mysensor2 MagEncoders - getAllData (diag == 1) NOK\r\n");
     chDbgAssert((agc >= 30 && agc <= 75),
             "init() m_mysensor2 MagEncoders - getAllData (agc >= 30 && agc <= 75) NOK\r\n");
+    m_sensor2Status = {agc, diag, mag};
 
 //    float encoder1 = (m_mysensor1.angleR(U_RAW, true) );
 //    float encoder2 = (m_mysensor2.angleR(U_RAW, true) );
     //chprintf(outputStream,"MagEncoders::init() %f  %f;\r\n", encoder1,encoder2);
 
+    if (m_pipelinedAcquisition)
+    {
+        // Le working area du thread est statique : un seul MagEncoders pipeliné possible
+        chDbgAssert(!acquisitionThreadStarted, "MagEncoders: only one acquisition thread can be started");
+        acquisitionThreadStarted = true;
+
+        chBSemObjectInit(&m_acquisitionRequest, true);
+        chBSemObjectInit(&m_acquisitionDone, true);
+        chThdCreateStatic(waMagEncodersAcquisition, sizeof(waMagEncodersAcquisition), acquisitionPriority,
+                MagEncoders::acquisitionThread, this);
+    }
 
     chprintf(outputStream,"MagEncoders::init() done;\r\n");
 }
 
 void MagEncoders::start()
 {
-    m_encoder1Previous = ((m_mysensor1.angleR(U_RAW, true) - 8192.0) * 4.0);
-    m_encoder2Previous = ((m_mysensor2.angleR(U_RAW, true) - 8192.0) * 4.0);
+    m_encoder1Previous = m_mysensor1.angleRegR();
+    m_encoder2Previous = m_mysensor2.angleRegR();
     m_encoderRSum = 0;
     m_encoderLSum = 0;
+
+    if (m_pipelinedAcquisition)
+    {
+        // Les angles de la première itération sont acquis dès maintenant
+        m_sampleSlot.store(0, std::memory_order_relaxed);
+        startAcquisition();
+    }
 }
 
 void MagEncoders::stop()
@@ -97,78 +149,45 @@ void MagEncoders::stop()
 
 void MagEncoders::getValues(float *deltaEncoderRightFiltered, float *deltaEncoderLeftFiltered)
 {
-/*
-     // (outputStream,"MagEncoders::getValues() done; %d %d\r\n", m_encoder1Previous, m_encoder2Previous);
-     //utilisation du depassement d'un int16
-     //[0;16383] -8192 * 4 = [-32768;32764]
-     float encoder1 = (m_mysensor1.angleR(U_RAW, true) - 8192.0) * 4.0;
-     float encoder2 = (m_mysensor2.angleR(U_RAW, true) - 8192.0) * 4.0;
-
-
-     *deltaEncoderRight = 1;
-     *deltaEncoderLeft = 1;
-     return;
-
-     if (m_is1EncoderRight) {
-     *deltaEncoderRight = encoder1 - m_encoder1Previous;
-     *deltaEncoderLeft = encoder2 - m_encoder2Previous;
-     } else {
-     *deltaEncoderRight = encoder2 - m_encoder2Previous;
-     *deltaEncoderLeft = encoder1 - m_encoder1Previous;
-     }
-
-     if (m_invertEncoderR)
-     *deltaEncoderRight = -*deltaEncoderRight;
-     if (m_invertEncoderL)
-     *deltaEncoderLeft = -*deltaEncoderLeft;
-
-     *deltaEncoderRight = (int16_t)(*deltaEncoderRight / 4.0);
-     *deltaEncoderLeft = (int16_t)(*deltaEncoderLeft / 4.0);
-
-     m_encoderRSum += (int32_t)(*deltaEncoderRight);
-     m_encoderLSum += (int32_t)(*deltaEncoderLeft);
-
-     m_encoder1Previous = encoder1;
-     m_encoder2Previous = encoder2;
-*/
-
-    float deltaEncoderRight = 0.0;
-    float deltaEncoderLeft = 0.0;
-    //utilisation du depassement d'un int16
-    //[0;16383] -8192 * 4 = [-32768;32764]
-
-    //query minimale
-//    float encoder1 = (m_mysensor1.angleR(U_RAW, true) - 8192.0) * 4.0;
-//    float encoder2 = (m_mysensor2.angleR(U_RAW, true) - 8192.0) * 4.0;
-
     uint16_t raw1 =0;
     uint16_t raw2 = 0 ;
-    uint8_t agc1 = 0;
-    uint8_t agc2 = 0;
-    uint8_t diag1 = 0;
-    uint8_t diag2 = 0;
-    uint16_t mag1 = 0;
-    uint16_t mag2 = 0;
-    getValuesStatus(&raw1, &raw2, &agc1, &agc2, &diag1, &diag2, &mag1, &mag2);
-    float encoder1 = ((float)(raw1) - 8192.0) * 4.0;
-    float encoder2 = ((float)(raw2) - 8192.0) * 4.0;
-
-//    uint8_t agc = 0;
-//    uint8_t diag = 0;
-//    uint16_t mag = 0;
-//    uint16_t raw = 0;
-//    m_mysensor1.getAllData(&agc, &diag, &mag, &raw);
-//    float encoder11 = ((float)(raw) - 8192.0) * 4.0;
-//    m_mysensor2.getAllData(&agc, &diag, &mag, &raw);
-
-    //chprintf(outputStream, "---- %f = %f    \r\n", encoder1, encoder11);
+    if (m_pipelinedAcquisition)
+    {
+        if (!takeAcquiredAngles(&raw1, &raw2))
+        {
+            // Pas d'angles frais : le déplacement sera compté en entier à l'itération suivante
+            chSysLock();
+            m_acquisitionStats.stale++;
+            chSysUnlock();
+            *deltaEncoderRightFiltered = 0.0;
+            *deltaEncoderLeftFiltered = 0.0;
+            return;
+        }
+    }
+    else
+    {
+        uint8_t agc1 = 0;
+        uint8_t agc2 = 0;
+        uint8_t diag1 = 0;
+        uint8_t diag2 = 0;
+        uint16_t mag1 = 0;
+        uint16_t mag2 = 0;
+        getValuesStatus(&raw1, &raw2, &agc1, &agc2, &diag1, &diag2, &mag1, &mag2);
+        m_sensor1Status = {agc1, diag1, mag1};
+        m_sensor2Status = {agc2, diag2, mag2};
+    }
+
+    int32_t delta1 = angleDelta(raw1, m_encoder1Previous);
+    int32_t delta2 = angleDelta(raw2, m_encoder2Previous);
 
+    int32_t deltaEncoderRight;
+    int32_t deltaEncoderLeft;
     if (m_is1EncoderRight) {
-        deltaEncoderRight = encoder1 - m_encoder1Previous;
-        deltaEncoderLeft = encoder2 - m_encoder2Previous;
+        deltaEncoderRight = delta1;
+        deltaEncoderLeft = delta2;
     } else {
-        deltaEncoderRight = encoder2 - m_encoder2Previous;
-        deltaEncoderLeft = encoder1 - m_encoder1Previous;
+        deltaEncoderRight = delta2;
+        deltaEncoderLeft = delta1;
     }
 
     if (m_invertEncoderR)
@@ -176,17 +195,15 @@ void MagEncoders::getValues(float *deltaEncoderRightFiltered, float *deltaEncode
     if (m_invertEncoderL)
         deltaEncoderLeft = -deltaEncoderLeft;
 
-    deltaEncoderRight = ((int16_t) (deltaEncoderRight)) / 4.0;
-    deltaEncoderLeft = ((int16_t) (deltaEncoderLeft)) / 4.0;
-
-    m_encoderRSum += (int32_t) (deltaEncoderRight);
-    m_encoderLSum += (int32_t) (deltaEncoderLeft);
+    m_encoderRSum += deltaEncoderRight;
+    m_encoderLSum += deltaEncoderLeft;
 
-    m_encoder1Previous = encoder1;
-    m_encoder2Previous = encoder2;
+    m_encoder1Previous = raw1;
+    m_encoder2Previous = raw2;
 
-    *deltaEncoderRightFiltered = (deltaEncoderRight);
-    *deltaEncoderLeftFiltered = (deltaEncoderLeft);
+    // Pleine résolution du capteur : un tick = 1/16384 de tour
+    *deltaEncoderRightFiltered = float(deltaEncoderRight) * m_rightGain;
+    *deltaEncoderLeftFiltered = float(deltaEncoderLeft) * m_leftGain;
 }
 
 void MagEncoders::getEncodersTotalCount(int32_t *encoderRight, int32_t *encoderLeft)
@@ -201,3 +218,137 @@ void MagEncoders::getValuesStatus(uint16_t *raw1, uint16_t *raw2, uint8_t *agc1,
     m_mysensor1.getAllData(agc1, diag1, mag1, raw1);
     m_mysensor2.getAllData(agc2, diag2, mag2, raw2);
 }
+
+void MagEncoders::startAcquisition()
+{
+    if (!m_pipelinedAcquisition)
+        return;
+
+    m_requestTime.store(chSysGetRealtimeCounterX(), std::memory_order_relaxed);
+    chSysLock();
+    m_acquisitionStats.requested++;
+    chSysUnlock();
+
+    // Réveille le thread d'acquisition, sans attendre : il est moins prioritaire que l'appelant
+    chBSemSignal(&m_acquisitionRequest);
+}
+
+bool MagEncoders::takeAcquiredAngles(uint16_t *raw1, uint16_t *raw2)
+{
+    uint32_t sample = m_sampleSlot.fetch_and(~SAMPLE_FRESH, std::memory_order_acq_rel);
+
+    if (!(sample & SAMPLE_FRESH))
+    {
+        // L'acquisition lancée à la fin de l'itération précédente est en retard : on lui laisse un peu de temps.
+        // m_acquisitionDone peut être resté signalé par une acquisition déjà consommée, d'où la deuxième attente.
+        rtcnt_t waitStart = chSysGetRealtimeCounterX();
+        for (int i = 0; i < 2 && !(sample & SAMPLE_FRESH); i++)
+        {
+            if (chBSemWaitTimeout(&m_acquisitionDone, acquisitionWaitTimeout) != MSG_OK)
+                break;
+            sample = m_sampleSlot.fetch_and(~SAMPLE_FRESH, std::memory_order_acq_rel);
+        }
+
+        uint32_t wait_us = RTC2US(STM32_HCLK, chSysGetRealtimeCounterX() - waitStart);
+        chSysLock();
+        if (wait_us > m_acquisitionStats.maxWait_us)
+            m_acquisitionStats.maxWait_us = wait_us;
+        chSysUnlock();
+
+        if (!(sample & SAMPLE_FRESH))
+            return false;
+    }
+
+    // Lecture ratée : on garde les derniers angles, la prochaine acquisition rattrapera le déplacement
+    if (sample & SAMPLE_ERROR)
+        return false;
+
+    *raw1 = sample & 0x3FFF;
+    *raw2 = (sample >> 14) & 0x3FFF;
+    return true;
+}
+
+void MagEncoders::acquisitionThread(void *arg)
+{
+    chRegSetThreadName("MagEncodersAcquisition");
+    static_cast<MagEncoders*>(arg)->acquisitionLoop();
+}
+
+void MagEncoders::acquisitionLoop()
+{
+    uint32_t acquisitionCount = 0;
+
+    while (true)
+    {
+        chBSemWait(&m_acquisitionRequest);
+
+        // Chemin rapide : seulement les deux registres d'angle de chaque capteur, une transaction chacun
+        uint16_t raw1 = 0;
+        uint16_t raw2 = 0;
+        if (m_mysensor1.readAngleRaw(&raw1) != 0 || m_mysensor2.readAngleRaw(&raw2) != 0)
+        {
+            // Pas de nouvel essai : getValues() est prévenu tout de suite, rend un delta nul
+            //  et la prochaine acquisition rattrapera
+            m_sampleSlot.store(SAMPLE_FRESH | SAMPLE_ERROR, std::memory_order_release);
+            chBSemSignal(&m_acquisitionDone);
+            chSysLock();
+            m_acquisitionStats.errors++;
+            chSysUnlock();
+            continue;
+        }
+
+        m_sampleSlot.store(SAMPLE_FRESH | ((uint32_t) raw2 << 14) | raw1, std::memory_order_release);
+        chBSemSignal(&m_acquisitionDone);
+
+        rtcnt_t requestTime = m_requestTime.load(std::memory_order_relaxed);
+        uint32_t latency_us = RTC2US(STM32_HCLK, chSysGetRealtimeCounterX() - requestTime);
+        chSysLock();
+        m_acquisitionStats.completed++;
+        m_acquisitionStats.sumLatency_us += latency_us;
+        if (latency_us < m_acquisitionStats.minLatency_us)
+            m_acquisitionStats.minLatency_us = latency_us;
+        if (latency_us > m_acquisitionStats.maxLatency_us)
+            m_acquisitionStats.maxLatency_us = latency_us;
+        chSysUnlock();
+
+        // AGC, diagnostic et magnitude ne servent qu'à la surveillance des aimants : relus à basse fréquence,
+        //  une fois les angles publiés pour ne pas retarder l'itération suivante
+        if (++acquisitionCount % STATUS_POLL_DIVISOR == 0)
+        {
+            SensorStatus status;
+            uint16_t raw;
+            if (m_mysensor1.getAllData(&status.agc, &status.diag, &status.mag, &raw) == 0)
+                m_sensor1Status = status;
+            if (m_mysensor2.getAllData(&status.agc, &status.diag, &status.mag, &raw) == 0)
+                m_sensor2Status = status;
+        }
+    }
+}
+
+MagEncoders::AcquisitionStats MagEncoders::getAcquisitionStats()
+{
+    chSysLock();
+    AcquisitionStats stats = m_acquisitionStats;
+    chSysUnlock();
+    return stats;
+}
+
+void MagEncoders::resetAcquisitionStats()
+{
+    chSysLock();
+    m_acquisitionStats.requested = 0;
+    m_acquisitionStats.completed = 0;
+    m_acquisitionStats.errors = 0;
+    m_acquisitionStats.stale = 0;
+    m_acquisitionStats.minLatency_us = UINT32_MAX;
+    m_acquisitionStats.maxLatency_us = 0;
+    m_acquisitionStats.sumLatency_us = 0;
+    m_acquisitionStats.maxWait_us = 0;
+    chSysUnlock();
+}
+
+void MagEncoders::getSensorsStatus(SensorStatus *sensor1, SensorStatus *sensor2) const
+{
+    *sensor1 = m_sensor1Status;
+    *sensor2 = m_sensor2Status;
+}
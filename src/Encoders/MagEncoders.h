@@ -6,11 +6,12 @@
 #include "hal.h"
 #include "hal_streams.h"
 #include "ams_as5048b.h"
+#include <atomic>
 
 // Address depending on the two DIL switches
 //#define AS5048B_ADDR(a2,a1)  (uint8_t)(0x40 | ( a2 ? 0x2 : 0 ) | ( a1 ? 0x1 : 0 ))//todo a changer
 
-class MagEncoders: public Encoders
+class MagEncoders final : public Encoders
 {
 public:
     struct I2cPinInit
@@ -21,7 +22,41 @@ public:
         uint8_t pinNumberSDA;
     };
 
-    MagEncoders(bool is1EncoderRight, bool invertEncoderRight = false, bool invertEncoderLeft = false);
+    /*
+     * Statistiques de l'acquisition pipelinée. Mises à jour par le thread d'asserv (requested, stale, maxWait_us),
+     *  le thread d'acquisition et le shell (reset) : toujours sous chSysLock, et lues en une seule copie.
+     */
+    struct AcquisitionStats
+    {
+        uint32_t requested;
+        uint32_t completed;
+        uint32_t errors; // lectures ratées, signalées à getValues() qui garde les derniers angles sans attendre
+        uint32_t stale; // getValues() sans angles frais : delta nul, rattrapé à l'itération suivante
+        uint32_t minLatency_us; // entre startAcquisition() et les angles prêts
+        uint32_t maxLatency_us;
+        uint64_t sumLatency_us;
+        uint32_t maxWait_us; // attente maximale dans getValues() d'une acquisition en retard
+    };
+
+    /*
+     * Derniers registres de diagnostic d'un capteur, relus à basse fréquence en mode pipeliné
+     */
+    struct SensorStatus
+    {
+        uint8_t agc;
+        uint8_t diag;
+        uint16_t mag;
+    };
+
+    /*
+     * pipelinedAcquisition :
+     *  - false : getValues() lit AGC, diagnostic, magnitude et angle des deux capteurs sur le bus I2C
+     *  - true : startAcquisition(), appelé après l'écriture des consignes moteur, réveille un thread dédié
+     *            (lancé par init()) qui ne lit que les registres d'angle. getValues() consomme ces angles
+     *            sans toucher au bus. AGC, diagnostic et magnitude sont relus toutes les STATUS_POLL_DIVISOR acquisitions.
+     */
+    MagEncoders(bool is1EncoderRight, bool invertEncoderRight = false, bool invertEncoderLeft = false,
+            bool pipelinedAcquisition = false);
     virtual ~MagEncoders();
 
     void init();
@@ -31,10 +66,22 @@ public:
     void getEncodersTotalCount(int32_t *sumEncoderRight, int32_t *sumEncoderLeft);
 
     virtual void getValues(float *deltaEncoderRight, float *deltaEncoderLeft);
+    virtual void startAcquisition();
+
+    AcquisitionStats getAcquisitionStats();
+    void resetAcquisitionStats();
+    void getSensorsStatus(SensorStatus *sensor1, SensorStatus *sensor2) const;
 
     void getValuesStatus(uint16_t *encoderRight, uint16_t *encoderLeft, uint8_t *agcR, uint8_t *agcL, uint8_t *diagR,
             uint8_t *diagL, uint16_t *magR, uint16_t *magL);
 private:
+    static constexpr uint32_t STATUS_POLL_DIVISOR = 100;
+
+    bool takeAcquiredAngles(uint16_t *raw1, uint16_t *raw2);
+
+    static void acquisitionThread(void *arg);
+    void acquisitionLoop();
+
     I2CConfig m_i2cconfig;
     I2cPinInit m_i2cPinConf;
     AMS_AS5048B m_mysensor1;
@@ -44,11 +91,27 @@ private:
     bool m_invertEncoderR;
     int32_t m_encoderLSum;
     int32_t m_encoderRSum;
-    float m_encoder1Previous;
-    float m_encoder2Previous;
+    uint16_t m_encoder1Previous; // derniers angles bruts (14 bits)
+    uint16_t m_encoder2Previous;
 
     bool m_is1EncoderRight;
+    bool m_pipelinedAcquisition;
+
+    /*
+     * Slot des derniers angles acquis : bit SAMPLE_FRESH, bit SAMPLE_ERROR, angle capteur 2 (14 bits), angle capteur 1 (14 bits).
+     *  Un seul mot de 32 bits, écrit par le thread d'acquisition et consommé (bit SAMPLE_FRESH effacé) par getValues().
+     *  Une lecture ratée publie SAMPLE_FRESH | SAMPLE_ERROR, sans angles : l'acquisition est terminée mais inutilisable.
+     */
+    static constexpr uint32_t SAMPLE_FRESH = 1UL << 31;
+    static constexpr uint32_t SAMPLE_ERROR = 1UL << 30;
+    std::atomic<uint32_t> m_sampleSlot;
+    std::atomic<rtcnt_t> m_requestTime;
+    binary_semaphore_t m_acquisitionRequest;
+    binary_semaphore_t m_acquisitionDone;
 
+    AcquisitionStats m_acquisitionStats;
+    SensorStatus m_sensor1Status;
+    SensorStatus m_sensor2Status;
 };
 
 #endif /* SRC_ENCODERS_MAGENCODERS_CPP_ */
@@ -34,9 +34,10 @@ QuadratureEncoder::QuadratureEncoder(GpioPinInit *gpioPins, bool is1EncoderRight
     m_encoderLSum = 0;
     m_encoder1Previous = 0;
     m_encoder2Previous = 0;
+    m_encoder1Latched = 0;
+    m_encoder2Latched = 0;
+    m_latched = false;
     m_is1EncoderRight = is1EncoderRight;
-    m_encoderLGain = 1;
-    m_encoderRGain = 1;
 }
 
 QuadratureEncoder::~QuadratureEncoder()
@@ -61,6 +62,7 @@ void QuadratureEncoder::start()
     qeiEnable (&QEID2);
     m_encoder1Previous = qeiGetCount(&QEID3);
     m_encoder2Previous = qeiGetCount(&QEID2);
+    m_latched = false;
     m_encoderRSum = 0;
     m_encoderLSum = 0;
 
@@ -72,10 +74,30 @@ void QuadratureEncoder::stop()
     qeiDisable (&QEID2);
 }
 
+void QuadratureEncoder::latchI()
+{
+    m_encoder1Latched = qeiGetCountI(&QEID3);
+    m_encoder2Latched = qeiGetCountI(&QEID2);
+    m_latched = true;
+}
+
 void QuadratureEncoder::getValues(float *deltaEncoderRight, float *deltaEncoderLeft)
 {
-    int16_t encoder2 = qeiGetCount(&QEID2);
-    int16_t encoder1 = qeiGetCount(&QEID3);
+    int16_t encoder1;
+    int16_t encoder2;
+    chSysLock();
+    if (m_latched)
+    {
+        encoder1 = m_encoder1Latched;
+        encoder2 = m_encoder2Latched;
+        m_latched = false;
+    }
+    else
+    {
+        encoder2 = qeiGetCountI(&QEID2);
+        encoder1 = qeiGetCountI(&QEID3);
+    }
+    chSysUnlock();
 
     int16_t deltaRight;
     int16_t deltaLeft;
@@ -99,8 +121,8 @@ void QuadratureEncoder::getValues(float *deltaEncoderRight, float *deltaEncoderL
     m_encoderRSum += deltaRight;
     m_encoderLSum += deltaLeft;
 
-    *deltaEncoderRight = float(deltaRight) * m_encoderRGain;
-    *deltaEncoderLeft = float(deltaLeft) * m_encoderLGain;
+    *deltaEncoderRight = float(deltaRight) * m_rightGain;
+    *deltaEncoderLeft = float(deltaLeft) * m_leftGain;
 
     m_encoder1Previous = encoder1;
     m_encoder2Previous = encoder2;
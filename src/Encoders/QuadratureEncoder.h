@@ -5,7 +5,7 @@
 #include "ch.h"
 #include "hal.h"
 
-class QuadratureEncoder: public Encoders
+class QuadratureEncoder final : public Encoders
 {
 public:
     struct GpioPinInit
@@ -30,10 +30,8 @@ public:
     int32_t getRightEncoderTotalCount() { return m_encoderRSum;};
     int32_t getLeftEncoderTotalCount() {return m_encoderLSum;};
 
-    float getRightEncoderGain() { return m_encoderRGain; };
-    float getLeftEncoderGain() { return m_encoderLGain; };
-
     virtual void getValues(float *deltaEncoderRight, float *deltaEncoderLeft);
+    virtual void latchI();
 
 private:
     GpioPinInit m_gpioPinConf;
@@ -43,8 +41,10 @@ private:
     int32_t m_encoderRSum;
     int16_t m_encoder1Previous;
     int16_t m_encoder2Previous;
-    float m_encoderLGain;
-    float m_encoderRGain;
+    // Compteurs figés au tick de la boucle, lus en direct par getValues() sans LoopTimer
+    int16_t m_encoder1Latched;
+    int16_t m_encoder2Latched;
+    bool m_latched;
     bool m_is1EncoderRight;
 };
 
@@ -490,7 +490,7 @@ msg_t AMS_AS5048B::i2cMasterTransmitTimeoutTimes(I2CDriver *i2cp,
                                size_t rxbytes,
                                sysinterval_t timeout, int times)
 {
-    msg_t r;
+    msg_t r = MSG_RESET;
    for(int i = 0; i <= times ; i++)
    {
        if (i2cp->state != I2C_READY)
@@ -536,6 +536,36 @@ uint8_t AMS_AS5048B::getAllData(uint8_t *agc, uint8_t *diag, uint16_t *mag, uint
     return r;
 }
 
+/**************************************************************************/
+/*!
+ @brief  reads the 2 bytes angle register value in a single I2C transaction,
+ without retry nor trace : meant for the control loop fast path,
+ which prefers to skip a sample rather than to wait
+
+ @params[out]
+ uint16_t *raw : angle register value trimmed on 14 bits
+ @returns
+ 0 if OK, -1 on I2C error
+ */
+/**************************************************************************/
+int AMS_AS5048B::readAngleRaw(uint16_t *raw)
+{
+    uint8_t cmd[] = { AS5048B_ANGLMSB_REG };
+    uint8_t data[2] = { 0, 0 };
+
+    i2cAcquireBus (&I2CD2);
+    if (I2CD2.state != I2C_READY)
+        i2cStart(&I2CD2, I2CD2.config);
+    msg_t msg = i2cMasterTransmitTimeout(&I2CD2, _chipAddress, cmd, sizeof(cmd), data, sizeof(data), TIME_MS2I(1));
+    i2cReleaseBus(&I2CD2);
+
+    if (msg != MSG_OK)
+        return -1;
+
+    *raw = ((uint16_t) (data[0]) << 6) + (data[1] & 0x3F);
+    return 0;
+}
+
 int AMS_AS5048B::writeReg(uint8_t address, uint8_t value)
 {
 
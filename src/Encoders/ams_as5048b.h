@@ -74,6 +74,7 @@ public:
     void resetMovingAvgExp(void); //reset Exponential Moving Average calculation values
 
     uint8_t getAllData(uint8_t *agc, uint8_t *diag, uint16_t *mag, uint16_t *raw);
+    int readAngleRaw(uint16_t *raw); //read only the angle registers, one I2C transaction, no retry
 
 
 private:
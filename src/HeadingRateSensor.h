@@ -0,0 +1,20 @@
+#ifndef SRC_HEADINGRATESENSOR_H_
+#define SRC_HEADINGRATESENSOR_H_
+
+/*
+ * Source optionnelle de vitesse angulaire (gyromètre) pour le PoseEstimator.
+ *  Lue une fois par itération de la boucle d'asserv, elle ne doit pas bloquer :
+ *  sans nouvel échantillon depuis la dernière lecture, getHeadingRate() renvoie false.
+ */
+class HeadingRateSensor
+{
+public:
+    virtual ~HeadingRateSensor()
+    {
+    }
+
+    // Vitesse angulaire du robot, en rad/s, positive en tournant à gauche
+    virtual bool getHeadingRate(float *rate_radps) = 0;
+};
+
+#endif /* SRC_HEADINGRATESENSOR_H_ */
@@ -0,0 +1,296 @@
+#include "LoopTimer.h"
+#include "ch.h"
+#include "hal.h"
+#include "Encoders/Encoder.h"
+
+// Fréquence du compteur du timer : la période est réglée à la us
+#define LOOP_TIMER_GPT_FREQUENCY (1000000)
+
+#ifdef HOST_BUILD
+static constexpr uint32_t TIMESTAMP_TICKS_PER_US = 1000;
+#else
+static constexpr uint32_t TIMESTAMP_TICKS_PER_US = STM32_SYSCLK / 1000000;
+
+static LoopTimer *s_loopTimer = nullptr;
+
+static void loopTimerCallback(GPTDriver *gptp)
+{
+    (void) gptp;
+    uint32_t timestamp = s_loopTimer->now();
+    chSysLockFromISR();
+    s_loopTimer->tickI(timestamp);
+    chSysUnlockFromISR();
+}
+
+__extension__ static const GPTConfig loopTimerConfig = {
+        .frequency = LOOP_TIMER_GPT_FREQUENCY,
+        .callback = loopTimerCallback,
+        .cr2 = 0,
+        .dier = 0
+};
+#endif
+
+// Durée d'une unité de timestamp, en s
+static constexpr float TIMESTAMP_PERIOD_S = 1.0f / (float(TIMESTAMP_TICKS_PER_US) * 1000000.0f);
+
+LoopTimer::LoopTimer(uint16_t frequency, Encoders &encoders) :
+        m_frequency(frequency), m_encoders(encoders), m_running(false),
+        m_intervalBase_us(LOOP_TIMER_GPT_FREQUENCY / frequency), m_intervalRemainder(LOOP_TIMER_GPT_FREQUENCY % frequency)
+{
+    m_remainderAccumulator = 0;
+    m_periodInterval_us = m_intervalBase_us;
+    m_nextInterval_us = m_intervalBase_us;
+    m_lastTickTimestamp = 0;
+    m_lastSampleTimestamp = 0;
+    m_samplePeriod = m_intervalBase_us * TIMESTAMP_TICKS_PER_US;
+    m_tickPending = false;
+#ifdef HOST_BUILD
+    m_virtualTime = 0;
+    m_virtualEdge = 0;
+    m_virtualWaiting = false;
+    m_maxSampleDelay_us = 0;
+    m_missedTickInterval = 0;
+    m_ticksSinceMissed = 0;
+    m_randomState = 1;
+#else
+    m_waitingThread = nullptr;
+#endif
+    m_resetRequested = false;
+    clearStats();
+}
+
+#ifndef HOST_BUILD
+uint32_t LoopTimer::now() const
+{
+    return DWT->CYCCNT;
+}
+#endif
+
+void LoopTimer::start()
+{
+    m_remainderAccumulator = 0;
+    // Première période, et la suivante préchargée dès le démarrage
+    m_periodInterval_us = nextInterval_us();
+    m_nextInterval_us = nextInterval_us();
+    m_tickPending = false;
+    m_samplePeriod = m_periodInterval_us * TIMESTAMP_TICKS_PER_US;
+    clearStats();
+
+#ifndef HOST_BUILD
+    // Active le compteur de cycles du DWT, base de temps des mesures
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    s_loopTimer = this;
+    m_lastTickTimestamp = now();
+    gptStart(&GPTD7, &loopTimerConfig);
+    gptStartContinuous(&GPTD7, m_periodInterval_us);
+    gptChangeInterval(&GPTD7, m_nextInterval_us);
+#else
+    m_virtualEdge = m_virtualTime;
+    m_lastTickTimestamp = m_virtualTime;
+#endif
+    m_lastSampleTimestamp = m_lastTickTimestamp;
+    m_running = true;
+}
+
+void LoopTimer::stop()
+{
+#ifndef HOST_BUILD
+    gptStopTimer(&GPTD7);
+    gptStop(&GPTD7);
+#endif
+    m_running = false;
+}
+
+void LoopTimer::setFrequency(uint16_t frequency)
+{
+    chDbgAssert(frequency >= 16, "TIM7 counts at most 65535 us");
+    chSysLock();
+    m_frequency = frequency;
+    m_intervalBase_us = LOOP_TIMER_GPT_FREQUENCY / frequency;
+    m_intervalRemainder = LOOP_TIMER_GPT_FREQUENCY % frequency;
+    m_remainderAccumulator = 0;
+    m_resetRequested = true;
+    chSysUnlock();
+}
+
+uint32_t LoopTimer::nextInterval_us()
+{
+    uint32_t interval = m_intervalBase_us;
+    m_remainderAccumulator += m_intervalRemainder;
+    if (m_remainderAccumulator >= m_frequency)
+    {
+        m_remainderAccumulator -= m_frequency;
+        interval++;
+    }
+    return interval;
+}
+
+void LoopTimer::tickI(uint32_t timestamp)
+{
+    // Compteurs codeurs figés au plus près du front du timer
+    m_encoders.latchI();
+
+    /* La période en cours vient de commencer avec la valeur préchargée au tick précédent (ARR préchargé du timer).
+     *  On précharge la suivante : l'interruption arrivant quelques us après le front, elle est prise au prochain tick
+     */
+    m_periodInterval_us = m_nextInterval_us;
+    m_nextInterval_us = nextInterval_us();
+#ifndef HOST_BUILD
+    gptChangeIntervalI(&GPTD7, m_nextInterval_us);
+#endif
+
+    if (m_resetRequested)
+    {
+        clearStats();
+        m_resetRequested = false;
+    }
+    else if (m_ticks > 0)
+    {
+        uint32_t period = timestamp - m_lastTickTimestamp;
+        m_periodSum += period;
+        if (period < m_minPeriod)
+            m_minPeriod = period;
+        if (period > m_maxPeriod)
+            m_maxPeriod = period;
+    }
+    m_ticks++;
+    m_lastTickTimestamp = timestamp;
+
+#ifndef HOST_BUILD
+    if (m_waitingThread != nullptr)
+    {
+        chThdResumeI(&m_waitingThread, MSG_OK);
+    }
+    else
+    {
+        // Le thread n'a pas fini l'itération précédente
+        m_tickPending = true;
+        m_missedTicks++;
+    }
+#else
+    if (!m_virtualWaiting)
+    {
+        // Tick simulé pendant l'itération précédente (voir waitTick)
+        m_tickPending = true;
+        m_missedTicks++;
+    }
+#endif
+}
+
+void LoopTimer::waitTick()
+{
+    chSysLock();
+#ifdef HOST_BUILD
+    if (!m_tickPending)
+    {
+        m_virtualEdge += m_periodInterval_us * TIMESTAMP_TICKS_PER_US;
+        if (m_missedTickInterval != 0 && ++m_ticksSinceMissed >= m_missedTickInterval)
+        {
+            // Tick tombé pendant l'itération précédente, le thread ne l'attend pas : ses compteurs figés sont écrasés par ceux du suivant
+            m_ticksSinceMissed = 0;
+            tickI(m_virtualEdge + virtualSampleDelay());
+            m_virtualEdge += m_periodInterval_us * TIMESTAMP_TICKS_PER_US;
+        }
+        m_virtualWaiting = true;
+        m_virtualTime = m_virtualEdge + virtualSampleDelay();
+        tickI(m_virtualTime);
+        m_virtualWaiting = false;
+    }
+#else
+    if (!m_tickPending)
+        chThdSuspendS(&m_waitingThread);
+#endif
+    m_tickPending = false;
+    m_samplePeriod = m_lastTickTimestamp - m_lastSampleTimestamp;
+    m_lastSampleTimestamp = m_lastTickTimestamp;
+
+    uint32_t wakeLatency = now() - m_lastTickTimestamp;
+    if (wakeLatency > m_maxWakeLatency)
+        m_maxWakeLatency = wakeLatency;
+    chSysUnlock();
+}
+
+#ifdef HOST_BUILD
+void LoopTimer::setVirtualJitter(uint32_t maxSampleDelay_us, uint16_t missedTickInterval)
+{
+    m_maxSampleDelay_us = maxSampleDelay_us;
+    m_missedTickInterval = missedTickInterval;
+    m_ticksSinceMissed = 0;
+}
+
+uint32_t LoopTimer::virtualSampleDelay()
+{
+    if (m_maxSampleDelay_us == 0)
+        return 0;
+    // Générateur congruentiel : la même gigue d'un lancement à l'autre
+    m_randomState = m_randomState * 1664525u + 1013904223u;
+    return (m_randomState >> 8) % (m_maxSampleDelay_us * TIMESTAMP_TICKS_PER_US + 1);
+}
+#endif
+
+float LoopTimer::getSamplePeriod_s() const
+{
+    return float(m_samplePeriod) * TIMESTAMP_PERIOD_S;
+}
+
+int32_t LoopTimer::getTimeToNextTick_us() const
+{
+    // Tick tombé pendant l'itération : l'échéance est dépassée depuis ce tick
+    if (m_tickPending)
+        return -int32_t((now() - m_lastTickTimestamp) / TIMESTAMP_TICKS_PER_US);
+
+    int32_t remaining = int32_t(m_lastTickTimestamp + m_periodInterval_us * TIMESTAMP_TICKS_PER_US - now());
+    return remaining / int32_t(TIMESTAMP_TICKS_PER_US);
+}
+
+void LoopTimer::clearStats()
+{
+    m_ticks = 0;
+    m_periodSum = 0;
+    m_minPeriod = UINT32_MAX;
+    m_maxPeriod = 0;
+    m_maxWakeLatency = 0;
+    m_missedTicks = 0;
+}
+
+float LoopTimer::timestampToMicroseconds(uint32_t timestamp)
+{
+    return float(timestamp) / float(TIMESTAMP_TICKS_PER_US);
+}
+
+float LoopTimer::getMeanPeriod_us() const
+{
+    if (m_ticks < 2)
+        return 0;
+    // Quotient entier puis reste : la somme de plusieurs minutes de périodes dépasse la précision d'un float
+    const uint32_t periods = m_ticks - 1;
+    const float mean = float(uint32_t(m_periodSum / periods)) + float(uint32_t(m_periodSum % periods)) / float(periods);
+    return mean / float(TIMESTAMP_TICKS_PER_US);
+}
+
+float LoopTimer::getMinPeriod_us() const
+{
+    return (m_ticks < 2) ? 0 : timestampToMicroseconds(m_minPeriod);
+}
+
+float LoopTimer::getMaxPeriod_us() const
+{
+    return timestampToMicroseconds(m_maxPeriod);
+}
+
+float LoopTimer::getMaxJitter_us() const
+{
+    if (m_ticks < 2)
+        return 0;
+    const float nominal = 1000000.0f / float(m_frequency);
+    const float above = getMaxPeriod_us() - nominal;
+    const float below = nominal - getMinPeriod_us();
+    return (above > below) ? above : below;
+}
+
+float LoopTimer::getMaxWakeLatency_us() const
+{
+    return timestampToMicroseconds(m_maxWakeLatency);
+}
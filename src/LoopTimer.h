@@ -0,0 +1,160 @@
+#ifndef SRC_LOOPTIMER_H_
+#define SRC_LOOPTIMER_H_
+
+#include "ch.h"
+#include <cstdint>
+
+class Encoders;
+
+/*
+ * Horloge de la boucle d'asserv.
+ *
+ *  Sur la cible, un timer matériel (GPT sur TIM7, à 1 MHz) donne le tick : son interruption fige les compteurs codeurs
+ *   (voir Encoders::latchI) et réveille le thread d'asserv, qui attend dans waitTick().
+ *   Le systick à 10 kHz ne tombe pas juste pour toutes les fréquences de boucle (3.33 ms à 300 Hz) :
+ *   la période du timer est la partie entière en us, avec 1 us de plus sur une partie des ticks pour que le reste
+ *   de 1000000 / frequency soit rattrapé exactement, sans dérive (à 300 Hz : 3333, 3333, 3334, ...).
+ *   La fréquence de boucle doit rester au dessus de 16 Hz (TIM7 a un compteur 16 bits).
+ *
+ *  Sur le host, le même ordonnancement tourne en temps virtuel : waitTick() avance l'horloge jusqu'au tick suivant,
+ *   avec en option une gigue artificielle (voir setVirtualJitter).
+ *
+ *  Le temps réellement écoulé entre deux échantillons codeurs consommés par la boucle (getSamplePeriod_s) est mesuré
+ *   sur les timestamps des ticks : c'est le deltaT que la boucle passe à ses intégrateurs.
+ *
+ *  La période réellement obtenue et sa gigue sont mesurées à chaque tick, sur le compteur de cycles du DWT
+ *   pour la cible et en ns virtuelles pour le host, ainsi que la latence de réveil du thread et les ticks
+ *   tombés pendant que le thread était encore occupé par l'itération précédente.
+ */
+class LoopTimer
+{
+public:
+    explicit LoopTimer(uint16_t frequency, Encoders &encoders);
+
+    void start();
+    void stop();
+    inline bool isRunning() const
+    {
+        return m_running;
+    }
+
+    /*
+     * Nouvelle fréquence (au moins 16 Hz), appliquée à partir de la période qui commence au deuxième tick :
+     *  le timer a déjà préchargé celle qui commence au prochain. Les statistiques repartent de zéro
+     */
+    void setFrequency(uint16_t frequency);
+
+    /*
+     * Attend le tick suivant. Si un tick est tombé pendant l'itération précédente, on repart tout de suite
+     *  sur ce tick, les ticks suivants manqués n'étant pas rattrapés
+     */
+    void waitTick();
+
+    /*
+     * Appelée à chaque tick, sous verrou, depuis l'interruption du timer sur la cible et par waitTick() sur le host
+     */
+    void tickI(uint32_t timestamp);
+
+    // Temps restant avant le prochain tick, négatif s'il est déjà passé
+    int32_t getTimeToNextTick_us() const;
+
+    /*
+     * Temps écoulé, en s, entre le tick sur lequel waitTick() vient de rendre la main et celui de l'itération précédente,
+     *  ticks manqués compris : la période couverte par les compteurs codeurs figés
+     */
+    float getSamplePeriod_s() const;
+
+    inline uint16_t getFrequency() const
+    {
+        return m_frequency;
+    }
+
+    /*
+     * Statistiques depuis le dernier resetStats() : nombre de ticks, période mesurée (moyenne, min, max),
+     *  gigue (pire écart d'une période à 1 / frequency), pire latence de réveil du thread, ticks manqués
+     */
+    inline uint32_t getTicks() const
+    {
+        return m_ticks;
+    }
+    float getMeanPeriod_us() const;
+    float getMinPeriod_us() const;
+    float getMaxPeriod_us() const;
+    float getMaxJitter_us() const;
+    float getMaxWakeLatency_us() const;
+    inline uint32_t getMissedTicks() const
+    {
+        return m_missedTicks;
+    }
+
+    // Le reset est fait par le tick suivant, pour ne pas toucher aux stats pendant leur mise à jour
+    inline void resetStats()
+    {
+        m_resetRequested = true;
+    }
+
+#ifdef HOST_BUILD
+    // Temps virtuel en ns, avancé par waitTick()
+    inline uint32_t now() const
+    {
+        return m_virtualTime;
+    }
+
+    /*
+     * Gigue artificielle du temps virtuel : chaque tick est horodaté (et les codeurs figés) avec un retard aléatoire
+     *  de 0 à maxSampleDelay_us après son front, et un tick sur missedTickInterval tombe pendant l'itération précédente
+     *  (0 : aucun)
+     */
+    void setVirtualJitter(uint32_t maxSampleDelay_us, uint16_t missedTickInterval);
+#else
+    uint32_t now() const;
+#endif
+
+private:
+    uint32_t nextInterval_us();
+    void clearStats();
+#ifdef HOST_BUILD
+    uint32_t virtualSampleDelay();
+#endif
+    static float timestampToMicroseconds(uint32_t timestamp);
+
+    uint16_t m_frequency;
+    Encoders &m_encoders;
+    bool m_running;
+
+    // Période en us : partie entière, et reste de 1000000 / frequency accumulé d'un tick à l'autre
+    uint32_t m_intervalBase_us;
+    uint32_t m_intervalRemainder;
+    uint32_t m_remainderAccumulator;
+    // Période en cours depuis le dernier tick, et période suivante, préchargée dans le timer (prise à son prochain tick)
+    uint32_t m_periodInterval_us;
+    uint32_t m_nextInterval_us;
+
+    uint32_t m_lastTickTimestamp;
+    // Timestamp du tick de l'itération précédente, et écart mesuré avec celui de l'itération courante
+    uint32_t m_lastSampleTimestamp;
+    uint32_t m_samplePeriod;
+    bool m_tickPending;
+#ifdef HOST_BUILD
+    uint32_t m_virtualTime;
+    uint32_t m_virtualEdge;
+    bool m_virtualWaiting;  // le thread attend le tick, comme m_waitingThread sur la cible
+    uint32_t m_maxSampleDelay_us;
+    uint16_t m_missedTickInterval;
+    uint16_t m_ticksSinceMissed;
+    uint32_t m_randomState;
+#else
+    thread_reference_t m_waitingThread;
+#endif
+
+    volatile bool m_resetRequested;
+    uint32_t m_ticks;
+    // Périodes mesurées entre deux ticks, dans l'unité des timestamps (cycles CPU ou ns virtuelles)
+    uint64_t m_periodSum;
+    uint32_t m_minPeriod;
+    uint32_t m_maxPeriod;
+    uint32_t m_maxWakeLatency;
+    uint32_t m_missedTicks;
+};
+
+#endif /* SRC_LOOPTIMER_H_ */
@@ -3,30 +3,38 @@
 #include <math.h>
 
 #include "util/asservMath.h"
+#include "util/fastMath.h"
+
+/* Avec la rotation incrémentale, (cos, sin) du cap accumule les erreurs d'arrondi de chaque rotation :
+ *  il est recalculé depuis le cap (somme compensée) toutes les ODOMETRY_RESYNC_PERIOD mises à jour
+ */
+#define ODOMETRY_RESYNC_PERIOD (64)
 
 Odometry::Odometry(float encoderWheelsDistance_mm, float initialX, float initialY)
 {
     m_encoderWheelsDistance_mm = encoderWheelsDistance_mm;
 
     // Initialisation de la position
-    m_X_mm = initialX;
-    m_Y_mm = initialY;
-    m_theta_rad = 0;
+    m_X_mm.set(initialX);
+    m_Y_mm.set(initialY);
+    m_theta_rad.set(0);
+    resyncRotation();
 }
 
 void Odometry::resetX(float X)
 {
-    m_X_mm = X;
+    m_X_mm.set(X);
 }
 
 void Odometry::resetY(float Y)
 {
-    m_Y_mm = Y;
+    m_Y_mm.set(Y);
 }
 
 void Odometry::resetTheta()
 {
-    m_theta_rad = 0;
+    m_theta_rad.set(0);
+    resyncRotation();
 }
 
 void Odometry::reset()
@@ -43,37 +51,96 @@ void Odometry::refresh(float m_encoderDeltaRight_mm, float m_encoderDeltaLeft_mm
      * deltaTheta = la variation de l'angle pendant l'itération = rapport de la différence des distances codeurs sur la
      *               distance entre les roues
      */
-    float deltaDist = (m_encoderDeltaLeft_mm + m_encoderDeltaRight_mm) / 2;
+    float deltaDist = (m_encoderDeltaLeft_mm + m_encoderDeltaRight_mm) * 0.5f;
     float diffCount = m_encoderDeltaRight_mm - m_encoderDeltaLeft_mm;
-    double deltaTheta = double(diffCount) / double(m_encoderWheelsDistance_mm); // En radian
-
-    if (diffCount == 0)    // On considère le mouvement comme une ligne droite
-            {
-        // Mise à jour de la position
-        m_X_mm += deltaDist * cos(m_theta_rad);
-        m_Y_mm += deltaDist * sin(m_theta_rad);
-    } else {
-        //On approxime en considérant que le robot suit un arc de cercle
-        // On calcule le rayon de courbure du cercle
-        float R = float(deltaDist) / deltaTheta;
-
-        //Mise à jour de la position
-        m_X_mm += R * (-sin(m_theta_rad) + sin(m_theta_rad + deltaTheta));
-        m_Y_mm += R * (cos(m_theta_rad) - cos(m_theta_rad + deltaTheta));
-        // Mise à jour du cap
-        m_theta_rad += deltaTheta;
-
-        // On limite le cap à +/- PI afin de ne pouvoir tourner dans les deux sens et pas dans un seul
-        if (m_theta_rad > M_PI)
-            m_theta_rad -= 2 * M_PI;
-        else if (m_theta_rad <= -M_PI)
-            m_theta_rad += 2 * M_PI;
+    float deltaTheta = diffCount / m_encoderWheelsDistance_mm; // En radian
+
+    /*
+     * On approxime en considérant que le robot suit un arc de cercle de rayon R = deltaDist / deltaTheta :
+     *   deltaX = R * (sin(theta + deltaTheta) - sin(theta)) = deltaDist * cos(theta + deltaTheta/2) * sinc(deltaTheta/2)
+     *   deltaY = R * (cos(theta) - cos(theta + deltaTheta)) = deltaDist * sin(theta + deltaTheta/2) * sinc(deltaTheta/2)
+     * La forme en sinc évite la différence de deux sinus presque égaux, qui perd toute la précision d'un float
+     *  quand deltaTheta est petit, et couvre la ligne droite (sinc(0) = 1)
+     */
+    float halfDeltaTheta = 0.5f * deltaTheta;
+#ifdef ENABLE_FAST_MATH
+    /*
+     * Rotation incrémentale : le cap au milieu de l'arc est celui du début, tourné de deltaTheta/2, et le cap de fin
+     *  encore tourné de deltaTheta/2. deltaTheta/2 reste petit (quelques centièmes de rad par itération) :
+     *  développements limités, d'erreur inférieure à l'arrondi d'un float jusqu'à 0.1 rad.
+     */
+    float halfDeltaTheta2 = halfDeltaTheta * halfDeltaTheta;
+    float sinc = 1.0f - halfDeltaTheta2 * (1.0f / 6.0f) * (1.0f - halfDeltaTheta2 * (1.0f / 20.0f));
+    float sinHalf = halfDeltaTheta * sinc;
+    float cosHalf = 1.0f - halfDeltaTheta2 * 0.5f * (1.0f - halfDeltaTheta2 * (1.0f / 12.0f));
+
+    float cosMiddle = m_cosTheta * cosHalf - m_sinTheta * sinHalf;
+    float sinMiddle = m_sinTheta * cosHalf + m_cosTheta * sinHalf;
+
+    float chord = deltaDist * sinc;
+    m_X_mm.add(chord * cosMiddle);
+    m_Y_mm.add(chord * sinMiddle);
+
+    m_cosTheta = cosMiddle * cosHalf - sinMiddle * sinHalf;
+    m_sinTheta = sinMiddle * cosHalf + cosMiddle * sinHalf;
+#else
+    float theta = m_theta_rad.get();
+    float sinc;
+    if (fabsf(halfDeltaTheta) < 1e-3f)
+        sinc = 1.0f - halfDeltaTheta * halfDeltaTheta * (1.0f / 6.0f);
+    else
+        sinc = sinf(halfDeltaTheta) / halfDeltaTheta;
+
+    float chord = deltaDist * sinc;
+    m_X_mm.add(chord * cosf(theta + halfDeltaTheta));
+    m_Y_mm.add(chord * sinf(theta + halfDeltaTheta));
+#endif
+
+    /* Mise à jour du cap. Aux vitesses constantes, les mêmes deltas codeurs reviennent à chaque itération et les arrondis
+     *  de diffCount et deltaTheta se cumulent toujours dans le même sens (plusieurs µrad sur un match) : leurs restes
+     *  exacts (somme de Knuth, fmaf) sont ajoutés aussi
+     */
+    float virtualLeft = diffCount - m_encoderDeltaRight_mm;
+    float virtualRight = diffCount - virtualLeft;
+    float diffCountError = (m_encoderDeltaRight_mm - virtualRight) - (m_encoderDeltaLeft_mm + virtualLeft);
+    m_theta_rad.add(deltaTheta);
+    m_theta_rad.add((fmaf(-deltaTheta, m_encoderWheelsDistance_mm, diffCount) + diffCountError) / m_encoderWheelsDistance_mm);
+
+    /* On limite le cap à +/- PI afin de ne pouvoir tourner dans les deux sens et pas dans un seul.
+     *  M_2PI_F seul est faux de 1.7e-7 rad : à chaque tour complet, le cap dériverait d'autant
+     */
+    if (m_theta_rad.get() > M_PI_F)
+    {
+        m_theta_rad.add(-M_2PI_F);
+        m_theta_rad.add(-M_2PI_F_LOW);
+    }
+    else if (m_theta_rad.get() <= -M_PI_F)
+    {
+        m_theta_rad.add(M_2PI_F);
+        m_theta_rad.add(M_2PI_F_LOW);
     }
+
+#ifdef ENABLE_FAST_MATH
+    if (++m_refreshesSinceResync >= ODOMETRY_RESYNC_PERIOD)
+        resyncRotation();
+#endif
 }
 
 void Odometry::setPosition(float X_mm, float Y_mm, float theta_rad)
 {
-    m_X_mm = X_mm;
-    m_Y_mm = Y_mm;
-    m_theta_rad = theta_rad;
+    m_X_mm.set(X_mm);
+    m_Y_mm.set(Y_mm);
+    m_theta_rad.set(theta_rad);
+    resyncRotation();
+}
+
+void Odometry::setWheelsDistance(float encoderWheelsDistance_mm)
+{
+    m_encoderWheelsDistance_mm = encoderWheelsDistance_mm;
+}
+
+void Odometry::resyncRotation()
+{
+    loopSinCosf(m_theta_rad.get(), &m_sinTheta, &m_cosTheta);
+    m_refreshesSinceResync = 0;
 }
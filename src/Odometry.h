@@ -2,6 +2,7 @@
 #define ODOMETRIE
 
 #include <cstdint>
+#include "util/CompensatedSum.h"
 
 class Odometry
 {
@@ -23,27 +24,41 @@ public:
 
     float getX() const
     {
-        return m_X_mm;   // Renvoie la position en X par rapport au point de départ
+        return m_X_mm.get();   // Renvoie la position en X par rapport au point de départ
     }
     float getY() const
     {
-        return m_Y_mm;   // Renvoie la position en Y par rapport au point de départ
+        return m_Y_mm.get();   // Renvoie la position en Y par rapport au point de départ
     }
     float getTheta() const
     {
-        return m_theta_rad;   // Renvoie l'angle par rapport au cap de départ
+        return m_theta_rad.get();   // Renvoie l'angle par rapport au cap de départ
     }
 
     void setPosition(float X_mm, float Y_mm, float theta_rad);
 
+    // Voie des roues codeuses recalibrée (voir OdometryCalibration)
+    void setWheelsDistance(float encoderWheelsDistance_mm);
+    float getWheelsDistance() const
+    {
+        return m_encoderWheelsDistance_mm;
+    }
+
 
 private:
 
+    // Sinus et cosinus du cap recalculés depuis m_theta_rad (voir refresh() avec ENABLE_FAST_MATH)
+    void resyncRotation();
+
     float m_encoderWheelsDistance_mm;
 
-    // Position actuelle
-    float m_X_mm, m_Y_mm; // En mm
-    float m_theta_rad; //En radian
+    // Position actuelle, en sommes compensées pour ne pas dériver sur un match
+    CompensatedSum m_X_mm, m_Y_mm; // En mm
+    CompensatedSum m_theta_rad; //En radian
+
+    // Cap en rotation (cos, sin), tourné à chaque refresh() au lieu d'être recalculé (ENABLE_FAST_MATH)
+    float m_cosTheta, m_sinTheta;
+    uint8_t m_refreshesSinceResync;
 };
 
 #endif
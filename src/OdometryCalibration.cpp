@@ -0,0 +1,148 @@
+#include "OdometryCalibration.h"
+
+#include <math.h>
+
+#include "commandManager/CommandManager.h"
+#include "util/asservMath.h"
+
+// Recherche de Gauss-Newton : itérations max, et pas en dessous duquel elle a convergé
+#define ODOMETRY_CALIBRATION_MAX_ITERATIONS (20)
+#define ODOMETRY_CALIBRATION_RATIO_TOLERANCE (1e-6f)
+#define ODOMETRY_CALIBRATION_TRACK_TOLERANCE_mm (1e-3f)
+
+OdometryCalibration::OdometryCalibration()
+{
+    m_side_mm = 0;
+    clearRuns();
+}
+
+void OdometryCalibration::clearRuns()
+{
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        m_sumX_mm[i] = 0;
+        m_sumY_mm[i] = 0;
+        m_runCount[i] = 0;
+    }
+}
+
+void OdometryCalibration::setSide(float side_mm)
+{
+    if (side_mm != m_side_mm)
+        clearRuns();
+    m_side_mm = side_mm;
+}
+
+bool OdometryCalibration::addSquare(CommandManager &commandManager, float side_mm, bool clockwise)
+{
+    setSide(side_mm);
+    const float turn = clockwise ? -M_PI_F * 0.5f : M_PI_F * 0.5f;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        if (!commandManager.addStraightLine(side_mm) || !commandManager.addTurn(turn))
+            return false;
+    }
+    return true;
+}
+
+void OdometryCalibration::addRun(bool clockwise, float errorX_mm, float errorY_mm)
+{
+    const uint8_t direction = clockwise ? 0 : 1;
+    m_sumX_mm[direction] += errorX_mm;
+    m_sumY_mm[direction] += errorY_mm;
+    m_runCount[direction]++;
+}
+
+void OdometryCalibration::squareEnd(float side_mm, bool clockwise, float odometryWheelsDistance_mm,
+        float rightScale, float leftScale, float realWheelsDistance_mm, float *X_mm, float *Y_mm)
+{
+    // Distances des roues selon l'odométrie : ligne droite, puis virage sur place de 90°
+    const float turnWheelDistance = (clockwise ? -M_PI_F * 0.25f : M_PI_F * 0.25f) * odometryWheelsDistance_mm;
+    const float segmentRight[2] = {side_mm, turnWheelDistance};
+    const float segmentLeft[2] = {side_mm, -turnWheelDistance};
+
+    float X = 0, Y = 0, theta = 0;
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        // Arc réellement parcouru
+        const float right = segmentRight[i % 2] * rightScale;
+        const float left = segmentLeft[i % 2] * leftScale;
+        const float distance = (right + left) * 0.5f;
+        const float deltaTheta = (right - left) / realWheelsDistance_mm;
+        const float halfDeltaTheta = deltaTheta * 0.5f;
+        const float sinc = (fabsf(halfDeltaTheta) > 1e-4f) ? sinf(halfDeltaTheta) / halfDeltaTheta : 1.0f;
+        X += distance * sinc * cosf(theta + halfDeltaTheta);
+        Y += distance * sinc * sinf(theta + halfDeltaTheta);
+        theta += deltaTheta;
+    }
+    *X_mm = X;
+    *Y_mm = Y;
+}
+
+void OdometryCalibration::residuals(float ratio, float realWheelsDistance_mm, float distanceScale, float wheelsDistance_mm,
+        const float measured[4], float r[4]) const
+{
+    // Échelles des roues de rapport ratio et de moyenne distanceScale
+    const float rightScale = distanceScale * 2.0f * ratio / (1.0f + ratio);
+    const float leftScale = distanceScale * 2.0f / (1.0f + ratio);
+    squareEnd(m_side_mm, true, wheelsDistance_mm, rightScale, leftScale, realWheelsDistance_mm, &r[0], &r[1]);
+    squareEnd(m_side_mm, false, wheelsDistance_mm, rightScale, leftScale, realWheelsDistance_mm, &r[2], &r[3]);
+    for (uint8_t i = 0; i < 4; i++)
+        r[i] -= measured[i];
+}
+
+bool OdometryCalibration::solve(float rightGain, float leftGain, float wheelsDistance_mm, float distanceScale, Result *result) const
+{
+    if (m_runCount[0] == 0 || m_runCount[1] == 0 || m_side_mm <= 0)
+        return false;
+
+    // Écarts mesurés : horaire X, Y puis anti-horaire X, Y
+    const float measured[4] = {m_sumX_mm[0] / m_runCount[0], m_sumY_mm[0] / m_runCount[0],
+                               m_sumX_mm[1] / m_runCount[1], m_sumY_mm[1] / m_runCount[1]};
+
+    // Inconnues : rapport des distances réelles droite/gauche et voie réelle
+    float ratio = 1;
+    float realWheelsDistance_mm = wheelsDistance_mm;
+    const float ratioStep = 1e-3f;
+    const float trackStep = 1e-3f * wheelsDistance_mm;
+    float r[4], rRatio[4], rTrack[4];
+    bool converged = false;
+    for (uint8_t iteration = 0; iteration < ODOMETRY_CALIBRATION_MAX_ITERATIONS && !converged; iteration++)
+    {
+        residuals(ratio, realWheelsDistance_mm, distanceScale, wheelsDistance_mm, measured, r);
+        residuals(ratio + ratioStep, realWheelsDistance_mm, distanceScale, wheelsDistance_mm, measured, rRatio);
+        residuals(ratio, realWheelsDistance_mm + trackStep, distanceScale, wheelsDistance_mm, measured, rTrack);
+
+        // Équations normales du système 4x2 linéarisé
+        float a = 0, b = 0, c = 0, gRatio = 0, gTrack = 0;
+        for (uint8_t i = 0; i < 4; i++)
+        {
+            const float jRatio = (rRatio[i] - r[i]) / ratioStep;
+            const float jTrack = (rTrack[i] - r[i]) / trackStep;
+            a += jRatio * jRatio;
+            b += jRatio * jTrack;
+            c += jTrack * jTrack;
+            gRatio += jRatio * r[i];
+            gTrack += jTrack * r[i];
+        }
+        const float determinant = a * c - b * b;
+        if (!(fabsf(determinant) > 0))
+            return false;
+        const float deltaRatio = -(c * gRatio - b * gTrack) / determinant;
+        const float deltaTrack = -(a * gTrack - b * gRatio) / determinant;
+        ratio += deltaRatio;
+        realWheelsDistance_mm += deltaTrack;
+
+        converged = fabsf(deltaRatio) < ODOMETRY_CALIBRATION_RATIO_TOLERANCE
+                && fabsf(deltaTrack) < ODOMETRY_CALIBRATION_TRACK_TOLERANCE_mm;
+    }
+    if (!converged || !(ratio > 0) || !(realWheelsDistance_mm > 0))
+        return false;
+
+    residuals(ratio, realWheelsDistance_mm, distanceScale, wheelsDistance_mm, measured, r);
+    result->rightGain = rightGain * distanceScale * 2.0f * ratio / (1.0f + ratio);
+    result->leftGain = leftGain * distanceScale * 2.0f / (1.0f + ratio);
+    result->wheelsDistance_mm = realWheelsDistance_mm;
+    result->residual_mm = sqrtf((r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]) * 0.25f);
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef SRC_ODOMETRYCALIBRATION_H_
+#define SRC_ODOMETRYCALIBRATION_H_
+
+#include <cstdint>
+
+class CommandManager;
+
+/*
+ * Calibration de l'odométrie façon UMBmark (Borenstein & Feng) : le robot fait un carré de côté side_mm dans le sens
+ *  horaire puis dans le sens anti-horaire, en StraitLine/Turn. Ces commandes étant relatives à l'odométrie, le robot
+ *  revient au départ selon son odométrie, mais pas en vrai. L'écart de la position d'arrivée réelle (mesurée à la main,
+ *  dans le repère de départ) à l'odométrie sépare les deux erreurs systématiques :
+ *   - rayons différents des deux roues codeuses : chaque ligne droite tourne, dans le même sens pour les deux carrés,
+ *   - voie fausse : chaque virage de 90° est trop ou pas assez tourné, en sens opposé d'un carré à l'autre.
+ *  solve() cherche le rapport des rayons et la voie qui expliquent les écarts mesurés, en rejouant les carrés sur un
+ *  modèle cinématique exact (Gauss-Newton), sans l'approximation aux petits angles de l'article.
+ *  Le carré ne dit rien de l'échelle moyenne des deux roues : elle se mesure sur une ligne droite (distanceScale,
+ *  distance réelle / distance odométrie), 1 sinon.
+ *
+ *  Le solveur n'utilise que des floats et rien du robot : il tourne aussi sur des mesures relevées à la main, sur PC
+ *  (voir l'outil host odometryCalibrationBench).
+ */
+class OdometryCalibration
+{
+public:
+    struct Result
+    {
+        float rightGain;            // gains absolus, à passer à Encoders::setGains() (ENCODERS_*_GAIN du robotConfig.h)
+        float leftGain;
+        float wheelsDistance_mm;    // voie des roues codeuses (ENCODERS_WHEELS_DISTANCE_MM)
+        float residual_mm;          // écart moyen restant entre le modèle et les mesures
+    };
+
+    OdometryCalibration();
+
+    /*
+     * Met en file les 8 commandes d'un carré (côté, puis virage de 90° à droite en horaire, à gauche sinon).
+     *  L'odométrie doit être remise à (0, 0, 0) juste avant, les écarts étant mesurés dans le repère de départ.
+     *  Changer de côté efface les mesures déjà faites
+     */
+    bool addSquare(CommandManager &commandManager, float side_mm, bool clockwise);
+
+    /*
+     * Mesure à la fin d'un carré : position réelle moins position selon l'odométrie, dans le repère de départ.
+     *  Plusieurs carrés dans le même sens sont moyennés
+     */
+    void addRun(bool clockwise, float errorX_mm, float errorY_mm);
+    void clearRuns();
+
+    void setSide(float side_mm);
+    float getSide() const
+    {
+        return m_side_mm;
+    }
+    uint8_t getRunCount(bool clockwise) const
+    {
+        return m_runCount[clockwise ? 0 : 1];
+    }
+
+    /*
+     * Gains et voie corrigés à partir de ceux utilisés pendant les carrés.
+     *  Faux s'il manque les mesures d'un des deux sens ou si la recherche ne converge pas
+     */
+    bool solve(float rightGain, float leftGain, float wheelsDistance_mm, float distanceScale, Result *result) const;
+
+    /*
+     * Modèle : position d'arrivée réelle d'un carré exécuté exactement par l'odométrie (voie odometryWheelsDistance_mm),
+     *  quand les roues parcourent en vrai rightScale et leftScale fois leur distance odométrie, sur une voie réelle
+     *  realWheelsDistance_mm
+     */
+    static void squareEnd(float side_mm, bool clockwise, float odometryWheelsDistance_mm,
+            float rightScale, float leftScale, float realWheelsDistance_mm, float *X_mm, float *Y_mm);
+
+private:
+    // Écarts du modèle aux mesures (horaire X, Y puis anti-horaire X, Y) pour un rapport droite/gauche et une voie réelle
+    void residuals(float ratio, float realWheelsDistance_mm, float distanceScale, float wheelsDistance_mm,
+            const float measured[4], float r[4]) const;
+
+    float m_side_mm;
+    float m_sumX_mm[2];    // horaire, anti-horaire
+    float m_sumY_mm[2];
+    uint8_t m_runCount[2];
+};
+
+#endif /* SRC_ODOMETRYCALIBRATION_H_ */
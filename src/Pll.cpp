@@ -10,20 +10,33 @@ Pll::Pll(float bandwidth)
 // Voir ce thread pour plus de détails sur le fonctionnement
 // https://discourse.odriverobotics.com/t/rotor-encoder-pll-and-velocity/224
 
-void Pll::update(int16_t deltaTicks, float deltaT)
+void Pll::update(float deltaTicks, float deltaT)
 {
-// Prediction
-    m_position += deltaT * m_speed;
+    // Prediction
+    float predictedDelta = deltaT * m_speed;
+    m_position += predictedDelta;
 
-    // Calul de l'erreur entre la prediction et l'info codeur
-    m_count += deltaTicks;
-    float deltaPos = (float) (m_count - (int64_t) floor(m_position));
+    // Calul de l'erreur entre la prediction et l'info codeur, sans arrondi au tick
+    m_positionError += deltaTicks - predictedDelta;
+    float deltaPos = m_positionError;
 
-    // Correction de la PLL
-    m_position += deltaT * m_kp * deltaPos;
-    m_speed += deltaT * m_ki * deltaPos;
+    /* Correction de la PLL. Sur une période plus longue que prévu (tick manqué), la correction proportionnelle
+     *  dépasserait l'erreur elle-même et la Pll divergerait : gains bornés à kp * deltaT = 1 pour cette itération
+     */
+    float kp = m_kp;
+    float ki = m_ki;
+    if (kp * deltaT > 1.0f)
+    {
+        kp = 1.0f / deltaT;
+        ki = 0.25f * kp * kp;
+    }
+    float correction = deltaT * kp * deltaPos;
+    m_position += correction;
+    m_positionError -= correction;
+    m_acceleration = ki * deltaPos;
+    m_speed += deltaT * m_acceleration;
 
-    if (fabsf(m_speed) < 0.5f * deltaT * m_ki)
+    if (fabsf(m_speed) < 0.5f * deltaT * ki)
         m_speed = 0.0f;
 }
 
@@ -2,30 +2,47 @@
 #define SRC_PLL_H_
 
 #include <cstdint>
+#include "VelocityEstimator/VelocityEstimator.h"
 
-class Pll
+/*
+ * Estimateur de vitesse à bande passante fixe : compromis unique entre bruit à basse vitesse et retard à haute vitesse
+ *  (voir AdaptivePll et KalmanVelocityEstimator pour les alternatives)
+ */
+class Pll final : public VelocityEstimator
 {
 
 public:
     explicit Pll(float bandwidth);
 
-    void update(int16_t deltaPosition, float deltaT);
+    /*
+     * deltaPosition en ticks, éventuellement fractionnaires (gains de calibration des codeurs...)
+     */
+    virtual void update(float deltaPosition, float deltaT) override;
 
     void setBandwidth(float bandwidth);
 
-    inline void reset()
+    virtual void reset() override
     {
         m_position = 0;
         m_speed = 0;
-        m_count = 0;
+        m_acceleration = 0;
+        m_positionError = 0;
     }
 
-    inline float getSpeed()
+    virtual float getSpeed() const override
     {
         return m_speed;
     }
 
-    inline float getPosition()
+    /*
+     * Correction intégrale de la dernière itération : la dérivée de la vitesse estimée
+     */
+    virtual float getAcceleration() const override
+    {
+        return m_acceleration;
+    }
+
+    inline float getPosition() const
     {
         return m_position;
     }
@@ -35,7 +52,12 @@ private:
     float m_ki;
     float m_position;
     float m_speed;
-    int64_t m_count;
+    float m_acceleration;
+    /*
+     * Position codeur moins position estimée, en ticks fractionnaires. Suivie directement plutôt que comme
+     *  la différence de deux grands compteurs : la précision ne dépend pas de la distance parcourue.
+     */
+    float m_positionError;
 };
 
 #endif /* SRC_PLL_H_ */
@@ -0,0 +1,262 @@
+#include "PoseEstimator.h"
+
+#include <cmath>
+
+#include "Encoders/Encoder.h"
+#include "HeadingRateSensor.h"
+#include "util/asservMath.h"
+#include "util/fastMath.h"
+
+// Dérive autorisée de la calibration des roues motrices entre deux itérations (usure, charge), en relatif
+#define POSE_ESTIMATOR_CALIBRATION_DRIFT (1e-6f)
+// Dérive du biais du gyromètre entre deux itérations (température), en rad/s
+#define POSE_ESTIMATOR_HEADING_RATE_BIAS_DRIFT (1e-5f)
+
+PoseEstimator::PoseEstimator(Configuration const &configuration, Encoders &motorEncoders,
+        HeadingRateSensor *headingRateSensor)
+: m_configuration(configuration), m_motorEncoders(motorEncoders), m_headingRateSensor(headingRateSensor)
+{
+    // Un delta quantifié est la différence de deux arrondis au tick : variance 2 * tick² / 12
+    m_encoderVariance = configuration.encodermmByTick * configuration.encodermmByTick * (1.0f / 6.0f);
+    m_motorEncoderVariance = configuration.motorEncodermmByTick * configuration.motorEncodermmByTick * (1.0f / 6.0f);
+    m_encoderHalfTrack = 0.5f * configuration.encoderWheelsDistance_mm;
+
+    reset();
+}
+
+void PoseEstimator::setEncoderWheelsDistance(float encoderWheelsDistance_mm)
+{
+    m_encoderHalfTrack = 0.5f * encoderWheelsDistance_mm;
+}
+
+void PoseEstimator::reset()
+{
+    for (uint8_t i = 0; i < STATE_SIZE; i++)
+    {
+        m_state[i] = 0;
+        for (uint8_t j = 0; j < STATE_SIZE; j++)
+            m_covariance[i][j] = 0;
+    }
+    m_state[RIGHT_MOTOR_SCALE] = 1;
+    m_state[LEFT_MOTOR_SCALE] = 1;
+    m_state[MOTOR_WHEELS_DISTANCE] = m_configuration.motorWheelsDistance_mm;
+
+    float scaleVariance = m_configuration.motorCalibrationUncertainty * m_configuration.motorCalibrationUncertainty;
+    m_covariance[RIGHT_MOTOR_SCALE][RIGHT_MOTOR_SCALE] = scaleVariance;
+    m_covariance[LEFT_MOTOR_SCALE][LEFT_MOTOR_SCALE] = scaleVariance;
+    m_covariance[MOTOR_WHEELS_DISTANCE][MOTOR_WHEELS_DISTANCE] = scaleVariance * m_configuration.motorWheelsDistance_mm * m_configuration.motorWheelsDistance_mm;
+    m_covariance[HEADING_RATE_BIAS][HEADING_RATE_BIAS] = m_configuration.headingRateBiasUncertainty * m_configuration.headingRateBiasUncertainty;
+
+    m_X_mm.set(0);
+    m_Y_mm.set(0);
+    m_theta_rad.set(0);
+
+    for (uint8_t i = 0; i < SOURCE_COUNT; i++)
+    {
+        m_consecutiveRejects[i] = 0;
+        m_rejectCount[i] = 0;
+    }
+    m_motorSlipSpeed[0] = 0;
+    m_motorSlipSpeed[1] = 0;
+}
+
+void PoseEstimator::setPosition(float X_mm, float Y_mm, float theta_rad)
+{
+    m_X_mm.set(X_mm);
+    m_Y_mm.set(Y_mm);
+    m_theta_rad.set(theta_rad);
+
+    for (uint8_t i = X; i <= THETA; i++)
+    {
+        m_state[i] = 0;
+        for (uint8_t j = 0; j < STATE_SIZE; j++)
+        {
+            m_covariance[i][j] = 0;
+            m_covariance[j][i] = 0;
+        }
+    }
+}
+
+void PoseEstimator::getPoseCovariance(float covariance[3][3]) const
+{
+    for (uint8_t i = 0; i < 3; i++)
+        for (uint8_t j = 0; j < 3; j++)
+            covariance[i][j] = m_covariance[X + i][X + j];
+}
+
+void PoseEstimator::predictSpeeds(float dt)
+{
+    const float speedNoise = m_configuration.maxAcceleration * dt;
+    const float angularSpeedNoise = m_configuration.maxAngularAcceleration * dt;
+    const float calibrationNoise = POSE_ESTIMATOR_CALIBRATION_DRIFT;
+    const float trackNoise = POSE_ESTIMATOR_CALIBRATION_DRIFT * m_configuration.motorWheelsDistance_mm;
+
+    m_covariance[SPEED][SPEED] += speedNoise * speedNoise;
+    m_covariance[ANGULAR_SPEED][ANGULAR_SPEED] += angularSpeedNoise * angularSpeedNoise;
+    m_covariance[RIGHT_MOTOR_SCALE][RIGHT_MOTOR_SCALE] += calibrationNoise * calibrationNoise;
+    m_covariance[LEFT_MOTOR_SCALE][LEFT_MOTOR_SCALE] += calibrationNoise * calibrationNoise;
+    m_covariance[MOTOR_WHEELS_DISTANCE][MOTOR_WHEELS_DISTANCE] += trackNoise * trackNoise;
+    if (m_headingRateSensor != nullptr)
+        m_covariance[HEADING_RATE_BIAS][HEADING_RATE_BIAS] += POSE_ESTIMATOR_HEADING_RATE_BIAS_DRIFT * POSE_ESTIMATOR_HEADING_RATE_BIAS_DRIFT;
+}
+
+bool PoseEstimator::correct(Source source, float innovation, float const (&H)[STATE_SIZE], float variance)
+{
+    // PHt = P * Ht, S = H * P * Ht + R
+    float PHt[STATE_SIZE];
+    float S = variance;
+    for (uint8_t i = 0; i < STATE_SIZE; i++)
+    {
+        float sum = 0;
+        for (uint8_t j = 0; j < STATE_SIZE; j++)
+            sum += m_covariance[i][j] * H[j];
+        PHt[i] = sum;
+        S += H[i] * sum;
+    }
+
+    // Mesure incohérente avec l'état : roue qui patine ou qui décolle
+    const float gate = m_configuration.gate;
+    if (innovation * innovation > gate * gate * S && m_consecutiveRejects[source] < m_configuration.maxConsecutiveRejects)
+    {
+        m_consecutiveRejects[source]++;
+        m_rejectCount[source]++;
+        return false;
+    }
+    m_consecutiveRejects[source] = 0;
+
+    // K = PHt / S, x += K * innovation, P -= K * PHtᵀ
+    const float inverseS = 1.0f / S;
+    float gain[STATE_SIZE];
+    for (uint8_t i = 0; i < STATE_SIZE; i++)
+        gain[i] = PHt[i] * inverseS;
+
+    m_X_mm.add(gain[X] * innovation);
+    m_Y_mm.add(gain[Y] * innovation);
+    m_theta_rad.add(gain[THETA] * innovation);
+    for (uint8_t i = SPEED; i < STATE_SIZE; i++)
+        m_state[i] += gain[i] * innovation;
+
+    for (uint8_t i = 0; i < STATE_SIZE; i++)
+        for (uint8_t j = i; j < STATE_SIZE; j++)
+        {
+            float value = m_covariance[i][j] - gain[i] * PHt[j];
+            m_covariance[i][j] = value;
+            m_covariance[j][i] = value;
+        }
+    return true;
+}
+
+void PoseEstimator::propagatePose(float dt)
+{
+    const float speed = m_state[SPEED];
+    const float angularSpeed = m_state[ANGULAR_SPEED];
+
+    // Arc de cercle, comme Odometry::refresh()
+    const float deltaDist = speed * dt;
+    const float halfDeltaTheta = 0.5f * angularSpeed * dt;
+    const float sinc = 1.0f - halfDeltaTheta * halfDeltaTheta * (1.0f / 6.0f);
+    float sinMiddle, cosMiddle;
+    loopSinCosf(m_theta_rad.get() + halfDeltaTheta, &sinMiddle, &cosMiddle);
+
+    const float chord = deltaDist * sinc;
+    m_X_mm.add(chord * cosMiddle);
+    m_Y_mm.add(chord * sinMiddle);
+    m_theta_rad.add(2.0f * halfDeltaTheta);
+    if (m_theta_rad.get() > M_PI_F)
+    {
+        m_theta_rad.add(-M_2PI_F);
+        m_theta_rad.add(-M_2PI_F_LOW);
+    }
+    else if (m_theta_rad.get() <= -M_PI_F)
+    {
+        m_theta_rad.add(M_2PI_F);
+        m_theta_rad.add(M_2PI_F_LOW);
+    }
+
+    /* P = F * P * Fᵀ, avec F = I + J : J n'a de termes que sur les lignes X, Y et cap,
+     *  dans les colonnes cap, vitesse et vitesse angulaire
+     */
+    float J[3][3];  // [X, Y, cap][cap, vitesse, vitesse angulaire]
+    J[0][0] = -chord * sinMiddle;   J[0][1] = dt * cosMiddle;   J[0][2] = -chord * sinMiddle * 0.5f * dt;
+    J[1][0] = chord * cosMiddle;    J[1][1] = dt * sinMiddle;   J[1][2] = chord * cosMiddle * 0.5f * dt;
+    J[2][0] = 0;                    J[2][1] = 0;                J[2][2] = dt;
+
+    // F * P : seules les lignes X, Y et cap changent
+    float rows[3][STATE_SIZE];
+    for (uint8_t i = 0; i < 3; i++)
+        for (uint8_t j = 0; j < STATE_SIZE; j++)
+            rows[i][j] = m_covariance[X + i][j] + J[i][0] * m_covariance[THETA][j]
+                    + J[i][1] * m_covariance[SPEED][j] + J[i][2] * m_covariance[ANGULAR_SPEED][j];
+    for (uint8_t i = 0; i < 3; i++)
+        for (uint8_t j = 0; j < STATE_SIZE; j++)
+            m_covariance[X + i][j] = rows[i][j];
+
+    // (F * P) * Fᵀ : seules les colonnes X, Y et cap changent, la matrice reste symétrique
+    for (uint8_t i = 0; i < STATE_SIZE; i++)
+        for (uint8_t j = 0; j < 3; j++)
+            rows[j][i] = m_covariance[i][X + j] + J[j][0] * m_covariance[i][THETA]
+                    + J[j][1] * m_covariance[i][SPEED] + J[j][2] * m_covariance[i][ANGULAR_SPEED];
+    for (uint8_t i = 0; i < STATE_SIZE; i++)
+        for (uint8_t j = 0; j < 3; j++)
+        {
+            m_covariance[i][X + j] = rows[j][i];
+            m_covariance[X + j][i] = rows[j][i];
+        }
+}
+
+void PoseEstimator::update(float deltaRight_mm, float deltaLeft_mm, float deltaT)
+{
+    predictSpeeds(deltaT);
+
+    // Gyromètre : vitesse angulaire plus son biais
+    float headingRate;
+    if (m_headingRateSensor != nullptr && m_headingRateSensor->getHeadingRate(&headingRate))
+    {
+        float Hrate[STATE_SIZE] = {0};
+        Hrate[ANGULAR_SPEED] = 1;
+        Hrate[HEADING_RATE_BIAS] = 1;
+        correct(SOURCE_HEADING_RATE, headingRate - m_state[ANGULAR_SPEED] - m_state[HEADING_RATE_BIAS], Hrate,
+                m_configuration.headingRateNoise * m_configuration.headingRateNoise);
+    }
+
+    // Roues folles : delta = (v ± ω * voie / 2) * deltaT
+    const float halfTrack = m_encoderHalfTrack;
+    float H[STATE_SIZE] = {0};
+    H[SPEED] = deltaT;
+    H[ANGULAR_SPEED] = halfTrack * deltaT;
+    correct(SOURCE_RIGHT_ENCODER, deltaRight_mm - (m_state[SPEED] + m_state[ANGULAR_SPEED] * halfTrack) * deltaT, H, m_encoderVariance);
+    H[ANGULAR_SPEED] = -halfTrack * deltaT;
+    correct(SOURCE_LEFT_ENCODER, deltaLeft_mm - (m_state[SPEED] - m_state[ANGULAR_SPEED] * halfTrack) * deltaT, H, m_encoderVariance);
+
+    /* Roues motrices : delta = échelle * (v ± ω * voie motrice / 2) * deltaT, avec une incertitude de patinage
+     *  proportionnelle au delta
+     */
+    float motorDeltaRight, motorDeltaLeft;
+    m_motorEncoders.getValues(&motorDeltaRight, &motorDeltaLeft);
+    motorDeltaRight *= m_configuration.motorEncodermmByTick;
+    motorDeltaLeft *= m_configuration.motorEncodermmByTick;
+
+    const float slipRatio2 = m_configuration.motorSlipRatio * m_configuration.motorSlipRatio;
+    const float motorHalfTrack = 0.5f * m_state[MOTOR_WHEELS_DISTANCE];
+    const float inverseDt = 1.0f / deltaT;
+    float wheelDistance = (m_state[SPEED] + m_state[ANGULAR_SPEED] * motorHalfTrack) * deltaT;
+    float innovation = motorDeltaRight - m_state[RIGHT_MOTOR_SCALE] * wheelDistance;
+    m_motorSlipSpeed[0] = innovation * inverseDt / m_state[RIGHT_MOTOR_SCALE];
+    H[SPEED] = m_state[RIGHT_MOTOR_SCALE] * deltaT;
+    H[ANGULAR_SPEED] = m_state[RIGHT_MOTOR_SCALE] * motorHalfTrack * deltaT;
+    H[RIGHT_MOTOR_SCALE] = wheelDistance;
+    H[MOTOR_WHEELS_DISTANCE] = m_state[RIGHT_MOTOR_SCALE] * m_state[ANGULAR_SPEED] * 0.5f * deltaT;
+    correct(SOURCE_RIGHT_MOTOR_ENCODER, innovation, H, m_motorEncoderVariance + slipRatio2 * motorDeltaRight * motorDeltaRight);
+
+    wheelDistance = (m_state[SPEED] - m_state[ANGULAR_SPEED] * motorHalfTrack) * deltaT;
+    innovation = motorDeltaLeft - m_state[LEFT_MOTOR_SCALE] * wheelDistance;
+    m_motorSlipSpeed[1] = innovation * inverseDt / m_state[LEFT_MOTOR_SCALE];
+    H[SPEED] = m_state[LEFT_MOTOR_SCALE] * deltaT;
+    H[ANGULAR_SPEED] = -m_state[LEFT_MOTOR_SCALE] * motorHalfTrack * deltaT;
+    H[RIGHT_MOTOR_SCALE] = 0;
+    H[LEFT_MOTOR_SCALE] = wheelDistance;
+    H[MOTOR_WHEELS_DISTANCE] = -m_state[LEFT_MOTOR_SCALE] * m_state[ANGULAR_SPEED] * 0.5f * deltaT;
+    correct(SOURCE_LEFT_MOTOR_ENCODER, innovation, H, m_motorEncoderVariance + slipRatio2 * motorDeltaLeft * motorDeltaLeft);
+
+    propagatePose(deltaT);
+}
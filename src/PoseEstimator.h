@@ -0,0 +1,131 @@
+#ifndef SRC_POSEESTIMATOR_H_
+#define SRC_POSEESTIMATOR_H_
+
+#include <cstdint>
+#include "util/CompensatedSum.h"
+
+class Encoders;
+class HeadingRateSensor;
+
+/*
+ * Estimation de la position par filtre de Kalman étendu, à côté de l'Odometry, pour les robots qui ont des codeurs
+ *  sur les roues folles (ceux de l'asserv) et sur les roues motrices.
+ *
+ *  État : position (X, Y, cap), vitesses (linéaire, angulaire), calibration des roues motrices (facteur d'échelle
+ *  de chaque codeur moteur et voie réelle des roues motrices) et biais du gyromètre. À chaque itération :
+ *   - les vitesses sont mises à jour par le gyromètre s'il y en a un, puis par les deltas des roues folles, puis des
+ *     roues motrices, une mesure scalaire à la fois (pas d'inversion de matrice). Le gyromètre passe en premier :
+ *     indépendant des roues, c'est lui qui permet de voir qu'une roue folle décolle alors que le robot est à l'arrêt ;
+ *   - une mesure trop loin de la prédiction (plus de 'gate' écarts types) est ignorée : roue motrice qui patine,
+ *     roue folle qui décolle. Après maxConsecutiveRejects rejets de suite, elle est reprise quand même ;
+ *   - la position avance de l'arc parcouru (même modèle que l'Odometry), la covariance suit.
+ *  Le nombre d'opérations est le même à chaque itération, matrices de taille fixe et aucune allocation.
+ *
+ *  L'asserv reste sur l'Odometry : l'estimateur fournit position, vitesses et covariances en plus
+ *  (voir AsservMain::setPoseEstimator()).
+ */
+class PoseEstimator
+{
+public:
+    struct Configuration
+    {
+        float encoderWheelsDistance_mm;     // voie des roues folles
+        float encodermmByTick;              // résolution des roues folles
+        float motorEncodermmByTick;         // résolution nominale des roues motrices
+        float motorWheelsDistance_mm;       // voie nominale des roues motrices, valeur initiale de l'estimation
+        float maxAcceleration;              // mm/s², bruit de modèle sur la vitesse linéaire
+        float maxAngularAcceleration;       // rad/s², bruit de modèle sur la vitesse angulaire
+        float motorSlipRatio;               // écart type relatif des deltas des roues motrices (patinage courant)
+        float motorCalibrationUncertainty;  // écart type initial des facteurs d'échelle des roues motrices (sans unité)
+        float headingRateNoise;             // rad/s, écart type d'une mesure de vitesse angulaire
+        float headingRateBiasUncertainty;   // rad/s, écart type initial du biais du gyromètre
+        float gate;                         // seuil de rejet, en écarts types de l'innovation
+        uint16_t maxConsecutiveRejects;
+    };
+
+    // Sources de mesure, pour les compteurs de rejets
+    enum Source
+    {
+        SOURCE_RIGHT_ENCODER, SOURCE_LEFT_ENCODER, SOURCE_RIGHT_MOTOR_ENCODER, SOURCE_LEFT_MOTOR_ENCODER, SOURCE_HEADING_RATE,
+        SOURCE_COUNT
+    };
+
+    /*
+     * motorEncoders : codeurs des roues motrices, lus à chaque update() (leurs deltas ne doivent pas être consommés ailleurs).
+     *  headingRateSensor est optionnel (nullptr sans gyromètre)
+     */
+    explicit PoseEstimator(Configuration const &configuration, Encoders &motorEncoders,
+            HeadingRateSensor *headingRateSensor = nullptr);
+
+    /*
+     * Une itération, avec les deltas des roues folles (en mm) et la durée deltaT (en s) de la période écoulée
+     */
+    void update(float deltaRight_mm, float deltaLeft_mm, float deltaT);
+
+    // Position connue : la covariance de la position est remise à zéro, la calibration des roues motrices est gardée
+    void setPosition(float X_mm, float Y_mm, float theta_rad);
+    // Retour à l'état initial, calibration comprise
+    void reset();
+    // Voie des roues folles recalibrée (voir OdometryCalibration), à la place de celle de la configuration
+    void setEncoderWheelsDistance(float encoderWheelsDistance_mm);
+
+    float getX() const { return m_X_mm.get(); }
+    float getY() const { return m_Y_mm.get(); }
+    float getTheta() const { return m_theta_rad.get(); }
+    float getSpeed() const { return m_state[SPEED]; }                   // mm/s
+    float getAngularSpeed() const { return m_state[ANGULAR_SPEED]; }    // rad/s
+    float getRightMotorScale() const { return m_state[RIGHT_MOTOR_SCALE]; }
+    float getLeftMotorScale() const { return m_state[LEFT_MOTOR_SCALE]; }
+    float getMotorWheelsDistance() const { return m_state[MOTOR_WHEELS_DISTANCE]; }
+    float getHeadingRateBias() const { return m_state[HEADING_RATE_BIAS]; }
+
+    // Covariance de (X, Y, cap), en mm², mm.rad et rad²
+    void getPoseCovariance(float covariance[3][3]) const;
+
+    uint32_t getRejectCount(Source source) const { return m_rejectCount[source]; }
+
+    /*
+     * Vitesse de patinage de chaque roue motrice à la dernière itération, en mm/s : vitesse vue par son codeur
+     *  (calibration apprise appliquée) moins vitesse au sol de la roue selon les roues folles. Voir SlipDetector
+     */
+    float getRightMotorSlipSpeed() const { return m_motorSlipSpeed[0]; }
+    float getLeftMotorSlipSpeed() const { return m_motorSlipSpeed[1]; }
+
+private:
+    enum StateIndex
+    {
+        X, Y, THETA, SPEED, ANGULAR_SPEED, RIGHT_MOTOR_SCALE, LEFT_MOTOR_SCALE, MOTOR_WHEELS_DISTANCE, HEADING_RATE_BIAS,
+        STATE_SIZE
+    };
+
+    // Modèle à vitesses constantes : seules les vitesses, la calibration et le biais du gyromètre reçoivent du bruit
+    void predictSpeeds(float dt);
+
+    /*
+     * Mise à jour par une mesure scalaire : innovation (mesure - prédiction), ligne de la jacobienne, variance du bruit.
+     *  Renvoie false si la mesure est rejetée
+     */
+    bool correct(Source source, float innovation, float const (&H)[STATE_SIZE], float variance);
+
+    // Avance de la position sur l'arc parcouru aux vitesses estimées, et propagation de la covariance
+    void propagatePose(float dt);
+
+    Configuration const &m_configuration;
+    Encoders &m_motorEncoders;
+    HeadingRateSensor *m_headingRateSensor;
+
+    // Position en sommes compensées (comme l'Odometry), les autres composantes de l'état dans m_state
+    CompensatedSum m_X_mm, m_Y_mm, m_theta_rad;
+    float m_state[STATE_SIZE];
+    float m_covariance[STATE_SIZE][STATE_SIZE];
+
+    float m_encoderVariance;    // bruit de quantification d'un delta de roue folle, en mm²
+    float m_motorEncoderVariance;
+    float m_encoderHalfTrack;
+
+    uint16_t m_consecutiveRejects[SOURCE_COUNT];
+    uint32_t m_rejectCount[SOURCE_COUNT];
+    float m_motorSlipSpeed[2];  // droite, gauche
+};
+
+#endif /* SRC_POSEESTIMATOR_H_ */
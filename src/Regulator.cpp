@@ -2,7 +2,6 @@
 
 Regulator::Regulator(float Kp, float max_output)
 {
-    m_accumulator = 0;
     m_Kp = Kp;
     m_error = 0;
     m_output = 0;
@@ -12,7 +11,7 @@ Regulator::Regulator(float Kp, float max_output)
 
 void Regulator::updateFeedback(float feedback)
 {
-    m_accumulator += feedback;
+    m_accumulator.add(feedback);
 }
 
 /*
@@ -21,8 +20,13 @@ void Regulator::updateFeedback(float feedback)
 
 float Regulator::updateOutput(float goal)
 {
-    m_error = goal - m_accumulator;
-    m_output = m_error * m_Kp;
+    return updateOutput(goal, 0);
+}
+
+float Regulator::updateOutput(float goal, float speedFeedForward)
+{
+    m_error = goal - m_accumulator.get();
+    m_output = m_error * m_Kp + speedFeedForward;
 
     if( !m_enabled) // When this regulator is disabled, just set output to zero
         m_output = 0;
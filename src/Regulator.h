@@ -2,6 +2,7 @@
 #define REGULATOR_H_
 
 #include <cstdint>
+#include "util/CompensatedSum.h"
 
 class Regulator
 {
@@ -12,9 +13,16 @@ public:
     void updateFeedback(float feedback);
     float updateOutput(float goal);
 
+    /*
+     * Sortie avec anticipation : la vitesse de consigne (speedFeedForward, dans l'unité de la sortie)
+     *  est ajoutée à la correction proportionnelle. Le régulateur suit ainsi une consigne qui se déplace
+     *  (profil de vitesse, voir SCurveProfile) sans l'erreur de traînage vitesse/Kp d'un régulateur P seul
+     */
+    float updateOutput(float goal, float speedFeedForward);
+
     float getAccumulator() const
     {
-        return m_accumulator;
+        return m_accumulator.get();
     };
 
     void setGain(float Kp)
@@ -29,7 +37,7 @@ public:
 
     void reset()
     {
-        m_accumulator = 0;
+        m_accumulator.set(0);
     };
 
     float getError() const
@@ -54,7 +62,7 @@ public:
 
 
 private:
-    double m_accumulator;
+    CompensatedSum m_accumulator;
     float m_Kp;
     float m_error;
     float m_output;
@@ -0,0 +1 @@
+../Princess/RobotAsservMain.cpp
\ No newline at end of file
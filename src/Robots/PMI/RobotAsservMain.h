@@ -0,0 +1 @@
+../Princess/RobotAsservMain.h
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include "util/asservMath.h"
 #include "util/chibiOsAllocatorWrapper.h"
 #include "AsservMain.h"
+#include "RobotAsservMain.h"
 #include "commandManager/CommandManager.h"
 #include "SpeedController/SpeedController.h"
 #include "SpeedController/AdaptativeSpeedController.h"
@@ -21,50 +22,10 @@
 #include "AccelerationLimiter/SimpleAccelerationLimiter.h"
 #include "AccelerationLimiter/AdvancedAccelerationLimiter.h"
 #include "Pll.h"
+#include "OdometryCalibration.h"
 
 
-#define ASSERV_THREAD_FREQUENCY (300)
-#define ASSERV_THREAD_PERIOD_S (1.0/ASSERV_THREAD_FREQUENCY)
-#define ASSERV_POSITION_DIVISOR (5)
-
-#define ENCODERS_WHEELS_RADIUS_MM (31.80/2.0)
-#define ENCODERS_WHEELS_DISTANCE_MM (264)
-#define ENCODERS_TICKS_BY_TURN (1440*4)
-
-#define MAX_SPEED_MM_PER_SEC (1500)
-
-#define DIST_REGULATOR_KP (3)
-#define DIST_REGULATOR_MAX_ACC (1300)
-#define DIST_REGULATOR_MIN_ACC (500)
-#define DIST_REGULATOR_HIGH_SPEED_THRESHOLD (400)
-
-#define ANGLE_REGULATOR_KP (700)
-#define ANGLE_REGULATOR_MAX_ACC (1500)
-
-float speed_controller_right_Kp[NB_PI_SUBSET] = { 0.1, 0.1, 0.1};
-float speed_controller_right_Ki[NB_PI_SUBSET] = { 1.0, 0.8, 0.6};
-float speed_controller_right_SpeedRange[NB_PI_SUBSET] = { 20, 50, 60};
-
-float speed_controller_left_Kp[NB_PI_SUBSET] = { 0.1, 0.1, 0.1};
-float speed_controller_left_Ki[NB_PI_SUBSET] = { 1.0, 0.8, 0.6};
-float speed_controller_left_SpeedRange[NB_PI_SUBSET] = { 20, 50, 60};
-
-#define PLL_BANDWIDTH (150)
-
-
-#define COMMAND_MANAGER_ARRIVAL_ANGLE_THRESHOLD_RAD (M_PI/8)
-#define COMMAND_MANAGER_ARRIVAL_DISTANCE_THRESHOLD_mm (5)
-
-#define COMMAND_MANAGER_GOTO_RETURN_THRESHOLD_mm (20)
-#define COMMAND_MANAGER_GOTO_ANGLE_THRESHOLD_RAD (M_PI/8)
-#define COMMAND_MANAGER_GOTO_PRECISE_ARRIVAL_DISTANCE_mm (3)
-Goto::GotoConfiguration preciseGotoConf  = {COMMAND_MANAGER_GOTO_RETURN_THRESHOLD_mm, COMMAND_MANAGER_GOTO_ANGLE_THRESHOLD_RAD, COMMAND_MANAGER_GOTO_PRECISE_ARRIVAL_DISTANCE_mm};
-
-#define COMMAND_MANAGER_GOTO_WAYPOINT_ARRIVAL_DISTANCE_mm (20)
-Goto::GotoConfiguration waypointGotoConf  = {COMMAND_MANAGER_GOTO_RETURN_THRESHOLD_mm, COMMAND_MANAGER_GOTO_ANGLE_THRESHOLD_RAD, COMMAND_MANAGER_GOTO_WAYPOINT_ARRIVAL_DISTANCE_mm};
-
-#define COMMAND_MANAGER_GOTONOSTOP_TOO_BIG_ANGLE_THRESHOLD_RAD (M_PI/2)
-GotoNoStop::GotoNoStopConfiguration gotoNoStopConf = {COMMAND_MANAGER_GOTO_ANGLE_THRESHOLD_RAD, COMMAND_MANAGER_GOTONOSTOP_TOO_BIG_ANGLE_THRESHOLD_RAD, (100/DIST_REGULATOR_KP)};
+#include "robotConfig.h"
 
 Md22::I2cPinInit ESIALCardPinConf_SCL_SDA = {GPIOB, 6, GPIOB, 7};
 QuadratureEncoder::GpioPinInit qeESIALCardPinConf_E1ch1_E1ch2_E2ch1_E2ch2 = {GPIOC, 6, GPIOA, 7, GPIOA, 1, GPIOA, 0};
@@ -89,12 +50,15 @@ AdvancedAccelerationLimiter *distanceAccelerationLimiter;
 
 CommandManager *commandManager;
 AsservMain *mainAsserv;
+SlipDetector *slipDetector;
+OdometryCalibration *odometryCalibration;
 
 
 static void initAsserv()
 {
-    encoders = new QuadratureEncoder(&qeESIALCardPinConf_E1ch1_E1ch2_E2ch1_E2ch2, true, true, true, 1.0, 1.0);
-    md22MotorController = new Md22(&ESIALCardPinConf_SCL_SDA, true, true, true, 100000);
+    encoders = new QuadratureEncoder(&qeESIALCardPinConf_E1ch1_E1ch2_E2ch1_E2ch2, true, true, true);
+    encoders->setGains(ENCODERS_RIGHT_GAIN, ENCODERS_LEFT_GAIN);
+    md22MotorController = new Md22(&ESIALCardPinConf_SCL_SDA, true, true, true, 100000, false);
 
     angleRegulator = new Regulator(ANGLE_REGULATOR_KP, MAX_SPEED_MM_PER_SEC);
     distanceRegulator = new Regulator(DIST_REGULATOR_KP, MAX_SPEED_MM_PER_SEC);
@@ -104,24 +68,31 @@ static void initAsserv()
 
     odometry = new Odometry (ENCODERS_WHEELS_DISTANCE_MM, 0, 0);
 
-    speedControllerRight = new AdaptativeSpeedController(speed_controller_right_Kp, speed_controller_right_Ki, speed_controller_right_SpeedRange, 100, MAX_SPEED_MM_PER_SEC, ASSERV_THREAD_FREQUENCY);
-    speedControllerLeft = new AdaptativeSpeedController(speed_controller_left_Kp, speed_controller_left_Ki, speed_controller_left_SpeedRange, 100, MAX_SPEED_MM_PER_SEC, ASSERV_THREAD_FREQUENCY);
+    speedControllerRight = new AdaptativeSpeedController(speed_controller_right_Kp, speed_controller_right_Ki, speed_controller_right_SpeedRange, 100, MAX_SPEED_MM_PER_SEC);
+    speedControllerLeft = new AdaptativeSpeedController(speed_controller_left_Kp, speed_controller_left_Ki, speed_controller_left_SpeedRange, 100, MAX_SPEED_MM_PER_SEC);
 
 
     angleAccelerationlimiter = new SimpleAccelerationLimiter(ANGLE_REGULATOR_MAX_ACC);
     distanceAccelerationLimiter = new AdvancedAccelerationLimiter(DIST_REGULATOR_MAX_ACC, DIST_REGULATOR_MIN_ACC, DIST_REGULATOR_HIGH_SPEED_THRESHOLD);
 
     commandManager = new CommandManager( COMMAND_MANAGER_ARRIVAL_DISTANCE_THRESHOLD_mm, COMMAND_MANAGER_ARRIVAL_ANGLE_THRESHOLD_RAD,
-                                   preciseGotoConf, waypointGotoConf, gotoNoStopConf,
+                                   preciseGotoConf, waypointGotoConf, gotoNoStopConf, distanceProfileConf, angleProfileConf, distanceBrakeConf, angleBrakeConf,
+                                   lookAheadConf, splinePathConf,
                                    *angleRegulator, *distanceRegulator);
 
-    mainAsserv = new AsservMain( ASSERV_THREAD_FREQUENCY, ASSERV_POSITION_DIVISOR,
+    mainAsserv = new RobotAsservMain( ASSERV_THREAD_FREQUENCY, ASSERV_POSITION_DIVISOR,
                            ENCODERS_WHEELS_RADIUS_MM, ENCODERS_WHEELS_DISTANCE_MM, ENCODERS_TICKS_BY_TURN,
                            *commandManager, *md22MotorController, *encoders, *odometry,
                            *angleRegulator, *distanceRegulator,
                            *angleAccelerationlimiter, *distanceAccelerationLimiter,
                            *speedControllerRight, *speedControllerLeft,
                            *rightPll, *leftPll);
+
+    // Baisse des accélérations quand les roues patinent : commenter ces deux lignes pour s'en passer
+    slipDetector = new SlipDetector(slipDetectorConf);
+    mainAsserv->setSlipDetector(slipDetector);
+
+    odometryCalibration = new OdometryCalibration();
 }
 
 
@@ -133,7 +104,11 @@ static void initAsserv()
  */
 static binary_semaphore_t asservStarted_semaphore;
 
-static THD_WORKING_AREA(waAsservThread, 512);
+/*
+ * Pile de la boucle d'asserv : le démarrage d'une commande SplinePath (calcul de sa table) en est le point le plus
+ *  profond, vers 750 octets avec l'estimateur de position et les profils de vitesse (voir make stack_usage). Large marge.
+ */
+static THD_WORKING_AREA(waAsservThread, 1536);
 static THD_FUNCTION(AsservThread, arg)
 {
     (void) arg;
@@ -262,6 +237,12 @@ void asservCommandUSB(BaseSequentialStream *chp, int argc, char **argv)
         chprintf(outputStream," -------------- \r\n");
         chprintf(outputStream," - asserv addgoto X Y\r\n");
         chprintf(outputStream," - asserv gototest\r\n");
+        chprintf(outputStream," - asserv profiler [reset]\r\n");
+        chprintf(outputStream," - asserv deadlines [reset]\r\n");
+        chprintf(outputStream," - asserv loopfreq [Hz]\r\n");
+        chprintf(outputStream," - asserv slip\r\n");
+        chprintf(outputStream," - asserv umbmark square L cw|ccw / error cw|ccw X Y / solve|apply [scale] / clear\r\n");
+        chprintf(outputStream," - asserv md22stats [reset]\r\n");
     };
     (void) chp;
 
@@ -331,13 +312,13 @@ void asservCommandUSB(BaseSequentialStream *chp, int argc, char **argv)
         int32_t deltaAngle = startAngle - (encoderRightEnd-encoderLeftEnd);
 
         float factor = float(deltaAngle) / float(deltaDistance);
-        float leftGain = (1. + factor) * encoders->getLeftEncoderGain();
-        float rightGain = (1. - factor) * encoders->getRightEncoderGain();
+        float leftGain = (1. + factor) * encoders->getLeftGain();
+        float rightGain = (1. - factor) * encoders->getRightGain();
 
         chprintf(outputStream, "Wheel Calibration done with travel dist : %d step, delta %d steps \r\n", deltaDistance, deltaAngle);
         chprintf(outputStream, "Suggested factors :\n");
-        chprintf(outputStream, "Left : %.8f (old gain was %f)\n", leftGain, encoders->getLeftEncoderGain());
-        chprintf(outputStream, "Right : %.8f (old gain was %f)\n", rightGain, encoders->getRightEncoderGain());
+        chprintf(outputStream, "Left : %.8f (old gain was %f)\n", leftGain, encoders->getLeftGain());
+        chprintf(outputStream, "Right : %.8f (old gain was %f)\n", rightGain, encoders->getRightGain());
 
     }
     else if (!strcmp(argv[0], "wheelspeedstep"))
@@ -566,6 +547,137 @@ void asservCommandUSB(BaseSequentialStream *chp, int argc, char **argv)
 
 
 
+    }
+    else if (!strcmp(argv[0], "profiler"))
+    {
+#ifdef ENABLE_LOOP_PROFILER
+        if (argc > 1 && !strcmp(argv[1], "reset"))
+        {
+            chprintf(outputStream, "Loop profiler reset\r\n");
+            mainAsserv->getProfiler().requestReset();
+        }
+        else
+        {
+            mainAsserv->getProfiler().print(outputStream);
+        }
+#else
+        chprintf(outputStream, "Loop profiler not compiled, use make PROFILER_ENABLE=true\r\n");
+#endif
+    }
+    else if (!strcmp(argv[0], "deadlines"))
+    {
+        if (argc > 1 && !strcmp(argv[1], "reset"))
+        {
+            chprintf(outputStream, "Deadline stats reset\r\n");
+            mainAsserv->resetDeadlineStats();
+        }
+        else
+        {
+            chprintf(outputStream, "missed deadlines : %u\r\n", (unsigned int) mainAsserv->getDeadlineMisses());
+            chprintf(outputStream, "worst lateness : %u us\r\n", (unsigned int) mainAsserv->getWorstDeadlineLateness_us());
+            chprintf(outputStream, "min slack : %u us\r\n", (unsigned int) mainAsserv->getMinDeadlineSlack_us());
+            chprintf(outputStream, "telemetry mode : %d (0 full, 1 throttled, 2 off)\r\n", mainAsserv->getTelemetryMode());
+
+            LoopTimer &loopTimer = mainAsserv->getLoopTimer();
+            chprintf(outputStream, "loop timer : %u ticks at %u Hz, %u missed\r\n", (unsigned int) loopTimer.getTicks(),
+                    loopTimer.getFrequency(), (unsigned int) loopTimer.getMissedTicks());
+            chprintf(outputStream, "period : mean %.3f us, min %.3f us, max %.3f us, jitter %.3f us\r\n", loopTimer.getMeanPeriod_us(),
+                    loopTimer.getMinPeriod_us(), loopTimer.getMaxPeriod_us(), loopTimer.getMaxJitter_us());
+            chprintf(outputStream, "max wake latency : %.3f us\r\n", loopTimer.getMaxWakeLatency_us());
+        }
+    }
+    else if (!strcmp(argv[0], "loopfreq"))
+    {
+        // La LoopTimer compte au plus 65535 us par période, et une itération doit tenir dans la période
+        if (argc > 1 && atoi(argv[1]) >= 16 && atoi(argv[1]) <= 1000)
+        {
+            mainAsserv->setLoopFrequency(atoi(argv[1]));
+            chprintf(outputStream, "Loop frequency set to %u Hz\r\n", mainAsserv->getLoopFrequency());
+        }
+        else
+        {
+            chprintf(outputStream, "Loop frequency : %u Hz (16 to 1000 Hz)\r\n", mainAsserv->getLoopFrequency());
+        }
+    }
+    else if (!strcmp(argv[0], "slip"))
+    {
+        if (slipDetector == nullptr)
+        {
+            chprintf(outputStream, "Slip detector not enabled\r\n");
+        }
+        else
+        {
+            chprintf(outputStream, "slip events : %u\r\n", (unsigned int) slipDetector->getSlipEvents());
+            chprintf(outputStream, "acceleration scale : %.2f%s\r\n", slipDetector->getAccelerationScale(),
+                    slipDetector->isSlipping() ? " (slipping)" : "");
+        }
+    }
+    else if (!strcmp(argv[0], "md22stats"))
+    {
+        if (argc > 1 && !strcmp(argv[1], "reset"))
+        {
+            chprintf(outputStream, "Md22 stats reset\r\n");
+            md22MotorController->resetWriteStats();
+        }
+        else
+        {
+            // Ecriture synchrone : seules les transactions I2C ratées sont comptées
+            Md22::WriteStats stats = md22MotorController->getWriteStats();
+            chprintf(outputStream, "i2c failed tries %u\r\n", (unsigned int) stats.failedTries);
+        }
+    }
+    else if (!strcmp(argv[0], "umbmark"))
+    {
+        // Calibration de l'odométrie : carrés dans les deux sens, écarts mesurés à la main au retour (voir OdometryCalibration)
+        if (argc > 3 && !strcmp(argv[1], "square"))
+        {
+            float side = atof(argv[2]);
+            bool clockwise = !strcmp(argv[3], "cw");
+            chprintf(outputStream, "Adding %s square of %.0f mm from (0, 0, 0)\r\n", clockwise ? "clockwise" : "counterclockwise", side);
+
+            mainAsserv->resetToNormalMode();
+            mainAsserv->setPosition(0, 0, 0);
+            if (!odometryCalibration->addSquare(*commandManager, side, clockwise))
+                chprintf(outputStream, "Command list full\r\n");
+        }
+        else if (argc > 4 && !strcmp(argv[1], "error"))
+        {
+            // Position réelle mesurée dans le repère de départ, moins l'odométrie
+            bool clockwise = !strcmp(argv[2], "cw");
+            float errorX = float(atof(argv[3])) - odometry->getX();
+            float errorY = float(atof(argv[4])) - odometry->getY();
+            odometryCalibration->addRun(clockwise, errorX, errorY);
+            chprintf(outputStream, "%s error X %.2f mm Y %.2f mm, runs cw %u ccw %u\r\n", clockwise ? "cw" : "ccw", errorX, errorY,
+                    (unsigned int) odometryCalibration->getRunCount(true), (unsigned int) odometryCalibration->getRunCount(false));
+        }
+        else if (argc > 1 && (!strcmp(argv[1], "solve") || !strcmp(argv[1], "apply")))
+        {
+            float distanceScale = (argc > 2) ? float(atof(argv[2])) : 1.0f;
+            OdometryCalibration::Result result;
+            if (!odometryCalibration->solve(encoders->getRightGain(), encoders->getLeftGain(), mainAsserv->getEncoderWheelsDistance(),
+                    distanceScale, &result))
+            {
+                chprintf(outputStream, "No solution : measure both directions first\r\n");
+            }
+            else
+            {
+                chprintf(outputStream, "#define ENCODERS_WHEELS_DISTANCE_MM (%.3f)\r\n", result.wheelsDistance_mm);
+                chprintf(outputStream, "#define ENCODERS_RIGHT_GAIN (%.6f)\r\n", result.rightGain);
+                chprintf(outputStream, "#define ENCODERS_LEFT_GAIN (%.6f)\r\n", result.leftGain);
+                chprintf(outputStream, "residual : %.2f mm\r\n", result.residual_mm);
+                if (!strcmp(argv[1], "apply"))
+                {
+                    mainAsserv->setOdometryCalibration(result.rightGain, result.leftGain, result.wheelsDistance_mm);
+                    odometryCalibration->clearRuns();
+                    chprintf(outputStream, "Applied, measures cleared\r\n");
+                }
+            }
+        }
+        else if (argc > 1 && !strcmp(argv[1], "clear"))
+        {
+            odometryCalibration->clearRuns();
+            chprintf(outputStream, "Measures cleared\r\n");
+        }
     }
     else if (!strcmp(argv[0], "get_config"))
     {
@@ -0,0 +1,130 @@
+#ifndef ROBOTS_PMI_ROBOTCONFIG_H_
+#define ROBOTS_PMI_ROBOTCONFIG_H_
+
+/*
+ * Reglages de l'asserv du robot PMI.
+ *  Partagés entre le firmware (main.cpp) et les outils host (voir host/)
+ *  Les tables de réglage sont static constexpr : chaque unité de compilation qui
+ *  inclut ce fichier a sa propre copie, sans définition globale en double.
+ */
+
+#include "util/asservMath.h"
+#include "SpeedController/AdaptativeSpeedController.h"
+#include "commandManager/Commands/Goto.h"
+#include "commandManager/Commands/GotoNoStop.h"
+#include "commandManager/SCurveProfile.h"
+#include "commandManager/LookAheadPlanner.h"
+#include "commandManager/Commands/SplinePath.h"
+#include "SlipDetector.h"
+#include "VelocityEstimator/AdaptivePll.h"
+#include "VelocityEstimator/KalmanVelocityEstimator.h"
+
+#define ASSERV_THREAD_FREQUENCY (300)
+#define ASSERV_THREAD_PERIOD_S (1.0/ASSERV_THREAD_FREQUENCY)
+#define ASSERV_POSITION_DIVISOR (5)
+
+#define ENCODERS_WHEELS_RADIUS_MM (31.80/2.0)
+#define ENCODERS_WHEELS_DISTANCE_MM (264)
+#define ENCODERS_TICKS_BY_TURN (1440*4)
+// Gains par roue codeuse (écarts de rayon) et voie ci-dessus : donnés par "asserv umbmark apply"
+#define ENCODERS_RIGHT_GAIN (1.0)
+#define ENCODERS_LEFT_GAIN (1.0)
+
+#define MAX_SPEED_MM_PER_SEC (1500)
+
+#define DIST_REGULATOR_KP (3)
+#define DIST_REGULATOR_MAX_ACC (1300)
+#define DIST_REGULATOR_MIN_ACC (500)
+#define DIST_REGULATOR_HIGH_SPEED_THRESHOLD (400)
+
+#define ANGLE_REGULATOR_KP (700)
+#define ANGLE_REGULATOR_MAX_ACC (1500)
+// Accélération angulaire du robot (rad/s²) quand chaque roue est à ANGLE_REGULATOR_MAX_ACC
+#define ANGLE_REGULATOR_MAX_ANGULAR_ACC (ANGLE_REGULATOR_MAX_ACC / (ENCODERS_WHEELS_DISTANCE_MM/2.0f))
+
+static constexpr float speed_controller_right_Kp[NB_PI_SUBSET] = { 0.1, 0.1, 0.1};
+static constexpr float speed_controller_right_Ki[NB_PI_SUBSET] = { 1.0, 0.8, 0.6};
+static constexpr float speed_controller_right_SpeedRange[NB_PI_SUBSET] = { 20, 50, 60};
+
+static constexpr float speed_controller_left_Kp[NB_PI_SUBSET] = { 0.1, 0.1, 0.1};
+static constexpr float speed_controller_left_Ki[NB_PI_SUBSET] = { 1.0, 0.8, 0.6};
+static constexpr float speed_controller_left_SpeedRange[NB_PI_SUBSET] = { 20, 50, 60};
+
+#define PLL_BANDWIDTH (150)
+
+// Estimateurs de vitesse à la place de la Pll (voir src/VelocityEstimator et RobotAsservMain.h), vitesses en ticks
+#define VELOCITY_ESTIMATOR_TICKS_BY_MM (ENCODERS_TICKS_BY_TURN / (2.0 * M_PI * ENCODERS_WHEELS_RADIUS_MM))
+#define ADAPTIVE_PLL_MIN_BANDWIDTH (PLL_BANDWIDTH / 3.0)
+#define ADAPTIVE_PLL_MAX_BANDWIDTH (PLL_BANDWIDTH)
+#define ADAPTIVE_PLL_MAX_BANDWIDTH_SPEED_MM_PER_SEC (100)
+static constexpr AdaptivePll::Configuration adaptivePllConf = {ADAPTIVE_PLL_MIN_BANDWIDTH, ADAPTIVE_PLL_MAX_BANDWIDTH,
+        ADAPTIVE_PLL_MAX_BANDWIDTH_SPEED_MM_PER_SEC * VELOCITY_ESTIMATOR_TICKS_BY_MM};
+#define KALMAN_VELOCITY_JERK_MM_PER_SEC3 (50000)
+#define KALMAN_VELOCITY_MEASUREMENT_NOISE_TICKS (0.5)
+static constexpr KalmanVelocityEstimator::Configuration kalmanVelocityConf = {ASSERV_THREAD_PERIOD_S,
+        KALMAN_VELOCITY_JERK_MM_PER_SEC3 * VELOCITY_ESTIMATOR_TICKS_BY_MM, KALMAN_VELOCITY_MEASUREMENT_NOISE_TICKS};
+
+
+#define COMMAND_MANAGER_ARRIVAL_ANGLE_THRESHOLD_RAD (M_PI/8)
+#define COMMAND_MANAGER_ARRIVAL_DISTANCE_THRESHOLD_mm (5)
+
+#define COMMAND_MANAGER_GOTO_RETURN_THRESHOLD_mm (20)
+#define COMMAND_MANAGER_GOTO_ANGLE_THRESHOLD_RAD (M_PI/8)
+#define COMMAND_MANAGER_GOTO_PRECISE_ARRIVAL_DISTANCE_mm (3)
+static constexpr Goto::GotoConfiguration preciseGotoConf  = {COMMAND_MANAGER_GOTO_RETURN_THRESHOLD_mm, COMMAND_MANAGER_GOTO_ANGLE_THRESHOLD_RAD, COMMAND_MANAGER_GOTO_PRECISE_ARRIVAL_DISTANCE_mm};
+
+#define COMMAND_MANAGER_GOTO_WAYPOINT_ARRIVAL_DISTANCE_mm (20)
+static constexpr Goto::GotoConfiguration waypointGotoConf  = {COMMAND_MANAGER_GOTO_RETURN_THRESHOLD_mm, COMMAND_MANAGER_GOTO_ANGLE_THRESHOLD_RAD, COMMAND_MANAGER_GOTO_WAYPOINT_ARRIVAL_DISTANCE_mm};
+
+#define COMMAND_MANAGER_GOTONOSTOP_TOO_BIG_ANGLE_THRESHOLD_RAD (M_PI/2)
+static constexpr GotoNoStop::GotoNoStopConfiguration gotoNoStopConf = {COMMAND_MANAGER_GOTO_ANGLE_THRESHOLD_RAD, COMMAND_MANAGER_GOTONOSTOP_TOO_BIG_ANGLE_THRESHOLD_RAD, (100/DIST_REGULATOR_KP)};
+
+// Profils de vitesse en S des lignes droites (mm) et des rotations (rad), voir SCurveProfile
+//  Réglés sur robot simulé avec l'outil host profileBench. Pendant un profil, les limiteurs d'accélération ne bornent plus
+//  que la correction de l'asserv en position (voir AccelerationLimiter::limitProfileSpeed) : les profils prennent
+//  PROFILE_ACCELERATION_SHARE des accélérations max des régulateurs (l'angulaire sur chaque roue), le reste est pour la correction
+#define PROFILE_ACCELERATION_SHARE (0.8f)
+#define DIST_PROFILE_MAX_SPEED_MM_PER_SEC (1200)
+#define DIST_PROFILE_MAX_ACC (DIST_REGULATOR_MAX_ACC * PROFILE_ACCELERATION_SHARE)
+#define DIST_PROFILE_MAX_JERK (10000)
+#define ANGLE_PROFILE_MAX_SPEED_RAD_PER_SEC (6)
+#define ANGLE_PROFILE_MAX_ACC (ANGLE_REGULATOR_MAX_ANGULAR_ACC * PROFILE_ACCELERATION_SHARE)
+#define ANGLE_PROFILE_MAX_JERK (1000)
+#define PROFILE_SAMPLE_PERIOD_S (ASSERV_POSITION_DIVISOR * ASSERV_THREAD_PERIOD_S)
+// Avances des vitesses d'anticipation, pour le retard de l'asserv en vitesse (voir SCurveProfile::getFeedForward)
+#define DIST_PROFILE_ACCELERATION_FEEDFORWARD_S (0.1)
+#define ANGLE_PROFILE_ACCELERATION_FEEDFORWARD_S (0.1)
+static constexpr SCurveProfile::Configuration distanceProfileConf = {DIST_PROFILE_MAX_SPEED_MM_PER_SEC, DIST_PROFILE_MAX_ACC, DIST_PROFILE_MAX_JERK, DIST_PROFILE_ACCELERATION_FEEDFORWARD_S};
+static constexpr SCurveProfile::Configuration angleProfileConf = {ANGLE_PROFILE_MAX_SPEED_RAD_PER_SEC, ANGLE_PROFILE_MAX_ACC, ANGLE_PROFILE_MAX_JERK, ANGLE_PROFILE_ACCELERATION_FEEDFORWARD_S};
+// Freinage de la pause (CommandManager::pause) : sans la marge des profils, aux accélérations max des régulateurs, avec le jerk des profils
+static constexpr SCurveProfile::Configuration distanceBrakeConf = {DIST_PROFILE_MAX_SPEED_MM_PER_SEC, DIST_REGULATOR_MAX_ACC, DIST_PROFILE_MAX_JERK, DIST_PROFILE_ACCELERATION_FEEDFORWARD_S};
+static constexpr SCurveProfile::Configuration angleBrakeConf = {ANGLE_PROFILE_MAX_SPEED_RAD_PER_SEC, ANGLE_REGULATOR_MAX_ANGULAR_ACC, ANGLE_PROFILE_MAX_JERK, ANGLE_PROFILE_ACCELERATION_FEEDFORWARD_S};
+
+// Vitesses de passage des suites de Goto/GotoNoStop, voir LookAheadPlanner. Réglées sur robot simulé avec l'outil host lookAheadBench
+#define LOOKAHEAD_MAX_ACC (DIST_REGULATOR_MAX_ACC)
+// Le virage d'un Goto suit le régulateur d'angle (proportionnel) : plus lent que le virage à accélération max que modélise le planificateur
+#define LOOKAHEAD_MAX_ANGULAR_ACC (ANGLE_REGULATOR_MAX_ANGULAR_ACC * 0.5f)
+#define LOOKAHEAD_MAX_LATERAL_ACC (1000)
+#define LOOKAHEAD_JUNCTION_DEVIATION_MM (30)
+static constexpr LookAheadPlanner::Configuration lookAheadConf = {MAX_SPEED_MM_PER_SEC, LOOKAHEAD_MAX_ACC, LOOKAHEAD_MAX_ANGULAR_ACC, LOOKAHEAD_MAX_LATERAL_ACC, LOOKAHEAD_JUNCTION_DEVIATION_MM, PROFILE_SAMPLE_PERIOD_S};
+
+// Suivi de courbe (SplinePath) : accélération latérale max dans les virages, gains de Ramsete, avance prise sur la courbure. Réglés sur robot simulé avec l'outil host splineBench
+#define SPLINE_MAX_LATERAL_ACC (1000)
+#define SPLINE_RAMSETE_B (1e-4)
+#define SPLINE_RAMSETE_ZETA (0.7)
+#define SPLINE_ANTICIPATION_S (0.05)
+static constexpr SplinePath::Configuration splinePathConf = {MAX_SPEED_MM_PER_SEC, LOOKAHEAD_MAX_ACC, SPLINE_MAX_LATERAL_ACC, ANGLE_REGULATOR_MAX_ANGULAR_ACC, SPLINE_RAMSETE_B, SPLINE_RAMSETE_ZETA, SPLINE_ANTICIPATION_S,
+        ENCODERS_WHEELS_DISTANCE_MM, COMMAND_MANAGER_GOTO_ANGLE_THRESHOLD_RAD, COMMAND_MANAGER_GOTO_RETURN_THRESHOLD_mm, COMMAND_MANAGER_ARRIVAL_DISTANCE_THRESHOLD_mm};
+
+// Détection du patinage (SlipDetector) : les accélérations des limiteurs baissent quand les roues ne suivent plus leur consigne,
+//  puis remontent. Réglée sur robot simulé avec l'outil host slipBench
+#define SLIP_DETECTOR_TRACKING_ERROR_MM_PER_SEC (250)
+#define SLIP_DETECTOR_MOTOR_SLIP_MM_PER_SEC (50)
+#define SLIP_DETECTOR_ITERATIONS (ASSERV_THREAD_FREQUENCY / 50)
+#define SLIP_DETECTOR_ACCELERATION_DROP (0.7)
+#define SLIP_DETECTOR_MIN_ACCELERATION_SCALE (0.3)
+#define SLIP_DETECTOR_RECOVERY_PER_SEC (0.2)
+static constexpr SlipDetector::Configuration slipDetectorConf = {SLIP_DETECTOR_TRACKING_ERROR_MM_PER_SEC, SLIP_DETECTOR_MOTOR_SLIP_MM_PER_SEC, SLIP_DETECTOR_ITERATIONS,
+        SLIP_DETECTOR_ACCELERATION_DROP, SLIP_DETECTOR_MIN_ACCELERATION_SCALE, SLIP_DETECTOR_RECOVERY_PER_SEC};
+
+#endif /* ROBOTS_PMI_ROBOTCONFIG_H_ */
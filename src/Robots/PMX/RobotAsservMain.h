@@ -0,0 +1,25 @@
+#ifndef SRC_ROBOTS_PMX_ROBOTASSERVMAIN_H_
+#define SRC_ROBOTS_PMX_ROBOTASSERVMAIN_H_
+
+/*
+ * Types concrets de la chaîne de contrôle du robot PMX.
+ *  Doit rester cohérent avec les objets créés dans main.cpp.
+ *  Les estimateurs de vitesse sont des Pll (type par défaut) : pour un AdaptivePll ou un KalmanVelocityEstimator,
+ *  l'ajouter en dernier type ici et dans RobotAsservMain.cpp, et créer ces objets dans main.cpp (adaptivePllConf,
+ *  kalmanVelocityConf du robotConfig.h).
+ */
+#include "ComposedAsservMain.h"
+#include "Encoders/MagEncoders.h"
+#include "motorController/Md22.h"
+#include "SpeedController/AdaptativeSpeedController.h"
+#include "AccelerationLimiter/SimpleAccelerationLimiter.h"
+#include "AccelerationLimiter/AdvancedAccelerationLimiter.h"
+
+typedef ComposedAsservMain<MagEncoders, Md22, AdaptativeSpeedController,
+        SimpleAccelerationLimiter, AdvancedAccelerationLimiter> RobotAsservMain;
+
+// Instanciée une seule fois dans RobotAsservMain.cpp, qui fait partie des unités vérifiées par check_double
+extern template class ComposedAsservMain<MagEncoders, Md22, AdaptativeSpeedController,
+        SimpleAccelerationLimiter, AdvancedAccelerationLimiter>;
+
+#endif /* SRC_ROBOTS_PMX_ROBOTASSERVMAIN_H_ */
@@ -11,6 +11,7 @@
 #include "util/asservMath.h"
 #include "util/chibiOsAllocatorWrapper.h"
 #include "AsservMain.h"
+#include "RobotAsservMain.h"
 #include "commandManager/CommandManager.h"
 #include "SpeedController/SpeedController.h"
 #include "SpeedController/AdaptativeSpeedController.h"
@@ -21,53 +22,12 @@
 #include "AccelerationLimiter/SimpleAccelerationLimiter.h"
 #include "AccelerationLimiter/AdvancedAccelerationLimiter.h"
 #include "Pll.h"
+#include "OdometryCalibration.h"
 #include "Encoders/MagEncoders.h"
 
 #define ENABLE_SHELL
 
-#define ASSERV_THREAD_FREQUENCY (200) //200=>5ms 300=>3ms
-#define ASSERV_THREAD_PERIOD_S (1.0/ASSERV_THREAD_FREQUENCY)
-#define ASSERV_POSITION_DIVISOR (5)
-
-#define ENCODERS_WHEELS_RADIUS_MM (39.93/2.0) // le rayon de vos roues codeuses 39.88, 39.93
-#define ENCODERS_WHEELS_DISTANCE_MM (234.4) //distance entre les 2 roues codeuses
-#define ENCODERS_TICKS_BY_TURN (16384) //nombre de ticks par tour de vos encodeurs.
-
-#define MAX_SPEED_MM_PER_SEC (1500)
-
-#define DIST_REGULATOR_KP (1.95)
-#define DIST_REGULATOR_MAX_ACC (900)
-#define DIST_REGULATOR_MIN_ACC (500)
-#define DIST_REGULATOR_HIGH_SPEED_THRESHOLD (500)
-
-
-#define ANGLE_REGULATOR_KP (400) //480
-#define ANGLE_REGULATOR_MAX_ACC (900)
-
-float speed_controller_right_Kp[NB_PI_SUBSET] = { 0.3, 0.2, 0.1};
-float speed_controller_right_Ki[NB_PI_SUBSET] = { 3.0, 4.2, 1.5};
-float speed_controller_right_SpeedRange[NB_PI_SUBSET] = { 20, 50, 60};
-
-float speed_controller_left_Kp[NB_PI_SUBSET] = { 0.3, 0.2, 0.1}; //0.08
-float speed_controller_left_Ki[NB_PI_SUBSET] = { 3.0, 4.2, 1.5}; //1.0
-float speed_controller_left_SpeedRange[NB_PI_SUBSET] = { 20, 50, 60};
-
-#define PLL_BANDWIDTH (100) //verifpour garder un minimum de variation sur la vitesse
-
-
-#define COMMAND_MANAGER_ARRIVAL_ANGLE_THRESHOLD_RAD (0.02)
-#define COMMAND_MANAGER_ARRIVAL_DISTANCE_THRESHOLD_mm (2.5)
-
-#define COMMAND_MANAGER_GOTO_RETURN_THRESHOLD_mm (20)
-#define COMMAND_MANAGER_GOTO_ANGLE_THRESHOLD_RAD (M_PI/8)
-#define COMMAND_MANAGER_GOTO_PRECISE_ARRIVAL_DISTANCE_mm (3)
-Goto::GotoConfiguration preciseGotoConf  = {COMMAND_MANAGER_GOTO_RETURN_THRESHOLD_mm, COMMAND_MANAGER_GOTO_ANGLE_THRESHOLD_RAD, COMMAND_MANAGER_GOTO_PRECISE_ARRIVAL_DISTANCE_mm};
-
-#define COMMAND_MANAGER_GOTO_WAYPOINT_ARRIVAL_DISTANCE_mm (20)
-Goto::GotoConfiguration waypointGotoConf  = {COMMAND_MANAGER_GOTO_RETURN_THRESHOLD_mm, COMMAND_MANAGER_GOTO_ANGLE_THRESHOLD_RAD, COMMAND_MANAGER_GOTO_WAYPOINT_ARRIVAL_DISTANCE_mm};
-
-#define COMMAND_MANAGER_GOTONOSTOP_TOO_BIG_ANGLE_THRESHOLD_RAD (M_PI/2)
-GotoNoStop::GotoNoStopConfiguration gotoNoStopConf = {COMMAND_MANAGER_GOTO_ANGLE_THRESHOLD_RAD, COMMAND_MANAGER_GOTONOSTOP_TOO_BIG_ANGLE_THRESHOLD_RAD, (100/DIST_REGULATOR_KP)};
+#include "robotConfig.h"
 
 Md22::I2cPinInit md22PMXCardPinConf_SCL_SDA = {GPIOB, 6, GPIOB, 7};
 QuadratureEncoder::GpioPinInit qePMXCardPinConf_E1ch1_E1ch2_E2ch1_E2ch2 = {GPIOC, 6, GPIOA, 7, GPIOA, 5, GPIOB, 9};
@@ -93,13 +53,17 @@ AdvancedAccelerationLimiter *distanceAccelerationLimiter;
 
 CommandManager *commandManager;
 AsservMain *mainAsserv;
+SlipDetector *slipDetector;
+OdometryCalibration *odometryCalibration;
+PoseEstimator *poseEstimator;
 
 
 static void initAsserv()
 {
-    md22MotorController= new Md22(&md22PMXCardPinConf_SCL_SDA, false, false, false, 400000); //100k ou 400k
+    md22MotorController= new Md22(&md22PMXCardPinConf_SCL_SDA, false, false, false, 400000, true); //100k ou 400k, écriture asynchrone
     encoders = new QuadratureEncoder(&qePMXCardPinConf_E1ch1_E1ch2_E2ch1_E2ch2, false, true, false);
-    encoders_ext = new MagEncoders(false, false, true);
+    encoders_ext = new MagEncoders(false, false, true, true); // acquisition pipelinée, lancée après l'écriture moteur
+    encoders_ext->setGains(ENCODERS_RIGHT_GAIN, ENCODERS_LEFT_GAIN);
 
 
     angleRegulator = new Regulator(ANGLE_REGULATOR_KP, MAX_SPEED_MM_PER_SEC);
@@ -110,18 +74,19 @@ static void initAsserv()
 
     odometry = new Odometry (ENCODERS_WHEELS_DISTANCE_MM, 0, 0);
 
-    speedControllerRight = new AdaptativeSpeedController(speed_controller_right_Kp, speed_controller_right_Ki, speed_controller_right_SpeedRange, 100, MAX_SPEED_MM_PER_SEC, ASSERV_THREAD_FREQUENCY);
-    speedControllerLeft = new AdaptativeSpeedController(speed_controller_left_Kp, speed_controller_left_Ki, speed_controller_left_SpeedRange, 100, MAX_SPEED_MM_PER_SEC, ASSERV_THREAD_FREQUENCY);
+    speedControllerRight = new AdaptativeSpeedController(speed_controller_right_Kp, speed_controller_right_Ki, speed_controller_right_SpeedRange, 100, MAX_SPEED_MM_PER_SEC);
+    speedControllerLeft = new AdaptativeSpeedController(speed_controller_left_Kp, speed_controller_left_Ki, speed_controller_left_SpeedRange, 100, MAX_SPEED_MM_PER_SEC);
 
 
     angleAccelerationlimiter = new SimpleAccelerationLimiter(ANGLE_REGULATOR_MAX_ACC);
     distanceAccelerationLimiter = new AdvancedAccelerationLimiter(DIST_REGULATOR_MAX_ACC, DIST_REGULATOR_MIN_ACC, DIST_REGULATOR_HIGH_SPEED_THRESHOLD);
 
     commandManager = new CommandManager( COMMAND_MANAGER_ARRIVAL_DISTANCE_THRESHOLD_mm, COMMAND_MANAGER_ARRIVAL_ANGLE_THRESHOLD_RAD,
-                                   preciseGotoConf, waypointGotoConf, gotoNoStopConf,
+                                   preciseGotoConf, waypointGotoConf, gotoNoStopConf, distanceProfileConf, angleProfileConf, distanceBrakeConf, angleBrakeConf,
+                                   lookAheadConf, splinePathConf,
                                    *angleRegulator, *distanceRegulator);
 
-    mainAsserv = new AsservMain( ASSERV_THREAD_FREQUENCY, ASSERV_POSITION_DIVISOR,
+    mainAsserv = new RobotAsservMain( ASSERV_THREAD_FREQUENCY, ASSERV_POSITION_DIVISOR,
                            ENCODERS_WHEELS_RADIUS_MM, ENCODERS_WHEELS_DISTANCE_MM, ENCODERS_TICKS_BY_TURN,
                            *commandManager, *md22MotorController, *encoders_ext, *odometry,
                            *angleRegulator, *distanceRegulator,
@@ -129,6 +94,15 @@ static void initAsserv()
                            *speedControllerRight, *speedControllerLeft,
                            *rightPll, *leftPll);
 
+    // Baisse des accélérations quand les roues patinent : commenter ces deux lignes pour s'en passer
+    slipDetector = new SlipDetector(slipDetectorConf);
+    mainAsserv->setSlipDetector(slipDetector);
+
+    odometryCalibration = new OdometryCalibration();
+
+    // Estimation de position avec les codeurs des roues motrices en plus : commenter ces deux lignes pour s'en passer
+    poseEstimator = new PoseEstimator(poseEstimatorConf, *encoders);
+    mainAsserv->setPoseEstimator(poseEstimator);
 
 }
 
@@ -143,7 +117,11 @@ BaseSequentialStream *outputStreamSd4;
  */
 static binary_semaphore_t asservStarted_semaphore;
 
-static THD_WORKING_AREA(waAsservThread, 512);
+/*
+ * Pile de la boucle d'asserv : le démarrage d'une commande SplinePath (calcul de sa table) en est le point le plus
+ *  profond, vers 750 octets avec l'estimateur de position et les profils de vitesse (voir make stack_usage). Large marge.
+ */
+static THD_WORKING_AREA(waAsservThread, 1536);
 static THD_FUNCTION(AsservThread, arg)
 {
     (void) arg;
@@ -289,6 +267,7 @@ void asservCommandUSB(BaseSequentialStream *chp, int argc, char **argv)
         chprintf(outputStream," - asserv enablepolar 0|1\r\n");
         chprintf(outputStream," - asserv coders \r\n");
         chprintf(outputStream," - asserv ext (coders) \r\n");
+        chprintf(outputStream," - asserv pose \r\n");
         chprintf(outputStream," - asserv reset \r\n");
         chprintf(outputStream," - asserv motorspeed [r|l] speed \r\n");
         chprintf(outputStream," -------------- \r\n");
@@ -310,6 +289,13 @@ void asservCommandUSB(BaseSequentialStream *chp, int argc, char **argv)
         chprintf(outputStream," -------------- \r\n");
         chprintf(outputStream," - asserv addgoto X Y\r\n");
         chprintf(outputStream," - asserv gototest\r\n");
+        chprintf(outputStream," - asserv profiler [reset]\r\n");
+        chprintf(outputStream," - asserv deadlines [reset]\r\n");
+        chprintf(outputStream," - asserv loopfreq [Hz]\r\n");
+        chprintf(outputStream," - asserv slip\r\n");
+        chprintf(outputStream," - asserv umbmark square L cw|ccw / error cw|ccw X Y / solve|apply [scale] / clear\r\n");
+        chprintf(outputStream," - asserv md22stats [reset]\r\n");
+        chprintf(outputStream," - asserv magstats [reset]\r\n");
     };
     (void) chp;
 
@@ -441,9 +427,13 @@ void asservCommandUSB(BaseSequentialStream *chp, int argc, char **argv)
     }
     else if (!strcmp(argv[0], "coders"))
     {
-        float deltaEncoderRight;
-        float deltaEncoderLeft;
-        encoders->getValues(&deltaEncoderRight, &deltaEncoderLeft);
+        // Avec le PoseEstimator, c'est lui qui lit les deltas des codeurs moteurs
+        if (poseEstimator == nullptr)
+        {
+            float deltaEncoderRight;
+            float deltaEncoderLeft;
+            encoders->getValues(&deltaEncoderRight, &deltaEncoderLeft);
+        }
         chprintf(outputStream, "Encoders count R %d L %d \r\n", encoders->getRightEncoderTotalCount(), encoders->getLeftEncoderTotalCount());
 
     }
@@ -456,6 +446,26 @@ void asservCommandUSB(BaseSequentialStream *chp, int argc, char **argv)
             encoders_ext->getEncodersTotalCount(&encoderRight, &encoderLeft);
             chprintf(outputStream, "Encoders count R %d  L %d \r\n", encoderRight, encoderLeft);
         }
+    else if (!strcmp(argv[0], "pose"))
+    {
+        if (poseEstimator == nullptr)
+        {
+            chprintf(outputStream, "no pose estimator \r\n");
+            return;
+        }
+        float covariance[3][3];
+        poseEstimator->getPoseCovariance(covariance);
+        chprintf(outputStream, "odometry X %.2f Y %.2f theta %.4f \r\n", odometry->getX(), odometry->getY(), odometry->getTheta());
+        chprintf(outputStream, "estimator X %.2f Y %.2f theta %.4f (sigma %.2f %.2f %.4f) \r\n", poseEstimator->getX(), poseEstimator->getY(),
+                poseEstimator->getTheta(), sqrtf(covariance[0][0]), sqrtf(covariance[1][1]), sqrtf(covariance[2][2]));
+        chprintf(outputStream, "speed %.1f mm/s %.3f rad/s \r\n", poseEstimator->getSpeed(), poseEstimator->getAngularSpeed());
+        chprintf(outputStream, "motor scale R %.4f L %.4f track %.2f mm \r\n", poseEstimator->getRightMotorScale(),
+                poseEstimator->getLeftMotorScale(), poseEstimator->getMotorWheelsDistance());
+        chprintf(outputStream, "rejects R %lu L %lu motor R %lu L %lu gyro %lu \r\n",
+                poseEstimator->getRejectCount(PoseEstimator::SOURCE_RIGHT_ENCODER), poseEstimator->getRejectCount(PoseEstimator::SOURCE_LEFT_ENCODER),
+                poseEstimator->getRejectCount(PoseEstimator::SOURCE_RIGHT_MOTOR_ENCODER), poseEstimator->getRejectCount(PoseEstimator::SOURCE_LEFT_MOTOR_ENCODER),
+                poseEstimator->getRejectCount(PoseEstimator::SOURCE_HEADING_RATE));
+    }
     else if (!strcmp(argv[0], "reset"))
     {
         mainAsserv->reset();
@@ -515,6 +525,164 @@ void asservCommandUSB(BaseSequentialStream *chp, int argc, char **argv)
         commandManager->addGoToAngle(100,0);
 
     }
+    else if (!strcmp(argv[0], "profiler"))
+    {
+#ifdef ENABLE_LOOP_PROFILER
+        if (argc > 1 && !strcmp(argv[1], "reset"))
+        {
+            chprintf(outputStream, "Loop profiler reset\r\n");
+            mainAsserv->getProfiler().requestReset();
+        }
+        else
+        {
+            mainAsserv->getProfiler().print(outputStream);
+        }
+#else
+        chprintf(outputStream, "Loop profiler not compiled, use make PROFILER_ENABLE=true\r\n");
+#endif
+    }
+    else if (!strcmp(argv[0], "deadlines"))
+    {
+        if (argc > 1 && !strcmp(argv[1], "reset"))
+        {
+            chprintf(outputStream, "Deadline stats reset\r\n");
+            mainAsserv->resetDeadlineStats();
+        }
+        else
+        {
+            chprintf(outputStream, "missed deadlines : %u\r\n", (unsigned int) mainAsserv->getDeadlineMisses());
+            chprintf(outputStream, "worst lateness : %u us\r\n", (unsigned int) mainAsserv->getWorstDeadlineLateness_us());
+            chprintf(outputStream, "min slack : %u us\r\n", (unsigned int) mainAsserv->getMinDeadlineSlack_us());
+            chprintf(outputStream, "telemetry mode : %d (0 full, 1 throttled, 2 off)\r\n", mainAsserv->getTelemetryMode());
+
+            LoopTimer &loopTimer = mainAsserv->getLoopTimer();
+            chprintf(outputStream, "loop timer : %u ticks at %u Hz, %u missed\r\n", (unsigned int) loopTimer.getTicks(),
+                    loopTimer.getFrequency(), (unsigned int) loopTimer.getMissedTicks());
+            chprintf(outputStream, "period : mean %.3f us, min %.3f us, max %.3f us, jitter %.3f us\r\n", loopTimer.getMeanPeriod_us(),
+                    loopTimer.getMinPeriod_us(), loopTimer.getMaxPeriod_us(), loopTimer.getMaxJitter_us());
+            chprintf(outputStream, "max wake latency : %.3f us\r\n", loopTimer.getMaxWakeLatency_us());
+        }
+    }
+    else if (!strcmp(argv[0], "loopfreq"))
+    {
+        // La LoopTimer compte au plus 65535 us par période, et une itération doit tenir dans la période
+        if (argc > 1 && atoi(argv[1]) >= 16 && atoi(argv[1]) <= 1000)
+        {
+            mainAsserv->setLoopFrequency(atoi(argv[1]));
+            chprintf(outputStream, "Loop frequency set to %u Hz\r\n", mainAsserv->getLoopFrequency());
+        }
+        else
+        {
+            chprintf(outputStream, "Loop frequency : %u Hz (16 to 1000 Hz)\r\n", mainAsserv->getLoopFrequency());
+        }
+    }
+    else if (!strcmp(argv[0], "slip"))
+    {
+        if (slipDetector == nullptr)
+        {
+            chprintf(outputStream, "Slip detector not enabled\r\n");
+        }
+        else
+        {
+            chprintf(outputStream, "slip events : %u\r\n", (unsigned int) slipDetector->getSlipEvents());
+            chprintf(outputStream, "acceleration scale : %.2f%s\r\n", slipDetector->getAccelerationScale(),
+                    slipDetector->isSlipping() ? " (slipping)" : "");
+        }
+    }
+    else if (!strcmp(argv[0], "md22stats"))
+    {
+        if (argc > 1 && !strcmp(argv[1], "reset"))
+        {
+            chprintf(outputStream, "Md22 stats reset\r\n");
+            md22MotorController->resetWriteStats();
+        }
+        else
+        {
+            Md22::WriteStats stats = md22MotorController->getWriteStats();
+            chprintf(outputStream, "published %u, written %u, dropped %u, errors %u\r\n", (unsigned int) stats.published,
+                    (unsigned int) stats.written, (unsigned int) stats.dropped, (unsigned int) stats.errors);
+            chprintf(outputStream, "i2c failed tries %u\r\n", (unsigned int) stats.failedTries);
+            if (stats.written > 0)
+                chprintf(outputStream, "latency min %u us, mean %u us, max %u us\r\n", (unsigned int) stats.minLatency_us,
+                        (unsigned int) (stats.sumLatency_us / stats.written), (unsigned int) stats.maxLatency_us);
+        }
+    }
+    else if (!strcmp(argv[0], "magstats"))
+    {
+        if (argc > 1 && !strcmp(argv[1], "reset"))
+        {
+            chprintf(outputStream, "MagEncoders stats reset\r\n");
+            encoders_ext->resetAcquisitionStats();
+        }
+        else
+        {
+            MagEncoders::AcquisitionStats stats = encoders_ext->getAcquisitionStats();
+            chprintf(outputStream, "requested %u, completed %u, errors %u, stale %u\r\n", (unsigned int) stats.requested,
+                    (unsigned int) stats.completed, (unsigned int) stats.errors, (unsigned int) stats.stale);
+            if (stats.completed > 0)
+                chprintf(outputStream, "latency min %u us, mean %u us, max %u us, max wait %u us\r\n",
+                        (unsigned int) stats.minLatency_us, (unsigned int) (stats.sumLatency_us / stats.completed),
+                        (unsigned int) stats.maxLatency_us, (unsigned int) stats.maxWait_us);
+
+            MagEncoders::SensorStatus sensor1, sensor2;
+            encoders_ext->getSensorsStatus(&sensor1, &sensor2);
+            chprintf(outputStream, "sensor1 agc=%d diag=%d mag=%d\r\n", sensor1.agc, sensor1.diag, sensor1.mag);
+            chprintf(outputStream, "sensor2 agc=%d diag=%d mag=%d\r\n", sensor2.agc, sensor2.diag, sensor2.mag);
+        }
+    }
+    else if (!strcmp(argv[0], "umbmark"))
+    {
+        // Calibration de l'odométrie : carrés dans les deux sens, écarts mesurés à la main au retour (voir OdometryCalibration)
+        if (argc > 3 && !strcmp(argv[1], "square"))
+        {
+            float side = atof(argv[2]);
+            bool clockwise = !strcmp(argv[3], "cw");
+            chprintf(outputStream, "Adding %s square of %.0f mm from (0, 0, 0)\r\n", clockwise ? "clockwise" : "counterclockwise", side);
+
+            mainAsserv->resetToNormalMode();
+            mainAsserv->setPosition(0, 0, 0);
+            if (!odometryCalibration->addSquare(*commandManager, side, clockwise))
+                chprintf(outputStream, "Command list full\r\n");
+        }
+        else if (argc > 4 && !strcmp(argv[1], "error"))
+        {
+            // Position réelle mesurée dans le repère de départ, moins l'odométrie
+            bool clockwise = !strcmp(argv[2], "cw");
+            float errorX = float(atof(argv[3])) - odometry->getX();
+            float errorY = float(atof(argv[4])) - odometry->getY();
+            odometryCalibration->addRun(clockwise, errorX, errorY);
+            chprintf(outputStream, "%s error X %.2f mm Y %.2f mm, runs cw %u ccw %u\r\n", clockwise ? "cw" : "ccw", errorX, errorY,
+                    (unsigned int) odometryCalibration->getRunCount(true), (unsigned int) odometryCalibration->getRunCount(false));
+        }
+        else if (argc > 1 && (!strcmp(argv[1], "solve") || !strcmp(argv[1], "apply")))
+        {
+            float distanceScale = (argc > 2) ? float(atof(argv[2])) : 1.0f;
+            OdometryCalibration::Result result;
+            if (!odometryCalibration->solve(encoders_ext->getRightGain(), encoders_ext->getLeftGain(), mainAsserv->getEncoderWheelsDistance(),
+                    distanceScale, &result))
+            {
+                chprintf(outputStream, "No solution : measure both directions first\r\n");
+            }
+            else
+            {
+                chprintf(outputStream, "#define ENCODERS_WHEELS_DISTANCE_MM (%.3f)\r\n", result.wheelsDistance_mm);
+                chprintf(outputStream, "#define ENCODERS_RIGHT_GAIN (%.6f)\r\n", result.rightGain);
+                chprintf(outputStream, "#define ENCODERS_LEFT_GAIN (%.6f)\r\n", result.leftGain);
+                chprintf(outputStream, "residual : %.2f mm\r\n", result.residual_mm);
+                if (!strcmp(argv[1], "apply"))
+                {
+                    mainAsserv->setOdometryCalibration(result.rightGain, result.leftGain, result.wheelsDistance_mm);
+                    odometryCalibration->clearRuns();
+                    chprintf(outputStream, "Applied, measures cleared\r\n");
+                }
+            }
+        }
+        else if (argc > 1 && !strcmp(argv[1], "clear"))
+        {
+            odometryCalibration->clearRuns();
+            chprintf(outputStream, "Measures cleared\r\n");
+        }
+    }
     else if (!strcmp(argv[0], "get_config"))
     {
         uint8_t index = 0;
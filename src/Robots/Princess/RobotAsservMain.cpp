@@ -0,0 +1,4 @@
+#include "RobotAsservMain.h"
+
+template class ComposedAsservMain<QuadratureEncoder, Md22, AdaptativeSpeedController,
+        SimpleAccelerationLimiter, AdvancedAccelerationLimiter>;
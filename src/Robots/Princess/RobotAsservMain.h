@@ -0,0 +1,25 @@
+#ifndef SRC_ROBOTS_PRINCESS_ROBOTASSERVMAIN_H_
+#define SRC_ROBOTS_PRINCESS_ROBOTASSERVMAIN_H_
+
+/*
+ * Types concrets de la chaîne de contrôle du robot Princess (utilisé aussi par PMI).
+ *  Doit rester cohérent avec les objets créés dans main.cpp.
+ *  Les estimateurs de vitesse sont des Pll (type par défaut) : pour un AdaptivePll ou un KalmanVelocityEstimator,
+ *  l'ajouter en dernier type ici et dans RobotAsservMain.cpp, et créer ces objets dans main.cpp (adaptivePllConf,
+ *  kalmanVelocityConf du robotConfig.h).
+ */
+#include "ComposedAsservMain.h"
+#include "Encoders/QuadratureEncoder.h"
+#include "motorController/Md22.h"
+#include "SpeedController/AdaptativeSpeedController.h"
+#include "AccelerationLimiter/SimpleAccelerationLimiter.h"
+#include "AccelerationLimiter/AdvancedAccelerationLimiter.h"
+
+typedef ComposedAsservMain<QuadratureEncoder, Md22, AdaptativeSpeedController,
+        SimpleAccelerationLimiter, AdvancedAccelerationLimiter> RobotAsservMain;
+
+// Instanciée une seule fois dans RobotAsservMain.cpp, qui fait partie des unités vérifiées par check_double
+extern template class ComposedAsservMain<QuadratureEncoder, Md22, AdaptativeSpeedController,
+        SimpleAccelerationLimiter, AdvancedAccelerationLimiter>;
+
+#endif /* SRC_ROBOTS_PRINCESS_ROBOTASSERVMAIN_H_ */
@@ -25,10 +25,33 @@ extern Md22 *md22MotorController;
 extern CommandManager *commandManager;
 
 
+/*
+ * Réponse à une commande de déplacement : son identifiant, repris par ses évènements, ou 0 si la file est pleine
+ */
+static void acknowledgeCommand(bool queued)
+{
+    chprintf(outputStream, "!Q%u\r\n", queued ? (unsigned int) commandManager->getLastCommandId() : 0u);
+}
+
+static char eventCode(CommandEvent::Type type)
+{
+    switch (type)
+    {
+    case CommandEvent::STARTED:
+        return 'S';
+    case CommandEvent::COMPLETED:
+        return 'C';
+    case CommandEvent::PREEMPTED:
+        return 'P';
+    default:
+        return 'F';
+    }
+}
+
 static void serialReadLine(char *buffer, unsigned int buffer_size)
 {
     unsigned int i;
-    for(i=0; i<buffer_size; i++)
+    for(i=0; i<buffer_size-1; i++)
     {
         buffer[i] = streamGet(&SD2);
         if ( buffer[i] == '\n' || buffer[i] == '\r')
@@ -37,6 +60,72 @@ static void serialReadLine(char *buffer, unsigned int buffer_size)
     buffer[i] = '\0';
 }
 
+/*
+ * Spline, points x1#y1#x2#y2... lus sur la ligne (au plus SplinePath::MAX_POINTS), placée dans la file selon mode.
+ *  false si elle est refusée ou si la ligne ne contient pas de point.
+ */
+static bool addSplineCommand(CommandManager::QueueMode mode)
+{
+    char buffer[128];
+    float X[SplinePath::MAX_POINTS];
+    float Y[SplinePath::MAX_POINTS];
+    uint8_t count = 0;
+    serialReadLine(buffer, sizeof(buffer));
+
+    char *cursor = buffer;
+    while (count < SplinePath::MAX_POINTS) {
+        char *end;
+        X[count] = strtof(cursor, &end);
+        if (end == cursor || *end != '#')
+            break;
+        cursor = end + 1;
+        Y[count] = strtof(cursor, &end);
+        if (end == cursor)
+            break;
+        count++;
+        if (*end != '#')
+            break;
+        cursor = end + 1;
+    }
+
+    if (count == 0)
+        return false;
+    return commandManager->addSpline(X, Y, count, mode);
+}
+
+/*
+ * Commande de déplacement v, t, f, g, b, e ou l, paramètres lus sur la ligne, placée dans la file selon mode
+ *  (voir CommandManager::QueueMode). false si elle est refusée ou inconnue.
+ */
+static bool addMotionCommand(char code, CommandManager::QueueMode mode)
+{
+    if (code == 'l')
+        return addSplineCommand(mode);
+
+    char buffer[64];
+    float value1 = 0;
+    float value2 = 0;
+    serialReadLine(buffer, sizeof(buffer));
+    sscanf(buffer, "%f#%f", &value1, &value2);
+
+    switch (code) {
+    case 'v':
+        return commandManager->addStraightLine(value1, mode);
+    case 't':
+        return commandManager->addTurn(degToRad(value1), mode);
+    case 'f':
+        return commandManager->addGoToAngle(value1, value2, mode);
+    case 'g':
+        return commandManager->addGoTo(value1, value2, mode);
+    case 'b':
+        return commandManager->addGoToBack(value1, value2, mode);
+    case 'e':
+        return commandManager->addGoToNoStop(value1, value2, mode);
+    default:
+        return false;
+    }
+}
+
 THD_FUNCTION(asservCommandSerial, p)
 {
     (void) p;
@@ -45,11 +134,14 @@ THD_FUNCTION(asservCommandSerial, p)
 
      g%x#%y\n / Goto / x, y : entiers, en mm /Le robot se déplace au point de coordonnée (x, y). Il tourne vers le point, puis avance en ligne droite. L'angle est sans cesse corrigé pour bien viser le point voulu.
      e%x#%y\n / goto Enchaîné / x, y : entiers, en mm / Idem que le Goto, sauf que lorsque le robot est proche du point d'arrivée (x, y), on s'autorise à enchaîner directement la consigne suivante si c'est un Goto ou un Goto enchaîné, sans marquer d'arrêt.
+     l%x1#%y1#%x2#%y2...\n / spLine / x, y : en mm, de 1 à 8 points / Le robot suit une courbe lisse passant par les points, en partant tangent à son cap, sans s'arrêter sur les points intermédiaires. Marche avant seulement.
      v%d\n / aVancer / d : entier, en mm / Fait avancer le robot de d mm, tout droit
      t%a\n / Tourner / a : entier, en degrées / Fait tourner le robot de a degrées. Le robot tournera dans le sens trigonométrique : si a est positif, il tourne à gauche, et vice-versa.
      f%x#%y\n / faire Face / x, y : entiers, en mm / Fait tourner le robot pour être en face du point de coordonnées (x, y). En gros, ça réalise la première partie d'un Goto : on se tourne vers le point cible, mais on avance pas.
      h / Halte ! / Arrêt d'urgence ! Le robot est ensuite systématiquement asservi à sa position actuelle. Cela devrait suffire à arrêter le robot correctement. La seule commande acceptée par la suite sera un Reset de l'arrêt d'urgence : toute autre commande sera ignorée.
      r / Reset de l'arrêt d'urgence / Remet le robot dans son fonctionnement normal après un arrêt d'urgence. Les commandes en cours au moment de l'arrêt d'urgence NE sont PAS reprises. Si le robot n'est pas en arrêt d'urgence, cette commande n'a aucun effet.
+     H / Pause / Le robot freine aux limites d'accélération des profils et s'arrête, sans vider la file : la commande en cours et les commandes en attente sont gardées, celles envoyées ensuite attendent la reprise. L'état de la ligne de position vaut 4 pendant la pause. Un arrêt d'urgence annule la pause.
+     c / Continuer / Reprend la commande en cours depuis la pose où le robot s'est arrêté, puis la file. Sans effet hors pause.
 
      p / get Position / Récupère la position et le cap du robot sur la connexion i2c, sous la forme de 3 types float (3 * 4 bytes), avec x, y, et a les coordonnées et l'angle du robot.
      S%x#%y#%a\n / set Position / applique la nouvelle position du robot
@@ -73,6 +165,20 @@ THD_FUNCTION(asservCommandSerial, p)
 
      + / applique une valeur +1 sur les moteurs LEFT
      - / applique une valeur -1 sur les moteurs LEFT
+
+     X%c... / remplace la commande en cours / c : commande de déplacement v, t, f, g, b, e ou l, suivie de ses paramètres (ex : Xg500#300) / La commande en cours est interrompue et la nouvelle démarre depuis la pose et la vitesse actuelles, sans arrêt du robot. Les commandes en attente sont gardées.
+     N%c... / insère en tête / c : commande de déplacement, comme X / La commande est exécutée dès la fin de la commande en cours, avant les commandes en attente.
+     C / vide la file / Retire les commandes en attente, la commande en cours continue.
+     X, N et C sont appliqués à la mise à jour suivante de la boucle de position. Une seule de ces opérations peut être en attente : sinon X et N répondent !Q0, C répond !Q0 et n'a pas d'effet.
+
+     Les commandes de déplacement (z, s, q, d, v, t, f, g, b, e, l, X, N) répondent !Q%id, avec id l'identifiant donné à la commande, ou 0 si la file est pleine.
+     C répond !Q1 si la file sera vidée, !Q0 sinon.
+     Les évènements des commandes sont envoyés dès que la boucle d'asserv les publie, entre les lignes de position :
+     !S%id / commande démarrée
+     !C%id / commande terminée
+     !P%id / commande interrompue en cours d'exécution, par un arrêt d'urgence ou remplacée (X)
+     !F%id / commande retirée de la file sans avoir été exécutée, par un arrêt d'urgence ou la commande C
+     !L%n / n évènements perdus depuis le démarrage (file des évènements pleine)
      */
 
     float consigneValue1 = 0;
@@ -100,61 +206,90 @@ THD_FUNCTION(asservCommandSerial, p)
             serialReadLine(buffer, sizeof(buffer));
             break;
 
+        case 'H': // pause, freinage contrôlé en gardant la file
+            commandManager->pause();
+            serialReadLine(buffer, sizeof(buffer));
+            break;
+
+        case 'c': // reprise après la pause
+            commandManager->resume();
+            serialReadLine(buffer, sizeof(buffer));
+            break;
+
         case 'z':
             // Go 20cm
             chprintf(outputStream, "consigne avant : 200mm\n");
-            commandManager->addStraightLine(200);
+            acknowledgeCommand(commandManager->addStraightLine(200));
             break;
 
         case 's':
             chprintf(outputStream, "consigne arrière : 200mm\n");
-            commandManager->addStraightLine(-200);
+            acknowledgeCommand(commandManager->addStraightLine(-200));
             break;
 
         case 'q':
             chprintf(outputStream, "consigne gauche : 45°\n");
-            commandManager->addTurn(degToRad(45));
+            acknowledgeCommand(commandManager->addTurn(degToRad(45)));
             break;
 
         case 'd':
             chprintf(outputStream, "consigne gauche : 45°\n");
-             commandManager->addTurn(degToRad(-45));
+             acknowledgeCommand(commandManager->addTurn(degToRad(-45)));
              break;
 
         case 'v': //aVance d'un certain nombre de mm
             serialReadLine(buffer, sizeof(buffer));
             sscanf(buffer, "%f", &consigneValue1);
-            commandManager->addStraightLine(consigneValue1);
+            acknowledgeCommand(commandManager->addStraightLine(consigneValue1));
             break;
 
         case 't': //Tourne d'un certain angle en degrés
             serialReadLine(buffer, sizeof(buffer));
             sscanf(buffer, "%f", &consigneValue1);
-            commandManager->addTurn(degToRad(consigneValue1));
+            acknowledgeCommand(commandManager->addTurn(degToRad(consigneValue1)));
             break;
 
         case 'f': //faire Face à un point précis, mais ne pas y aller, juste se tourner
             serialReadLine(buffer, sizeof(buffer));
             sscanf(buffer, "%f#%f", &consigneValue1, &consigneValue2);
-            commandManager->addGoToAngle(consigneValue1, consigneValue2);
+            acknowledgeCommand(commandManager->addGoToAngle(consigneValue1, consigneValue2));
             break;
 
         case 'g': //Go : va à un point précis
             serialReadLine(buffer, sizeof(buffer));
             sscanf(buffer, "%f#%f", &consigneValue1, &consigneValue2);
-            commandManager->addGoTo(consigneValue1, consigneValue2);
+            acknowledgeCommand(commandManager->addGoTo(consigneValue1, consigneValue2));
             break;
 
         case 'b': //Go : va à un point précis
             serialReadLine(buffer, sizeof(buffer));
             sscanf(buffer, "%f#%f", &consigneValue1, &consigneValue2);
-            commandManager->addGoToBack(consigneValue1, consigneValue2);
+            acknowledgeCommand(commandManager->addGoToBack(consigneValue1, consigneValue2));
             break;
 
         case 'e': // goto, mais on s'autorise à Enchainer la consigne suivante sans s'arrêter
             serialReadLine(buffer, sizeof(buffer));
             sscanf(buffer, "%f#%f", &consigneValue1, &consigneValue2);
-            commandManager->addGoToNoStop(consigneValue1, consigneValue2);
+            acknowledgeCommand(commandManager->addGoToNoStop(consigneValue1, consigneValue2));
+            break;
+
+        case 'l': // suit une spline passant par les points donnés
+            acknowledgeCommand(addSplineCommand(CommandManager::QUEUE_APPEND));
+            break;
+
+        case 'X': // remplace la commande en cours, sans arrêt
+            readChar = streamGet(&SD2);
+            acknowledgeCommand(addMotionCommand(readChar, CommandManager::QUEUE_REPLACE_CURRENT));
+            break;
+
+        case 'N': // insère une commande en tête de file
+            readChar = streamGet(&SD2);
+            acknowledgeCommand(addMotionCommand(readChar, CommandManager::QUEUE_INSERT_HEAD));
+            break;
+
+        case 'C': // vide la file, en gardant la commande en cours
+            serialReadLine(buffer, sizeof(buffer));
+            chprintf(outputStream, "!Q%u\r\n", commandManager->clearPendingCommands() ? 1u : 0u);
             break;
 
         case 'p': //retourne la Position et l'angle courants du robot
@@ -193,16 +328,36 @@ THD_FUNCTION(asservPositionSerial, p)
 {
     (void) p;
     const time_conv_t loopPeriod_ms = 100;
+    CommandEventQueue &events = commandManager->getEventQueue();
+    uint32_t reportedLostEvents = 0;
     systime_t time = chVTGetSystemTime();
     time += TIME_MS2I(loopPeriod_ms);
     while(true)
     {
+        // Évènements des commandes, envoyés dès que la boucle d'asserv les publie
+        CommandEvent event;
+        while (events.pop(&event))
+            chprintf(outputStream, "!%c%u\r\n", eventCode(event.type), (unsigned int) event.commandId);
+        uint32_t lostEvents = events.getLostEvents();
+        if (lostEvents != reportedLostEvents)
+        {
+            chprintf(outputStream, "!L%u\r\n", (unsigned int) lostEvents);
+            reportedLostEvents = lostEvents;
+        }
+
+        // Position toutes les 100 ms : jusque là, on attend les évènements
+        sysinterval_t remaining = chTimeDiffX(chVTGetSystemTime(), time);
+        if (remaining > 0 && remaining <= TIME_MS2I(loopPeriod_ms))
+        {
+            events.wait(remaining);
+            continue;
+        }
+
         chprintf(outputStream, "#%d;%d;%f;%d;%d;%d;%d\r\n",
             (int32_t)odometry->getX(), (int32_t)odometry->getY(), odometry->getTheta(),
             commandManager->getCommandStatus(), commandManager->getPendingCommandCount(),
             md22MotorController->getLeftSpeed(), md22MotorController->getRightSpeed());
 
-        chThdSleepUntil(time);
         time += TIME_MS2I(loopPeriod_ms);
     }
 }
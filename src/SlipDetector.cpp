@@ -0,0 +1,51 @@
+#include "SlipDetector.h"
+
+SlipDetector::SlipDetector(Configuration const &configuration) :
+        m_configuration(configuration)
+{
+    reset();
+}
+
+void SlipDetector::reset()
+{
+    m_accelerationScale = 1;
+    m_slippingIterations = 0;
+    m_slipping = false;
+    m_slipEvents = 0;
+}
+
+bool SlipDetector::isWheelSlipping(float speedGoal, float speed, float slipSpeed) const
+{
+    // Écarts comptés dans le sens de la consigne : retard à l'accélération, roue motrice qui s'emballe
+    const float direction = (speedGoal >= 0) ? 1.0f : -1.0f;
+    return (speedGoal - speed) * direction > m_configuration.trackingErrorThreshold
+            || slipSpeed * direction > m_configuration.slipSpeedThreshold;
+}
+
+void SlipDetector::update(float dt, float speedGoalRight, float speedGoalLeft, float speedRight, float speedLeft,
+        float slipSpeedRight, float slipSpeedLeft)
+{
+    if (isWheelSlipping(speedGoalRight, speedRight, slipSpeedRight) || isWheelSlipping(speedGoalLeft, speedLeft, slipSpeedLeft))
+    {
+        m_slippingIterations++;
+        // Tant que le patinage dure, le facteur rebaisse toutes les detectionIterations itérations
+        if (m_slippingIterations >= m_configuration.detectionIterations)
+        {
+            if (!m_slipping)
+                m_slipEvents++;
+            m_slipping = true;
+            m_slippingIterations = 0;
+
+            m_accelerationScale *= m_configuration.accelerationDrop;
+            if (m_accelerationScale < m_configuration.minAccelerationScale)
+                m_accelerationScale = m_configuration.minAccelerationScale;
+        }
+        return;
+    }
+
+    m_slippingIterations = 0;
+    m_slipping = false;
+    m_accelerationScale += m_configuration.recoveryRate * dt;
+    if (m_accelerationScale > 1)
+        m_accelerationScale = 1;
+}
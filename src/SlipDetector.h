@@ -0,0 +1,68 @@
+#ifndef SRC_SLIPDETECTOR_H_
+#define SRC_SLIPDETECTOR_H_
+
+#include <cstdint>
+
+/*
+ * Détection du patinage des roues motrices, et facteur d'accélération qui en découle pour les limiteurs et les profils
+ *  du CommandManager (voir CommandManager::setAccelerationScale()).
+ *
+ *  Une roue patine (ou est bloquée) quand, pendant detectionIterations itérations de suite :
+ *   - elle est en retard sur sa consigne de vitesse de plus de trackingErrorThreshold, dans le sens où la consigne
+ *     accélère : la vitesse PLL ne suit pas l'accélération demandée. Les freinages ne sont pas limités par les
+ *     limiteurs, un retard au freinage n'est donc pas compté,
+ *   - ou, avec une seconde source (codeurs des roues motrices, voir PoseEstimator::getMotorSlipSpeed()),
+ *     la roue motrice tourne plus vite que le sol de plus de slipSpeedThreshold.
+ *  À chaque détection, le facteur d'accélération est multiplié par accelerationDrop (sans descendre sous
+ *  minAccelerationScale), puis remonte de recoveryRate par seconde sans patinage, jusqu'à 1.
+ *  Le robot peut ainsi avoir des accélérations max proches de la limite d'adhérence : elles baissent d'elles-mêmes
+ *  sur un sol glissant.
+ */
+class SlipDetector
+{
+public:
+    struct Configuration
+    {
+        float trackingErrorThreshold;   // mm/s
+        float slipSpeedThreshold;       // mm/s
+        uint16_t detectionIterations;
+        float accelerationDrop;
+        float minAccelerationScale;
+        float recoveryRate;             // 1/s
+    };
+
+    explicit SlipDetector(Configuration const &configuration);
+
+    /*
+     * Une itération : consignes de vitesse des roues appliquées pendant la période écoulée, vitesses PLL mesurées,
+     *  et vitesses de patinage vues par la seconde source (0 sans seconde source), en mm/s
+     */
+    void update(float dt, float speedGoalRight, float speedGoalLeft, float speedRight, float speedLeft,
+            float slipSpeedRight = 0, float slipSpeedLeft = 0);
+
+    void reset();
+
+    inline float getAccelerationScale() const
+    {
+        return m_accelerationScale;
+    }
+    inline bool isSlipping() const
+    {
+        return m_slipping;
+    }
+    inline uint32_t getSlipEvents() const
+    {
+        return m_slipEvents;
+    }
+
+private:
+    bool isWheelSlipping(float speedGoal, float speed, float slipSpeed) const;
+
+    Configuration const &m_configuration;
+    float m_accelerationScale;
+    uint16_t m_slippingIterations;
+    bool m_slipping;
+    uint32_t m_slipEvents;
+};
+
+#endif /* SRC_SLIPDETECTOR_H_ */
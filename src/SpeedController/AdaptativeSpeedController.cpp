@@ -5,9 +5,9 @@
 
 
 AdaptativeSpeedController::AdaptativeSpeedController(
-        float KpGains[NB_PI_SUBSET], float KiGains[NB_PI_SUBSET], float speedRange[NB_PI_SUBSET],
-        float outputLimit, float maxInputSpeed, float measureFrequency) :
-        SpeedController(KpGains[0], KiGains[0], outputLimit, maxInputSpeed, measureFrequency)
+        const float KpGains[NB_PI_SUBSET], const float KiGains[NB_PI_SUBSET], const float speedRange[NB_PI_SUBSET],
+        float outputLimit, float maxInputSpeed) :
+        SpeedController(KpGains[0], KiGains[0], outputLimit, maxInputSpeed)
 {
 
     for (int i = 0; i < NB_PI_SUBSET; i++)
@@ -18,15 +18,15 @@ AdaptativeSpeedController::AdaptativeSpeedController(
     }
 }
 
-float AdaptativeSpeedController::update(float actualSpeed)
+float AdaptativeSpeedController::update(float actualSpeed, float deltaT)
 {
     updateGains(actualSpeed);
-    return SpeedController::update(actualSpeed);
+    return SpeedController::update(actualSpeed, deltaT);
 }
 
 void AdaptativeSpeedController::updateGains(float actualSpeed)
 {
-    actualSpeed = fabs(actualSpeed);
+    actualSpeed = fabsf(actualSpeed);
 
     // D'abord, on cherche à quel set correspond la vitesse actuelle
     uint8_t set = 0;
@@ -50,7 +50,7 @@ void AdaptativeSpeedController::updateGains(float actualSpeed)
 
         m_speedKi = fmap(actualSpeed, m_GainsSpeedRange[set - 1], m_GainsSpeedRange[set],m_speedKiSet[set - 1], m_speedKiSet[set]);
 
-        if( m_speedKi < 0.0)
+        if( m_speedKi < 0.0f)
         {
             m_GainsSpeedRange[0] = 1;
             m_speedKi = fmap(actualSpeed,
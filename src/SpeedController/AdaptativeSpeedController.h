@@ -5,15 +5,15 @@
 
 constexpr uint8_t NB_PI_SUBSET = 3;
 
-class AdaptativeSpeedController : public SpeedController
+class AdaptativeSpeedController final : public SpeedController
 {
     public:
         explicit AdaptativeSpeedController(
-                float KpGains[NB_PI_SUBSET], float KiGains[NB_PI_SUBSET], float speedRange[NB_PI_SUBSET],
-                float outputLimit, float maxInputSpeed, float measureFrequency);
+                const float KpGains[NB_PI_SUBSET], const float KiGains[NB_PI_SUBSET], const float speedRange[NB_PI_SUBSET],
+                float outputLimit, float maxInputSpeed);
         virtual ~AdaptativeSpeedController() {};
 
-        virtual float update(float actualSpeed);
+        virtual float update(float actualSpeed, float deltaT);
 
         virtual void setGains(float Kp, float Ki);
         void setGains(float Kp, float Ki, uint8_t range);
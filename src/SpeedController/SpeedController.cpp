@@ -5,7 +5,7 @@
 #include <cstdlib>
 #include <cstdint>
 
-SpeedController::SpeedController(float speedKp, float speedKi, float outputLimit, float maxInputSpeed, float measureFrequency)
+SpeedController::SpeedController(float speedKp, float speedKi, float outputLimit, float maxInputSpeed)
 {
     m_speedGoal = 0;
     m_integratedOutput = 0;
@@ -14,10 +14,9 @@ SpeedController::SpeedController(float speedKp, float speedKi, float outputLimit
 
     m_outputLimit = outputLimit;
     m_inputLimit = maxInputSpeed;
-    m_measureFrequency = measureFrequency;
 }
 
-float SpeedController::update(float actualSpeed)
+float SpeedController::update(float actualSpeed, float deltaT)
 {
     float outputValue = 0;
     float speedError = m_speedGoal - actualSpeed;
@@ -39,13 +38,13 @@ float SpeedController::update(float actualSpeed)
 
     if (limited) // .. Si la sortie est limité, on désature l'intégrale
     {
-        m_integratedOutput *= 0.9;
+        m_integratedOutput *= 0.9f;
     }
     else	// .. Sinon, on integre l'erreur
     {
-        m_integratedOutput += m_speedKi * speedError / m_measureFrequency;
-        if (std::fabs(speedError) < 0.1) // Quand l'erreur de vitesse est proche de zero(ie: consigne à 0 et le robot ne bouge pas..), on désature l'intégrale
-            m_integratedOutput *= 0.95;
+        m_integratedOutput += m_speedKi * speedError * deltaT;
+        if (std::fabs(speedError) < 0.1f) // Quand l'erreur de vitesse est proche de zero(ie: consigne à 0 et le robot ne bouge pas..), on désature l'intégrale
+            m_integratedOutput *= 0.95f;
     }
 
     // Protection antiWindup, surement inutile avec la désaturation au dessus, mais on garde ceinture & bretelles !
@@ -64,7 +63,7 @@ void SpeedController::setSpeedGoal(float speed)
     if (speed < -m_inputLimit)
         speed = -m_inputLimit;
 
-    if (speed == 0.0)
+    if (speed == 0.0f)
         resetIntegral();
     m_speedGoal = speed;
 }
@@ -6,10 +6,11 @@
 class SpeedController
 {
 public:
-    explicit SpeedController(float speedKp, float speedKi, float outputLimit, float maxInputSpeed, float measureFrequency);
+    explicit SpeedController(float speedKp, float speedKi, float outputLimit, float maxInputSpeed);
     virtual ~SpeedController(){};
 
-    virtual float update(float actualSpeed);
+    // deltaT : temps écoulé depuis la mesure de vitesse précédente, en s
+    virtual float update(float actualSpeed, float deltaT);
 
     virtual void setGains(float Kp, float Ki);
 
@@ -60,8 +61,6 @@ private:
 
     float m_outputLimit;
     float m_inputLimit;
-
-    float m_measureFrequency;
 };
 
 #endif /* SRC_SPEEDCONTROLLER_H_ */
@@ -35,6 +35,12 @@ typedef struct
     float value25;
     float value26;
     float value27;
+    float value28;
+    float value29;
+    float value30;
+    float value31;
+    float value32;
+    float value33;
 }__attribute__((packed)) UsbStreamSample;
 
 class USBStream
@@ -60,7 +66,7 @@ public:
     inline static void setValue(void *ptr, float value)
     {
         float *ptrFlt = (float*) ptr;
-        if (value == 0.0)
+        if (value == 0.0f)
             *ptrFlt = NAN;
         else
             *ptrFlt = value;
@@ -189,6 +195,36 @@ public:
         setValue(&m_currentStruct.value23, y);
     }
 
+    // Échéances de la boucle d'asserv
+    inline void setDeadlineMisses(float count)
+    {
+        setValue(&m_currentStruct.value30, count);
+    }
+    inline void setWorstDeadlineLateness(float lateness_us)
+    {
+        setValue(&m_currentStruct.value31, lateness_us);
+    }
+
+    // Patinage des roues motrices (voir SlipDetector)
+    inline void setSlipEvents(float count)
+    {
+        setValue(&m_currentStruct.value32, count);
+    }
+    inline void setAccelerationScale(float scale)
+    {
+        setValue(&m_currentStruct.value33, scale);
+    }
+
+    // Profiler de la boucle d'asserv (en us), seulement avec ENABLE_LOOP_PROFILER
+    inline void setLoopDuration(float duration_us)
+    {
+        setValue(&m_currentStruct.value28, duration_us);
+    }
+    inline void setLoopIODuration(float duration_us)
+    {
+        setValue(&m_currentStruct.value29, duration_us);
+    }
+
 private:
     USBStream();
     virtual ~USBStream()
@@ -199,7 +235,12 @@ private:
     void getEmptyBuffer();
     void sendFullBuffer();
 
+#ifdef HOST_BUILD
+    // Sur le host, une instance par thread : les simulations en parallèle ne partagent pas leur télémétrie (voir host/)
+    static thread_local USBStream* s_instance;
+#else
     static USBStream* s_instance;
+#endif
 
     UsbStreamSample *m_currentPtr;
     UsbStreamSample m_currentStruct;
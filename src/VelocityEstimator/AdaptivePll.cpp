@@ -0,0 +1,30 @@
+#include "VelocityEstimator/AdaptivePll.h"
+#include <cmath>
+
+AdaptivePll::AdaptivePll(Configuration const &configuration) :
+        m_configuration(configuration), m_pll(configuration.minBandwidth)
+{
+    reset();
+}
+
+void AdaptivePll::reset()
+{
+    m_pll.reset();
+    m_bandwidth = m_configuration.minBandwidth;
+    m_pll.setBandwidth(m_bandwidth);
+}
+
+void AdaptivePll::update(float deltaPosition, float deltaT)
+{
+    // Bande passante choisie sur la vitesse de l'itération précédente
+    float ratio = fabsf(m_pll.getSpeed()) / m_configuration.maxBandwidthSpeed;
+    if (ratio > 1.0f)
+        ratio = 1.0f;
+    m_bandwidth = m_configuration.minBandwidth + ratio * (m_configuration.maxBandwidth - m_configuration.minBandwidth);
+    // Au-delà de 0.5 / deltaT (correction proportionnelle de plus d'une fois l'erreur par période), la Pll diverge
+    if (m_bandwidth > 0.5f / deltaT)
+        m_bandwidth = 0.5f / deltaT;
+    m_pll.setBandwidth(m_bandwidth);
+
+    m_pll.update(deltaPosition, deltaT);
+}
@@ -0,0 +1,51 @@
+#ifndef SRC_ADAPTIVEPLL_H_
+#define SRC_ADAPTIVEPLL_H_
+
+#include "VelocityEstimator/VelocityEstimator.h"
+#include "Pll.h"
+
+/*
+ * Pll dont la bande passante suit la vitesse estimée : minBandwidth à l'arrêt, où le bruit de quantification domine,
+ *  jusqu'à maxBandwidth à partir de maxBandwidthSpeed, où c'est le retard qui compte.
+ *  Interpolation linéaire entre les deux, recalculée à chaque itération, et bornée à 0.5 / deltaT au-delà de quoi
+ *  la Pll diverge : à la fréquence de la boucle, PLL_BANDWIDTH en est déjà proche, l'adaptation sert surtout à
+ *  baisser le bruit à basse vitesse.
+ */
+class AdaptivePll final : public VelocityEstimator
+{
+public:
+    struct Configuration
+    {
+        float minBandwidth;
+        float maxBandwidth;
+        float maxBandwidthSpeed;    // ticks/s
+    };
+
+    explicit AdaptivePll(Configuration const &configuration);
+
+    virtual void update(float deltaPosition, float deltaT) override;
+
+    virtual void reset() override;
+
+    virtual float getSpeed() const override
+    {
+        return m_pll.getSpeed();
+    }
+
+    virtual float getAcceleration() const override
+    {
+        return m_pll.getAcceleration();
+    }
+
+    inline float getBandwidth() const
+    {
+        return m_bandwidth;
+    }
+
+private:
+    Configuration const &m_configuration;
+    Pll m_pll;
+    float m_bandwidth;
+};
+
+#endif /* SRC_ADAPTIVEPLL_H_ */
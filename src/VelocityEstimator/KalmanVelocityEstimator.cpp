@@ -0,0 +1,97 @@
+#include "VelocityEstimator/KalmanVelocityEstimator.h"
+#include <cmath>
+#include <cstdint>
+
+// Itérations max de l'équation de Riccati, et variation relative des gains en dessous de laquelle elle a convergé
+#define KALMAN_VELOCITY_MAX_RICCATI_ITERATIONS (10000)
+#define KALMAN_VELOCITY_RICCATI_TOLERANCE (1e-6f)
+
+KalmanVelocityEstimator::KalmanVelocityEstimator(Configuration const &configuration)
+: m_configuration(configuration), m_activeGains(0)
+{
+    computeSteadyStateGains(configuration.period_s, &m_gains[0]);
+    m_gains[1] = m_gains[0];
+    reset();
+}
+
+void KalmanVelocityEstimator::setPeriod(float period_s)
+{
+    const uint8_t inactive = 1 - m_activeGains.load(std::memory_order_relaxed);
+    computeSteadyStateGains(period_s, &m_gains[inactive]);
+    m_activeGains.store(inactive, std::memory_order_release);
+}
+
+void KalmanVelocityEstimator::reset()
+{
+    m_speed = 0;
+    m_acceleration = 0;
+    m_positionError = 0;
+}
+
+void KalmanVelocityEstimator::computeSteadyStateGains(float period_s, Gains *gains) const
+{
+    /* État normalisé par la période (position, vitesse * T, accélération * T²) : toute la covariance est en ticks²,
+     *  sans écart d'ordre de grandeur entre ses termes pour les calculs en float.
+     *  Transition [[1, 1, 1/2], [0, 1, 1], [0, 0, 1]], bruit de jerk sur G = jerkNoise * T³ * [1/6, 1/2, 1]
+     */
+    const float T = period_s;
+    const float jerk = m_configuration.jerkNoise * T * T * T;
+    const float g0 = jerk / 6.0f, g1 = jerk * 0.5f, g2 = jerk;
+    const float r = m_configuration.measurementNoise * m_configuration.measurementNoise;
+
+    // Covariance symétrique après correction, partant d'une vitesse et d'une accélération inconnues
+    float p00 = r, p01 = 0, p02 = 0, p11 = 1e4f, p12 = 0, p22 = 1e4f;
+    float k0 = 0, k1 = 0, k2 = 0;
+    for (uint16_t i = 0; i < KALMAN_VELOCITY_MAX_RICCATI_ITERATIONS; i++)
+    {
+        // Prédiction : F P F' + G G'
+        const float a00 = p00 + p01 + 0.5f * p02;
+        const float a01 = p01 + p11 + 0.5f * p12;
+        const float a02 = p02 + p12 + 0.5f * p22;
+        const float a11 = p11 + p12;
+        const float a12 = p12 + p22;
+        const float n00 = a00 + a01 + 0.5f * a02 + g0 * g0;
+        const float n01 = a01 + a02 + g0 * g1;
+        const float n02 = a02 + g0 * g2;
+        const float n11 = a11 + a12 + g1 * g1;
+        const float n12 = a12 + g1 * g2;
+        const float n22 = p22 + g2 * g2;
+
+        // Correction par la position codeur
+        const float s = n00 + r;
+        const float newK0 = n00 / s, newK1 = n01 / s, newK2 = n02 / s;
+        p00 = n00 - newK0 * n00;
+        p01 = n01 - newK0 * n01;
+        p02 = n02 - newK0 * n02;
+        p11 = n11 - newK1 * n01;
+        p12 = n12 - newK1 * n02;
+        p22 = n22 - newK2 * n02;
+
+        const bool converged = fabsf(newK0 - k0) <= KALMAN_VELOCITY_RICCATI_TOLERANCE * newK0
+                && fabsf(newK1 - k1) <= KALMAN_VELOCITY_RICCATI_TOLERANCE * newK1
+                && fabsf(newK2 - k2) <= KALMAN_VELOCITY_RICCATI_TOLERANCE * newK2;
+        k0 = newK0;
+        k1 = newK1;
+        k2 = newK2;
+        if (converged)
+            break;
+    }
+
+    gains->position = k0;
+    gains->speed = k1 / T;
+    gains->acceleration = k2 / (T * T);
+}
+
+void KalmanVelocityEstimator::update(float deltaPosition, float deltaT)
+{
+    // Prédiction à accélération constante
+    m_positionError += deltaPosition - deltaT * (m_speed + 0.5f * deltaT * m_acceleration);
+    m_speed += deltaT * m_acceleration;
+
+    // Correction par l'écart au codeur (innovation)
+    const Gains &gains = m_gains[m_activeGains.load(std::memory_order_acquire)];
+    const float innovation = m_positionError;
+    m_positionError -= gains.position * innovation;
+    m_speed += gains.speed * innovation;
+    m_acceleration += gains.acceleration * innovation;
+}
@@ -0,0 +1,87 @@
+#ifndef SRC_KALMANVELOCITYESTIMATOR_H_
+#define SRC_KALMANVELOCITYESTIMATOR_H_
+
+#include <atomic>
+#include <cstdint>
+#include "VelocityEstimator/VelocityEstimator.h"
+
+/*
+ * Filtre de Kalman à accélération constante : état position, vitesse, accélération, le jerk étant un bruit blanc
+ *  d'écart type jerkNoise constant sur chaque période, et la position codeur étant mesurée à measurementNoise près
+ *  (quantification : environ 0.3 tick, plus le bruit du capteur).
+ *
+ *  Les gains sont ceux du régime établi pour la période nominale de la boucle (équation de Riccati itérée), calculés
+ *  à la construction pour period_s puis à chaque changement de fréquence de la boucle (setPeriod()) : l'itération ne
+ *  coûte qu'une prédiction et une correction. La gigue d'une itération à l'autre passe par deltaT dans la prédiction.
+ *  Comme la Pll, la position est suivie par son écart au codeur, sans grand compteur qui perdrait en précision.
+ */
+class KalmanVelocityEstimator final : public VelocityEstimator
+{
+public:
+    struct Configuration
+    {
+        float period_s;
+        float jerkNoise;            // ticks/s³
+        float measurementNoise;     // ticks
+    };
+
+    explicit KalmanVelocityEstimator(Configuration const &configuration);
+
+    virtual void update(float deltaPosition, float deltaT) override;
+
+    virtual void reset() override;
+
+    /*
+     * Gains recalculés pour la période period_s, dans le jeu de gains que la boucle n'utilise pas, puis échangés :
+     *  le calcul (quelques centaines d'itérations de Riccati) se fait dans le thread appelant, sans bloquer la boucle
+     */
+    virtual void setPeriod(float period_s) override;
+
+    virtual float getSpeed() const override
+    {
+        return m_speed;
+    }
+
+    virtual float getAcceleration() const override
+    {
+        return m_acceleration;
+    }
+
+    /*
+     * Gains du régime établi sur la position, la vitesse et l'accélération
+     */
+    inline float getPositionGain() const
+    {
+        return m_gains[m_activeGains.load(std::memory_order_acquire)].position;
+    }
+    inline float getSpeedGain() const
+    {
+        return m_gains[m_activeGains.load(std::memory_order_acquire)].speed;
+    }
+    inline float getAccelerationGain() const
+    {
+        return m_gains[m_activeGains.load(std::memory_order_acquire)].acceleration;
+    }
+
+private:
+    struct Gains
+    {
+        float position;
+        float speed;
+        float acceleration;
+    };
+
+    void computeSteadyStateGains(float period_s, Gains *gains) const;
+
+    Configuration const &m_configuration;
+    // Deux jeux de gains : la boucle lit celui d'indice m_activeGains, setPeriod() remplit l'autre
+    Gains m_gains[2];
+    std::atomic<uint8_t> m_activeGains;
+
+    float m_speed;
+    float m_acceleration;
+    // Position codeur moins position estimée, en ticks fractionnaires
+    float m_positionError;
+};
+
+#endif /* SRC_KALMANVELOCITYESTIMATOR_H_ */
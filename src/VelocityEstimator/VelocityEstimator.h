@@ -0,0 +1,38 @@
+#ifndef SRC_VELOCITYESTIMATOR_H_
+#define SRC_VELOCITYESTIMATOR_H_
+
+/*
+ * Estimation de la vitesse d'une roue à partir de ses deltas codeur, pour l'asserv en vitesse.
+ *  Implémentations : Pll (bande passante fixe), AdaptivePll (bande passante suivant la vitesse),
+ *  KalmanVelocityEstimator (modèle à accélération constante).
+ *  Tout est en ticks : deltas fractionnaires (gains des codeurs), vitesse en ticks/s, accélération en ticks/s².
+ */
+class VelocityEstimator
+{
+public:
+    virtual ~VelocityEstimator()
+    {
+    }
+
+    virtual void update(float deltaPosition, float deltaT) = 0;
+
+    virtual float getSpeed() const = 0;
+
+    /*
+     * Accélération estimée, pour de l'anticipation (0 tant que l'estimateur n'est pas accroché)
+     */
+    virtual float getAcceleration() const = 0;
+
+    virtual void reset() = 0;
+
+    /*
+     * Nouvelle période nominale de la boucle (voir AsservMain::setLoopFrequency), pour les estimateurs dont les
+     *  gains en dépendent. Appelée hors de la boucle d'asserv, pendant qu'elle tourne
+     */
+    virtual void setPeriod(float period_s)
+    {
+        (void) period_s;
+    }
+};
+
+#endif /* SRC_VELOCITYESTIMATOR_H_ */
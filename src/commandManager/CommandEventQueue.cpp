@@ -0,0 +1,54 @@
+#include "CommandEventQueue.h"
+
+CommandEventQueue::CommandEventQueue()
+{
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+    m_lostEvents.store(0, std::memory_order_relaxed);
+    m_notifiedTail = 0;
+    chBSemObjectInit(&m_eventSemaphore, true);
+}
+
+bool CommandEventQueue::push(uint32_t commandId, CommandEvent::Type type)
+{
+    // La tête en acquire : le consommateur a fini de lire un emplacement avant qu'on le réécrive
+    uint8_t tail = m_tail.load(std::memory_order_relaxed);
+    uint8_t head = m_head.load(std::memory_order_acquire);
+    if ((tail + 2 * DEPTH - head) % (2 * DEPTH) == DEPTH)
+    {
+        m_lostEvents.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    CommandEvent &event = m_events[tail % DEPTH];
+    event.commandId = commandId;
+    event.type = type;
+    m_tail.store(next(tail), std::memory_order_release);
+    return true;
+}
+
+void CommandEventQueue::notify()
+{
+    uint8_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_notifiedTail)
+        return;
+
+    m_notifiedTail = tail;
+    chBSemSignal(&m_eventSemaphore);
+}
+
+bool CommandEventQueue::pop(CommandEvent *event)
+{
+    uint8_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire))
+        return false;
+
+    *event = m_events[head % DEPTH];
+    m_head.store(next(head), std::memory_order_release);
+    return true;
+}
+
+void CommandEventQueue::wait(sysinterval_t timeout)
+{
+    chBSemWaitTimeout(&m_eventSemaphore, timeout);
+}
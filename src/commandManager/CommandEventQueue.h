@@ -0,0 +1,68 @@
+#ifndef COMMAND_EVENT_QUEUE
+#define COMMAND_EVENT_QUEUE
+
+#include <cstdint>
+#include <atomic>
+#include "ch.h"
+
+/*
+ * Évènement de la vie d'une commande du CommandManager, repérée par son identifiant (voir Command::getId)
+ */
+struct CommandEvent
+{
+    typedef enum {
+        STARTED     = 0,    // devient la commande en cours
+        COMPLETED   = 1,    // but atteint, ou relais pris par la commande suivante (GotoNoStop)
+        PREEMPTED   = 2,    // interrompue en cours d'exécution (arrêt d'urgence, reset, remplacée par QUEUE_REPLACE_CURRENT : X)
+        FLUSHED     = 3,    // retirée sans avoir été exécutée (arrêt d'urgence, reset, clearPendingCommands : C)
+    } Type;
+
+    uint32_t commandId;
+    Type type;
+};
+
+/*
+ * File sans verrou des évènements des commandes, de la boucle d'asserv (producteur, CommandManager::update)
+ *  vers le thread qui les envoie au haut niveau (consommateur, asservPositionSerial dans raspIO.cpp).
+ *
+ *  Côté producteur, push() n'attend jamais : file pleine, l'évènement est perdu et compté (getLostEvents()).
+ *   notify() réveille ensuite le consommateur, une fois par mise à jour du CommandManager, sans attendre :
+ *   le consommateur est moins prioritaire. push() est aussi appelé par setEmergencyStop(), depuis le thread des
+ *   commandes sous chSysLock, quand la boucle d'asserv ne peut pas tourner : le réveil attend alors sa mise à jour suivante.
+ *  Côté consommateur, wait() attend un évènement publié au plus timeout, pop() les retire dans l'ordre.
+ *
+ *  Mêmes index que la CommandList : sur 2 * DEPTH, chacun écrit d'un seul côté.
+ */
+class CommandEventQueue
+{
+public:
+    static constexpr uint8_t DEPTH = 64;
+
+    CommandEventQueue();
+
+    bool push(uint32_t commandId, CommandEvent::Type type);
+    void notify();
+
+    bool pop(CommandEvent *event);
+    void wait(sysinterval_t timeout);
+
+    uint32_t getLostEvents() const
+    {
+        return m_lostEvents.load(std::memory_order_relaxed);
+    }
+
+private:
+    static inline uint8_t next(uint8_t index)
+    {
+        return (index + 1 == 2 * DEPTH) ? 0 : index + 1;
+    }
+
+    CommandEvent m_events[DEPTH];
+    std::atomic<uint8_t> m_head;    // prochain évènement à lire, écrit par le consommateur
+    std::atomic<uint8_t> m_tail;    // prochain emplacement libre, écrit par le producteur
+    std::atomic<uint32_t> m_lostEvents;
+    uint8_t m_notifiedTail;         // queue au dernier réveil du consommateur, côté producteur
+    binary_semaphore_t m_eventSemaphore;
+};
+
+#endif
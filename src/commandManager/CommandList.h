@@ -2,32 +2,189 @@
 #define CMD_LIST
 
 #include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "Commands/Command.h"
 
-class Command;
+// Plus grande taille parmi les types de commandes, à la compilation
+template<typename T>
+constexpr size_t commandMaxSizeof()
+{
+    return sizeof(T);
+}
+template<typename T, typename U, typename... Others>
+constexpr size_t commandMaxSizeof()
+{
+    return (sizeof(T) > commandMaxSizeof<U, Others...>()) ? sizeof(T) : commandMaxSizeof<U, Others...>();
+}
+
+// T fait-il partie des types de commandes
+template<typename T>
+constexpr bool commandIsOneOf()
+{
+    return false;
+}
+template<typename T, typename U, typename... Others>
+constexpr bool commandIsOneOf()
+{
+    return std::is_same<T, U>::value || commandIsOneOf<T, Others...>();
+}
+
+/*
+ * Emplacement d'une commande de n'importe lequel des types Commands : stockage à la taille et à l'alignement
+ *  du plus grand, calculés à la compilation, et adresse de la commande construite vue comme une Command
+ */
+template<typename... Commands>
+struct CommandSlot
+{
+    // Construit sur place une commande CommandT d'identifiant id (voir Command::getId)
+    template<typename CommandT, typename... Args>
+    Command* construct(uint32_t id, Args&&... args)
+    {
+        static_assert(commandIsOneOf<CommandT, Commands...>(), "command type not stored by this CommandSlot");
 
+        command = new (storage) CommandT(std::forward<Args>(args)...);
+        command->setId(id);
+        return command;
+    }
+
+    void destroy()
+    {
+        command->~Command();
+    }
+
+    alignas(Commands...) uint8_t storage[commandMaxSizeof<Commands...>()];
+    Command *command;
+};
+
+/*
+ * File des commandes, sans verrou, entre un producteur et un consommateur :
+ *  le thread qui ajoute les commandes (shell, raspIO) et la boucle d'asserv qui les exécute (CommandManager::update).
+ *
+ *  Le producteur construit la commande sur place dans un emplacement libre avec push<Type>(identifiant, paramètres du constructeur),
+ *   qui lui donne son identifiant (voir Command::getId) puis la publie (store release de la queue) : le consommateur ne la voit qu'entière (load acquire).
+ *  Le consommateur garde la commande de tête tant qu'il l'exécute, et pop() la détruit puis rend son emplacement
+ *   au producteur (store release de la tête, lu en acquire avant toute réutilisation).
+ *  Chaque index n'a qu'un écrivain : aucune attente, ni verrou, ni interruptions masquées d'un côté comme de l'autre.
+ *
+ *  Les Depth emplacements (CommandSlot) sont un tableau contigu, dans l'objet lui-même (pas d'allocation),
+ *   chacun à la taille du plus grand des types Commands. Seuls ces types peuvent être ajoutés.
+ *
+ *  Les index courent sur 2 * Depth pour distinguer file pleine et file vide sans emplacement perdu (Depth de 127 au plus).
+ */
+template<uint8_t Depth, typename... Commands>
 class CommandList
 {
 public:
-    explicit CommandList(uint8_t nbElement, uint8_t elementSize);
-    ~CommandList();
+    static_assert(Depth > 0 && Depth <= 127, "CommandList indexes run over 2 * Depth in 8 bits");
+
+    typedef CommandSlot<Commands...> Slot;
+
+    CommandList()
+    {
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+    }
 
+    ~CommandList()
+    {
+        flush();
+    }
 
-    Command* getFree();
-    bool push();
+    /*
+     * Côté producteur : construit une commande CommandT d'identifiant id dans l'emplacement libre et la publie,
+     *  false si la file est pleine
+     */
+    template<typename CommandT, typename... Args>
+    bool push(uint32_t id, Args&&... args)
+    {
+        static_assert(commandIsOneOf<CommandT, Commands...>(), "command type not stored by this CommandList");
 
-    Command* getFirst();
-    void pop();
-    Command const * getSecond();
-    
-    uint8_t size();
-    void flush();
+        // La tête en acquire : le consommateur a fini avec un emplacement avant qu'on le réutilise
+        uint8_t tail = m_tail.load(std::memory_order_relaxed);
+        if (count(m_head.load(std::memory_order_acquire), tail) == Depth)
+            return false;
+
+        m_slots[tail % Depth].template construct<CommandT>(id, std::forward<Args>(args)...);
+
+        // Publie la commande construite dans l'emplacement
+        m_tail.store(next(tail), std::memory_order_release);
+        return true;
+    }
+
+    /*
+     * Côté consommateur
+     */
+    Command* getFirst()
+    {
+        return get(0);
+    }
+
+    void pop()
+    {
+        uint8_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return; // List is empty
+
+        m_slots[head % Depth].destroy();
+        m_head.store(next(head), std::memory_order_release);
+    }
+
+    Command const * getSecond()
+    {
+        return get(1);
+    }
+
+    // index 0 : premier de la liste, nullptr au delà de la fin
+    Command * get(uint8_t index)
+    {
+        uint8_t head = m_head.load(std::memory_order_relaxed);
+        if (index >= count(head, m_tail.load(std::memory_order_acquire)))
+            return nullptr;
+
+        return m_slots[(head + index) % Depth].command;
+    }
+
+    // Des deux côtés : instantané, le producteur peut en ajouter ou le consommateur en retirer juste après
+    uint8_t size()
+    {
+        uint8_t head = m_head.load(std::memory_order_acquire);
+        return count(head, m_tail.load(std::memory_order_acquire));
+    }
+
+    /*
+     * Détruit et retire toutes les commandes : côté consommateur, ou depuis le producteur sous verrou quand
+     *  le consommateur ne peut pas tourner en même temps (thread d'asserv de plus haute priorité, sur un seul coeur)
+     */
+    void flush()
+    {
+        uint8_t head = m_head.load(std::memory_order_relaxed);
+        uint8_t tail = m_tail.load(std::memory_order_acquire);
+        for (; head != tail; head = next(head))
+            m_slots[head % Depth].destroy();
+        m_head.store(tail, std::memory_order_release);
+    }
 
 private:
-    uint8_t nbElement;
-    Command **commandList;
-    uint8_t nextFreePos;
-    uint8_t headPos;
-    bool full;
+    static inline uint8_t next(uint8_t index)
+    {
+        return (index + 1 == 2 * Depth) ? 0 : index + 1;
+    }
+    static inline uint8_t count(uint8_t head, uint8_t tail)
+    {
+        return (tail >= head) ? tail - head : tail + 2 * Depth - head;
+    }
+
+    Slot m_slots[Depth];
+    std::atomic<uint8_t> m_head;    // premier élément, écrit par le consommateur
+    std::atomic<uint8_t> m_tail;    // prochain emplacement libre, écrit par le producteur
+
+public:
+    // Taille d'un emplacement : le plus grand type de commande et son adresse vue comme une Command
+    static constexpr size_t SLOT_SIZE = sizeof(Slot);
 };
 
 #endif
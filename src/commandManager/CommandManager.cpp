@@ -3,6 +3,7 @@
 #include "Commands/Turn.h"
 #include "Commands/Goto.h"
 #include "Commands/GotoAngle.h"
+#include "Commands/SplinePath.h"
 #include <cstdlib>
 #include <cmath>
 #include <new>
@@ -13,134 +14,153 @@
 #include <chprintf.h>
 
 
-#define MAX(a,b) (((a)>(b))?(a):(b))
-#define COMMAND_MAX_SIZE MAX( MAX( MAX( MAX(sizeof(StraitLine), sizeof(Turn)), sizeof(Goto)), sizeof(GotoAngle) ), sizeof(GotoNoStop) )
 
 CommandManager::CommandManager(float straitLineArrivalWindows_mm, float turnArrivalWindows_rad,
-        Goto::GotoConfiguration &preciseGotoConfiguration, Goto::GotoConfiguration &waypointGotoConfiguration, GotoNoStop::GotoNoStopConfiguration &gotoNoStopConfiguration,
+        const Goto::GotoConfiguration &preciseGotoConfiguration, const Goto::GotoConfiguration &waypointGotoConfiguration, const GotoNoStop::GotoNoStopConfiguration &gotoNoStopConfiguration,
+        const SCurveProfile::Configuration &distanceProfileConfiguration, const SCurveProfile::Configuration &angleProfileConfiguration,
+        const SCurveProfile::Configuration &distanceBrakeConfiguration, const SCurveProfile::Configuration &angleBrakeConfiguration,
+        const LookAheadPlanner::Configuration &lookAheadConfiguration, const SplinePath::Configuration &splinePathConfiguration,
         const Regulator &angle_regulator, const Regulator &distance_regulator):
-		m_cmdList(32,COMMAND_MAX_SIZE),
 		m_straitLineArrivalWindows_mm(straitLineArrivalWindows_mm), m_turnArrivalWindows_rad(turnArrivalWindows_rad),
 		m_preciseGotoConfiguration(preciseGotoConfiguration), m_waypointGotoConfiguration(waypointGotoConfiguration), m_gotoNoStopConfiguration(gotoNoStopConfiguration),
+		m_distanceProfileConfiguration(distanceProfileConfiguration), m_angleProfileConfiguration(angleProfileConfiguration),
+		m_distanceBrakeConfiguration(distanceBrakeConfiguration), m_angleBrakeConfiguration(angleBrakeConfiguration),
+		m_lookAheadPlanner(lookAheadConfiguration), m_splinePathConfiguration(splinePathConfiguration),
 		m_angle_regulator(angle_regulator), m_distance_regulator(distance_regulator)
 {
-    m_emergencyStop = false;
+    m_emergencyStop.store(false, std::memory_order_relaxed);
     m_currentCmd = nullptr;
+    m_lastCommandId = 0;
     m_angleRegulatorConsign = 0;
     m_distRegulatorConsign = 0;
+    m_motionProfileEnabled = true;
+    m_lookAheadEnabled = true;
+    m_followingProfile = false;
+    m_angleSpeedConsign = 0;
+    m_distSpeedConsign = 0;
+    m_angleAccelerationConsign = 0;
+    m_distAccelerationConsign = 0;
+
+    m_prioritySlotsInUse.store(0, std::memory_order_relaxed);
+    m_pendingOperation.store(OPERATION_NONE, std::memory_order_relaxed);
+    m_operationSlot = 0;
+    m_operationLastId = 0;
+    m_flushRequested.store(false, std::memory_order_relaxed);
+    m_flushLastId.store(0, std::memory_order_relaxed);
+    m_insertedCount = 0;
+    m_currentSlot = -1;
+    m_skippedCommands = 0;
+    m_pendingCountOffset.store(0, std::memory_order_relaxed);
+    m_lastDistanceAccumulator = 0;
+    m_lastAngleAccumulator = 0;
+    m_distanceSpeed = 0;
+    m_angleSpeed = 0;
+    m_pauseRequested.store(false, std::memory_order_relaxed);
+    m_paused.store(false, std::memory_order_relaxed);
+    m_startOnResume = false;
+    m_distanceProfileMaxAcceleration = distanceProfileConfiguration.maxAcceleration;
+    m_angleProfileMaxAcceleration = angleProfileConfiguration.maxAcceleration;
+    m_distanceBrakeMaxAcceleration = distanceBrakeConfiguration.maxAcceleration;
+    m_angleBrakeMaxAcceleration = angleBrakeConfiguration.maxAcceleration;
+    m_accelerationScale = 1;
+    m_replanProfile = false;
 }
 
 extern BaseSequentialStream *outputStream;
 
-bool CommandManager::addStraightLine(float valueInmm)
+bool CommandManager::addStraightLine(float valueInmm, QueueMode mode)
 {
-    Command *ptr = m_cmdList.getFree();
-    if(ptr == nullptr)
-        return false;
-
-    new (ptr) StraitLine(valueInmm, m_straitLineArrivalWindows_mm);
-
-    return m_cmdList.push();
+    return addCommand<StraitLine>(mode, valueInmm, m_straitLineArrivalWindows_mm, m_motionProfileEnabled ? &m_distanceProfileConfiguration : nullptr);
 }
 
-bool CommandManager::addTurn(float angleInRad)
+bool CommandManager::addTurn(float angleInRad, QueueMode mode)
 {
-    Command *ptr = m_cmdList.getFree();
-    if(ptr == nullptr)
-        return false;
-
-    new (ptr) Turn(angleInRad, m_turnArrivalWindows_rad);
-    m_cmdList.push();
-    return true;
+    return addCommand<Turn>(mode, angleInRad, m_turnArrivalWindows_rad, m_motionProfileEnabled ? &m_angleProfileConfiguration : nullptr);
 }
 
-bool CommandManager::addGoTo(float posXInmm, float posYInmm)
+bool CommandManager::addGoTo(float posXInmm, float posYInmm, QueueMode mode)
 {
-    Command *ptr = m_cmdList.getFree();
-    if(ptr == nullptr)
-        return false;
-
-    new (ptr) Goto(posXInmm, posYInmm, &m_preciseGotoConfiguration);
-    m_cmdList.push();
-    return true;
+    return addCommand<Goto>(mode, posXInmm, posYInmm, &m_preciseGotoConfiguration);
 }
 
-bool CommandManager::addGoToWaypoint(float posXInmm, float posYInmm)
+bool CommandManager::addGoToWaypoint(float posXInmm, float posYInmm, QueueMode mode)
 {
-    Command *ptr = m_cmdList.getFree();
-    if(ptr == nullptr)
-        return false;
-
-    new (ptr) Goto(posXInmm, posYInmm, &m_waypointGotoConfiguration);
-    m_cmdList.push();
-    return true;
+    return addCommand<Goto>(mode, posXInmm, posYInmm, &m_waypointGotoConfiguration);
 }
 
-bool CommandManager::addGoToBack(float posXInmm, float posYInmm)
+bool CommandManager::addGoToBack(float posXInmm, float posYInmm, QueueMode mode)
 {
-    Command *ptr = m_cmdList.getFree();
-    if(ptr == nullptr)
-        return false;
+    return addCommand<Goto>(mode, posXInmm, posYInmm, &m_preciseGotoConfiguration, true);
+}
 
-    new (ptr) Goto(posXInmm, posYInmm, &m_preciseGotoConfiguration, true);
-    m_cmdList.push();
-    return true;
+bool CommandManager::addGoToNoStop(float posXInmm, float posYInmm, QueueMode mode)
+{
+    return addCommand<GotoNoStop>(mode, posXInmm, posYInmm, &m_gotoNoStopConfiguration, &m_preciseGotoConfiguration);
 }
 
-bool CommandManager::addGoToNoStop(float posXInmm, float posYInmm)
+bool CommandManager::addGoToNoStopBack(float posXInmm, float posYInmm, QueueMode mode)
 {
-    Command *ptr = m_cmdList.getFree();
-    if(ptr == nullptr)
-        return false;
+    return addCommand<GotoNoStop>(mode, posXInmm, posYInmm, &m_gotoNoStopConfiguration, &m_preciseGotoConfiguration, true);
+}
 
-    new (ptr) GotoNoStop(posXInmm, posYInmm, &m_gotoNoStopConfiguration, &m_preciseGotoConfiguration);
-    m_cmdList.push();
-    return true;
+bool CommandManager::addGoToAngle(float posXInmm, float posYInmm, QueueMode mode)
+{
+    return addCommand<GotoAngle>(mode, posXInmm, posYInmm, m_turnArrivalWindows_rad);
 }
 
-bool CommandManager::addGoToNoStopBack(float posXInmm, float posYInmm)
+bool CommandManager::addSpline(float const *posXInmm, float const *posYInmm, uint8_t count, QueueMode mode)
 {
-    Command *ptr = m_cmdList.getFree();
-    if(ptr == nullptr)
+    if (count == 0 || count > SplinePath::MAX_POINTS)
         return false;
 
-    new (ptr) GotoNoStop(posXInmm, posYInmm, &m_gotoNoStopConfiguration, &m_preciseGotoConfiguration, true);
-    m_cmdList.push();
-    return true;
+    return addCommand<SplinePath>(mode, posXInmm, posYInmm, count, &m_splinePathConfiguration, &m_splinePathTable);
 }
 
-bool CommandManager::addGoToAngle(float posXInmm, float posYInmm)
+void CommandManager::setEmergencyStop()
 {
-    Command *ptr = m_cmdList.getFree();
-    if(ptr == nullptr)
-        return false;
+    m_angleRegulatorConsign = m_angle_regulator.getAccumulator();
+    m_distRegulatorConsign = m_distance_regulator.getAccumulator();
+    requestFlush();
+    m_emergencyStop.store(true, std::memory_order_release);
+}
 
-    new (ptr) GotoAngle(posXInmm, posYInmm, m_turnArrivalWindows_rad);
-    m_cmdList.push();
-    return true;
+void CommandManager::resetEmergencyStop()
+{
+    m_emergencyStop.store(false, std::memory_order_release);
 }
 
-void CommandManager::setEmergencyStop()
+void CommandManager::reset()
 {
     m_angleRegulatorConsign = m_angle_regulator.getAccumulator();
     m_distRegulatorConsign = m_distance_regulator.getAccumulator();
+    requestFlush();
+}
 
-    m_cmdList.flush();
-    m_currentCmd = nullptr;
+void CommandManager::requestFlush()
+{
+    // Le vidage prend le pas sur la pause : plus rien à reprendre
+    m_pauseRequested.store(false, std::memory_order_relaxed);
+    m_flushLastId.store(m_lastCommandId, std::memory_order_relaxed);
+    m_flushRequested.store(true, std::memory_order_release);
+}
 
-    m_emergencyStop = true;
+void CommandManager::pause()
+{
+    m_pauseRequested.store(true, std::memory_order_release);
 }
 
-void CommandManager::resetEmergencyStop()
+void CommandManager::resume()
 {
-    m_emergencyStop = false;
+    m_pauseRequested.store(false, std::memory_order_release);
 }
 
 CommandManager::CommandStatus CommandManager::getCommandStatus()
 {
 
-    if( m_emergencyStop )
+    if (m_emergencyStop.load(std::memory_order_relaxed))
         return STATUS_HALTED;
+    else if (m_paused.load(std::memory_order_relaxed))
+        return STATUS_PAUSED;
     else if (m_currentCmd == nullptr)
         return STATUS_IDLE;
     else
@@ -149,37 +169,429 @@ CommandManager::CommandStatus CommandManager::getCommandStatus()
 
 uint8_t CommandManager::getPendingCommandCount()
 {
-    return m_cmdList.size();
+    // Instantané, depuis n'importe quel thread : les commandes prioritaires sont comptées à la fin de chaque mise à jour
+    int count = m_cmdList.size() + m_pendingCountOffset.load(std::memory_order_relaxed);
+    return (count > 0) ? count : 0;
 }
 
+bool CommandManager::clearPendingCommands()
+{
+    if (m_pendingOperation.load(std::memory_order_acquire) != OPERATION_NONE)
+        return false;
+
+    postOperation(OPERATION_CLEAR, 0);
+    return true;
+}
+
+int8_t CommandManager::reserveOperationSlot()
+{
+    // Une opération à la fois : la précédente a été appliquée, et son emplacement marqué occupé, avant OPERATION_NONE
+    if (m_pendingOperation.load(std::memory_order_acquire) != OPERATION_NONE)
+        return -1;
+
+    // En acquire : la boucle d'asserv a fini de détruire la commande d'un emplacement avant de le rendre
+    uint8_t inUse = m_prioritySlotsInUse.load(std::memory_order_acquire);
+    for (uint8_t slot = 0; slot < PRIORITY_SLOTS; slot++)
+    {
+        if ((inUse & (1 << slot)) == 0)
+            return slot;
+    }
+    return -1;
+}
+
+void CommandManager::postOperation(QueueOperation operation, uint8_t slot)
+{
+    m_operationSlot = slot;
+    m_operationLastId = m_lastCommandId;
+    m_pendingOperation.store(operation, std::memory_order_release);
+}
+
+bool CommandManager::applyQueueOperation()
+{
+    uint8_t operation = m_pendingOperation.load(std::memory_order_acquire);
+    if (operation == OPERATION_NONE)
+        return false;
+
+    if (operation == OPERATION_CLEAR)
+    {
+        dropPendingCommands(m_operationLastId);
+    }
+    else
+    {
+        m_prioritySlotsInUse.store(m_prioritySlotsInUse.load(std::memory_order_relaxed) | (1 << m_operationSlot), std::memory_order_relaxed);
+        if (operation == OPERATION_INSERT)
+            m_insertedSlots[m_insertedCount++] = m_operationSlot;
+        else
+            replaceCurrentCommand(m_operationSlot);
+    }
+
+    // Rend la main au producteur pour l'opération suivante
+    m_pendingOperation.store(OPERATION_NONE, std::memory_order_release);
+    return operation == OPERATION_REPLACE;
+}
+
+void CommandManager::replaceCurrentCommand(uint8_t slot)
+{
+    Command *cmd = m_prioritySlots[slot].command;
+    if (m_currentCmd != nullptr)
+    {
+        m_events.push(m_currentCmd->getId(), CommandEvent::PREEMPTED);
+        releaseCurrentCommand();
+
+        /* Les consignes de la commande interrompue sont en avance sur le robot : elles repartent des accumulateurs,
+         *  pour que la nouvelle commande se calcule depuis la pose actuelle, et une commande à profil part de la vitesse
+         *  actuelle plutôt que de l'arrêt. Le robot enchaîne vers le nouveau but sans s'arrêter.
+         */
+        if (!m_paused.load(std::memory_order_relaxed))
+        {
+            m_distRegulatorConsign = m_distance_regulator.getAccumulator();
+            m_angleRegulatorConsign = m_angle_regulator.getAccumulator();
+            cmd->setEntrySpeed(m_distanceSpeed, m_angleSpeed);
+        }
+    }
+
+    // Pendant une pause, les consignes restent au freinage : la commande ne démarre qu'à la reprise
+    m_startOnResume = m_paused.load(std::memory_order_relaxed);
+    m_currentSlot = slot;
+    m_currentCmd = cmd;
+    m_events.push(m_currentCmd->getId(), CommandEvent::STARTED);
+}
+
+void CommandManager::dropPendingCommands(uint32_t lastId)
+{
+    // Dans l'ordre d'exécution, chacune avec son évènement
+    while (m_insertedCount > 0)
+    {
+        uint8_t slot = m_insertedSlots[--m_insertedCount];
+        m_events.push(m_prioritySlots[slot].command->getId(), CommandEvent::FLUSHED);
+        releasePrioritySlot(slot);
+    }
+
+    // Seules les commandes ajoutées avant l'opération, qui ont un identifiant plus petit
+    Command *cmd;
+    if (m_currentCmd != nullptr && m_currentSlot < 0)
+    {
+        // La commande en cours est en tête de file : les suivantes sont sautées, et détruites avec elle
+        while ((cmd = m_cmdList.get(1 + m_skippedCommands)) != nullptr && cmd->getId() <= lastId)
+        {
+            m_events.push(cmd->getId(), CommandEvent::FLUSHED);
+            m_skippedCommands++;
+        }
+    }
+    else
+    {
+        while ((cmd = m_cmdList.getFirst()) != nullptr && cmd->getId() <= lastId)
+        {
+            m_events.push(cmd->getId(), CommandEvent::FLUSHED);
+            m_cmdList.pop();
+        }
+    }
+}
+
+void CommandManager::releaseCurrentCommand()
+{
+    if (m_currentSlot >= 0)
+    {
+        releasePrioritySlot(m_currentSlot);
+        m_currentSlot = -1;
+    }
+    else
+    {
+        m_cmdList.pop();
+        for (; m_skippedCommands > 0; m_skippedCommands--)
+            m_cmdList.pop();
+    }
+    m_currentCmd = nullptr;
+}
+
+void CommandManager::releasePrioritySlot(uint8_t slot)
+{
+    m_prioritySlots[slot].destroy();
+    m_prioritySlotsInUse.store(m_prioritySlotsInUse.load(std::memory_order_relaxed) & ~(1 << slot), std::memory_order_release);
+}
+
+Command* CommandManager::getQueuedCommand(uint8_t index)
+{
+    // Ordre d'exécution : commande en cours, commandes insérées en tête (la dernière d'abord), puis la file
+    if (m_currentCmd != nullptr)
+    {
+        if (index == 0)
+            return m_currentCmd;
+        index--;
+    }
+    if (index < m_insertedCount)
+        return m_prioritySlots[m_insertedSlots[m_insertedCount - 1 - index]].command;
+    index -= m_insertedCount;
+
+    // Commande en cours en tête de file, et celles qui sont déjà retirées derrière elle
+    if (m_currentCmd != nullptr && m_currentSlot < 0)
+        index += 1 + m_skippedCommands;
+    return m_cmdList.get(index);
+}
+
+void CommandManager::publishPendingCount()
+{
+    int8_t priorityCommands = m_insertedCount + ((m_currentSlot >= 0) ? 1 : 0);
+    m_pendingCountOffset.store(priorityCommands - m_skippedCommands, std::memory_order_relaxed);
+}
 
 void CommandManager::switchToNextCommand()
 {
     if (m_currentCmd != nullptr)
-       m_cmdList.pop();
+    {
+        m_events.push(m_currentCmd->getId(), CommandEvent::COMPLETED);
+        releaseCurrentCommand();
+    }
+
+    if (m_insertedCount > 0)
+    {
+        m_currentSlot = m_insertedSlots[--m_insertedCount];
+        m_currentCmd = m_prioritySlots[m_currentSlot].command;
+    }
+    else
+    {
+        m_currentCmd = m_cmdList.getFirst();
+    }
+    if (m_currentCmd != nullptr)
+        m_events.push(m_currentCmd->getId(), CommandEvent::STARTED);
+}
+
+void CommandManager::flushCommands(uint32_t lastId)
+{
+    /* Retire les commandes une à une pour publier l'évènement de chacune : la commande en cours est interrompue,
+     *  les suivantes n'ont pas été exécutées. Les commandes insérées ont été appliquées avant la demande ; les
+     *  autres ajoutées après (identifiant plus grand que lastId) sont gardées.
+     */
+    if (m_currentCmd != nullptr && m_currentCmd->getId() <= lastId)
+    {
+        m_events.push(m_currentCmd->getId(), CommandEvent::PREEMPTED);
+        releaseCurrentCommand();
+    }
+
+    // Opération pas encore appliquée : la commande qu'elle porte n'est pas exécutée non plus
+    uint8_t operation = m_pendingOperation.load(std::memory_order_acquire);
+    if (operation == OPERATION_REPLACE || operation == OPERATION_INSERT)
+    {
+        if (m_prioritySlots[m_operationSlot].command->getId() <= lastId)
+        {
+            m_events.push(m_prioritySlots[m_operationSlot].command->getId(), CommandEvent::FLUSHED);
+            m_prioritySlots[m_operationSlot].destroy();
+            m_pendingOperation.store(OPERATION_NONE, std::memory_order_release);
+        }
+    }
+    else if (operation == OPERATION_CLEAR && m_operationLastId <= lastId)
+    {
+        m_pendingOperation.store(OPERATION_NONE, std::memory_order_release);
+    }
+
+    dropPendingCommands(lastId);
+}
+
+void CommandManager::startCommand(float X_mm, float Y_mm, float theta_rad)
+{
+    planJunctionSpeeds(X_mm, Y_mm);
+    m_currentCmd->computeInitialConsign(X_mm, Y_mm, theta_rad, &m_distRegulatorConsign, &m_angleRegulatorConsign, m_angle_regulator, m_distance_regulator);
+}
+
+void CommandManager::startPause()
+{
+    /* Freinage à la vitesse mesurée, sur la distance de la décélération seule : le profil part de la vitesse actuelle et
+     *  descend à l'arrêt. L'axe immobile d'une commande à profil part de sa consigne, qui garde son but ; sinon le freinage
+     *  part de la pose : la consigne d'un Goto est loin devant le robot, celle d'un profil un peu devant (le retard de l'asserv
+     *  en vitesse), que le robot rattraperait en plus de la distance de freinage.
+     */
+    const float distanceOrigin = (m_followingProfile && m_distSpeedConsign == 0) ? m_distRegulatorConsign : m_distance_regulator.getAccumulator();
+    const float angleOrigin = (m_followingProfile && m_angleSpeedConsign == 0) ? m_angleRegulatorConsign : m_angle_regulator.getAccumulator();
+    m_distanceBrake.plan(distanceOrigin,
+            copysignf(SCurveProfile::stoppingDistance(m_distanceSpeed, m_distanceBrakeConfiguration), m_distanceSpeed),
+            m_distanceBrakeConfiguration, m_distanceSpeed);
+    m_angleBrake.plan(angleOrigin,
+            copysignf(SCurveProfile::stoppingDistance(m_angleSpeed, m_angleBrakeConfiguration), m_angleSpeed),
+            m_angleBrakeConfiguration, m_angleSpeed);
+    m_distRegulatorConsign = m_distanceBrake.getPosition();
+    m_angleRegulatorConsign = m_angleBrake.getPosition();
+
+    m_paused.store(true, std::memory_order_relaxed);
+    m_startOnResume = false;
+}
+
+void CommandManager::resumeCurrentCommand(float X_mm, float Y_mm, float theta_rad)
+{
+    m_paused.store(false, std::memory_order_relaxed);
+    if (m_currentCmd == nullptr)
+        return;
+
+    // Depuis la consigne de freinage, à sa vitesse si le robot n'était pas encore arrêté
+    m_currentCmd->setEntrySpeed(m_distanceBrake.getSpeed(), m_angleBrake.getSpeed());
+    if (m_startOnResume)
+    {
+        // Commande de remplacement : depuis la pose, comme un remplacement hors pause (voir replaceCurrentCommand())
+        m_distRegulatorConsign = m_distance_regulator.getAccumulator();
+        m_angleRegulatorConsign = m_angle_regulator.getAccumulator();
+        startCommand(X_mm, Y_mm, theta_rad);
+        return;
+    }
 
-    m_currentCmd = m_cmdList.getFirst();
+    planJunctionSpeeds(X_mm, Y_mm);
+    m_currentCmd->resume(X_mm, Y_mm, theta_rad, &m_distRegulatorConsign, &m_angleRegulatorConsign, m_angle_regulator, m_distance_regulator);
 }
 
+void CommandManager::setAccelerationScale(float scale)
+{
+    if (scale == m_accelerationScale)
+        return;
+
+    // Les prochains profils (commandes, freinage) sont planifiés aux accélérations baissées
+    if (scale < m_accelerationScale)
+        m_replanProfile = true;
+    m_accelerationScale = scale;
+    m_distanceProfileConfiguration.maxAcceleration = m_distanceProfileMaxAcceleration * scale;
+    m_angleProfileConfiguration.maxAcceleration = m_angleProfileMaxAcceleration * scale;
+    m_distanceBrakeConfiguration.maxAcceleration = m_distanceBrakeMaxAcceleration * scale;
+    m_angleBrakeConfiguration.maxAcceleration = m_angleBrakeMaxAcceleration * scale;
+}
 
-void CommandManager::update(float X_mm, float Y_mm, float theta_rad)
+void CommandManager::replanCurrentCommand(float X_mm, float Y_mm, float theta_rad)
 {
-    if (m_emergencyStop)
+    /* Le profil en cours a été planifié avant le patinage : il repart de la pose et de la vitesse mesurée, comme une
+     *  commande de remplacement (voir replaceCurrentCommand()), vers le même but (voir Command::resume).
+     */
+    m_distRegulatorConsign = m_distance_regulator.getAccumulator();
+    m_angleRegulatorConsign = m_angle_regulator.getAccumulator();
+    m_currentCmd->setEntrySpeed(m_distanceSpeed, m_angleSpeed);
+    m_currentCmd->resume(X_mm, Y_mm, theta_rad, &m_distRegulatorConsign, &m_angleRegulatorConsign, m_angle_regulator, m_distance_regulator);
+}
+
+void CommandManager::update(float X_mm, float Y_mm, float theta_rad, float deltaT)
+{
+    float distanceAccumulator = m_distance_regulator.getAccumulator();
+    float angleAccumulator = m_angle_regulator.getAccumulator();
+    if (deltaT > 0)
+    {
+        m_distanceSpeed = (distanceAccumulator - m_lastDistanceAccumulator) / deltaT;
+        m_angleSpeed = (angleAccumulator - m_lastAngleAccumulator) / deltaT;
+    }
+    m_lastDistanceAccumulator = distanceAccumulator;
+    m_lastAngleAccumulator = angleAccumulator;
+
+    // Vidage demandé par le producteur : depuis la position, sans pause ni commande à reprendre
+    if (m_flushRequested.exchange(false, std::memory_order_acq_rel))
+    {
+        m_distRegulatorConsign = distanceAccumulator;
+        m_angleRegulatorConsign = angleAccumulator;
+        m_paused.store(false, std::memory_order_relaxed);
+        m_startOnResume = false;
+        flushCommands(m_flushLastId.load(std::memory_order_relaxed));
+    }
+
+    const bool replanProfile = m_replanProfile;
+    m_replanProfile = false;
+
+    if (m_emergencyStop.load(std::memory_order_acquire))
     {
-        m_cmdList.flush();
-        m_currentCmd = nullptr;
+        updateProfileSpeed();
+        publishPendingCount();
+        m_events.notify();
         return;
     }
 
-    if (m_currentCmd != nullptr && !m_currentCmd->isGoalReached(X_mm, Y_mm, theta_rad, m_angle_regulator, m_distance_regulator, m_cmdList.getSecond()))
+    const bool pauseRequested = m_pauseRequested.load(std::memory_order_acquire);
+    if (pauseRequested && !m_paused.load(std::memory_order_relaxed))
+        startPause();
+
+    if (m_paused.load(std::memory_order_relaxed))
+    {
+        // Opérations sur la file appliquées, la commande en cours n'avance pas
+        applyQueueOperation();
+        if (pauseRequested)
+        {
+            m_distanceBrake.step(deltaT);
+            m_angleBrake.step(deltaT);
+            m_distRegulatorConsign = m_distanceBrake.getPosition();
+            m_angleRegulatorConsign = m_angleBrake.getPosition();
+        }
+        else
+        {
+            resumeCurrentCommand(X_mm, Y_mm, theta_rad);
+        }
+    }
+    else if (applyQueueOperation())
+    {
+        // Commande de remplacement, démarrée dès cette mise à jour
+        startCommand(X_mm, Y_mm, theta_rad);
+    }
+    else if (m_currentCmd != nullptr && !m_currentCmd->isGoalReached(X_mm, Y_mm, theta_rad, m_angle_regulator, m_distance_regulator, getQueuedCommand(1)))
     {
-        m_currentCmd->updateConsign(X_mm, Y_mm, theta_rad, &m_distRegulatorConsign, &m_angleRegulatorConsign, m_angle_regulator, m_distance_regulator);
+        planJunctionSpeeds(X_mm, Y_mm);
+        if (replanProfile && m_followingProfile)
+            replanCurrentCommand(X_mm, Y_mm, theta_rad);
+        else
+            m_currentCmd->updateConsign(X_mm, Y_mm, theta_rad, &m_distRegulatorConsign, &m_angleRegulatorConsign, m_angle_regulator, m_distance_regulator, deltaT);
     }
     else
     {
         switchToNextCommand();
         if( m_currentCmd != nullptr )
-            m_currentCmd->computeInitialConsign(X_mm, Y_mm, theta_rad, &m_distRegulatorConsign, &m_angleRegulatorConsign, m_angle_regulator, m_distance_regulator);
+            startCommand(X_mm, Y_mm, theta_rad);
+    }
+
+    updateProfileSpeed();
+    publishPendingCount();
+    m_events.notify();
+}
+
+void CommandManager::planJunctionSpeeds(float X_mm, float Y_mm)
+{
+    if (!m_lookAheadEnabled)
+        return;
+
+    /* Le chemin part de la position actuelle et suit les commandes enchaînables de tête de liste,
+     *  la commande en cours étant la première. La sortie du régulateur de distance donne la vitesse de départ.
+     */
+    m_lookAheadPlanner.reset(X_mm, Y_mm, m_distance_regulator.getOutput());
+
+    for (uint8_t i = 0; i < LookAheadPlanner::MAX_WAYPOINTS; i++)
+    {
+        Command *cmd = getQueuedCommand(i);
+        float X_waypoint, Y_waypoint;
+        bool backward;
+        if (cmd == nullptr || !cmd->getWaypoint(&X_waypoint, &Y_waypoint, &backward))
+            break;
+        m_lookAheadPlanner.addWaypoint(X_waypoint, Y_waypoint, backward);
+    }
+
+    if (m_lookAheadPlanner.getWaypointCount() == 0)
+        return;
+
+    m_lookAheadPlanner.plan();
+
+    Command::PlannedSpeed plannedSpeed;
+    plannedSpeed.entrySpeed = fabsf(m_distance_regulator.getOutput());
+    plannedSpeed.exitSpeed = m_lookAheadPlanner.getJunctionSpeed(0);
+    plannedSpeed.maxAcceleration = m_lookAheadPlanner.getConfiguration().maxAcceleration;
+    plannedSpeed.passDistance_mm = m_lookAheadPlanner.getPassDistance(0);
+    m_currentCmd->setPlannedSpeed(plannedSpeed);
+}
+
+void CommandManager::updateProfileSpeed()
+{
+    // En pause, le freinage est un profil : les limiteurs d'accélération ne freinent pas
+    if (m_paused.load(std::memory_order_relaxed))
+    {
+        m_followingProfile = true;
+        m_distanceBrake.getFeedForward(&m_distSpeedConsign, &m_distAccelerationConsign);
+        m_angleBrake.getFeedForward(&m_angleSpeedConsign, &m_angleAccelerationConsign);
+        return;
+    }
+
+    m_followingProfile = m_currentCmd != nullptr && m_currentCmd->getProfileSpeed(&m_distSpeedConsign, &m_angleSpeedConsign,
+            &m_distAccelerationConsign, &m_angleAccelerationConsign);
+    if (!m_followingProfile)
+    {
+        m_distSpeedConsign = 0;
+        m_angleSpeedConsign = 0;
+        m_distAccelerationConsign = 0;
+        m_angleAccelerationConsign = 0;
     }
 }
 
@@ -1,12 +1,27 @@
 #ifndef COMMAND_MANAGER
 #define COMMAND_MANAGER
 
+#include <utility>
+#include <atomic>
 #include "CommandList.h"
+#include "CommandEventQueue.h"
 #include "Commands/StraitLine.h"
+#include "Commands/Turn.h"
 #include "Commands/Goto.h"
+#include "Commands/GotoAngle.h"
 #include "Commands/GotoNoStop.h"
+#include "Commands/SplinePath.h"
+#include "SCurveProfile.h"
+#include "LookAheadPlanner.h"
 #include "Regulator.h"
 
+/*
+ * Profondeur de la file des commandes, réglable à la compilation (make COMMAND_LIST_DEPTH=...)
+ */
+#ifndef COMMAND_MANAGER_LIST_DEPTH
+#define COMMAND_MANAGER_LIST_DEPTH 32
+#endif
+
 class Command;
 
 class CommandManager
@@ -18,36 +33,136 @@ class CommandManager
             STATUS_RUNNING  = 1,
             STATUS_HALTED   = 2,
             STATUS_BLOCKED  = 3,
+            STATUS_PAUSED   = 4,
         } CommandStatus;
 
+        /*
+         * File des commandes en attente : COMMAND_LIST_DEPTH emplacements, dans l'objet lui-même,
+         *  à la taille de la plus grande commande (voir CommandList)
+         */
+        static constexpr uint8_t COMMAND_LIST_DEPTH = COMMAND_MANAGER_LIST_DEPTH;
+        static_assert(COMMAND_MANAGER_LIST_DEPTH > 0 && COMMAND_MANAGER_LIST_DEPTH <= 127, "CommandList indexes run over 2 * depth in 8 bits");
+        typedef CommandList<COMMAND_LIST_DEPTH, StraitLine, Turn, Goto, GotoAngle, GotoNoStop, SplinePath> CommandQueue;
+
+        /*
+         * Place d'une commande ajoutée par un add*(). Hors QUEUE_APPEND, la commande est construite dans l'un des
+         *  PRIORITY_SLOTS emplacements prioritaires, puis placée par la boucle d'asserv à sa mise à jour suivante
+         *  (une seule opération en attente à la fois, add*() rend false sinon, voir applyQueueOperation()).
+         */
+        typedef enum {
+            QUEUE_APPEND            = 0,    // en fin de file
+            QUEUE_REPLACE_CURRENT   = 1,    // interrompt la commande en cours et prend sa place, sans arrêt du robot. La file est gardée.
+            QUEUE_INSERT_HEAD       = 2,    // exécutée dès la fin de la commande en cours, avant la file (la dernière insérée d'abord)
+        } QueueMode;
+        static constexpr uint8_t PRIORITY_SLOTS = 4;
+
+        /*
+         * RAM occupée par la file et les emplacements prioritaires, en octets, calculée à la compilation.
+         *  Bornée par MAX_QUEUE_FOOTPRINT (8 Ko sur les 128 Ko du STM32F4) : une commande qui grossit, ou une file
+         *  plus profonde, qui la dépasse ne compile plus
+         */
+        static constexpr size_t QUEUE_FOOTPRINT = sizeof(CommandQueue) + PRIORITY_SLOTS * sizeof(CommandQueue::Slot);
+        static constexpr size_t MAX_QUEUE_FOOTPRINT = 8192;
+        static_assert(QUEUE_FOOTPRINT <= MAX_QUEUE_FOOTPRINT, "command queue above its RAM budget, see MAX_QUEUE_FOOTPRINT");
+
         explicit CommandManager(float straitLineArrivalWindows_mm, float turnArrivalWindows_rad,
-                Goto::GotoConfiguration &preciseGotoConfiguration, Goto::GotoConfiguration &waypointGotoConfiguration, GotoNoStop::GotoNoStopConfiguration &gotoNoStopConfiguration,
+                const Goto::GotoConfiguration &preciseGotoConfiguration, const Goto::GotoConfiguration &waypointGotoConfiguration, const GotoNoStop::GotoNoStopConfiguration &gotoNoStopConfiguration,
+                const SCurveProfile::Configuration &distanceProfileConfiguration, const SCurveProfile::Configuration &angleProfileConfiguration,
+                const SCurveProfile::Configuration &distanceBrakeConfiguration, const SCurveProfile::Configuration &angleBrakeConfiguration,
+                const LookAheadPlanner::Configuration &lookAheadConfiguration, const SplinePath::Configuration &splinePathConfiguration,
                 const Regulator &angle_regulator, const Regulator &distance_regulator);
         ~CommandManager() {};
 
         /*
          * Commandes ajoutables a la liste des consignes du robot
          */
-        bool addStraightLine(float valueInmm);
-        bool addTurn(float angleInDeg);
-        bool addGoTo(float posXInmm, float posYInmm);
-        bool addGoToWaypoint(float posXInmm, float posYInmm);
-        bool addGoToBack(float posXInmm, float posYInmm);
-        bool addGoToNoStop(float posXInmm, float posYInmm);
-        bool addGoToNoStopBack(float posXInmm, float posYInmm);
-        bool addGoToAngle(float posXInmm, float posYInmm);
+        bool addStraightLine(float valueInmm, QueueMode mode = QUEUE_APPEND);
+        bool addTurn(float angleInDeg, QueueMode mode = QUEUE_APPEND);
+        bool addGoTo(float posXInmm, float posYInmm, QueueMode mode = QUEUE_APPEND);
+        bool addGoToWaypoint(float posXInmm, float posYInmm, QueueMode mode = QUEUE_APPEND);
+        bool addGoToBack(float posXInmm, float posYInmm, QueueMode mode = QUEUE_APPEND);
+        bool addGoToNoStop(float posXInmm, float posYInmm, QueueMode mode = QUEUE_APPEND);
+        bool addGoToNoStopBack(float posXInmm, float posYInmm, QueueMode mode = QUEUE_APPEND);
+        bool addGoToAngle(float posXInmm, float posYInmm, QueueMode mode = QUEUE_APPEND);
+
+        /*
+         * Suivi d'une courbe lisse passant par 'count' points (au plus SplinePath::MAX_POINTS), en marche avant
+         */
+        bool addSpline(float const *posXInmm, float const *posYInmm, uint8_t count, QueueMode mode = QUEUE_APPEND);
+
+        /*
+         * Retire les commandes en attente (file et commandes insérées en tête) en gardant la commande en cours,
+         *  à la mise à jour suivante de la boucle d'asserv. Les commandes ajoutées ensuite ne sont pas retirées.
+         *  false si une opération est déjà en attente.
+         */
+        bool clearPendingCommands();
+
+        /*
+         * Identifiant de la dernière commande ajoutée (côté producteur), 0 avant la première.
+         *  Chaque commande acceptée par un add*() prend l'identifiant suivant, repris par ses évènements.
+         */
+        uint32_t getLastCommandId()
+        {
+            return m_lastCommandId;
+        }
 
         /*
-         * Gestion de l'arret d'urgence
+         * Évènements des commandes (démarrée, terminée, interrompue, retirée), publiés par la boucle d'asserv
+         */
+        CommandEventQueue& getEventQueue()
+        {
+            return m_events;
+        }
+
+        /*
+         * Profil de vitesse en S des lignes droites et des rotations (activé par défaut).
+         *  Désactivé, la consigne est donnée d'un coup et les limiteurs d'accélération font la rampe.
+         *  Ne concerne que les commandes ajoutées ensuite.
+         */
+        void enableMotionProfile(bool enable)
+        {
+            m_motionProfileEnabled = enable;
+        }
+
+        /*
+         * Planification des vitesses de passage des suites de Goto/GotoNoStop (activée par défaut), voir LookAheadPlanner.
+         *  Désactivée, chaque Goto s'arrête sur son point et GotoNoStop ralentit à lowSpeedDistanceConsign_mm de chaque point.
+         */
+        void enableLookAhead(bool enable)
+        {
+            m_lookAheadEnabled = enable;
+        }
+
+        /*
+         * Gestion de l'arret d'urgence. Côté producteur, les consignes sont figées sur la position et les commandes
+         *  ajoutées jusque-là sont retirées par la boucle d'asserv à sa mise à jour suivante ; d'ici la remise en
+         *  marche, les add*() sont refusés.
          */
         void setEmergencyStop();
         void resetEmergencyStop();
 
+        /*
+         * Pause : le robot freine aux limites d'accélération et de jerk des configurations de freinage (distanceBrakeConfiguration,
+         *  angleBrakeConfiguration : les limiteurs sont contournés pendant le freinage), puis tient sa position. La commande en cours et la file sont gardées, les commandes ajoutées pendant la pause attendent.
+         *  resume() reprend la commande en cours depuis la pose où le robot s'est arrêté (voir Command::resume).
+         *  Depuis n'importe quel thread, appliqués à la mise à jour suivante de la boucle d'asserv.
+         *  Un arrêt d'urgence annule la pause.
+         */
+        void pause();
+        void resume();
+
+        /*
+         * Facteur appliqué aux accélérations max des profils et du freinage de pause (1 par défaut), baissé quand les roues
+         *  patinent (voir SlipDetector), comme celles des limiteurs qui ne bornent que la correction pendant un profil.
+         *  Une baisse replanifie la commande à profil en cours à la mise à jour suivante. Depuis la boucle d'asserv.
+         */
+        void setAccelerationScale(float scale);
+
         /*
          * Mise à jour des consignes de sorties en fonction
-         * 	de la nouvelle position du robot
+         * 	de la nouvelle position du robot, deltaT secondes après la mise à jour précédente
          */
-        void update(float X_mm, float Y_mm, float theta_rad);
+        void update(float X_mm, float Y_mm, float theta_rad, float deltaT);
 
         /*
          * Sorties du commandManager
@@ -61,38 +176,187 @@ class CommandManager
             return m_angleRegulatorConsign;
         }
 
+        /*
+         * Vitesses de consigne de la commande en cours quand elle suit un profil (mm/s et rad/s), nulles sinon
+         */
+        bool isFollowingProfile()
+        {
+            return m_followingProfile;
+        }
+        // Vrai pendant la pause, freinage puis maintien : les vitesses de consigne sont celles du profil de freinage
+        bool isBraking()
+        {
+            return m_paused.load(std::memory_order_relaxed);
+        }
+        float getDistanceSpeedGoal()
+        {
+            return m_distSpeedConsign;
+        }
+        float getAngleSpeedGoal()
+        {
+            return m_angleSpeedConsign;
+        }
+        // Accélérations de ces vitesses (mm/s² et rad/s²), pour les interpoler à chaque itération de la boucle
+        float getDistanceAccelerationGoal()
+        {
+            return m_distAccelerationConsign;
+        }
+        float getAngleAccelerationGoal()
+        {
+            return m_angleAccelerationConsign;
+        }
+
         /*
          * Permet au haut niveau de savoir où en est la commande actuelle
          */
         CommandManager::CommandStatus getCommandStatus();
         uint8_t getPendingCommandCount();
 
-        inline void reset()
+        /*
+         * Consignes figées sur la position et commandes ajoutées jusque-là retirées, comme un arrêt d'urgence suivi
+         *  de sa remise en marche : les commandes ajoutées ensuite sont exécutées normalement
+         */
+        void reset();
+
+    private:
+
+        /*
+         * Opération sur la file postée par le producteur, appliquée par la boucle d'asserv
+         */
+        typedef enum {
+            OPERATION_NONE      = 0,
+            OPERATION_REPLACE   = 1,
+            OPERATION_INSERT    = 2,
+            OPERATION_CLEAR     = 3,
+        } QueueOperation;
+
+        template<typename CommandT, typename... Args>
+        bool addCommand(QueueMode mode, Args&&... args)
         {
-            setEmergencyStop();
-            resetEmergencyStop();
+            if (m_emergencyStop.load(std::memory_order_relaxed))
+                return false;
+
+            if (mode == QUEUE_APPEND)
+            {
+                if (!m_cmdList.push<CommandT>(m_lastCommandId + 1, std::forward<Args>(args)...))
+                    return false;
+                m_lastCommandId++;
+                return true;
+            }
+
+            int8_t slot = reserveOperationSlot();
+            if (slot < 0)
+                return false;
+            m_prioritySlots[slot].construct<CommandT>(m_lastCommandId + 1, std::forward<Args>(args)...);
+            m_lastCommandId++;
+            postOperation((mode == QUEUE_REPLACE_CURRENT) ? OPERATION_REPLACE : OPERATION_INSERT, slot);
+            return true;
         }
 
-    private:
+        // Côté producteur
+        int8_t reserveOperationSlot();
+        void postOperation(QueueOperation operation, uint8_t slot);
+        void requestFlush();
+
+        // Côté consommateur
+        bool applyQueueOperation();
+        void replaceCurrentCommand(uint8_t slot);
+        void dropPendingCommands(uint32_t lastId);
+        void releaseCurrentCommand();
+        void releasePrioritySlot(uint8_t slot);
+        Command* getQueuedCommand(uint8_t index);
+        void publishPendingCount();
 
+        void startCommand(float X_mm, float Y_mm, float theta_rad);
+        void startPause();
+        void resumeCurrentCommand(float X_mm, float Y_mm, float theta_rad);
+        void replanCurrentCommand(float X_mm, float Y_mm, float theta_rad);
         void switchToNextCommand();
+        void flushCommands(uint32_t lastId);
+        void updateProfileSpeed();
+        void planJunctionSpeeds(float X_mm, float Y_mm);
 
-        CommandList m_cmdList;
+        CommandQueue m_cmdList;
         Command *m_currentCmd;
+        uint32_t m_lastCommandId;
+        CommandEventQueue m_events;
+
+        /*
+         * Commandes prioritaires (remplacement, insertion en tête). Le producteur construit la commande dans un emplacement
+         *  libre puis publie l'opération (store release de m_pendingOperation), la boucle d'asserv l'applique et remet
+         *  OPERATION_NONE. Les emplacements occupés (bit par emplacement) ne sont écrits que par la boucle d'asserv.
+         */
+        CommandQueue::Slot m_prioritySlots[PRIORITY_SLOTS];
+        std::atomic<uint8_t> m_prioritySlotsInUse;
+        std::atomic<uint8_t> m_pendingOperation;
+        uint8_t m_operationSlot;
+        uint32_t m_operationLastId;     // dernier identifiant donné quand l'opération est postée
+
+        /*
+         * Vidage demandé par le producteur (arrêt d'urgence, reset) : la boucle d'asserv retire les commandes
+         *  d'identifiant inférieur ou égal à m_flushLastId, publié avant m_flushRequested
+         */
+        std::atomic<bool> m_flushRequested;
+        std::atomic<uint32_t> m_flushLastId;
+
+        // Côté boucle d'asserv
+        uint8_t m_insertedSlots[PRIORITY_SLOTS];    // commandes insérées en tête, la dernière exécutée d'abord
+        uint8_t m_insertedCount;
+        int8_t m_currentSlot;           // emplacement de la commande en cours, -1 si elle est en tête de file
+        uint8_t m_skippedCommands;      // commandes déjà retirées derrière la tête de file, détruites avec elle
+        std::atomic<int8_t> m_pendingCountOffset;   // commandes prioritaires moins celles déjà retirées, pour getPendingCommandCount()
+
+        // Vitesses mesurées sur les accumulateurs entre deux mises à jour, reprises par une commande de remplacement
+        float m_lastDistanceAccumulator;
+        float m_lastAngleAccumulator;
+        float m_distanceSpeed;
+        float m_angleSpeed;
+
+        /*
+         * Pause demandée par le producteur, suivie par la boucle d'asserv : m_paused tant que les consignes suivent
+         *  les profils de freinage, jusqu'à la reprise
+         */
+        std::atomic<bool> m_pauseRequested;
+        std::atomic<bool> m_paused;     // lu par getCommandStatus()
+        bool m_startOnResume;          // commande en cours remplacée pendant la pause : démarrée à la reprise
+        SCurveProfile m_distanceBrake;
+        SCurveProfile m_angleBrake;
 
         float m_straitLineArrivalWindows_mm;
         float m_turnArrivalWindows_rad;
         Goto::GotoConfiguration m_preciseGotoConfiguration;
         Goto::GotoConfiguration m_waypointGotoConfiguration;
         GotoNoStop::GotoNoStopConfiguration m_gotoNoStopConfiguration;
+        SCurveProfile::Configuration m_distanceProfileConfiguration;
+        SCurveProfile::Configuration m_angleProfileConfiguration;
+        SCurveProfile::Configuration m_distanceBrakeConfiguration;
+        SCurveProfile::Configuration m_angleBrakeConfiguration;
+        // Accélérations max nominales des configurations ci-dessus, avant le facteur de patinage
+        float m_distanceProfileMaxAcceleration;
+        float m_angleProfileMaxAcceleration;
+        float m_distanceBrakeMaxAcceleration;
+        float m_angleBrakeMaxAcceleration;
+        float m_accelerationScale;
+        bool m_replanProfile;           // facteur baissé depuis la mise à jour précédente
+        bool m_motionProfileEnabled;
+        LookAheadPlanner m_lookAheadPlanner;
+        bool m_lookAheadEnabled;
+        SplinePath::Configuration m_splinePathConfiguration;
+        SplinePath::Table m_splinePathTable;    // prêtée à la commande SplinePath en cours
 
         const Regulator &m_angle_regulator;
         const Regulator &m_distance_regulator;
 
-        bool m_emergencyStop;
+        std::atomic<bool> m_emergencyStop;
 
         float m_angleRegulatorConsign;
         float m_distRegulatorConsign;
+
+        bool m_followingProfile;
+        float m_angleSpeedConsign;
+        float m_distSpeedConsign;
+        float m_angleAccelerationConsign;
+        float m_distAccelerationConsign;
 };
 
 #endif
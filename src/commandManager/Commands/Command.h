@@ -1,17 +1,87 @@
 #ifndef SRC_COMMAND_H_
 #define SRC_COMMAND_H_
+#include <cstdint>
 class Regulator;
 
 class Command
 {
 public:
+    Command() : m_id(0) {}
     virtual ~Command() {}
 
+    /*
+     * Identifiant donné par le CommandManager à l'ajout dans la file, repris par ses évènements (voir CommandEventQueue)
+     */
+    uint32_t getId() const
+    {
+        return m_id;
+    }
+    void setId(uint32_t id)
+    {
+        m_id = id;
+    }
+
     virtual void computeInitialConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator) = 0;
-    virtual void updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator) = 0;
+    // deltaT : temps écoulé depuis la mise à jour précédente, en s (nul depuis computeInitialConsign())
+    virtual void updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator, float deltaT) = 0;
     virtual bool isGoalReached(float X_mm, float Y_mm, float theta_rad, const Regulator &angle_regulator, const Regulator &distance_regulator, const Command* nextCommand) = 0;
 
     virtual bool noStop() const = 0;
+
+    /*
+     * Vitesses de consigne d'une commande qui suit un profil de vitesse (voir SCurveProfile),
+     *  en mm/s pour la distance et en rad/s pour l'angle, et leurs accélérations (mm/s², rad/s²).
+     *  Les régulateurs s'en servent en anticipation, les limiteurs d'accélération ne bornent alors que leur correction :
+     *  le profil borne déjà accélération et jerk (voir AccelerationLimiter::limitProfileSpeed).
+     *  Rend false pour une commande sans profil, qui ne donne que des consignes de position.
+     */
+    virtual bool getProfileSpeed(float *, float *, float *, float *) const
+    {
+        return false;
+    }
+
+    /*
+     * Vitesses du robot (mm/s et rad/s) quand la commande en remplace une autre en cours de mouvement
+     *  (voir CommandManager::QUEUE_REPLACE_CURRENT), donnée avant computeInitialConsign() :
+     *  une commande à profil part de cette vitesse au lieu de l'arrêt
+     */
+    virtual void setEntrySpeed(float, float)
+    {
+    }
+
+    /*
+     * Reprise après une pause (voir CommandManager::pause), le robot arrêté hors de sa trajectoire.
+     *  Par défaut, les consignes sont recalculées depuis la pose actuelle, comme à chaque mise à jour : Goto, SplinePath...
+     *  Une commande relative à sa pose de départ (StraitLine, Turn) repart vers le but fixé à son démarrage.
+     */
+    virtual void resume(float X_mm, float Y_mm, float theta_rad, float *distanceConsign, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator)
+    {
+        updateConsign(X_mm, Y_mm, theta_rad, distanceConsign, angleConsign, angle_regulator, distance_regulator, 0);
+    }
+
+    /*
+     * Commandes enchaînables par le planificateur de vitesse de passage (voir LookAheadPlanner) : Goto, GotoNoStop.
+     *  getWaypoint() rend le point visé et le sens de marche, false pour une commande qui n'en a pas.
+     *  setPlannedSpeed() donne, à chaque mise à jour, les vitesses planifiées de la commande en cours.
+     */
+    struct PlannedSpeed
+    {
+        float entrySpeed;       // vitesse actuelle du robot (mm/s), gardée pendant le virage d'un point passé en vitesse
+        float exitSpeed;        // vitesse de passage du point (mm/s), 0 : arrêt sur le point
+        float maxAcceleration;  // freinage max pour atteindre exitSpeed (mm/s²)
+        float passDistance_mm;  // distance au point à laquelle on passe à la commande suivante, pour couper le virage
+    };
+
+    virtual bool getWaypoint(float *, float *, bool *) const
+    {
+        return false;
+    }
+    virtual void setPlannedSpeed(PlannedSpeed const &)
+    {
+    }
+
+private:
+    uint32_t m_id;
 };
 
 #endif /* SRC_COMMAND_H_ */
@@ -1,6 +1,8 @@
 #include "Goto.h"
 #include "Regulator.h"
+#include "commandManager/LookAheadPlanner.h"
 #include "util/asservMath.h"
+#include "util/fastMath.h"
 #include "USBStream.h"
 #include <new>
 #include <cmath>
@@ -9,7 +11,8 @@ Goto::Goto(float consignX_mm, float consignY_mm,
         GotoConfiguration const *configuration,
         float backwardMode)
 : m_consignX_mm(consignX_mm), m_consignY_mm(consignY_mm),
-  m_configuration(configuration), m_alignOnly(false)
+  m_configuration(configuration), m_alignOnly(false),
+  m_planned(false), m_plannedSpeed()
 {
     if( backwardMode)
         m_backModeCorrection = -1;
@@ -31,10 +34,10 @@ void Goto::computeInitialConsign(float X_mm, float Y_mm, float theta_rad, float
        m_alignOnly = true;
    }
 
-    updateConsign( X_mm, Y_mm, theta_rad, distanceConsig, angleConsign, angle_regulator, distance_regulator);
+    updateConsign( X_mm, Y_mm, theta_rad, distanceConsig, angleConsign, angle_regulator, distance_regulator, 0);
 }
 
-void Goto::updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator)
+void Goto::updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator, float)
 {
    float deltaX = m_consignX_mm - X_mm;
    float deltaY = m_consignY_mm - Y_mm;
@@ -48,18 +51,24 @@ void Goto::updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanc
    //  Si la distance est faible, on ne s'asservit plus qu'en distance en partant du principe qu'on est assez alligné.
    if (deltaDist < m_configuration->gotoReturnThreshold_mm && !m_alignOnly)
    {
-       float projectedDist = deltaDist * cosf(deltaTheta);
+       float projectedDist = deltaDist * loopCosf(deltaTheta);
        *distanceConsig = distance_regulator.getAccumulator() + m_backModeCorrection*projectedDist ;
    }
    else
    {
        *angleConsign = angle_regulator.getAccumulator() + deltaTheta;
 
-       if (fabs(deltaTheta) < m_configuration->gotoAngleThreshold_rad)
+       if (fabsf(deltaTheta) < m_configuration->gotoAngleThreshold_rad)
        {
-           *distanceConsig = distance_regulator.getAccumulator() + m_backModeCorrection*deltaDist;
+           *distanceConsig = distance_regulator.getAccumulator() + m_backModeCorrection*plannedDistance(deltaDist, distance_regulator);
            m_alignOnly = false;
        }
+       else if (m_planned && !m_alignOnly && fabsf(deltaTheta) < M_PI_F/2)
+       {
+           // Point précédent passé en vitesse : on ne s'arrête pas pour s'aligner, on garde la vitesse actuelle pendant le virage
+           float advance = fminf(plannedDistance(deltaDist, distance_regulator), m_plannedSpeed.entrySpeed / distance_regulator.getGain());
+           *distanceConsig = distance_regulator.getAccumulator() + m_backModeCorrection*advance;
+       }
    }
 
    USBStream::instance()->setXGoal(m_consignX_mm);
@@ -70,7 +79,39 @@ bool Goto::isGoalReached(float X_mm, float Y_mm, float , const Regulator &, cons
     float deltaX = m_consignX_mm - X_mm;
     float deltaY = m_consignY_mm - Y_mm;
 
-    return computeDeltaDist(deltaX, deltaY) < m_configuration->arrivalDistanceThreshold_mm;
+    float arrivalDistance = m_configuration->arrivalDistanceThreshold_mm;
+    if (m_planned && m_plannedSpeed.exitSpeed > 0)
+    {
+        // Point passé en vitesse : on le quitte au début du virage, au plus tard dans la zone où le cap n'est plus asservi
+        arrivalDistance = fmaxf(fmaxf(arrivalDistance, m_configuration->gotoReturnThreshold_mm), m_plannedSpeed.passDistance_mm);
+    }
+
+    return computeDeltaDist(deltaX, deltaY) < arrivalDistance;
+}
+
+bool Goto::getWaypoint(float *X_mm, float *Y_mm, bool *backward) const
+{
+    *X_mm = m_consignX_mm;
+    *Y_mm = m_consignY_mm;
+    *backward = m_backModeCorrection < 0;
+    return true;
+}
+
+void Goto::setPlannedSpeed(PlannedSpeed const &plannedSpeed)
+{
+    m_planned = true;
+    m_plannedSpeed = plannedSpeed;
+}
+
+float Goto::plannedDistance(float deltaDist, const Regulator &distance_regulator) const
+{
+    // Arrêt sur le point : approche proportionnelle habituelle
+    if (!m_planned || m_plannedSpeed.exitSpeed <= 0)
+        return deltaDist;
+
+    // Passage à exitSpeed au début du virage : la sortie du régulateur P vaut Kp * distance d'avance
+    float Kp = distance_regulator.getGain();
+    return LookAheadPlanner::approachSpeed(deltaDist - m_plannedSpeed.passDistance_mm, m_plannedSpeed.exitSpeed, m_plannedSpeed.maxAcceleration, Kp) / Kp;
 }
 
 bool Goto::noStop() const
@@ -80,35 +121,40 @@ bool Goto::noStop() const
 
 float Goto::computeDeltaDist(float deltaX, float deltaY)
 {
+#ifdef ENABLE_FAST_MATH
+    // Les distances de la table sont bornées (quelques mètres) : x² + y² ne peut pas déborder, une seule racine suffit
+    return fastHypotf(deltaX, deltaY);
+#else
     // On a besoin de min et max pour le calcul de la racine carrée
-    float max = fabs(deltaX) > fabs(deltaY) ? fabs(deltaX) : fabs(deltaY);
-    float min = fabs(deltaX) <= fabs(deltaY) ? fabs(deltaX) : fabs(deltaY);
+    float max = fabsf(deltaX) > fabsf(deltaY) ? fabsf(deltaX) : fabsf(deltaY);
+    float min = fabsf(deltaX) <= fabsf(deltaY) ? fabsf(deltaX) : fabsf(deltaY);
 
     // Valeur absolue de la distance à parcourir en allant tout droit pour atteindre la consigne
     if (max != 0)
-        return (max * sqrtf(1.0 + (min / max) * (min / max)));
+        return (max * sqrtf(1.0f + (min / max) * (min / max)));
     else
         return 0;
+#endif
 }
 
 
 float Goto::computeDeltaTheta(float deltaX, float deltaY, float theta_rad)
 {
     // Cap que doit atteindre le robot
-    float thetaCible = atan2f(deltaY, deltaX);
+    float thetaCible = loopAtan2f(deltaY, deltaX);
 
     // La différence entre le thetaCible (= cap à atteindre) et le theta (= cap actuel du robot) donne l'angle à parcourir
     float deltaTheta = thetaCible - theta_rad;
 
     // On ajuste l'angle à parcourir pour ne pas faire plus d'un demi-tour
     // Exemple, tourner de 340 degrés est plus chiant que de tourner de -20 degrés
-    if (deltaTheta > M_PI)
+    if (deltaTheta > M_PI_F)
     {
-        deltaTheta -= 2.0 * M_PI;
+        deltaTheta -= M_2PI_F;
     }
-    else if (deltaTheta < -M_PI)
+    else if (deltaTheta < -M_PI_F)
     {
-        deltaTheta += 2.0 * M_PI;
+        deltaTheta += M_2PI_F;
     }
 
     return deltaTheta;
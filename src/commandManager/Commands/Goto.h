@@ -21,14 +21,20 @@ class Goto : public Command
         virtual ~Goto() {};
 
         virtual void computeInitialConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator);
-        virtual void updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator);
+        virtual void updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator, float deltaT);
         virtual bool isGoalReached(float X_mm, float Y_mm, float theta_rad, const Regulator &angle_regulator, const Regulator &distance_regulator, const Command* nextCommand);
 
         virtual bool noStop() const;
 
+        virtual bool getWaypoint(float *X_mm, float *Y_mm, bool *backward) const;
+        virtual void setPlannedSpeed(PlannedSpeed const &plannedSpeed);
+
         static float computeDeltaDist(float deltaX, float deltaY);
         static float computeDeltaTheta(float deltaX, float deltaY, float theta_rad);
     private:
+        // Distance d'avance de la consigne sur le régulateur de distance, selon la vitesse de passage planifiée
+        float plannedDistance(float deltaDist, const Regulator &distance_regulator) const;
+
         float m_consignX_mm;
         float m_consignY_mm;
 
@@ -37,6 +43,9 @@ class Goto : public Command
         float m_backModeCorrection;
 
         bool m_alignOnly;
+
+        bool m_planned;
+        PlannedSpeed m_plannedSpeed;
 };
 
 #endif /* GOTO_H_ */
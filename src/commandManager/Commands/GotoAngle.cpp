@@ -23,7 +23,7 @@ void GotoAngle::computeInitialConsign(float X_mm, float Y_mm, float theta_rad, f
    *angleConsign =  angle_regulator.getAccumulator() + deltaTheta;
 }
 
-void GotoAngle::updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator)
+void GotoAngle::updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator, float)
 {
     return computeInitialConsign(X_mm, Y_mm, theta_rad, distanceConsig, angleConsign, angle_regulator, distance_regulator);
 }
@@ -34,7 +34,7 @@ bool GotoAngle::isGoalReached(float X_mm, float Y_mm, float theta_rad, const Reg
     float deltaX = m_consignX_mm - X_mm;
     float deltaY = m_consignY_mm - Y_mm;
 
-    return fabs(Goto::computeDeltaTheta(deltaX, deltaY, theta_rad)) < m_arrivalAngleThreshold_rad;
+    return fabsf(Goto::computeDeltaTheta(deltaX, deltaY, theta_rad)) < m_arrivalAngleThreshold_rad;
 }
 
 bool GotoAngle::noStop() const
@@ -1,6 +1,8 @@
 #include "GotoNoStop.h"
 #include "Regulator.h"
+#include "commandManager/LookAheadPlanner.h"
 #include "util/asservMath.h"
+#include "util/fastMath.h"
 #include "USBStream.h"
 #include <new>
 #include <cmath>
@@ -10,7 +12,8 @@ GotoNoStop::GotoNoStop(float consignX_mm, float consignY_mm,
         Goto::GotoConfiguration const *gotoconfiguration,
         float backwardMode)
 : m_consignX_mm(consignX_mm), m_consignY_mm(consignY_mm),
-  m_configuration(configuration), m_gotoConfiguration(gotoconfiguration)
+  m_configuration(configuration), m_gotoConfiguration(gotoconfiguration),
+  m_planned(false), m_plannedSpeed()
 {
     if( backwardMode)
         m_backModeCorrection = -1;
@@ -29,12 +32,19 @@ void GotoNoStop::computeInitialConsign(float X_mm, float Y_mm, float theta_rad,
    float deltaDist = Goto::computeDeltaDist(deltaX, deltaY);
    float deltaTheta = Goto::computeDeltaTheta(m_backModeCorrection * deltaX, m_backModeCorrection * deltaY, theta_rad);
 
-   if(deltaDist < m_configuration->lowSpeedDistanceConsign_mm)
+   // Point passé en vitesse (voir LookAheadPlanner) : pas d'approche lente, on garde le cap jusqu'au passage
+   bool passThrough = m_planned && m_plannedSpeed.exitSpeed > 0;
+   float Kp = distance_regulator.getGain();
+   float advance = deltaDist;
+   if (passThrough)
+       advance = LookAheadPlanner::approachSpeed(deltaDist - m_plannedSpeed.passDistance_mm, m_plannedSpeed.exitSpeed, m_plannedSpeed.maxAcceleration, Kp) / Kp;
+
+   if(deltaDist < m_configuration->lowSpeedDistanceConsign_mm && !passThrough)
    {
        /* If the distance is lower than lowSpeedDistanceConsign_mm,
         *  We want to go precisely to the goal, use a classic goto algorithm
         */
-       float projectedDist = deltaDist * cosf(deltaTheta);
+       float projectedDist = deltaDist * loopCosf(deltaTheta);
        if (deltaDist < m_gotoConfiguration->gotoReturnThreshold_mm)
        {
            *distanceConsig = distance_regulator.getAccumulator() + m_backModeCorrection * projectedDist ;
@@ -43,20 +53,28 @@ void GotoNoStop::computeInitialConsign(float X_mm, float Y_mm, float theta_rad,
        {
          *angleConsign = angle_regulator.getAccumulator() + deltaTheta;
 
-         if (fabs(deltaTheta) < m_gotoConfiguration->gotoAngleThreshold_rad)
+         if (fabsf(deltaTheta) < m_gotoConfiguration->gotoAngleThreshold_rad)
              *distanceConsig = distance_regulator.getAccumulator() + m_backModeCorrection * deltaDist;
        }
 
    }
-   else if (fabs(deltaTheta) < m_configuration->gotoAngleThreshold_rad)
+   else if (fabsf(deltaTheta) < m_configuration->gotoAngleThreshold_rad)
    {
        /*  Here we are pointing enough to the right direction to go strait to the goal
         *    use a basic goto command
         */
        *angleConsign = angle_regulator.getAccumulator() + deltaTheta;
-       *distanceConsig = distance_regulator.getAccumulator() + m_backModeCorrection * deltaDist;
+       *distanceConsig = distance_regulator.getAccumulator() + m_backModeCorrection * advance;
+   }
+   else if (m_planned && fabsf(deltaTheta) <= m_configuration->tooBigAngleThreshold_rad)
+   {
+       /*  Point précédent passé en vitesse (voir LookAheadPlanner) : la vitesse de passage tient compte du virage,
+        *   on la garde en tournant plutôt que de repartir à basse vitesse
+        */
+       *angleConsign = angle_regulator.getAccumulator() + deltaTheta;
+       *distanceConsig = distance_regulator.getAccumulator() + m_backModeCorrection * fminf(advance, m_plannedSpeed.entrySpeed / Kp);
    }
-   else if (fabs(deltaTheta) > m_configuration->tooBigAngleThreshold_rad)
+   else if (fabsf(deltaTheta) > m_configuration->tooBigAngleThreshold_rad)
    {
         /*  Here we are absolutly not pointing to the right direction (the goal is behind the robot for example)
         *   just compute a angle consign.
@@ -64,7 +82,7 @@ void GotoNoStop::computeInitialConsign(float X_mm, float Y_mm, float theta_rad,
         */
         *angleConsign = angle_regulator.getAccumulator() + deltaTheta;
    }
-   else if (fabs(deltaTheta) > m_configuration->tooBigAngleThreshold_rad)
+   else if (fabsf(deltaTheta) > m_configuration->tooBigAngleThreshold_rad)
    {
         /*  Here we are absolutly not pointing to the right direction (the goal is behind the robot for example)
         *   just compute a angle consign.
@@ -94,7 +112,7 @@ void GotoNoStop::computeInitialConsign(float X_mm, float Y_mm, float theta_rad,
 
 }
 
-void GotoNoStop::updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator)
+void GotoNoStop::updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator, float)
 {
     return computeInitialConsign(X_mm, Y_mm, theta_rad, distanceConsig, angleConsign, angle_regulator, distance_regulator);
 }
@@ -106,7 +124,15 @@ bool GotoNoStop::isGoalReached(float X_mm, float Y_mm, float , const Regulator &
 
     float deltaDist = Goto::computeDeltaDist(deltaX, deltaY);
 
-    if( nextCommand != nullptr && nextCommand->noStop())
+    if (m_planned)
+    {
+        // Vitesse de passage planifiée : on quitte le point au début du virage, au plus tard dans la zone où le cap n'est plus asservi
+        if (m_plannedSpeed.exitSpeed > 0)
+            return deltaDist < fmaxf(fmaxf(m_gotoConfiguration->arrivalDistanceThreshold_mm, m_gotoConfiguration->gotoReturnThreshold_mm), m_plannedSpeed.passDistance_mm);
+        else
+            return deltaDist < m_gotoConfiguration->arrivalDistanceThreshold_mm;
+    }
+    else if( nextCommand != nullptr && nextCommand->noStop())
     {
         return deltaDist < m_configuration->lowSpeedDistanceConsign_mm;
     }
@@ -121,9 +147,23 @@ bool GotoNoStop::noStop() const
     return true;
 }
 
+bool GotoNoStop::getWaypoint(float *X_mm, float *Y_mm, bool *backward) const
+{
+    *X_mm = m_consignX_mm;
+    *Y_mm = m_consignY_mm;
+    *backward = m_backModeCorrection < 0;
+    return true;
+}
+
+void GotoNoStop::setPlannedSpeed(PlannedSpeed const &plannedSpeed)
+{
+    m_planned = true;
+    m_plannedSpeed = plannedSpeed;
+}
+
 void GotoNoStop::computeConsignOnCircle(float X_mm, float Y_mm, float radius_mm, float *XGoal_mm, float *YGoal_mm)
 {
-    float angle = M_PI / 2;
+    float angle = M_PI_F / 2;
 
     if ((m_consignX_mm - X_mm) != 0) // with an angle of M_PI/2 an divide by zero will occur. So handle this special case.
     {
@@ -132,17 +172,19 @@ void GotoNoStop::computeConsignOnCircle(float X_mm, float Y_mm, float radius_mm,
 
         // ... then find the angle between the previous linear function and a linear function y=0x+X_mm (parallel to the x abscissa)
         // see https://fr.wikipedia.org/wiki/Propri%C3%A9t%C3%A9s_m%C3%A9triques_des_droites_et_des_plans#Angles_de_deux_droites
-        angle = atanf(fabs(slope));
+        angle = loopAtanf(fabsf(slope));
     }
 
     // Correct the angle if we are in the left side of the trigonometric circle
     if (X_mm > m_consignX_mm)
-        angle = M_PI - angle;
+        angle = M_PI_F - angle;
     // Correct the sign of the angle if we are in the ]-Pi;0[ side of the trigonometric circle
     if (Y_mm > m_consignY_mm)
         angle = -angle;
 
     // Then find a (x,y) point that will be our current goal
-    *XGoal_mm = X_mm + cosf(angle) * radius_mm;
-    *YGoal_mm = Y_mm + sinf(angle) * radius_mm;
+    float sinAngle, cosAngle;
+    loopSinCosf(angle, &sinAngle, &cosAngle);
+    *XGoal_mm = X_mm + cosAngle * radius_mm;
+    *YGoal_mm = Y_mm + sinAngle * radius_mm;
 }
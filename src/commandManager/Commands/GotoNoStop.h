@@ -24,10 +24,13 @@ class GotoNoStop : public Command
         virtual ~GotoNoStop() {};
 
         virtual void computeInitialConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator);
-        virtual void updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator);
+        virtual void updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator, float deltaT);
         virtual bool isGoalReached(float X_mm, float Y_mm, float theta_rad, const Regulator &angle_regulator, const Regulator &distance_regulator, const Command* nextCommand);
 
         virtual bool noStop() const;
+
+        virtual bool getWaypoint(float *X_mm, float *Y_mm, bool *backward) const;
+        virtual void setPlannedSpeed(PlannedSpeed const &plannedSpeed);
     private:
 
         void computeConsignOnCircle(float X_mm, float Y_mm, float dist_mm, float *XGoal_mm, float *YGoal_mm);
@@ -39,6 +42,9 @@ class GotoNoStop : public Command
 
         GotoNoStopConfiguration const *m_configuration;
         Goto::GotoConfiguration const *m_gotoConfiguration;
+
+        bool m_planned;
+        PlannedSpeed m_plannedSpeed;
 };
 
 #endif /* Goto_H_ */
@@ -0,0 +1,328 @@
+#include "SplinePath.h"
+#include "Goto.h"
+#include "Regulator.h"
+#include "util/asservMath.h"
+#include "USBStream.h"
+#include <new>
+#include <cmath>
+
+// Pas d'intégration de la longueur de chaque segment de spline, pour le rééchantillonnage de la table
+static constexpr uint8_t SUBSTEPS = 16;
+// Avance max du point le plus proche à chaque mise à jour : le coût par mise à jour reste borné
+static constexpr uint8_t MAX_INDEX_STEPS = 8;
+// Les gains de Ramsete s'annulent avec la vitesse : on les garde à cette vitesse (mm/s) pour corriger encore l'écart en fin de chemin
+static constexpr float RAMSETE_MIN_SPEED = 200;
+// Fin du chemin approchée comme un Goto, à moins de END_APPROACH_FACTOR * returnDistance_mm du bout
+static constexpr float END_APPROACH_FACTOR = 3;
+
+/*
+ * Segment d'Hermite de p0 (tangente t0) à p1 (tangente t1), u dans [0;1] : position, dérivée première et seconde
+ */
+static void hermite(float p0, float t0, float p1, float t1, float u, float *p, float *d, float *dd)
+{
+    float u2 = u * u;
+    float u3 = u2 * u;
+    *p = (2.0f * u3 - 3.0f * u2 + 1.0f) * p0 + (u3 - 2.0f * u2 + u) * t0 + (-2.0f * u3 + 3.0f * u2) * p1 + (u3 - u2) * t1;
+    *d = (6.0f * u2 - 6.0f * u) * p0 + (3.0f * u2 - 4.0f * u + 1.0f) * t0 + (-6.0f * u2 + 6.0f * u) * p1 + (3.0f * u2 - 2.0f * u) * t1;
+    *dd = (12.0f * u - 6.0f) * p0 + (6.0f * u - 4.0f) * t0 + (-12.0f * u + 6.0f) * p1 + (6.0f * u - 2.0f) * t1;
+}
+
+SplinePath::SplinePath(float const *X_mm, float const *Y_mm, uint8_t count,
+        Configuration const *configuration, Table *table)
+: m_count(count), m_configuration(configuration), m_table(table), m_index(0), m_aligning(false)
+{
+    if (m_count > MAX_POINTS)
+        m_count = MAX_POINTS;
+
+    for (uint8_t i = 0; i < m_count; i++)
+    {
+        m_X_mm[i] = X_mm[i];
+        m_Y_mm[i] = Y_mm[i];
+    }
+}
+
+void SplinePath::buildTable(float X_mm, float Y_mm, float theta_rad)
+{
+    m_index = 0;
+    if (m_count == 0)
+    {
+        m_table->length_mm = 0;
+        return;
+    }
+
+    // Points de passage, le premier étant la position du robot, et tangentes de Catmull-Rom
+    float *pointX = m_table->pointX;
+    float *pointY = m_table->pointY;
+    float *tangentX = m_table->tangentX;
+    float *tangentY = m_table->tangentY;
+    const uint8_t segmentCount = m_count;
+
+    pointX[0] = X_mm;
+    pointY[0] = Y_mm;
+    for (uint8_t i = 0; i < segmentCount; i++)
+    {
+        pointX[i + 1] = m_X_mm[i];
+        pointY[i + 1] = m_Y_mm[i];
+    }
+
+    // Au départ, tangente au cap du robot s'il regarde vers le premier point, sinon vers le point (le robot s'aligne d'abord)
+    float chordX = pointX[1] - pointX[0];
+    float chordY = pointY[1] - pointY[0];
+    float chordLength = sqrtf(chordX * chordX + chordY * chordY);
+    float headingX = cosf(theta_rad);
+    float headingY = sinf(theta_rad);
+    if (headingX * chordX + headingY * chordY > 0)
+    {
+        tangentX[0] = headingX * chordLength;
+        tangentY[0] = headingY * chordLength;
+    }
+    else
+    {
+        tangentX[0] = chordX;
+        tangentY[0] = chordY;
+    }
+    for (uint8_t i = 1; i < segmentCount; i++)
+    {
+        tangentX[i] = 0.5f * (pointX[i + 1] - pointX[i - 1]);
+        tangentY[i] = 0.5f * (pointY[i + 1] - pointY[i - 1]);
+    }
+    tangentX[segmentCount] = pointX[segmentCount] - pointX[segmentCount - 1];
+    tangentY[segmentCount] = pointY[segmentCount] - pointY[segmentCount - 1];
+
+    // Première passe : longueur du chemin
+    float length = 0;
+    for (uint8_t segment = 0; segment < segmentCount; segment++)
+    {
+        float previousX = pointX[segment], previousY = pointY[segment];
+        for (uint8_t j = 1; j <= SUBSTEPS; j++)
+        {
+            float u = float(j) / SUBSTEPS;
+            float x, y, unused1, unused2;
+            hermite(pointX[segment], tangentX[segment], pointX[segment + 1], tangentX[segment + 1], u, &x, &unused1, &unused2);
+            hermite(pointY[segment], tangentY[segment], pointY[segment + 1], tangentY[segment + 1], u, &y, &unused1, &unused2);
+            length += sqrtf((x - previousX) * (x - previousX) + (y - previousY) * (y - previousY));
+            previousX = x;
+            previousY = y;
+        }
+    }
+
+    m_table->length_mm = length;
+    m_table->step_mm = length / (TABLE_SIZE - 1);
+    if (length < 1.0f)
+    {
+        // Rien à parcourir : les points de contrôle sont sur le robot
+        m_table->length_mm = 0;
+        return;
+    }
+
+    // Seconde passe : une case de la table tous les step_mm, au paramètre u de la spline interpolé sur la longueur
+    sample(pointX, tangentX, pointY, tangentY, 0, 0, theta_rad);
+    uint8_t index = 1;
+    float abscissa = 0;
+    for (uint8_t segment = 0; segment < segmentCount; segment++)
+    {
+        float previousX = pointX[segment], previousY = pointY[segment];
+        for (uint8_t j = 1; j <= SUBSTEPS; j++)
+        {
+            float x, y, unused1, unused2;
+            hermite(pointX[segment], tangentX[segment], pointX[segment + 1], tangentX[segment + 1], float(j) / SUBSTEPS, &x, &unused1, &unused2);
+            hermite(pointY[segment], tangentY[segment], pointY[segment + 1], tangentY[segment + 1], float(j) / SUBSTEPS, &y, &unused1, &unused2);
+            float chord = sqrtf((x - previousX) * (x - previousX) + (y - previousY) * (y - previousY));
+
+            // La dernière case est posée à la fin, à la valeur exacte
+            while (chord > 0 && index < TABLE_SIZE - 1 && float(index) * m_table->step_mm <= abscissa + chord)
+            {
+                float u = (float(j) - 1.0f + (float(index) * m_table->step_mm - abscissa) / chord) / SUBSTEPS;
+                sample(pointX + segment, tangentX + segment, pointY + segment, tangentY + segment, u, index, m_table->theta_rad[index - 1]);
+                index++;
+            }
+
+            abscissa += chord;
+            previousX = x;
+            previousY = y;
+        }
+    }
+
+    // Fin du chemin, et cases restantes si les arrondis de la longueur en ont laissé
+    for (; index < TABLE_SIZE; index++)
+        sample(pointX + segmentCount - 1, tangentX + segmentCount - 1, pointY + segmentCount - 1, tangentY + segmentCount - 1, 1, index, m_table->theta_rad[index - 1]);
+
+    /* Vitesse max : accélération latérale v² * c dans les virages, accélération angulaire v² * dc/ds quand la courbure change,
+     *  puis freinage jusqu'à l'arrêt au dernier point
+     */
+    const float maxSpeed2 = m_configuration->maxSpeed * m_configuration->maxSpeed;
+    for (uint8_t i = 0; i < TABLE_SIZE; i++)
+    {
+        float curvature = fabsf(m_table->curvature[i]);
+        uint8_t next = (i + 1 < TABLE_SIZE) ? i + 1 : i;
+        uint8_t previous = (i > 0) ? i - 1 : i;
+        float curvatureRate = fabsf(m_table->curvature[next] - m_table->curvature[previous]) / (float(next - previous) * m_table->step_mm);
+
+        float speed2 = maxSpeed2;
+        if (curvature * speed2 > m_configuration->maxLateralAcceleration)
+            speed2 = m_configuration->maxLateralAcceleration / curvature;
+        if (curvatureRate * speed2 > m_configuration->maxAngularAcceleration)
+            speed2 = m_configuration->maxAngularAcceleration / curvatureRate;
+        m_table->speed[i] = sqrtf(speed2);
+    }
+    m_table->speed[TABLE_SIZE - 1] = 0;
+    const float brakingLength = 2.0f * m_configuration->maxAcceleration * m_table->step_mm;
+    for (int i = TABLE_SIZE - 2; i >= 0; i--)
+    {
+        float nextSpeed = m_table->speed[i + 1];
+        m_table->speed[i] = fminf(m_table->speed[i], sqrtf(nextSpeed * nextSpeed + brakingLength));
+    }
+}
+
+void SplinePath::sample(float const *pointX, float const *tangentX, float const *pointY, float const *tangentY, float u, uint8_t index, float previousTheta_rad)
+{
+    float dX, dY, ddX, ddY;
+    hermite(pointX[0], tangentX[0], pointX[1], tangentX[1], u, &m_table->X_mm[index], &dX, &ddX);
+    hermite(pointY[0], tangentY[0], pointY[1], tangentY[1], u, &m_table->Y_mm[index], &dY, &ddY);
+
+    float speed2 = dX * dX + dY * dY;
+    float theta = previousTheta_rad;
+    float curvature = 0;
+    if (speed2 > 1e-6f)
+    {
+        // Cap continu : on reste à moins d'un demi-tour de la case précédente
+        float heading = atan2f(dY, dX);
+        theta = heading - M_2PI_F * roundf((heading - previousTheta_rad) / M_2PI_F);
+        curvature = (dX * ddY - dY * ddX) / (speed2 * sqrtf(speed2));
+    }
+    m_table->theta_rad[index] = theta;
+    m_table->curvature[index] = curvature;
+}
+
+float SplinePath::interpolate(float const *values, float s_mm) const
+{
+    float position = s_mm / m_table->step_mm;
+    int index = int(position);
+    if (index < 0)
+        index = 0;
+    if (index > TABLE_SIZE - 2)
+        index = TABLE_SIZE - 2;
+
+    float fraction = limit(position - float(index), 0, 1);
+    return values[index] + fraction * (values[index + 1] - values[index]);
+}
+
+float SplinePath::project(float X_mm, float Y_mm)
+{
+    Table const &table = *m_table;
+
+    // Le point le plus proche ne fait qu'avancer, de quelques cases au plus : le chemin peut repasser près de lui-même
+    for (uint8_t i = 0; i < MAX_INDEX_STEPS && m_index + 1 < TABLE_SIZE; i++)
+    {
+        float currentX = table.X_mm[m_index] - X_mm, currentY = table.Y_mm[m_index] - Y_mm;
+        float nextX = table.X_mm[m_index + 1] - X_mm, nextY = table.Y_mm[m_index + 1] - Y_mm;
+        if (nextX * nextX + nextY * nextY > currentX * currentX + currentY * currentY)
+            break;
+        m_index++;
+    }
+
+    // Projeté sur le segment qui suit le point le plus proche, ou sur celui qui le précède si le robot est en arrière
+    uint8_t segment = (m_index < TABLE_SIZE - 1) ? m_index : TABLE_SIZE - 2;
+    const float step2 = table.step_mm * table.step_mm;
+    float t = ((X_mm - table.X_mm[segment]) * (table.X_mm[segment + 1] - table.X_mm[segment])
+            + (Y_mm - table.Y_mm[segment]) * (table.Y_mm[segment + 1] - table.Y_mm[segment])) / step2;
+    if (t < 0 && segment > 0)
+    {
+        segment--;
+        t = ((X_mm - table.X_mm[segment]) * (table.X_mm[segment + 1] - table.X_mm[segment])
+                + (Y_mm - table.Y_mm[segment]) * (table.Y_mm[segment + 1] - table.Y_mm[segment])) / step2;
+    }
+
+    return (float(segment) + limit(t, 0, 1)) * table.step_mm;
+}
+
+void SplinePath::computeInitialConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator)
+{
+    buildTable(X_mm, Y_mm, theta_rad);
+    updateConsign(X_mm, Y_mm, theta_rad, distanceConsig, angleConsign, angle_regulator, distance_regulator, 0);
+}
+
+void SplinePath::updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator, float)
+{
+    if (m_table->length_mm <= 0)
+        return;
+
+    const float s = project(X_mm, Y_mm);
+
+    USBStream::instance()->setXGoal(m_table->X_mm[TABLE_SIZE - 1]);
+    USBStream::instance()->setYGoal(m_table->Y_mm[TABLE_SIZE - 1]);
+
+    // Fin du chemin : comme un Goto, cap sur le dernier point puis distance seule tout près, pour y corriger l'écart latéral
+    if (m_table->length_mm - s < END_APPROACH_FACTOR * m_configuration->returnDistance_mm)
+    {
+        const float endDeltaX = m_table->X_mm[TABLE_SIZE - 1] - X_mm;
+        const float endDeltaY = m_table->Y_mm[TABLE_SIZE - 1] - Y_mm;
+        const float endDistance = Goto::computeDeltaDist(endDeltaX, endDeltaY);
+        const float deltaTheta = Goto::computeDeltaTheta(endDeltaX, endDeltaY, theta_rad);
+        if (endDistance > m_configuration->returnDistance_mm)
+            *angleConsign = angle_regulator.getAccumulator() + deltaTheta;
+        *distanceConsig = distance_regulator.getAccumulator() + endDistance * cosf(deltaTheta);
+        m_aligning = false;
+        return;
+    }
+
+    // Point de référence du chemin, et erreurs du robot par rapport à lui : latérale dans le repère du robot, et de cap
+    const float deltaX = interpolate(m_table->X_mm, s) - X_mm;
+    const float deltaY = interpolate(m_table->Y_mm, s) - Y_mm;
+    const float lateralError = -sinf(theta_rad) * deltaX + cosf(theta_rad) * deltaY;
+    float thetaError = interpolate(m_table->theta_rad, s) - theta_rad;
+    thetaError -= M_2PI_F * roundf(thetaError / M_2PI_F);
+
+    // Trop mal orienté pour suivre le chemin (au départ surtout) : on s'aligne sur place, comme un Goto
+    if (fabsf(thetaError) > m_configuration->alignAngleThreshold_rad)
+        m_aligning = true;
+    else if (fabsf(thetaError) < 0.5f * m_configuration->alignAngleThreshold_rad)
+        m_aligning = false;
+
+    if (m_aligning)
+    {
+        *angleConsign = angle_regulator.getAccumulator() + thetaError;
+    }
+    else
+    {
+        // Ramsete : vitesses de la table, corrigées par l'erreur de cap et l'écart latéral
+        const float pathSpeed = interpolate(m_table->speed, s);
+        const float pathAngularSpeed = pathSpeed * interpolate(m_table->curvature, s + pathSpeed * m_configuration->anticipation_s);
+        const float b = m_configuration->ramseteB;
+        const float gainSpeed = fmaxf(pathSpeed, RAMSETE_MIN_SPEED);
+        const float k = 2.0f * m_configuration->ramseteZeta * sqrtf(pathAngularSpeed * pathAngularSpeed + b * gainSpeed * gainSpeed);
+        const float sinc = (fabsf(thetaError) > 1e-3f) ? sinf(thetaError) / thetaError : 1.0f;
+
+        const float speed = pathSpeed * cosf(thetaError);
+        const float angularSpeed = pathAngularSpeed + k * thetaError + b * gainSpeed * sinc * lateralError;
+
+        // La sortie d'un régulateur P vaut Kp * avance de consigne
+        *distanceConsig = distance_regulator.getAccumulator() + fminf(speed / distance_regulator.getGain(), m_table->length_mm - s);
+        *angleConsign = angle_regulator.getAccumulator()
+                + angularSpeed * (0.5f * m_configuration->wheelsDistance_mm) / angle_regulator.getGain();
+    }
+}
+
+bool SplinePath::isGoalReached(float X_mm, float Y_mm, float , const Regulator &, const Regulator &, const Command* )
+{
+    if (m_table->length_mm <= 0)
+        return true;
+
+    if (m_index < TABLE_SIZE - 2)
+        return false;
+
+    const float endX = m_table->X_mm[TABLE_SIZE - 1], endY = m_table->Y_mm[TABLE_SIZE - 1];
+    const float endDistance = Goto::computeDeltaDist(endX - X_mm, endY - Y_mm);
+    if (endDistance < m_configuration->arrivalDistance_mm)
+        return true;
+
+    // Tout près du bout, le cap n'est plus corrigé : arrivé quand il reste moins de arrivalDistance_mm le long de la fin du chemin
+    const float tangentX = endX - m_table->X_mm[TABLE_SIZE - 2], tangentY = endY - m_table->Y_mm[TABLE_SIZE - 2];
+    const float remaining = ((endX - X_mm) * tangentX + (endY - Y_mm) * tangentY) / m_table->step_mm;
+    return endDistance < m_configuration->returnDistance_mm && remaining < m_configuration->arrivalDistance_mm;
+}
+
+bool SplinePath::noStop() const
+{
+    return false;
+}
@@ -0,0 +1,103 @@
+#ifndef SPLINEPATH_H_
+#define SPLINEPATH_H_
+
+#include <cstdint>
+#include "Command.h"
+
+/*
+ * Suivi d'une courbe lisse passant par une liste de points de contrôle, en marche avant.
+ *
+ *  La courbe est une spline d'Hermite (tangentes de Catmull-Rom) qui part de la position du robot au démarrage de
+ *  la commande, tangente à son cap s'il regarde à moins de 90° du premier point, puis passe par chaque point.
+ *  Elle est calculée une seule fois, dans computeInitialConsign(), et rééchantillonnée à pas constant en abscisse
+ *  curviligne dans une table (position, cap, courbure, vitesse max). La vitesse max de la table est bornée par
+ *  l'accélération latérale dans les virages et l'accélération angulaire aux changements de courbure (entrée de
+ *  virage, slalom), puis par le freinage jusqu'à l'arrêt au dernier point.
+ *
+ *  À chaque mise à jour, le point de la table le plus proche du robot n'avance que de quelques cases : le coût
+ *  est constant, quelle que soit la longueur du chemin. La loi de suivi est celle de Ramsete (suivi de trajectoire
+ *  non linéaire d'un robot différentiel), écrite ici en suivi de chemin : vitesse et vitesse angulaire de la table
+ *  au point le plus proche, corrigées par l'erreur de cap et l'écart latéral. Ces vitesses sont données aux
+ *  régulateurs sous forme d'avance de consigne en distance et en angle (sortie d'un régulateur P = Kp * avance).
+ *  Le dernier point est approché comme par un Goto, pour s'y arrêter malgré un reste d'écart latéral.
+ *
+ *  La table est trop grosse pour un emplacement de CommandList : elle appartient au CommandManager, qui la prête
+ *  à la commande. Seule la commande en cours s'en sert, elle la remplit au démarrage. Les calculs intermédiaires
+ *  de la spline y sont aussi, pour ne pas les poser sur la pile de la boucle d'asserv (waAsservThread) : le démarrage
+ *  de la commande y reste l'appel le plus profond (voir make stack_usage).
+ */
+class SplinePath : public Command
+{
+    public:
+
+        static constexpr uint8_t MAX_POINTS = 8;
+        static constexpr uint8_t TABLE_SIZE = 64;
+
+        struct Configuration
+        {
+            float maxSpeed;                 // mm/s
+            float maxAcceleration;          // mm/s², freinage avant les virages et à l'arrivée
+            float maxLateralAcceleration;   // mm/s², borne la vitesse dans les virages : v² * courbure
+            float maxAngularAcceleration;   // rad/s², borne la vitesse aux changements de courbure : v² * dcourbure/ds
+            float ramseteB;                 // gain de Ramsete sur l'écart latéral (1/mm²)
+            float ramseteZeta;              // amortissement de Ramsete (sans unité, entre 0 et 1)
+            float anticipation_s;           // retard de l'asserv en vitesse : courbure et vitesse de la table sont prises autant en avance
+            float wheelsDistance_mm;        // entraxe des roues codeuses, convertit la vitesse angulaire en sortie du régulateur d'angle
+            float alignAngleThreshold_rad;  // au delà de cette erreur de cap, le robot s'aligne sur place
+            float returnDistance_mm;        // à moins de cette distance du dernier point, le cap n'est plus corrigé (voir Goto)
+            float arrivalDistance_mm;
+        };
+
+        struct Table
+        {
+            float X_mm[TABLE_SIZE];
+            float Y_mm[TABLE_SIZE];
+            float theta_rad[TABLE_SIZE];    // continu, sans retour dans [-π;π]
+            float curvature[TABLE_SIZE];    // 1/mm, positive en tournant à gauche
+            float speed[TABLE_SIZE];        // mm/s
+            float step_mm;
+            float length_mm;
+
+            // Points de passage et tangentes de la spline, le temps de remplir la table (hors de la pile du thread d'asserv)
+            float pointX[MAX_POINTS + 1];
+            float pointY[MAX_POINTS + 1];
+            float tangentX[MAX_POINTS + 1];
+            float tangentY[MAX_POINTS + 1];
+        };
+
+        explicit SplinePath(float const *X_mm, float const *Y_mm, uint8_t count,
+                Configuration const *configuration, Table *table);
+
+        virtual ~SplinePath() {};
+
+        virtual void computeInitialConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator);
+        virtual void updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator, float deltaT);
+        virtual bool isGoalReached(float X_mm, float Y_mm, float theta_rad, const Regulator &angle_regulator, const Regulator &distance_regulator, const Command* nextCommand);
+
+        virtual bool noStop() const;
+
+    private:
+        // Calcul de la spline depuis la position du robot et remplissage de la table
+        void buildTable(float X_mm, float Y_mm, float theta_rad);
+
+        // Case 'index' de la table : point du segment d'Hermite (points et tangentes 0 et 1 des tableaux) au paramètre u
+        void sample(float const *pointX, float const *tangentX, float const *pointY, float const *tangentY, float u, uint8_t index, float previousTheta_rad);
+
+        // Valeur de 'values' à l'abscisse curviligne s_mm, interpolée entre deux cases de la table
+        float interpolate(float const *values, float s_mm) const;
+
+        // Abscisse curviligne du projeté du robot sur le chemin, en avançant le point le plus proche de la table
+        float project(float X_mm, float Y_mm);
+
+        float m_X_mm[MAX_POINTS];
+        float m_Y_mm[MAX_POINTS];
+        uint8_t m_count;
+
+        Configuration const *m_configuration;
+        Table *m_table;
+
+        uint8_t m_index;    // case de la table la plus proche du robot
+        bool m_aligning;
+};
+
+#endif /* SPLINEPATH_H_ */
@@ -3,26 +3,74 @@
 #include <new>
 #include <cmath>
 
-StraitLine::StraitLine(float consign, float arrivalDistanceThreshold_mm)
-: m_straitLineConsign(consign), m_arrivalDistanceThreshold_mm(arrivalDistanceThreshold_mm)
+StraitLine::StraitLine(float consign, float arrivalDistanceThreshold_mm, SCurveProfile::Configuration const *profileConfiguration)
+: m_straitLineConsign(consign), m_arrivalDistanceThreshold_mm(arrivalDistanceThreshold_mm), m_profileConfiguration(profileConfiguration),
+  m_goalConsign(0), m_entrySpeed(0)
 {
 }
 
 void StraitLine::computeInitialConsign(float , float , float , float *distanceConsig, float *, const Regulator &, const Regulator &)
 {
-    *distanceConsig += m_straitLineConsign;
+    m_goalConsign = *distanceConsig + m_straitLineConsign;
+    if (m_profileConfiguration == nullptr)
+    {
+        *distanceConsig = m_goalConsign;
+        return;
+    }
+
+    // Le profil part de la consigne courante, la consigne avance ensuite à chaque updateConsign()
+    m_profile.plan(*distanceConsig, m_straitLineConsign, *m_profileConfiguration, m_entrySpeed);
+    *distanceConsig = m_profile.getPosition();
 }
 
-void StraitLine::updateConsign(float , float , float , float *, float *, const Regulator &, const Regulator &)
+void StraitLine::updateConsign(float , float , float , float *distanceConsig, float *, const Regulator &, const Regulator &, float deltaT)
 {
+    if (m_profileConfiguration == nullptr)
+        return;
+
+    m_profile.step(deltaT);
+    *distanceConsig = m_profile.getPosition();
+}
+
+void StraitLine::resume(float , float , float , float *distanceConsig, float *, const Regulator &, const Regulator &)
+{
+    if (m_profileConfiguration == nullptr)
+    {
+        *distanceConsig = m_goalConsign;
+        return;
+    }
+
+    // Le reste de la distance, depuis la consigne où le robot s'est arrêté
+    m_profile.plan(*distanceConsig, m_goalConsign - *distanceConsig, *m_profileConfiguration, m_entrySpeed);
+    *distanceConsig = m_profile.getPosition();
 }
 
 bool StraitLine::isGoalReached(float , float , float , const Regulator &, const Regulator &distance_regulator, const Command* )
 {
-    return fabs(distance_regulator.getError()) <= m_arrivalDistanceThreshold_mm;
+    // Tant que le profil n'est pas terminé, la consigne n'est pas la position finale
+    if (m_profileConfiguration != nullptr && !m_profile.isFinished())
+        return false;
+
+    return fabsf(distance_regulator.getError()) <= m_arrivalDistanceThreshold_mm;
 }
 
 bool StraitLine::noStop() const
 {
     return false;
 }
+
+void StraitLine::setEntrySpeed(float distanceSpeed, float )
+{
+    m_entrySpeed = distanceSpeed;
+}
+
+bool StraitLine::getProfileSpeed(float *distanceSpeed, float *angleSpeed, float *distanceAcceleration, float *angleAcceleration) const
+{
+    if (m_profileConfiguration == nullptr)
+        return false;
+
+    m_profile.getFeedForward(distanceSpeed, distanceAcceleration);
+    *angleSpeed = 0;
+    *angleAcceleration = 0;
+    return true;
+}
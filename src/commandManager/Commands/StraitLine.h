@@ -2,22 +2,35 @@
 #define STRAITLINE_H_
 
 #include "Command.h"
+#include "commandManager/SCurveProfile.h"
 
+/*
+ * Ligne droite relative. Avec une configuration de profil, la consigne de distance suit un profil en S
+ *  (voir SCurveProfile), sinon elle est donnée d'un coup et le régulateur P fait le déplacement.
+ */
 class StraitLine : public Command
 {
     public:
-        explicit StraitLine(float consign, float arrivalDistanceThreshold_mm);
+        explicit StraitLine(float consign, float arrivalDistanceThreshold_mm,
+                SCurveProfile::Configuration const *profileConfiguration = nullptr);
         virtual ~StraitLine() {};
 
         virtual void computeInitialConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator);
-        virtual void updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator);
+        virtual void updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator, float deltaT);
         virtual bool isGoalReached(float X_mm, float Y_mm, float theta_rad, const Regulator &angle_regulator, const Regulator &distance_regulator, const Command* nextCommand);
 
         virtual bool noStop() const;
+        virtual bool getProfileSpeed(float *distanceSpeed, float *angleSpeed, float *distanceAcceleration, float *angleAcceleration) const;
+        virtual void setEntrySpeed(float distanceSpeed, float angleSpeed);
+        virtual void resume(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator);
     private:
         float m_straitLineConsign;
         float m_arrivalDistanceThreshold_mm;
 
+        SCurveProfile::Configuration const *m_profileConfiguration;
+        SCurveProfile m_profile;
+        float m_goalConsign;    // consigne de distance finale, fixée au démarrage
+        float m_entrySpeed;
 };
 
 #endif /* STRAITLINE_H_ */
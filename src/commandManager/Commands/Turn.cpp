@@ -3,26 +3,71 @@
 #include <new>
 #include <cmath>
 
-Turn::Turn(float consign_rad, float arrivalAngleThreshold_rad)
- : m_angleConsign(consign_rad), m_arrivalAngleThreshold_rad(arrivalAngleThreshold_rad)
+Turn::Turn(float consign_rad, float arrivalAngleThreshold_rad, SCurveProfile::Configuration const *profileConfiguration)
+ : m_angleConsign(consign_rad), m_arrivalAngleThreshold_rad(arrivalAngleThreshold_rad), m_profileConfiguration(profileConfiguration),
+   m_goalConsign(0), m_entrySpeed(0)
 {
 }
 
 void Turn::computeInitialConsign(float , float , float , float *, float *angleConsign, const Regulator &, const Regulator &)
 {
-    *angleConsign += m_angleConsign;
+    m_goalConsign = *angleConsign + m_angleConsign;
+    if (m_profileConfiguration == nullptr)
+    {
+        *angleConsign = m_goalConsign;
+        return;
+    }
+
+    m_profile.plan(*angleConsign, m_angleConsign, *m_profileConfiguration, m_entrySpeed);
+    *angleConsign = m_profile.getPosition();
 }
 
-void Turn::updateConsign(float , float , float , float *, float *, const Regulator &, const Regulator &)
+void Turn::updateConsign(float , float , float , float *, float *angleConsign, const Regulator &, const Regulator &, float deltaT)
 {
+    if (m_profileConfiguration == nullptr)
+        return;
+
+    m_profile.step(deltaT);
+    *angleConsign = m_profile.getPosition();
+}
+
+void Turn::resume(float , float , float , float *, float *angleConsign, const Regulator &, const Regulator &)
+{
+    if (m_profileConfiguration == nullptr)
+    {
+        *angleConsign = m_goalConsign;
+        return;
+    }
+
+    m_profile.plan(*angleConsign, m_goalConsign - *angleConsign, *m_profileConfiguration, m_entrySpeed);
+    *angleConsign = m_profile.getPosition();
 }
 
 bool Turn::isGoalReached(float , float , float , const Regulator &angle_regulator, const Regulator &, const Command* )
 {
-    return fabs(angle_regulator.getError()) <= m_arrivalAngleThreshold_rad;
+    if (m_profileConfiguration != nullptr && !m_profile.isFinished())
+        return false;
+
+    return fabsf(angle_regulator.getError()) <= m_arrivalAngleThreshold_rad;
 }
 
 bool Turn::noStop() const
 {
     return false;
 }
+
+void Turn::setEntrySpeed(float , float angleSpeed)
+{
+    m_entrySpeed = angleSpeed;
+}
+
+bool Turn::getProfileSpeed(float *distanceSpeed, float *angleSpeed, float *distanceAcceleration, float *angleAcceleration) const
+{
+    if (m_profileConfiguration == nullptr)
+        return false;
+
+    *distanceSpeed = 0;
+    *distanceAcceleration = 0;
+    m_profile.getFeedForward(angleSpeed, angleAcceleration);
+    return true;
+}
@@ -2,22 +2,35 @@
 #define TURN_H_
 
 #include "Command.h"
+#include "commandManager/SCurveProfile.h"
 
+/*
+ * Rotation relative. Avec une configuration de profil, la consigne d'angle suit un profil en S
+ *  (voir SCurveProfile, limites en rad/s, rad/s² et rad/s³), sinon elle est donnée d'un coup.
+ */
 class Turn : public Command
 {
     public:
-        explicit Turn(float consign_rad, float arrivalDistanceThreshold_mm);
+        explicit Turn(float consign_rad, float arrivalDistanceThreshold_mm,
+                SCurveProfile::Configuration const *profileConfiguration = nullptr);
         virtual ~Turn() {};
 
         virtual void computeInitialConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator);
-        virtual void updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator);
+        virtual void updateConsign(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator, float deltaT);
         virtual bool isGoalReached(float X_mm, float Y_mm, float theta_rad, const Regulator &angle_regulator, const Regulator &distance_regulator, const Command* nextCommand);
 
         virtual bool noStop() const;
+        virtual bool getProfileSpeed(float *distanceSpeed, float *angleSpeed, float *distanceAcceleration, float *angleAcceleration) const;
+        virtual void setEntrySpeed(float distanceSpeed, float angleSpeed);
+        virtual void resume(float X_mm, float Y_mm, float theta_rad, float *distanceConsig, float *angleConsign, const Regulator &angle_regulator, const Regulator &distance_regulator);
     private:
         float m_angleConsign;
         float m_arrivalAngleThreshold_rad;
 
+        SCurveProfile::Configuration const *m_profileConfiguration;
+        SCurveProfile m_profile;
+        float m_goalConsign;    // consigne d'angle finale, fixée au démarrage
+        float m_entrySpeed;
 };
 
 #endif /* TURN_H_ */
@@ -0,0 +1,142 @@
+#include "LookAheadPlanner.h"
+#include <cmath>
+
+LookAheadPlanner::LookAheadPlanner(Configuration const &configuration)
+: m_configuration(configuration)
+{
+    reset(0, 0, 0);
+}
+
+void LookAheadPlanner::reset(float X_mm, float Y_mm, float speed)
+{
+    m_startX_mm = X_mm;
+    m_startY_mm = Y_mm;
+    m_startSpeed = fabsf(speed);
+    m_waypointCount = 0;
+}
+
+bool LookAheadPlanner::addWaypoint(float X_mm, float Y_mm, bool backward)
+{
+    if (m_waypointCount >= MAX_WAYPOINTS)
+        return false;
+
+    m_X_mm[m_waypointCount] = X_mm;
+    m_Y_mm[m_waypointCount] = Y_mm;
+    m_backward[m_waypointCount] = backward;
+    m_waypointCount++;
+    return true;
+}
+
+float LookAheadPlanner::maxJunctionSpeed(float x1, float y1, float x2, float y2, float *halfTurnTime_s) const
+{
+    /* Le robot tourne de φ (angle entre les deux directions) en 2 * sqrt(φ / α) au mieux, à l'accélération angulaire α.
+     *  À vitesse v constante, il parcourt v * sqrt(φ / α) avant le point et autant après : la corde du virage
+     *  passe à v * sqrt(φ / α) * sin(φ / 2) du point, qu'on borne à junctionDeviation_mm.
+     *  Au milieu du virage, le robot tourne à α * sqrt(φ / α) = sqrt(φ * α) : son accélération latérale v * sqrt(φ * α)
+     *  est bornée à maxLateralAcceleration.
+     */
+    float cosAngle = fmaxf(-1.0f, fminf(1.0f, x1 * x2 + y1 * y2));
+    float angle = acosf(cosAngle);
+    *halfTurnTime_s = sqrtf(angle / m_configuration.maxAngularAcceleration);
+
+    float speed = m_configuration.maxSpeed;
+    float chordFactor = *halfTurnTime_s * sinf(0.5f * angle);
+    if (chordFactor * speed > m_configuration.junctionDeviation_mm)
+        speed = m_configuration.junctionDeviation_mm / chordFactor;
+
+    float peakRotationSpeed = sqrtf(angle * m_configuration.maxAngularAcceleration);
+    if (peakRotationSpeed * speed > m_configuration.maxLateralAcceleration)
+        speed = m_configuration.maxLateralAcceleration / peakRotationSpeed;
+
+    return speed;
+}
+
+void LookAheadPlanner::plan()
+{
+    if (m_waypointCount == 0)
+        return;
+
+    // Longueurs des segments, et vitesse max de chaque jonction d'après l'angle entre le segment qui arrive et celui qui repart
+    float previousX = m_startX_mm, previousY = m_startY_mm;
+    float incomingX = 0, incomingY = 0;
+    for (uint8_t i = 0; i < m_waypointCount; i++)
+    {
+        float deltaX = m_X_mm[i] - previousX;
+        float deltaY = m_Y_mm[i] - previousY;
+        m_length_mm[i] = sqrtf(deltaX * deltaX + deltaY * deltaY);
+
+        if (i > 0)
+        {
+            m_halfTurnTime_s[i - 1] = 0;
+            if (m_backward[i] != m_backward[i - 1])
+            {
+                // Changement de sens de marche : arrêt sur le point
+                m_junctionSpeed[i - 1] = 0;
+            }
+            else if (m_length_mm[i] > 0 && (incomingX != 0 || incomingY != 0))
+            {
+                m_junctionSpeed[i - 1] = maxJunctionSpeed(incomingX, incomingY, deltaX / m_length_mm[i], deltaY / m_length_mm[i],
+                        &m_halfTurnTime_s[i - 1]);
+
+                /* Le virage doit tenir dans la moitié des segments de part et d'autre (points rapprochés d'un chemin sur grille).
+                 *  Le premier segment part du robot et raccourcit à mesure qu'on avance, il a été pris en compte aux plans précédents.
+                 */
+                float turnLength = (i > 1) ? fminf(m_length_mm[i - 1], m_length_mm[i]) : m_length_mm[i];
+                if (m_halfTurnTime_s[i - 1] > 0)
+                    m_junctionSpeed[i - 1] = fminf(m_junctionSpeed[i - 1], 0.5f * turnLength / m_halfTurnTime_s[i - 1]);
+            }
+            else
+            {
+                // Segment de longueur nulle : pas de virage à cette jonction
+                m_junctionSpeed[i - 1] = m_configuration.maxSpeed;
+            }
+        }
+
+        if (m_length_mm[i] > 0)
+        {
+            incomingX = deltaX / m_length_mm[i];
+            incomingY = deltaY / m_length_mm[i];
+        }
+        previousX = m_X_mm[i];
+        previousY = m_Y_mm[i];
+    }
+    m_junctionSpeed[m_waypointCount - 1] = 0;
+    m_halfTurnTime_s[m_waypointCount - 1] = 0;
+
+    const float twoAcceleration = 2.0f * m_configuration.maxAcceleration;
+
+    /* Passe arrière : depuis chaque jonction, on doit pouvoir freiner jusqu'à la vitesse de la suivante,
+     *  atteinte au début de son virage (voir passDistance) et non sur le point.
+     */
+    for (int i = m_waypointCount - 2; i >= 0; i--)
+    {
+        float nextSpeed = m_junctionSpeed[i + 1];
+        float brakingLength = fmaxf(0, m_length_mm[i + 1] - passDistance(i + 1));
+        m_junctionSpeed[i] = fminf(m_junctionSpeed[i], sqrtf(nextSpeed * nextSpeed + twoAcceleration * brakingLength));
+    }
+
+    // Passe avant : depuis la vitesse actuelle, on ne peut pas accélérer plus que maxAcceleration sur chaque segment
+    float speed = m_startSpeed;
+    for (uint8_t i = 0; i < m_waypointCount; i++)
+    {
+        m_junctionSpeed[i] = fminf(m_junctionSpeed[i], sqrtf(speed * speed + twoAcceleration * m_length_mm[i]));
+        speed = m_junctionSpeed[i];
+    }
+
+    for (uint8_t i = 0; i < m_waypointCount; i++)
+        m_passDistance_mm[i] = passDistance(i);
+}
+
+float LookAheadPlanner::passDistance(uint8_t index) const
+{
+    /* Le virage commence à v * sqrt(φ / α) du point, avec la vitesse de la jonction.
+     *  On ne peut pas non plus changer de commande plus tôt qu'une période de consigne.
+     */
+    return m_junctionSpeed[index] * fmaxf(m_halfTurnTime_s[index], m_configuration.samplePeriod_s);
+}
+
+float LookAheadPlanner::approachSpeed(float remaining_mm, float exitSpeed, float maxAcceleration, float Kp)
+{
+    remaining_mm = fmaxf(remaining_mm, 0);
+    return fminf(sqrtf(exitSpeed * exitSpeed + 2.0f * maxAcceleration * remaining_mm), exitSpeed + Kp * remaining_mm);
+}
@@ -0,0 +1,112 @@
+#ifndef SRC_COMMANDMANAGER_LOOKAHEADPLANNER_H_
+#define SRC_COMMANDMANAGER_LOOKAHEADPLANNER_H_
+
+#include <cstdint>
+
+/*
+ * Planification des vitesses de passage aux points d'une suite de commandes Goto/GotoNoStop,
+ *  comme le fait un firmware de CNC avec sa file de segments.
+ *
+ *  Le chemin est la ligne brisée qui part de la position du robot et passe par les points des MAX_WAYPOINTS
+ *  premières commandes enchaînables de la file. À chaque jonction, la vitesse max de passage dépend de l'angle
+ *  du virage (méthode de la "junction deviation" des CNC, adaptée à un robot différentiel) : le robot tourne de φ
+ *  en 2 * sqrt(φ / maxAngularAcceleration) au mieux, à vitesse constante, en coupant le virage.
+ *  La vitesse est choisie pour que le robot ne passe pas à plus de junctionDeviation_mm du point, et que son accélération
+ *  latérale au plus fort du virage (vitesse de rotation sqrt(φ * maxAngularAcceleration)) reste sous maxLateralAcceleration.
+ *  Elle est nulle pour un changement de sens de marche, maxSpeed pour deux segments alignés, et le dernier point est un arrêt.
+ *
+ *  Deux passes bornent ensuite ces vitesses par l'accélération max sur la longueur des segments :
+ *   - arrière, depuis le dernier point : on doit pouvoir freiner jusqu'au début du virage suivant,
+ *   - avant, depuis la vitesse actuelle : on ne peut pas accélérer plus vite que maxAcceleration.
+ *  Le robot ne ralentit ainsi que pour le virage le plus serré à venir, et pas devant chaque point.
+ *
+ *  Calculs en simple précision, le plan est refait à chaque CommandManager::update().
+ */
+class LookAheadPlanner
+{
+public:
+    struct Configuration
+    {
+        float maxSpeed;                // mm/s
+        float maxAcceleration;         // mm/s², en accélération comme en freinage
+        float maxAngularAcceleration;  // rad/s², du robot qui tourne en roulant
+        float maxLateralAcceleration;  // mm/s², borne la vitesse dans les virages : v * vitesse de rotation
+        float junctionDeviation_mm;    // écart toléré au point de passage, fixe la vitesse dans les virages
+        float samplePeriod_s;          // période de CommandManager::update()
+    };
+
+    static constexpr uint8_t MAX_WAYPOINTS = 8;
+
+    explicit LookAheadPlanner(Configuration const &configuration);
+
+    /*
+     * Recommence un chemin depuis la position (et la vitesse, en valeur absolue) actuelle du robot
+     */
+    void reset(float X_mm, float Y_mm, float speed);
+
+    /*
+     * Ajoute le point suivant du chemin, rend false si le plan est complet
+     */
+    bool addWaypoint(float X_mm, float Y_mm, bool backward);
+
+    /*
+     * Calcule les vitesses de passage : jonctions, passe arrière puis passe avant
+     */
+    void plan();
+
+    uint8_t getWaypointCount() const
+    {
+        return m_waypointCount;
+    }
+
+    /*
+     * Vitesse de passage au point 'index' (0 : point de la commande en cours), nulle au dernier point
+     */
+    float getJunctionSpeed(uint8_t index) const
+    {
+        return m_junctionSpeed[index];
+    }
+
+    /*
+     * Distance au point 'index' à laquelle le robot commence son virage vers le point suivant
+     */
+    float getPassDistance(uint8_t index) const
+    {
+        return m_passDistance_mm[index];
+    }
+
+    Configuration const & getConfiguration() const
+    {
+        return m_configuration;
+    }
+
+    /*
+     * Vitesse de consigne à 'remaining_mm' d'un point à passer à 'exitSpeed' :
+     *  freinage à maxAcceleration loin du point, puis approche proportionnelle (gain Kp du régulateur de distance)
+     */
+    static float approachSpeed(float remaining_mm, float exitSpeed, float maxAcceleration, float Kp);
+
+private:
+    // Vitesse max de passage entre deux segments de directions unitaires (x1, y1) puis (x2, y2), et demi durée du virage
+    float maxJunctionSpeed(float x1, float y1, float x2, float y2, float *halfTurnTime_s) const;
+
+    // Distance au point 'index' du début du virage, à la vitesse de passage actuelle de la jonction
+    float passDistance(uint8_t index) const;
+
+    Configuration m_configuration;
+
+    float m_startX_mm;
+    float m_startY_mm;
+    float m_startSpeed;
+
+    uint8_t m_waypointCount;
+    float m_X_mm[MAX_WAYPOINTS];
+    float m_Y_mm[MAX_WAYPOINTS];
+    bool m_backward[MAX_WAYPOINTS];
+    float m_length_mm[MAX_WAYPOINTS];    // longueur du segment qui arrive au point
+    float m_junctionSpeed[MAX_WAYPOINTS];
+    float m_halfTurnTime_s[MAX_WAYPOINTS];
+    float m_passDistance_mm[MAX_WAYPOINTS];
+};
+
+#endif /* SRC_COMMANDMANAGER_LOOKAHEADPLANNER_H_ */
@@ -0,0 +1,249 @@
+#include "SCurveProfile.h"
+#include <cmath>
+
+SCurveProfile::SCurveProfile()
+{
+    Configuration none = {0, 0, 0, 0};
+    plan(0, 0, none);
+}
+
+void SCurveProfile::plan(float origin, float distance, Configuration const &configuration, float initialSpeed)
+{
+    m_origin = origin;
+    m_distance = distance;
+    m_direction = (distance < 0) ? -1.0f : 1.0f;
+    m_accelerationFeedForward = configuration.accelerationFeedForward_s;
+
+    m_jerk = configuration.maxJerk;
+    m_peakSpeed = configuration.maxSpeed;
+    m_accelerationRamp = ramp(0, 0, 0, 0);
+    m_decelerationRamp = m_accelerationRamp;
+    m_cruiseTime = 0;
+    m_duration = 0;
+
+    const float maxAcceleration = configuration.maxAcceleration;
+    float length = fabsf(distance);
+    if (length <= 0 || m_jerk <= 0 || maxAcceleration <= 0 || m_peakSpeed <= 0)
+    {
+        // Rien à planifier : la consigne est directement la position finale
+        m_peakSpeed = 0;
+        m_time = 0;
+        m_position = origin + distance;
+        m_speed = 0;
+        m_acceleration = 0;
+        return;
+    }
+
+    float startSpeed = fminf(initialSpeed * m_direction, m_peakSpeed);
+    if (startSpeed > 0)
+    {
+        planFromSpeed(startSpeed, length, maxAcceleration);
+        return;
+    }
+
+    float peakAcceleration = maxAcceleration;
+    float jerkTime;
+    float accelerationTime;
+    float accelerationDistance;
+
+    // Vitesse max atteinte avant l'accélération max : pas de palier d'accélération
+    if (m_peakSpeed * m_jerk < peakAcceleration * peakAcceleration)
+        peakAcceleration = sqrtf(m_peakSpeed * m_jerk);
+
+    // La phase d'accélération est symétrique : on y parcourt vitesse crête * durée / 2, de même pour la décélération
+    jerkTime = peakAcceleration / m_jerk;
+    accelerationTime = m_peakSpeed / peakAcceleration + jerkTime;
+
+    if (m_peakSpeed * accelerationTime > length)
+    {
+        /* Déplacement trop court pour atteindre la vitesse max, pas de palier de vitesse.
+         *  Avec un palier d'accélération, la distance vaut V * (V/A + A/J) : on résout en V.
+         */
+        float accelerationOverJerk = peakAcceleration / m_jerk;
+        m_peakSpeed = 0.5f * peakAcceleration
+                * (sqrtf(accelerationOverJerk * accelerationOverJerk + 4.0f * length / peakAcceleration) - accelerationOverJerk);
+
+        if (m_peakSpeed < peakAcceleration * accelerationOverJerk)
+        {
+            // Pas de palier d'accélération non plus : distance = 2 * V^(3/2) / sqrt(J)
+            m_peakSpeed = cbrtf(0.25f * length * length * m_jerk);
+            peakAcceleration = sqrtf(m_peakSpeed * m_jerk);
+            jerkTime = peakAcceleration / m_jerk;
+        }
+        accelerationTime = m_peakSpeed / peakAcceleration + jerkTime;
+        accelerationDistance = 0.5f * length;
+    }
+    else
+    {
+        accelerationDistance = 0.5f * m_peakSpeed * accelerationTime;
+        m_cruiseTime = (length - 2.0f * accelerationDistance) / m_peakSpeed;
+    }
+    m_duration = 2.0f * accelerationTime + m_cruiseTime;
+
+    m_accelerationRamp.endSpeed = m_peakSpeed;
+    m_accelerationRamp.peakAcceleration = peakAcceleration;
+    m_accelerationRamp.jerkTime = jerkTime;
+    m_accelerationRamp.duration = accelerationTime;
+    m_accelerationRamp.distance = accelerationDistance;
+    m_decelerationRamp = m_accelerationRamp;
+
+    m_time = 0;
+    m_position = origin;
+    m_speed = 0;
+    m_acceleration = 0;
+}
+
+void SCurveProfile::planFromSpeed(float startSpeed, float length, float maxAcceleration)
+{
+    /* Au plus la vitesse dont la décélération seule tient sur la distance, cherchée par dichotomie :
+     *  la distance d'une rampe croît avec sa vitesse crête
+     */
+    if (ramp(0, startSpeed, maxAcceleration, m_jerk).distance > length)
+    {
+        float low = 0;
+        float high = startSpeed;
+        for (uint8_t i = 0; i < SPEED_SEARCH_ITERATIONS; i++)
+        {
+            float speed = 0.5f * (low + high);
+            if (ramp(0, speed, maxAcceleration, m_jerk).distance > length)
+                high = speed;
+            else
+                low = speed;
+        }
+        startSpeed = low;
+    }
+
+    // Vitesse crête : la plus grande, jusqu'à la vitesse max, dont les deux rampes tiennent sur la distance
+    if (ramp(startSpeed, m_peakSpeed, maxAcceleration, m_jerk).distance + ramp(0, m_peakSpeed, maxAcceleration, m_jerk).distance > length)
+    {
+        float low = startSpeed;
+        float high = m_peakSpeed;
+        for (uint8_t i = 0; i < SPEED_SEARCH_ITERATIONS; i++)
+        {
+            float speed = 0.5f * (low + high);
+            if (ramp(startSpeed, speed, maxAcceleration, m_jerk).distance + ramp(0, speed, maxAcceleration, m_jerk).distance > length)
+                high = speed;
+            else
+                low = speed;
+        }
+        m_peakSpeed = low;
+    }
+
+    m_accelerationRamp = ramp(startSpeed, m_peakSpeed, maxAcceleration, m_jerk);
+    m_decelerationRamp = ramp(0, m_peakSpeed, maxAcceleration, m_jerk);
+    m_cruiseTime = fmaxf(0.0f, length - m_accelerationRamp.distance - m_decelerationRamp.distance) / m_peakSpeed;
+    m_duration = m_accelerationRamp.duration + m_cruiseTime + m_decelerationRamp.duration;
+
+    m_time = 0;
+    m_position = m_origin;
+    m_speed = m_direction * startSpeed;
+    m_acceleration = 0;
+}
+
+float SCurveProfile::stoppingDistance(float speed, Configuration const &configuration)
+{
+    // Même borne que plan() sur la vitesse initiale : la décélération seule tient alors exactement sur cette distance
+    return ramp(0, fminf(fabsf(speed), configuration.maxSpeed), configuration.maxAcceleration, configuration.maxJerk).distance;
+}
+
+SCurveProfile::Ramp SCurveProfile::ramp(float startSpeed, float endSpeed, float maxAcceleration, float jerk)
+{
+    Ramp ramp;
+    ramp.startSpeed = startSpeed;
+    ramp.endSpeed = endSpeed;
+    ramp.peakAcceleration = maxAcceleration;
+    ramp.jerkTime = 0;
+    ramp.duration = 0;
+    ramp.distance = 0;
+
+    float speedChange = endSpeed - startSpeed;
+    if (speedChange <= 0 || jerk <= 0)
+        return ramp;
+
+    // Changement de vitesse atteint avant l'accélération max : pas de palier d'accélération
+    if (speedChange * jerk < maxAcceleration * maxAcceleration)
+        ramp.peakAcceleration = sqrtf(speedChange * jerk);
+
+    // Rampe symétrique en accélération : vitesse moyenne à mi-chemin
+    ramp.jerkTime = ramp.peakAcceleration / jerk;
+    ramp.duration = speedChange / ramp.peakAcceleration + ramp.jerkTime;
+    ramp.distance = 0.5f * (startSpeed + endSpeed) * ramp.duration;
+    return ramp;
+}
+
+void SCurveProfile::step(float deltaT)
+{
+    m_time += deltaT;
+    sample(m_time, &m_position, &m_speed, &m_acceleration);
+}
+
+void SCurveProfile::getFeedForward(float *speed, float *acceleration) const
+{
+    float position;
+    sample(m_time + m_accelerationFeedForward, &position, speed, acceleration);
+}
+
+void SCurveProfile::rampPhase(Ramp const &ramp, float tau, float *position, float *speed, float *acceleration) const
+{
+    const float constantAccelerationEnd = ramp.duration - ramp.jerkTime;
+
+    if (tau < ramp.jerkTime)
+    {
+        *acceleration = m_jerk * tau;
+        *speed = ramp.startSpeed + 0.5f * m_jerk * tau * tau;
+        *position = ramp.startSpeed * tau + m_jerk * tau * tau * tau / 6.0f;
+    }
+    else if (tau < constantAccelerationEnd)
+    {
+        const float jerkSpeed = ramp.startSpeed + 0.5f * m_jerk * ramp.jerkTime * ramp.jerkTime;
+        const float jerkPosition = ramp.startSpeed * ramp.jerkTime + 0.5f * m_jerk * ramp.jerkTime * ramp.jerkTime * ramp.jerkTime / 3.0f;
+        const float s = tau - ramp.jerkTime;
+        *acceleration = ramp.peakAcceleration;
+        *speed = jerkSpeed + ramp.peakAcceleration * s;
+        *position = jerkPosition + jerkSpeed * s + 0.5f * ramp.peakAcceleration * s * s;
+    }
+    else
+    {
+        // Dernier segment, compté depuis la fin de la rampe (vitesse crête, accélération nulle)
+        const float s = ramp.duration - tau;
+        *acceleration = m_jerk * s;
+        *speed = ramp.endSpeed - 0.5f * m_jerk * s * s;
+        *position = ramp.distance - ramp.endSpeed * s + m_jerk * s * s * s / 6.0f;
+    }
+}
+
+void SCurveProfile::sample(float t, float *position, float *speed, float *acceleration) const
+{
+    float p, v, a;
+
+    if (t >= m_duration)
+    {
+        *position = m_origin + m_distance;
+        *speed = 0;
+        *acceleration = 0;
+        return;
+    }
+
+    const float decelerationStart = m_accelerationRamp.duration + m_cruiseTime;
+    if (t < m_accelerationRamp.duration)
+    {
+        rampPhase(m_accelerationRamp, t, &p, &v, &a);
+    }
+    else if (t < decelerationStart)
+    {
+        p = m_accelerationRamp.distance + m_peakSpeed * (t - m_accelerationRamp.duration);
+        v = m_peakSpeed;
+        a = 0;
+    }
+    else
+    {
+        // La décélération est la rampe depuis l'arrêt, parcourue depuis la fin du profil
+        rampPhase(m_decelerationRamp, m_duration - t, &p, &v, &a);
+        p = fabsf(m_distance) - p;
+        a = -a;
+    }
+
+    *position = m_origin + m_direction * p;
+    *speed = m_direction * v;
+    *acceleration = m_direction * a;
+}
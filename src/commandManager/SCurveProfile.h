@@ -0,0 +1,139 @@
+#ifndef SRC_COMMANDMANAGER_SCURVEPROFILE_H_
+#define SRC_COMMANDMANAGER_SCURVEPROFILE_H_
+
+#include <cstdint>
+
+/*
+ * Profil de vitesse en S (jerk limité, sept segments), jusqu'à l'arrêt, en partant de l'arrêt ou d'une vitesse initiale.
+ *
+ *  Planifié une fois au début d'une commande (StraitLine, Turn) à partir de la distance à parcourir
+ *  et des limites du robot (vitesse, accélération, jerk), puis échantillonné à chaque CommandManager::update(),
+ *  au temps réellement écoulé depuis la mise à jour précédente.
+ *  Il donne la consigne de position, de vitesse et d'accélération du régulateur.
+ *
+ *  Les sept segments, de jerk constant : +J, 0, -J (accélération), 0 (palier à vitesse max), -J, 0, +J (décélération).
+ *  Si la distance est trop courte pour atteindre la vitesse max (puis l'accélération max),
+ *  le palier correspondant disparaît et la vitesse crête est réduite.
+ *  L'accélération est aussi limitée en décélération : le robot ne freine plus sur la seule sortie du régulateur P.
+ *
+ *  Avec une vitesse initiale (commande qui en remplace une autre en cours de mouvement, voir CommandManager::QUEUE_REPLACE_CURRENT),
+ *   la phase d'accélération part de cette vitesse et n'est plus le symétrique de la décélération.
+ *   Sur la distance de freinage de cette vitesse (stoppingDistance()), le profil n'est plus que la décélération (CommandManager::pause).
+ *
+ *  La distance peut être négative (recul, rotation en sens horaire), les limites sont en valeur absolue.
+ *  Calculs en simple précision, le profil est échantillonné dans la boucle d'asserv.
+ */
+class SCurveProfile
+{
+public:
+    struct Configuration
+    {
+        float maxSpeed;
+        float maxAcceleration;
+        float maxJerk;
+        float accelerationFeedForward_s; // avance de la vitesse d'anticipation sur le retard de l'asserv en vitesse, voir getFeedForward()
+    };
+
+    explicit SCurveProfile();
+
+    /*
+     * Planifie un déplacement de 'distance' depuis 'origin', et revient au début du profil.
+     *  initialSpeed : vitesse au début du profil, dans l'unité de maxSpeed. Elle n'est gardée que dans le sens du déplacement,
+     *  bornée à maxSpeed et à la vitesse dont on peut encore freiner sur la distance : au delà, le robot dépasserait le but.
+     */
+    void plan(float origin, float distance, Configuration const &configuration, float initialSpeed = 0);
+
+    /*
+     * Distance parcourue pour freiner de 'speed' jusqu'à l'arrêt, en valeur absolue, vitesse bornée à maxSpeed
+     */
+    static float stoppingDistance(float speed, Configuration const &configuration);
+
+    /*
+     * Avance de deltaT secondes, puis met à jour les consignes
+     */
+    void step(float deltaT);
+
+    /*
+     * Consignes au temps t (en s) depuis le début du profil, bornées à sa fin
+     */
+    void sample(float t, float *position, float *speed, float *acceleration) const;
+
+    float getPosition() const
+    {
+        return m_position;
+    }
+    float getSpeed() const
+    {
+        return m_speed;
+    }
+    float getAcceleration() const
+    {
+        return m_acceleration;
+    }
+
+    /*
+     * Vitesse passée en anticipation au régulateur : vitesse du profil accelerationFeedForward_s plus tard.
+     *  L'asserv en vitesse (et le moteur) suit sa consigne avec du retard, sans cette avance le robot
+     *  traîne derrière le profil pendant l'accélération puis le dépasse à la décélération.
+     *  Prise sur le profil lui-même (et non vitesse + accélération * avance), elle en garde les limites :
+     *  la consigne de vitesse ne varie jamais plus vite que maxAcceleration et ne dépasse pas maxSpeed.
+     *  L'accélération du profil au même instant permet à la boucle d'asserv d'interpoler cette vitesse entre deux mises à jour.
+     */
+    void getFeedForward(float *speed, float *acceleration) const;
+
+    float getDuration() const
+    {
+        return m_duration;
+    }
+    float getPeakSpeed() const
+    {
+        return m_peakSpeed;
+    }
+    bool isFinished() const
+    {
+        return m_time >= m_duration;
+    }
+
+private:
+    /*
+     * Rampe de vitesse de startSpeed à endSpeed, en valeur absolue : segments 1 à 3 pour l'accélération,
+     *  la décélération est la rampe de 0 à la vitesse crête parcourue depuis la fin du profil
+     */
+    struct Ramp
+    {
+        float startSpeed;
+        float endSpeed;
+        float peakAcceleration;
+        float jerkTime;     // durée des segments à jerk non nul
+        float duration;
+        float distance;
+    };
+
+    static Ramp ramp(float startSpeed, float endSpeed, float maxAcceleration, float jerk);
+
+    // Planification avec une vitesse initiale : vitesses crête et initiale bornées par dichotomie, sur la distance
+    static constexpr uint8_t SPEED_SEARCH_ITERATIONS = 24;
+    void planFromSpeed(float startSpeed, float length, float maxAcceleration);
+
+    // Rampe parcourue jusqu'à tau, dans [0, ramp.duration]
+    void rampPhase(Ramp const &ramp, float tau, float *position, float *speed, float *acceleration) const;
+
+    float m_origin;
+    float m_distance;
+    float m_direction;
+    float m_accelerationFeedForward;
+
+    float m_jerk;
+    float m_peakSpeed;
+    Ramp m_accelerationRamp;       // segments 1 à 3
+    Ramp m_decelerationRamp;       // segments 5 à 7, à rebours
+    float m_cruiseTime;            // durée du palier à vitesse max (segment 4)
+    float m_duration;
+
+    float m_time;
+    float m_position;
+    float m_speed;
+    float m_acceleration;
+};
+
+#endif /* SRC_COMMANDMANAGER_SCURVEPROFILE_H_ */
@@ -1,7 +1,6 @@
 #include "Md22.h"
 #include <ch.h>
 #include <hal.h>
-#include <chprintf.h>
 #include "util/asservMath.h"
 
 constexpr uint8_t md22Address = 0xB0 >> 1; // MD22 address (All switches to ON) 0x10110000 =>1011000 0x58
@@ -12,9 +11,16 @@ constexpr uint8_t accReg = 0x03;
 
 constexpr uint8_t controlMode = 0x01; // Wanted value for mode register. Ie: -128 (full reverse)   0 (stop)   127 (full forward).
 
-extern BaseSequentialStream *outputStream;
+// Le thread d'écriture asynchrone passe juste après le thread d'asserv
+constexpr tprio_t asyncWriterPriority = HIGHPRIO - 1;
+// Délai avant de réessayer une écriture ratée quand aucune nouvelle consigne n'arrive
+constexpr sysinterval_t asyncWriterRetryDelay = TIME_MS2I(1);
 
- Md22::Md22(I2cPinInit *i2cPins, bool is1motorRight, bool invertMotorRight, bool invertMotorLeft, uint32_t i2cFrequency) :
+static THD_WORKING_AREA(waMd22AsyncWriter, 512);
+static bool asyncWriterStarted = false;
+
+ Md22::Md22(I2cPinInit *i2cPins, bool is1motorRight, bool invertMotorRight, bool invertMotorLeft, uint32_t i2cFrequency,
+        bool asynchronousWrite) :
         MotorController()
 {
     m_i2cPinConf = *i2cPins;
@@ -23,6 +29,13 @@ extern BaseSequentialStream *outputStream;
     m_is1motorRight = is1motorRight;
     m_lastRightConsign = 0;
     m_lastLeftConsign = 0;
+    m_asynchronousWrite = asynchronousWrite;
+
+    m_commandSlot = 0;
+    m_publishSequence = 0;
+    for (int i = 0; i < PUBLISH_TIMES_SIZE; i++)
+        m_publishTimes[i] = 0;
+    resetWriteStats();
 
     chDbgAssert(i2cFrequency <= 400000, "Md22: i2cFrequency shall be lower than 400khz \r\n");
 
@@ -83,6 +96,16 @@ void Md22::init()
     chDbgAssert(msg == MSG_OK, "Config MD22 - i2cMasterTransmitTimeout motor2Reg ERROR NOK\r\n");
 
     i2cReleaseBus(&I2CD1);
+
+    if (m_asynchronousWrite)
+    {
+        // Le working area du thread est statique : un seul Md22 asynchrone possible
+        chDbgAssert(!asyncWriterStarted, "Md22: only one asynchronous writer can be started");
+        asyncWriterStarted = true;
+
+        chBSemObjectInit(&m_newCommandSemaphore, true);
+        chThdCreateStatic(waMd22AsyncWriter, sizeof(waMd22AsyncWriter), asyncWriterPriority, Md22::asyncWriterThread, this);
+    }
 }
 
 msg_t Md22::i2cMasterTransmitTimeoutTimes(I2CDriver *i2cp,
@@ -94,7 +117,7 @@ msg_t Md22::i2cMasterTransmitTimeoutTimes(I2CDriver *i2cp,
                                sysinterval_t timeout, int times)
 {
 
-    msg_t r;
+    msg_t r = MSG_RESET;
    for(int i = 0; i <= times ; i++)
    {
        if (i2cp->state != I2C_READY)
@@ -107,7 +130,8 @@ msg_t Md22::i2cMasterTransmitTimeoutTimes(I2CDriver *i2cp,
            return r;
        else
        {
-           chprintf(outputStream,"...Md22::i2cMasterTransmitTimeoutTimes try... %d  \r\n", i);
+           // Compté pour 'asserv md22stats' : un affichage ici bloquerait l'appelant sur le port série
+           m_failedTries.fetch_add(1, std::memory_order_relaxed);
 
            i2cReleaseBus(&I2CD1);
            chThdSleepMilliseconds(2);
@@ -118,14 +142,51 @@ msg_t Md22::i2cMasterTransmitTimeoutTimes(I2CDriver *i2cp,
    return r;
 }
 
-void Md22::setMotorLeftSpeed(float percentage)
+int8_t Md22::computeConsign(float percentage, bool invert)
 {
     percentage = limit(percentage, -100.0, 100.0);
 
-    if (m_invertMotorLeft)
+    if (invert)
         percentage = -percentage;
 
-    int8_t md22SpeedConsign = (int8_t) fmap(percentage, -100.0, 100.0, -128.0, 127.0);
+    return (int8_t) fmap(percentage, -100.0, 100.0, -128.0, 127.0);
+}
+
+msg_t Md22::writeMotorsRegisters(int8_t rightConsign, int8_t leftConsign, sysinterval_t timeout, int times)
+{
+    // Le MD22 incrémente l'adresse du registre à chaque octet écrit : les deux moteurs en une seule transaction
+    uint8_t cmd[3];
+    cmd[0] = motor1Reg;
+    if (m_is1motorRight)
+    {
+        cmd[1] = (uint8_t) rightConsign;
+        cmd[2] = (uint8_t) leftConsign;
+    }
+    else
+    {
+        cmd[1] = (uint8_t) leftConsign;
+        cmd[2] = (uint8_t) rightConsign;
+    }
+
+    i2cAcquireBus(&I2CD1);
+    msg_t msg = i2cMasterTransmitTimeoutTimes(&I2CD1, md22Address, cmd, sizeof(cmd), NULL, 0, timeout, times);
+    i2cReleaseBus(&I2CD1);
+    return msg;
+}
+
+void Md22::setMotorLeftSpeed(float percentage)
+{
+    if (m_asynchronousWrite)
+    {
+        int8_t leftConsign = computeConsign(percentage, m_invertMotorLeft);
+        chSysLock();
+        publishConsignsS(m_lastRightConsign, leftConsign);
+        chSysUnlock();
+        chBSemSignal(&m_newCommandSemaphore);
+        return;
+    }
+
+    int8_t md22SpeedConsign = computeConsign(percentage, m_invertMotorLeft);
     uint8_t reg ;
     if (m_is1motorRight)
         reg = motor2Reg;
@@ -136,17 +197,24 @@ void Md22::setMotorLeftSpeed(float percentage)
     i2cAcquireBus (&I2CD1);
     i2cMasterTransmitTimeoutTimes(&I2CD1, md22Address, cmd, sizeof(cmd), NULL, 0, TIME_MS2I(1), 15);
     i2cReleaseBus(&I2CD1);
+    chSysLock();
     m_lastLeftConsign = md22SpeedConsign;
+    chSysUnlock();
 }
 
 void Md22::setMotorRightSpeed(float percentage)
 {
-    percentage = limit(percentage, -100.0, 100.0);
-
-    if (m_invertMotorRight)
-        percentage = -percentage;
-
-    int8_t md22SpeedConsign = (int8_t) fmap(percentage, -100.0, 100.0, -128.0, 127.0);
+    if (m_asynchronousWrite)
+    {
+        int8_t rightConsign = computeConsign(percentage, m_invertMotorRight);
+        chSysLock();
+        publishConsignsS(rightConsign, m_lastLeftConsign);
+        chSysUnlock();
+        chBSemSignal(&m_newCommandSemaphore);
+        return;
+    }
+
+    int8_t md22SpeedConsign = computeConsign(percentage, m_invertMotorRight);
     uint8_t reg;
     if (m_is1motorRight)
         reg = motor1Reg;
@@ -157,6 +225,125 @@ void Md22::setMotorRightSpeed(float percentage)
     i2cAcquireBus (&I2CD1);
     i2cMasterTransmitTimeoutTimes(&I2CD1, md22Address, cmd, sizeof(cmd), NULL, 0, TIME_MS2I(1), 15);
     i2cReleaseBus(&I2CD1);
+    chSysLock();
     m_lastRightConsign = md22SpeedConsign;
+    chSysUnlock();
+}
+
+void Md22::setMotorsSpeed(float rightPercentage, float leftPercentage)
+{
+    int8_t rightConsign = computeConsign(rightPercentage, m_invertMotorRight);
+    int8_t leftConsign = computeConsign(leftPercentage, m_invertMotorLeft);
+
+    if (m_asynchronousWrite)
+    {
+        publishConsigns(rightConsign, leftConsign);
+    }
+    else
+    {
+        writeMotorsRegisters(rightConsign, leftConsign, TIME_MS2I(1), 15);
+        chSysLock();
+        m_lastRightConsign = rightConsign;
+        m_lastLeftConsign = leftConsign;
+        chSysUnlock();
+    }
+}
+
+void Md22::publishConsigns(int8_t rightConsign, int8_t leftConsign)
+{
+    chSysLock();
+    publishConsignsS(rightConsign, leftConsign);
+    chSysUnlock();
+
+    // Réveille le thread d'écriture, sans attendre : il est moins prioritaire que l'appelant
+    chBSemSignal(&m_newCommandSemaphore);
+}
+
+void Md22::publishConsignsS(int8_t rightConsign, int8_t leftConsign)
+{
+    uint16_t sequence = (uint16_t) (m_publishSequence.fetch_add(1, std::memory_order_relaxed) + 1);
+    m_publishTimes[sequence % PUBLISH_TIMES_SIZE].store(chSysGetRealtimeCounterX(), std::memory_order_relaxed);
+
+    uint32_t command = ((uint32_t) sequence << 16) | ((uint32_t) (uint8_t) leftConsign << 8) | (uint8_t) rightConsign;
+    m_commandSlot.store(command, std::memory_order_release);
+
+    m_lastRightConsign = rightConsign;
+    m_lastLeftConsign = leftConsign;
 }
 
+void Md22::asyncWriterThread(void *arg)
+{
+    chRegSetThreadName("Md22AsyncWriter");
+    static_cast<Md22*>(arg)->asyncWriterLoop();
+}
+
+void Md22::asyncWriterLoop()
+{
+    uint16_t lastWrittenSequence = 0;
+    bool lastWriteFailed = false;
+
+    while (true)
+    {
+        // Après un échec, on réessaie avec la consigne la plus récente, même si aucune nouvelle n'est publiée
+        chBSemWaitTimeout(&m_newCommandSemaphore, lastWriteFailed ? asyncWriterRetryDelay : TIME_INFINITE);
+
+        uint32_t command = m_commandSlot.load(std::memory_order_acquire);
+        uint16_t sequence = command >> 16;
+        if (sequence == lastWrittenSequence)
+            continue;
+
+        // Une seule tentative : la prochaine consigne arrive à la prochaine période d'asserv
+        msg_t msg = writeMotorsRegisters((int8_t) (command & 0xFF), (int8_t) ((command >> 8) & 0xFF), TIME_MS2I(1), 0);
+        if (msg != MSG_OK)
+        {
+            chSysLock();
+            m_writeStats.errors++;
+            chSysUnlock();
+            lastWriteFailed = true;
+            continue;
+        }
+        lastWriteFailed = false;
+
+        rtcnt_t publishTime = m_publishTimes[sequence % PUBLISH_TIMES_SIZE].load(std::memory_order_relaxed);
+        uint32_t latency_us = RTC2US(STM32_HCLK, chSysGetRealtimeCounterX() - publishTime);
+
+        chSysLock();
+        m_writeStats.dropped += (uint16_t) (sequence - lastWrittenSequence - 1);
+        m_writeStats.written++;
+        m_writeStats.sumLatency_us += latency_us;
+        if (latency_us < m_writeStats.minLatency_us)
+            m_writeStats.minLatency_us = latency_us;
+        if (latency_us > m_writeStats.maxLatency_us)
+            m_writeStats.maxLatency_us = latency_us;
+        chSysUnlock();
+
+        lastWrittenSequence = sequence;
+    }
+}
+
+Md22::WriteStats Md22::getWriteStats()
+{
+    chSysLock();
+    WriteStats stats = m_writeStats;
+    // Toutes les publications depuis le dernier reset, qu'elles aient été écrites, écrasées ou pas encore traitées
+    stats.published = m_publishSequence.load(std::memory_order_relaxed) - m_publishSequenceAtReset;
+    chSysUnlock();
+    stats.failedTries = m_failedTries.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void Md22::resetWriteStats()
+{
+    chSysLock();
+    m_writeStats.published = 0;
+    m_writeStats.written = 0;
+    m_writeStats.dropped = 0;
+    m_writeStats.errors = 0;
+    m_writeStats.failedTries = 0;
+    m_writeStats.minLatency_us = UINT32_MAX;
+    m_writeStats.maxLatency_us = 0;
+    m_writeStats.sumLatency_us = 0;
+    m_publishSequenceAtReset = m_publishSequence.load(std::memory_order_relaxed);
+    chSysUnlock();
+    m_failedTries.store(0, std::memory_order_relaxed);
+}
@@ -4,10 +4,11 @@
 #include "MotorController.h"
 #include "ch.h"
 #include "hal.h"
+#include <atomic>
 #include <string>
 using namespace std;
 
-class Md22: public MotorController
+class Md22 final : public MotorController
 {
 public:
     struct I2cPinInit
@@ -18,7 +19,33 @@ public:
         uint8_t pinNumberSDA;
     };
 
-    explicit Md22(I2cPinInit *i2cPins, bool is1motorRight, bool invertMotorRight, bool invertMotorLeft, uint32_t i2cFrequency);
+    /*
+     * Statistiques d'écriture. Les latences, entre la publication d'une consigne et la fin de son écriture
+     *  sur le bus, et les compteurs published/written/dropped/errors ne concernent que le mode asynchrone.
+     *  failedTries compte les transactions I2C ratées dans les deux modes : elles ne sont plus affichées
+     *  au moment de l'échec, pour ne pas bloquer le thread d'écriture sur le port série.
+     */
+    struct WriteStats
+    {
+        uint32_t published; // consignes publiées, écrites ou non
+        uint32_t written;
+        uint32_t dropped; // consignes écrasées par une plus récente avant d'avoir été écrites
+        uint32_t errors; // écritures asynchrones ratées, réessayées avec la consigne la plus récente
+        uint32_t failedTries;
+        uint32_t minLatency_us;
+        uint32_t maxLatency_us;
+        uint64_t sumLatency_us;
+    };
+
+    /*
+     * asynchronousWrite :
+     *  - false : chaque consigne est écrite sur le bus I2C dans le thread appelant, avec jusqu'à 15 essais
+     *  - true : les consignes sont publiées sans attente dans un slot lock-free,
+     *            un thread dédié (lancé par init()) les écrit sur le bus dès que possible.
+     *            Une consigne pas encore écrite est écrasée par la suivante : seule la plus récente compte.
+     */
+    explicit Md22(I2cPinInit *i2cPins, bool is1motorRight, bool invertMotorRight, bool invertMotorLeft, uint32_t i2cFrequency,
+            bool asynchronousWrite);
     virtual ~Md22() {};
 
     msg_t i2cMasterTransmitTimeoutTimes(I2CDriver *i2cp,
@@ -31,19 +58,52 @@ public:
     void init();
     void setMotorRightSpeed(float percentage);
     void setMotorLeftSpeed(float percentage);
+    void setMotorsSpeed(float rightPercentage, float leftPercentage);
 
     inline int8_t getRightSpeed() { return m_lastRightConsign; }
     inline int8_t getLeftSpeed() { return m_lastLeftConsign; }
 
+    WriteStats getWriteStats();
+    void resetWriteStats();
+
 private:
+    int8_t computeConsign(float percentage, bool invert);
+    msg_t writeMotorsRegisters(int8_t rightConsign, int8_t leftConsign, sysinterval_t timeout, int times);
+    void publishConsigns(int8_t rightConsign, int8_t leftConsign);
+    void publishConsignsS(int8_t rightConsign, int8_t leftConsign);
+
+    static void asyncWriterThread(void *arg);
+    void asyncWriterLoop();
+
     I2CConfig m_i2cconfig;
     I2cPinInit m_i2cPinConf;
     bool m_invertMotorLeft;
     bool m_invertMotorRight;
     bool m_is1motorRight;
+    bool m_asynchronousWrite;
 
+    /*
+     * Dernières consignes, écrites par le thread d'asserv et par le shell (motorspeed) :
+     *  toujours modifiées sous chSysLock, une consigne d'un seul moteur relisant celle de l'autre.
+     */
     int8_t m_lastRightConsign;
     int8_t m_lastLeftConsign;
+
+    /*
+     * Slot de la dernière consigne publiée : numéro de séquence (16 bits), consigne gauche, consigne droite.
+     *  Un seul mot de 32 bits, donc écrit et lu atomiquement sans section critique.
+     *  L'instant de publication de chaque séquence est rangé dans m_publishTimes pour mesurer la latence.
+     */
+    static constexpr uint8_t PUBLISH_TIMES_SIZE = 8;
+    std::atomic<uint32_t> m_commandSlot;
+    std::atomic<uint32_t> m_publishSequence;
+    std::atomic<rtcnt_t> m_publishTimes[PUBLISH_TIMES_SIZE];
+    binary_semaphore_t m_newCommandSemaphore;
+
+    // Modifiées sous chSysLock, par le thread d'écriture et par resetWriteStats() depuis le shell
+    WriteStats m_writeStats;
+    uint32_t m_publishSequenceAtReset;
+    std::atomic<uint32_t> m_failedTries;
 };
 
 #endif /* MD22_H_ */
@@ -10,6 +10,16 @@ public:
 
     virtual void setMotorRightSpeed(float percentage) = 0;
     virtual void setMotorLeftSpeed(float percentage) = 0;
+
+    /*
+     * Consigne des deux moteurs d'un coup, utilisée par la boucle d'asserv.
+     *  Les contrôleurs qui peuvent écrire les deux moteurs ensemble (ex: Md22) la surchargent
+     */
+    virtual void setMotorsSpeed(float rightPercentage, float leftPercentage)
+    {
+        setMotorRightSpeed(rightPercentage);
+        setMotorLeftSpeed(leftPercentage);
+    }
 };
 
 #endif /* SRC_MOTORCONTROLLER_MOTORCONTROLLER_H_ */
@@ -65,8 +65,8 @@ void Vnh5019::setMotorRightSpeed(float percentage)
         reverse = 1;
     }
 
-    if (percentage > 100.0)
-        percentage = 100.0;
+    if (percentage > 100.0f)
+        percentage = 100.0f;
 
     if (percentage == 0)
     {
@@ -84,7 +84,7 @@ void Vnh5019::setMotorRightSpeed(float percentage)
         palClearPad(GPIOB, 5); //M1INB
     }
 
-    pwmEnableChannel(&PWMD8, 1, PWM_PERCENTAGE_TO_WIDTH(&PWMD8, (unsigned int)(10000*percentage/100.0))); // 10000 is 100% duty cycle
+    pwmEnableChannel(&PWMD8, 1, PWM_PERCENTAGE_TO_WIDTH(&PWMD8, (unsigned int)(10000*percentage/100.0f))); // 10000 is 100% duty cycle
 }
 
 void Vnh5019::setMotorLeftSpeed(float percentage)
@@ -99,8 +99,8 @@ void Vnh5019::setMotorLeftSpeed(float percentage)
         reverse = 1;
     }
 
-    if (percentage > 100.0)
-        percentage = 100.0;
+    if (percentage > 100.0f)
+        percentage = 100.0f;
 
     if (percentage == 0)
     {
@@ -118,6 +118,6 @@ void Vnh5019::setMotorLeftSpeed(float percentage)
         palClearPad(GPIOA, 9); //M2INB
     }
 
-    pwmEnableChannel(&PWMD4, 0, PWM_PERCENTAGE_TO_WIDTH(&PWMD4, (unsigned int )(10000 * percentage / 100.0))); // 10000 is 100% duty cycle
+    pwmEnableChannel(&PWMD4, 0, PWM_PERCENTAGE_TO_WIDTH(&PWMD4, (unsigned int )(10000 * percentage / 100.0f))); // 10000 is 100% duty cycle
 }
 
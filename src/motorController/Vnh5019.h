@@ -3,7 +3,7 @@
 
 #include "MotorController.h"
 
-class Vnh5019: public MotorController
+class Vnh5019 final : public MotorController
 {
 public:
     explicit Vnh5019(bool invertMotor1, bool invertMotor2);
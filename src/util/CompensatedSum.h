@@ -0,0 +1,52 @@
+#ifndef SRC_UTIL_COMPENSATEDSUM_H_
+#define SRC_UTIL_COMPENSATEDSUM_H_
+
+#include <cmath>
+
+/*
+ * Somme compensée (Kahan-Babuška, variante de Neumaier) en simple précision.
+ *
+ *  Pour les accumulateurs de la boucle d'asserv (position, cap, distance et angle parcourus),
+ *  qui additionnent des dizaines de milliers de petits incréments pendant un match :
+ *  l'erreur d'arrondi de chaque addition est cumulée dans m_compensation et rajoutée à la lecture,
+ *  ce qui donne la précision d'un accumulateur double sans calcul en double (émulé en logiciel sur la cible).
+ *  Contrairement à la somme de Kahan, l'erreur reste exacte quand la valeur ajoutée est plus grande que la somme
+ *  (retour du cap dans [-π;π] en ajoutant 2π à un cap proche de π).
+ *
+ *  Attention : -ffast-math (-fassociative-math) permet au compilateur de supprimer la compensation.
+ */
+class CompensatedSum
+{
+public:
+    explicit CompensatedSum(float value = 0)
+    {
+        set(value);
+    }
+
+    inline void add(float value)
+    {
+        float sum = m_sum + value;
+        if (fabsf(m_sum) >= fabsf(value))
+            m_compensation += (m_sum - sum) + value;
+        else
+            m_compensation += (value - sum) + m_sum;
+        m_sum = sum;
+    }
+
+    inline void set(float value)
+    {
+        m_sum = value;
+        m_compensation = 0;
+    }
+
+    inline float get() const
+    {
+        return m_sum + m_compensation;
+    }
+
+private:
+    float m_sum;
+    float m_compensation;
+};
+
+#endif /* SRC_UTIL_COMPENSATEDSUM_H_ */
@@ -0,0 +1,99 @@
+#include "LoopProfiler.h"
+
+#ifdef ENABLE_LOOP_PROFILER
+
+#include "ch.h"
+#include "hal.h"
+#include <chprintf.h>
+#include <cstring>
+
+LoopProfiler::LoopProfiler()
+{
+#ifndef HOST_BUILD
+    // Active le compteur de cycles du DWT
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    m_iterationStart = 0;
+    m_lapStart = 0;
+    m_resetRequested = false;
+    reset();
+}
+
+void LoopProfiler::reset()
+{
+    std::memset(m_stats, 0, sizeof(m_stats));
+    for (int i = 0; i < NB_STAGES; i++)
+        m_stats[i].min = UINT32_MAX;
+    m_resetRequested = false;
+}
+
+float LoopProfiler::ticksToMicroseconds(uint32_t ticks)
+{
+#ifdef HOST_BUILD
+    return float(ticks) / 1000.0f;
+#else
+    return float(ticks) / float(STM32_SYSCLK / 1000000);
+#endif
+}
+
+const char* LoopProfiler::stageName(Stage stage)
+{
+    switch (stage) {
+    case STAGE_ENCODERS:
+        return "encoders";
+    case STAGE_ODOMETRY:
+        return "odometry";
+    case STAGE_COMMAND_MANAGER:
+        return "commandManager";
+    case STAGE_PLL:
+        return "pll";
+    case STAGE_LIMITERS:
+        return "limiters";
+    case STAGE_SPEED_CONTROLLERS:
+        return "speedControllers";
+    case STAGE_MOTOR_OUTPUT:
+        return "motorOutput";
+    case STAGE_USB_STREAM_SETTERS:
+        return "usbStreamSetters";
+    case STAGE_USB_STREAM_SEND:
+        return "usbStreamSend";
+    case STAGE_TOTAL:
+        return "total";
+    default:
+        return "?";
+    }
+}
+
+void LoopProfiler::print(BaseSequentialStream *stream) const
+{
+    chprintf(stream, "%-18s %10s %10s %10s %10s (us)\r\n", "stage", "count", "min", "mean", "max");
+    for (int i = 0; i < NB_STAGES; i++)
+    {
+        const StageStats &stats = m_stats[i];
+        if (stats.count == 0)
+        {
+            chprintf(stream, "%-18s %10d\r\n", stageName(Stage(i)), 0);
+            continue;
+        }
+
+        float mean = ticksToMicroseconds(stats.sum / stats.count);
+        chprintf(stream, "%-18s %10u %10.2f %10.2f %10.2f\r\n", stageName(Stage(i)), (unsigned int) stats.count,
+                ticksToMicroseconds(stats.min), mean, ticksToMicroseconds(stats.max));
+    }
+
+    chprintf(stream, "histograms (bin i counts durations in [2^i;2^(i+1)[ ticks, 1 tick = %.4f us)\r\n", ticksToMicroseconds(1));
+    for (int i = 0; i < NB_STAGES; i++)
+    {
+        chprintf(stream, "%-18s", stageName(Stage(i)));
+        for (int bin = 0; bin < HISTOGRAM_SIZE; bin++)
+        {
+            if (m_stats[i].histogram[bin] != 0)
+                chprintf(stream, " %d:%u", bin, (unsigned int) m_stats[i].histogram[bin]);
+        }
+        chprintf(stream, "\r\n");
+    }
+}
+
+#endif /* ENABLE_LOOP_PROFILER */
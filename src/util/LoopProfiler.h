@@ -0,0 +1,151 @@
+#ifndef SRC_UTIL_LOOPPROFILER_H_
+#define SRC_UTIL_LOOPPROFILER_H_
+
+/*
+ * Profiler de la boucle d'asserv : mesure la durée de chaque étape de AsservMain::loopIteration().
+ *
+ *  Activé seulement si ENABLE_LOOP_PROFILER est défini (make PROFILER_ENABLE=true),
+ *   sinon les macros LOOP_PROFILER_* ne génèrent aucun code.
+ *
+ *  Sur la cible, la base de temps est le compteur de cycles du DWT (1 tick = 1 cycle CPU),
+ *   sur le host c'est l'horloge monotone (1 tick = 1 ns).
+ */
+
+#ifdef ENABLE_LOOP_PROFILER
+
+#include <cstdint>
+#ifdef HOST_BUILD
+#include <time.h>
+#else
+#include "hal.h"
+#endif
+
+struct BaseSequentialStream;
+
+class LoopProfiler
+{
+public:
+    typedef enum
+    {
+        STAGE_ENCODERS = 0,
+        STAGE_ODOMETRY,
+        STAGE_COMMAND_MANAGER,
+        STAGE_PLL,
+        STAGE_LIMITERS,
+        STAGE_SPEED_CONTROLLERS,
+        STAGE_MOTOR_OUTPUT,
+        STAGE_USB_STREAM_SETTERS,
+        STAGE_USB_STREAM_SEND,
+        STAGE_TOTAL,
+        NB_STAGES
+    } Stage;
+
+    // Histogramme en log2 : la case i compte les durées dans [2^i; 2^(i+1)[ ticks
+    static constexpr uint8_t HISTOGRAM_SIZE = 28;
+
+    struct StageStats
+    {
+        uint32_t count;
+        uint32_t min;
+        uint32_t max;
+        uint32_t last;
+        uint64_t sum;
+        uint32_t histogram[HISTOGRAM_SIZE];
+    };
+
+    LoopProfiler();
+
+    static inline uint32_t now()
+    {
+#ifdef HOST_BUILD
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint32_t) ((uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+#else
+        return DWT->CYCCNT;
+#endif
+    }
+
+    inline void startIteration()
+    {
+        if (m_resetRequested)
+            reset();
+        m_iterationStart = now();
+        m_lapStart = m_iterationStart;
+    }
+
+    // Clôture l'étape en cours, la suivante commence maintenant
+    inline void lap(Stage stage)
+    {
+        uint32_t t = now();
+        record(stage, t - m_lapStart);
+        m_lapStart = t;
+    }
+
+    inline void endIteration()
+    {
+        record(STAGE_TOTAL, m_lapStart - m_iterationStart);
+    }
+
+    inline const StageStats& getStats(Stage stage) const
+    {
+        return m_stats[stage];
+    }
+
+    /*
+     * La remise à zéro est faite par le thread d'asserv au début de l'itération suivante,
+     *  pour ne pas avoir à prendre de verrou dans la boucle
+     */
+    void requestReset()
+    {
+        m_resetRequested = true;
+    }
+
+    static float ticksToMicroseconds(uint32_t ticks);
+    static const char* stageName(Stage stage);
+
+    /*
+     * Affichage pour le shell. Lit les stats sans verrou pendant que le thread d'asserv
+     *  les met à jour : une ligne peut être incohérente d'une itération, sans conséquence.
+     */
+    void print(BaseSequentialStream *stream) const;
+
+private:
+    void reset();
+
+    inline void record(Stage stage, uint32_t duration)
+    {
+        StageStats &stats = m_stats[stage];
+        stats.count++;
+        stats.sum += duration;
+        stats.last = duration;
+        if (duration < stats.min)
+            stats.min = duration;
+        if (duration > stats.max)
+            stats.max = duration;
+
+        uint8_t bin = (duration == 0) ? 0 : (31 - __builtin_clz(duration));
+        if (bin >= HISTOGRAM_SIZE)
+            bin = HISTOGRAM_SIZE - 1;
+        stats.histogram[bin]++;
+    }
+
+    StageStats m_stats[NB_STAGES];
+    uint32_t m_iterationStart;
+    uint32_t m_lapStart;
+    volatile bool m_resetRequested;
+};
+
+#define LOOP_PROFILER_START(profiler) (profiler).startIteration()
+#define LOOP_PROFILER_LAP(profiler, stage) (profiler).lap(LoopProfiler::stage)
+#define LOOP_PROFILER_END(profiler) (profiler).endIteration()
+
+#else
+
+#define LOOP_PROFILER_START(profiler)
+#define LOOP_PROFILER_LAP(profiler, stage)
+#define LOOP_PROFILER_END(profiler)
+
+#endif /* ENABLE_LOOP_PROFILER */
+
+#endif /* SRC_UTIL_LOOPPROFILER_H_ */
@@ -1,9 +1,20 @@
 #ifndef SRC_UTIL_ASSERVMATH_H_
 #define SRC_UTIL_ASSERVMATH_H_
 
+#include <cmath>
+
+// La libc du host définit déjà M_PI, celle de la cible non (-std=c++11)
+#ifndef M_PI
 #define M_PI (3.14159265358979323846264338327950288)
+#endif
 #define M_2PI (2.0*M_PI)
 
+// Versions simple précision, pour le code de la boucle d'asserv : le FPU du Cortex-M4 ne calcule pas en double
+#define M_PI_F ((float) M_PI)
+#define M_2PI_F ((float) M_2PI)
+// Reste 2π - M_2PI_F (-1.7e-7) : M_2PI_F puis M_2PI_F_LOW ajoutés à une somme compensée retranchent 2π sans erreur
+#define M_2PI_F_LOW ((float) (M_2PI - (double) M_2PI_F))
+
 /*
  * Remap value contenue dans [inMin;inMax] dans [outMin;outMax]
  * à la façon de ce qui existe dans la lib arduino : https://www.arduino.cc/reference/en/language/functions/math/map/
@@ -26,7 +37,7 @@ inline float limit(float value, float minValue, float maxValue)
 
 inline float degToRad(float deg)
 {
-    return deg * M_PI/180.0;
+    return deg * (M_PI_F / 180.0f);
 }
 
 #endif /* SRC_UTIL_ASSERVMATH_H_ */
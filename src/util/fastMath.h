@@ -0,0 +1,141 @@
+#ifndef SRC_UTIL_FASTMATH_H_
+#define SRC_UTIL_FASTMATH_H_
+
+#include <cmath>
+#include <cstdint>
+#include "util/asservMath.h"
+
+/*
+ * Approximations polynomiales en simple précision des fonctions trigonométriques de la boucle d'asserv.
+ *
+ *  Réduction d'argument de Cody-Waite puis polynômes minimax de la Cephes : pas de errno, pas de réduction
+ *  exacte des très grands arguments comme la libm, et rien en double. Les erreurs max, mesurées par l'outil
+ *  host fastMathBench contre la libm en double, sont données pour chaque fonction (FAST_*_MAX_ERROR) :
+ *  l'outil échoue si elles sont dépassées.
+ *
+ *  Les fonctions loop*() sont celles appelées par l'odométrie et les Goto : approximations si ENABLE_FAST_MATH
+ *  est défini (make FAST_MATH_ENABLE=true), libm sinon.
+ */
+
+// Erreur absolue max de fastSinf / fastCosf / fastSinCosf pour |x| <= FAST_SINCOS_MAX_ARGUMENT
+#define FAST_SINCOS_MAX_ERROR (1.0e-7f)
+#define FAST_SINCOS_MAX_ARGUMENT (8192.0f)
+// Erreur absolue max de fastAtanf (rad)
+#define FAST_ATAN_MAX_ERROR (1.5e-7f)
+// Erreur absolue max de fastAtan2f (rad) : celle de fastAtanf, plus les arrondis de y/x et de ± π
+#define FAST_ATAN2_MAX_ERROR (3.0e-7f)
+// Erreur relative max de fastHypotf
+#define FAST_HYPOT_MAX_RELATIVE_ERROR (1.0e-7f)
+
+/*
+ * Sinus et cosinus de x, calculés ensemble : x est ramené dans [-π/4;π/4] par multiples de π/2 (Cody-Waite en trois
+ *  constantes, exact tant que |x| <= FAST_SINCOS_MAX_ARGUMENT), puis le quadrant choisit et signe les polynômes
+ */
+inline void fastSinCosf(float x, float *sin_x, float *cos_x)
+{
+    const float twoOverPi = 0.636619772367581f;
+    const float piOverTwo1 = 1.5703125f;                  // π/2 en trois parties, les premières exactes sur peu de bits
+    const float piOverTwo2 = 4.837512969970703125e-4f;
+    const float piOverTwo3 = 7.54978995489188216e-8f;
+
+    float quadrantFloat = x * twoOverPi;
+    int32_t quadrant = int32_t(quadrantFloat + (quadrantFloat >= 0 ? 0.5f : -0.5f));
+    float q = float(quadrant);
+    float r = ((x - q * piOverTwo1) - q * piOverTwo2) - q * piOverTwo3;
+
+    float z = r * r;
+    float sinR = r + r * z * (-1.6666654611e-1f + z * (8.3321608736e-3f + z * -1.9515295891e-4f));
+    float cosR = 1.0f - 0.5f * z + z * z * (4.166664568298827e-2f + z * (-1.388731625493765e-3f + z * 2.443315711809948e-5f));
+
+    switch (quadrant & 3)
+    {
+        case 0: *sin_x = sinR;  *cos_x = cosR;  break;
+        case 1: *sin_x = cosR;  *cos_x = -sinR; break;
+        case 2: *sin_x = -sinR; *cos_x = -cosR; break;
+        default: *sin_x = -cosR; *cos_x = sinR; break;
+    }
+}
+
+inline float fastSinf(float x)
+{
+    float sin_x, cos_x;
+    fastSinCosf(x, &sin_x, &cos_x);
+    return sin_x;
+}
+
+inline float fastCosf(float x)
+{
+    float sin_x, cos_x;
+    fastSinCosf(x, &sin_x, &cos_x);
+    return cos_x;
+}
+
+/*
+ * Arc tangente : |x| est ramené dans [0;tan(π/8)] par atan(x) = π/2 - atan(1/x) au delà de tan(3π/8)
+ *  et atan(x) = π/4 + atan((x-1)/(x+1)) entre les deux
+ */
+inline float fastAtanf(float x)
+{
+    float absX = fabsf(x);
+    float offset = 0;
+    if (absX > 2.414213562373095f)
+    {
+        offset = 0.5f * M_PI_F;
+        absX = -1.0f / absX;
+    }
+    else if (absX > 0.4142135623730950f)
+    {
+        offset = 0.25f * M_PI_F;
+        absX = (absX - 1.0f) / (absX + 1.0f);
+    }
+
+    float z = absX * absX;
+    float atanX = offset + ((((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z - 3.33329491539e-1f) * z * absX + absX);
+    return (x < 0) ? -atanX : atanX;
+}
+
+/*
+ * Arc tangente de y/x dans ]-π;π], comme atan2f (0 pour x = y = 0)
+ */
+inline float fastAtan2f(float y, float x)
+{
+    if (x == 0)
+    {
+        if (y == 0)
+            return 0;
+        return (y > 0) ? 0.5f * M_PI_F : -0.5f * M_PI_F;
+    }
+
+    float atanYX = fastAtanf(y / x);
+    if (x > 0)
+        return atanYX;
+    return (y >= 0) ? atanYX + M_PI_F : atanYX - M_PI_F;
+}
+
+/*
+ * Norme d'un vecteur en mm : pas de risque de dépassement, une seule racine (instruction vsqrt du FPU)
+ */
+inline float fastHypotf(float x, float y)
+{
+    return sqrtf(x * x + y * y);
+}
+
+#ifdef ENABLE_FAST_MATH
+
+inline void loopSinCosf(float x, float *sin_x, float *cos_x) { fastSinCosf(x, sin_x, cos_x); }
+inline float loopSinf(float x) { return fastSinf(x); }
+inline float loopCosf(float x) { return fastCosf(x); }
+inline float loopAtanf(float x) { return fastAtanf(x); }
+inline float loopAtan2f(float y, float x) { return fastAtan2f(y, x); }
+
+#else
+
+inline void loopSinCosf(float x, float *sin_x, float *cos_x) { *sin_x = sinf(x); *cos_x = cosf(x); }
+inline float loopSinf(float x) { return sinf(x); }
+inline float loopCosf(float x) { return cosf(x); }
+inline float loopAtanf(float x) { return atanf(x); }
+inline float loopAtan2f(float y, float x) { return atan2f(y, x); }
+
+#endif
+
+#endif /* SRC_UTIL_FASTMATH_H_ */